@@ -21,24 +21,49 @@
 #define OTRNG_ALLOC_PRIVATE
 
 #include "alloc.h"
+#include <pthread.h>
 #include <sodium.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Read and written atomically, as any thread can run out of memory */
 static void (*oom_handler)(void);
 
 API void otrng_register_out_of_memory_handler(
     /*@null@*/ void (*handler)(void)) /*@modifies internalState @*/ {
-  oom_handler = handler;
+  __atomic_store_n(&oom_handler, handler, __ATOMIC_RELEASE);
 }
 
+static void call_oom_handler(void) {
+  void (*handler)(void) = __atomic_load_n(&oom_handler, __ATOMIC_ACQUIRE);
+
+  if (handler != NULL) {
+    handler();
+  }
+}
+
+#ifdef OTRNG_TESTS
+static size_t allocations = 0;
+
+#define COUNT_ALLOCATION()                                                     \
+  (void)__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED)
+
+INTERNAL size_t otrng_allocations(void) {
+  return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+#else
+#define COUNT_ALLOCATION()
+#endif
+
 INTERNAL /*@only@*/ /*@notnull@*/ void *otrng_xmalloc(size_t size) {
   void *result = malloc(size);
+
+  COUNT_ALLOCATION();
+
   if (result == NULL) {
-    if (oom_handler != NULL) {
-      oom_handler();
-    }
+    call_oom_handler();
     fprintf(stderr, "fatal: memory exhausted (xmalloc of %lu bytes).\n", size);
     exit(EXIT_FAILURE);
   }
@@ -55,10 +80,11 @@ INTERNAL /*@only@*/ /*@notnull@*/ void *otrng_xmalloc_z(size_t size) {
 INTERNAL /*@only@*/ /*@notnull@*/ void *
 otrng_xrealloc(/*@only@*/ /*@null@*/ void *ptr, size_t size) {
   void *result = realloc(ptr, size);
+
+  COUNT_ALLOCATION();
+
   if (result == NULL) {
-    if (oom_handler != NULL) {
-      oom_handler();
-    }
+    call_oom_handler();
     fprintf(stderr, "fatal: memory exhausted (xrealloc of %lu bytes).\n", size);
     exit(EXIT_FAILURE);
   }
@@ -66,15 +92,240 @@ otrng_xrealloc(/*@only@*/ /*@null@*/ void *ptr, size_t size) {
   return result;
 }
 
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+
+/*
+ * Secure memory is used for almost every key and buffer on the data path, and
+ * sodium_malloc costs some system calls (to map, guard and lock pages) for
+ * each allocation. So small allocations are carved from larger regions
+ * instead, each one allocated with sodium_malloc (and so locked, and followed
+ * by a guard page), and holding slots of a single size class.
+ *
+ * Freed slots are wiped and kept in a free list for their class. Regions are
+ * never given back, so the memory used is that of the peak. Allocations larger
+ * than the biggest class go to sodium_malloc directly.
+ *
+ * Configure with --disable-secure-slab to use sodium_malloc for everything.
+ */
+#define SLAB_MIN_SHIFT 4 /* 16 bytes */
+#define SLAB_CLASSES 8   /* up to 2048 bytes */
+#define SLAB_MAX_SIZE ((size_t)1 << (SLAB_MIN_SHIFT + SLAB_CLASSES - 1))
+#define SLAB_REGION_SIZE ((size_t)64 * 1024)
+
+typedef struct slab_region_s {
+  uint8_t *start;
+  size_t slot_size;
+} slab_region_s;
+
+typedef struct slab_class_s {
+  /*@null@*/ void *free_list; /* linked through the first word of each slot */
+  /*@null@*/ uint8_t *fresh;  /* slots of the newest region never used yet */
+  /*@null@*/ uint8_t *fresh_end;
+} slab_class_s;
+
+static slab_class_s slab_classes[SLAB_CLASSES];
+
+/* sorted by start, so a slot can be found from its address */
+static /*@null@*/ slab_region_s *slab_regions = NULL;
+static size_t slab_regions_len = 0;
+static size_t slab_regions_cap = 0;
+static size_t slab_bytes_in_use = 0;
+
+/* A mutex rather than a spinlock, as adding a region holds it across
+ * sodium_malloc, which makes system calls */
+static pthread_mutex_t slab_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void slab_lock(void) { (void)pthread_mutex_lock(&slab_mutex); }
+
+static void slab_unlock(void) { (void)pthread_mutex_unlock(&slab_mutex); }
+
+static int slab_class_for(size_t size) {
+  int c = 0;
+
+  while (((size_t)1 << (SLAB_MIN_SHIFT + c)) < size) {
+    c++;
+  }
+
+  return c;
+}
+
+/* Returns the position of the region holding [p], or of the first region after
+ * it if there is none. */
+static size_t slab_region_search(const uint8_t *p) {
+  size_t low = 0, high = slab_regions_len;
+
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (slab_regions[mid].start + SLAB_REGION_SIZE <= p) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+static /*@null@*/ slab_region_s *slab_region_of(const void *p) {
+  const uint8_t *bytes = p;
+  size_t i = slab_region_search(bytes);
+
+  if (i < slab_regions_len && slab_regions[i].start <= bytes) {
+    return &slab_regions[i];
+  }
+
+  return NULL;
+}
+
+static otrng_bool slab_region_add(int c) {
+  slab_class_s *sc = &slab_classes[c];
+  uint8_t *start = sodium_malloc(SLAB_REGION_SIZE);
+  size_t i;
+
+  if (!start) {
+    return otrng_false;
+  }
+
+  if (slab_regions_len == slab_regions_cap) {
+    slab_regions_cap = slab_regions_cap ? slab_regions_cap * 2 : 8;
+    slab_regions = otrng_xrealloc(slab_regions,
+                                  slab_regions_cap * sizeof(slab_region_s));
+  }
+
+  i = slab_region_search(start);
+  memmove(slab_regions + i + 1, slab_regions + i,
+          (slab_regions_len - i) * sizeof(slab_region_s));
+  slab_regions[i].start = start;
+  slab_regions[i].slot_size = (size_t)1 << (SLAB_MIN_SHIFT + c);
+  slab_regions_len++;
+
+  memset(start, 0, SLAB_REGION_SIZE);
+  sc->fresh = start;
+  sc->fresh_end = start + SLAB_REGION_SIZE;
+
+  return otrng_true;
+}
+
+static /*@null@*/ void *slab_alloc(size_t size) {
+  int c = slab_class_for(size);
+  slab_class_s *sc = &slab_classes[c];
+  size_t slot_size = (size_t)1 << (SLAB_MIN_SHIFT + c);
+  void *result = NULL;
+
+  slab_lock();
+
+  if (sc->free_list) {
+    result = sc->free_list;
+    memcpy(&sc->free_list, result, sizeof(void *));
+    memset(result, 0, sizeof(void *));
+  } else if (sc->fresh != sc->fresh_end || slab_region_add(c)) {
+    result = sc->fresh;
+    sc->fresh += slot_size;
+  }
+
+  if (result) {
+    slab_bytes_in_use += slot_size;
+  }
+
+  slab_unlock();
+
+  return result;
+}
+
+static otrng_bool slab_free(void *p) {
+  slab_region_s *region;
+  slab_class_s *sc;
+
+  slab_lock();
+
+  region = slab_region_of(p);
+  if (!region) {
+    slab_unlock();
+    return otrng_false;
+  }
+
+  sc = &slab_classes[slab_class_for(region->slot_size)];
+
+  sodium_memzero(p, region->slot_size);
+  memcpy(p, &sc->free_list, sizeof(void *));
+  sc->free_list = p;
+  slab_bytes_in_use -= region->slot_size;
+
+  slab_unlock();
+
+  return otrng_true;
+}
+
+tstatic otrng_bool secure_slab_owns(const void *p) {
+  otrng_bool result;
+
+  slab_lock();
+  result = slab_region_of(p) != NULL;
+  slab_unlock();
+
+  return result;
+}
+
+#endif
+
+/* The secure allocations not carved from the slab, that are still live */
+static size_t direct_allocations = 0;
+
+API otrng_secure_memory_stats_s otrng_secure_memory_stats(void) {
+  otrng_secure_memory_stats_s stats;
+
+  memset(&stats, 0, sizeof(stats));
+
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+  slab_lock();
+  stats.slab_bytes = slab_regions_len * SLAB_REGION_SIZE;
+  stats.slab_bytes_in_use = slab_bytes_in_use;
+  slab_unlock();
+#endif
+
+  stats.direct_allocations =
+      __atomic_load_n(&direct_allocations, __ATOMIC_RELAXED);
+
+  return stats;
+}
+
 INTERNAL /*@only@*/ /*@notnull@*/ void *otrng_secure_alloc(size_t size) {
-  void *result = sodium_malloc(size);
+  void *result;
+
+  COUNT_ALLOCATION();
+
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+  if (size <= SLAB_MAX_SIZE) {
+    result = slab_alloc(size);
+    if (result) {
+      return result;
+    }
+  }
+#endif
+
+  result = sodium_malloc(size);
+  (void)__atomic_add_fetch(&direct_allocations, 1, __ATOMIC_RELAXED);
   memset(result, 0, size);
   return result;
 }
 
 INTERNAL /*@only@*/ /*@notnull@*/ void *otrng_secure_alloc_array(size_t count,
                                                                  size_t size) {
-  return sodium_allocarray(count, size);
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+  if (size > 0 && count > SIZE_MAX / size) {
+    return NULL;
+  }
+
+  return otrng_secure_alloc(count * size);
+#else
+  void *result = sodium_allocarray(count, size);
+
+  COUNT_ALLOCATION();
+  if (result) {
+    (void)__atomic_add_fetch(&direct_allocations, 1, __ATOMIC_RELAXED);
+  }
+  return result;
+#endif
 }
 
 INTERNAL void otrng_free(/*@notnull@*/ /*@only@*/ void *p) /*@modifies p@*/ {
@@ -83,6 +334,15 @@ INTERNAL void otrng_free(/*@notnull@*/ /*@only@*/ void *p) /*@modifies p@*/ {
 
 INTERNAL void
 otrng_secure_free(/*@notnull@*/ /*@only@*/ void *p) /*@modifies p@*/ {
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+  if (p && slab_free(p)) {
+    return;
+  }
+#endif
+
+  if (p) {
+    (void)__atomic_sub_fetch(&direct_allocations, 1, __ATOMIC_RELAXED);
+  }
   sodium_free(p);
 }
 
@@ -23,6 +23,7 @@
 
 #include <stddef.h>
 
+#include "error.h"
 #include "shared.h"
 
 /**
@@ -38,6 +39,19 @@
 API void otrng_register_out_of_memory_handler(
     /*@null@*/ void (*handler)(void)) /*@modifies internalState @*/;
 
+/* What the secure memory is used for */
+typedef struct otrng_secure_memory_stats_s {
+  size_t slab_bytes;         /* reserved by the slab, which never shrinks */
+  size_t slab_bytes_in_use;  /* in the slots that are allocated */
+  size_t direct_allocations; /* the live ones too big for the slab */
+} otrng_secure_memory_stats_s;
+
+/**
+ * @brief Tells how much secure (locked) memory is used. It can be called from
+ * any thread.
+ */
+API otrng_secure_memory_stats_s otrng_secure_memory_stats(void);
+
 INTERNAL /*@only@*/ /*@notnull@*/ void *otrng_xmalloc(size_t size);
 INTERNAL /*@only@*/ /*@notnull@*/ void *otrng_xmalloc_z(size_t size);
 
@@ -55,4 +69,21 @@ INTERNAL void otrng_secure_free(/*@notnull@*/ /*@only@*/ void *ptr);
 INTERNAL void otrng_secure_wipe(/*@notnull@*/ /*@only@*/ void *p,
                                 size_t size) /*@modifies p@*/;
 
+#ifdef OTRNG_TESTS
+/**
+ * @brief Returns how many allocations have been made so far through
+ * otrng_xmalloc, otrng_xrealloc and otrng_secure_alloc. Only counted in the
+ * tests and benchmarks.
+ */
+INTERNAL size_t otrng_allocations(void);
+#endif
+
+#ifdef OTRNG_ALLOC_PRIVATE
+
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+tstatic otrng_bool secure_slab_owns(const void *p);
+#endif
+
+#endif
+
 #endif // OTRNG_ALLOC_H
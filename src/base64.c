@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "base64.h"
 #include "alloc.h"
 
@@ -10,3 +12,74 @@ INTERNAL char *otrng_base64_encode(uint8_t *src, size_t src_len) {
 
   return dst;
 }
+
+static int base64_value(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 26;
+  }
+  if (c >= '0' && c <= '9') {
+    return c - '0' + 52;
+  }
+  if (c == '+') {
+    return 62;
+  }
+  if (c == '/') {
+    return 63;
+  }
+  return -1;
+}
+
+INTERNAL otrng_result otrng_base64_otr_decode_in_place(uint8_t **dst,
+                                                       size_t *dst_len,
+                                                       char *msg) {
+  uint8_t *out = (uint8_t *)msg;
+  const char *cursor, *end;
+  uint32_t group = 0;
+  int chars = 0;
+
+  if (!msg || strncmp(msg, "?OTR:", 5) != 0) {
+    return OTRNG_ERROR;
+  }
+
+  cursor = msg + 5;
+  end = strchr(cursor, '.');
+  if (!end) {
+    return OTRNG_ERROR;
+  }
+
+  /* Every 4 characters read become 3 bytes, so the output never catches up
+     with the input. As otrl_base64_decode, skip anything else, including the
+     padding. */
+  for (; cursor < end; cursor++) {
+    int value = base64_value(*cursor);
+    if (value < 0) {
+      continue;
+    }
+
+    group = (group << 6) | (uint32_t)value;
+    chars++;
+
+    if (chars == 4) {
+      *out++ = (uint8_t)(group >> 16);
+      *out++ = (uint8_t)(group >> 8);
+      *out++ = (uint8_t)group;
+      group = 0;
+      chars = 0;
+    }
+  }
+
+  if (chars == 2) {
+    *out++ = (uint8_t)(group >> 4);
+  } else if (chars == 3) {
+    *out++ = (uint8_t)(group >> 10);
+    *out++ = (uint8_t)(group >> 2);
+  }
+
+  *dst = (uint8_t *)msg;
+  *dst_len = out - (uint8_t *)msg;
+
+  return OTRNG_SUCCESS;
+}
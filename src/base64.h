@@ -12,10 +12,26 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "error.h"
 #include "shared.h"
 
 INTERNAL char *otrng_base64_encode(uint8_t *src, size_t src_len);
 
+/**
+ * @brief Decodes an encoded OTR message ("?OTR:<base64>.") over the message
+ * itself, so no buffer has to be allocated.
+ *
+ * @param [dst]     Set to where the decoded message starts, inside [msg].
+ * @param [dst_len] The length of the decoded message.
+ * @param [msg]     The encoded message. It is overwritten.
+ *
+ * @return OTRNG_ERROR if [msg] is not an encoded OTR message.
+ */
+INTERNAL otrng_result otrng_base64_otr_decode_in_place(uint8_t **dst,
+                                                       size_t *dst_len,
+                                                       char *msg);
+
 #endif
@@ -0,0 +1,229 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <gcrypt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "bench.h"
+#include "otrng.h"
+#include "random.h"
+
+#define BENCH_DEFAULT_ITERATIONS 200
+#define BENCH_DEFAULT_SEED UINT64_C(0x6f74726e67) /* "otrng" */
+
+typedef struct bench_group_s {
+  const char *name;
+  void (*run)(size_t iterations);
+} bench_group_s;
+
+static const bench_group_s bench_groups[] = {
+    {"catchup", bench_catchup},
+    {"dake", bench_dake},
+    {"data", bench_data},
+    {"dh", bench_dh},
+    {"fragment", bench_fragment},
+    {"persistence", bench_persistence},
+    {"prekey", bench_prekey},
+    {"profile", bench_profile},
+    {"proofs", bench_proofs},
+    {"rsig", bench_rsig},
+    {"smp", bench_smp},
+};
+
+/*
+ * The randomness the library asks for comes from a fixed sequence (splitmix64)
+ * instead of the system, so two runs do the same work. The randomness libgcrypt
+ * draws by itself (the DH keys, for one) is not affected.
+ */
+static uint64_t bench_random_state = BENCH_DEFAULT_SEED;
+
+static void bench_random_bytes(void *buffer, size_t size) {
+  uint8_t *out = buffer;
+  uint64_t z;
+  size_t n;
+
+  while (size > 0) {
+    bench_random_state += UINT64_C(0x9e3779b97f4a7c15);
+    z = bench_random_state;
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    z ^= z >> 31;
+
+    n = size < sizeof(z) ? size : sizeof(z);
+    memcpy(out, &z, n);
+    out += n;
+    size -= n;
+  }
+}
+
+void bench_seed(uint64_t seed) { bench_random_state = seed; }
+
+double bench_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int compare_latencies(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+double bench_run_prepared(const char *name, bench_op prepare, bench_op op,
+                          void *data, size_t iterations) {
+  double *latencies = otrng_xmalloc_z(iterations * sizeof(double));
+  double start, total = 0, ops_per_second;
+  size_t allocations = 0, before, i;
+
+  /* warm up caches and lazily initialized state */
+  if (prepare) {
+    prepare(data);
+  }
+  op(data);
+
+  for (i = 0; i < iterations; i++) {
+    if (prepare) {
+      prepare(data);
+    }
+
+    before = otrng_allocations();
+    start = bench_now();
+    op(data);
+    latencies[i] = bench_now() - start;
+    allocations += otrng_allocations() - before;
+
+    total += latencies[i];
+  }
+
+  qsort(latencies, iterations, sizeof(double), compare_latencies);
+
+  ops_per_second = total > 0 ? (double)iterations / total : 0;
+  printf("%-40s %8zu ops %12.1f ops/s %10.1f us p50 %10.1f us p99 "
+         "%8.1f allocs/op\n",
+         name, iterations, ops_per_second, latencies[iterations / 2] * 1e6,
+         latencies[(iterations * 99) / 100] * 1e6,
+         (double)allocations / (double)iterations);
+
+  otrng_free(latencies);
+
+  return ops_per_second;
+}
+
+double bench_run(const char *name, bench_op op, void *data, size_t iterations) {
+  return bench_run_prepared(name, NULL, op, data, iterations);
+}
+
+void bench_report(const char *name, double rate) {
+  printf("%-40s %12.1f /s\n", name, rate);
+}
+
+void bench_report_speedup(const char *name, double baseline, double candidate) {
+  if (baseline <= 0) {
+    return;
+  }
+
+  printf("%-40s %8.2fx\n", name, candidate / baseline);
+}
+
+static void usage(const char *program) {
+  size_t i;
+
+  fprintf(stderr, "usage: %s [-n iterations] [-s seed] [group...]\n",
+          program);
+  fprintf(stderr, "groups:");
+  for (i = 0; i < sizeof(bench_groups) / sizeof(bench_groups[0]); i++) {
+    fprintf(stderr, " %s", bench_groups[i].name);
+  }
+  fprintf(stderr, "\n");
+}
+
+static int selected(const char *group, int argc, char **argv, int first) {
+  int i;
+
+  if (first >= argc) {
+    return 1;
+  }
+
+  for (i = first; i < argc; i++) {
+    if (strcmp(argv[i], group) == 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  size_t iterations = BENCH_DEFAULT_ITERATIONS;
+  uint64_t seed = BENCH_DEFAULT_SEED;
+  size_t i;
+  int first = 1;
+
+  while (first < argc && argv[first][0] == '-') {
+    if (first + 1 < argc && strcmp(argv[first], "-n") == 0) {
+      long n = strtol(argv[first + 1], NULL, 10);
+      if (n <= 0) {
+        usage(argv[0]);
+        return 2;
+      }
+      iterations = (size_t)n;
+    } else if (first + 1 < argc && strcmp(argv[first], "-s") == 0) {
+      seed = strtoull(argv[first + 1], NULL, 0);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    first += 2;
+  }
+
+  if (!gcry_check_version(GCRYPT_VERSION)) {
+    return 2;
+  }
+
+  gcry_control(GCRYCTL_INIT_SECMEM, 0);
+  gcry_control(GCRYCTL_RESUME_SECMEM_WARN);
+  gcry_control(GCRYCTL_ENABLE_QUICK_RANDOM, 0);
+  gcry_control(GCRYCTL_INITIALIZATION_FINISHED);
+
+  OTRNG_INIT;
+
+  (void)otrng_set_current_randomness(bench_random_bytes);
+
+  for (i = 0; i < sizeof(bench_groups) / sizeof(bench_groups[0]); i++) {
+    if (selected(bench_groups[i].name, argc, argv, first)) {
+      bench_seed(seed);
+      bench_groups[i].run(iterations);
+    }
+  }
+
+  (void)otrng_set_current_randomness(NULL);
+
+  OTRNG_FREE;
+
+  return 0;
+}
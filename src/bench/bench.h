@@ -0,0 +1,129 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OTRNG_BENCH_H
+#define OTRNG_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "client.h"
+
+typedef void (*bench_op)(void *data);
+
+/**
+ * @brief Returns a monotonic timestamp, in seconds.
+ */
+double bench_now(void);
+
+/**
+ * @brief Runs [op] [iterations] times and prints how fast it was: the
+ * operations per second, the median and 99th percentile latency, and how many
+ * allocations the library made per operation.
+ *
+ * @param [name]        The name of the benchmark, as "group/name".
+ * @param [op]          The operation to measure.
+ * @param [data]        The argument passed to [op].
+ * @param [iterations]  How many times to run [op].
+ *
+ * @return The number of operations per second.
+ */
+double bench_run(const char *name, bench_op op, void *data, size_t iterations);
+
+/**
+ * @brief Runs [op] like bench_run, but calls [prepare] before every run of
+ * [op]. The time and allocations of [prepare] are not measured.
+ *
+ * @param [name]        The name of the benchmark, as "group/name".
+ * @param [prepare]     The operation that sets up the next run of [op].
+ * @param [op]          The operation to measure.
+ * @param [data]        The argument passed to [prepare] and [op].
+ * @param [iterations]  How many times to run [op].
+ *
+ * @return The number of operations per second.
+ */
+double bench_run_prepared(const char *name, bench_op prepare, bench_op op,
+                          void *data, size_t iterations);
+
+/**
+ * @brief Prints a rate measured by the benchmark itself.
+ *
+ * @param [name]   The name of the measurement, as "group/name".
+ * @param [rate]   How many things happened per second.
+ */
+void bench_report(const char *name, double rate);
+
+/**
+ * @brief Prints how much faster [candidate] was than [baseline].
+ */
+void bench_report_speedup(const char *name, double baseline, double candidate);
+
+/**
+ * @brief Restarts the deterministic randomness the benchmarks use from
+ * [seed], so every group sees the same keys whatever ran before it.
+ */
+void bench_seed(uint64_t seed);
+
+/**
+ * @brief Creates a client, in a global state of its own, with keys and
+ * profiles derived from [byte].
+ *
+ * @param [account] The account of the client.
+ * @param [byte]    A different value for each client.
+ */
+otrng_client_s *bench_client_new(const char *account, int byte);
+
+/**
+ * @brief Frees the client and its global state.
+ */
+void bench_client_free(otrng_client_s *client);
+
+/**
+ * @brief Creates a protocol state for the client, that only allows OTRv4.
+ */
+otrng_s *bench_conversation_new(otrng_client_s *client);
+
+/**
+ * @brief Runs an interactive DAKE, started by [alice].
+ *
+ * @return OTRNG_SUCCESS if both of them ended in the encrypted state.
+ */
+otrng_result bench_interactive_dake(otrng_s *alice, otrng_s *bob);
+
+/**
+ * @brief Delivers [msg] to [to].
+ *
+ * @return What [to] has to send back, if anything. Free it with otrng_free.
+ */
+/*@null@*/ char *bench_deliver(const char *msg, otrng_s *to);
+
+void bench_catchup(size_t iterations);
+void bench_dake(size_t iterations);
+void bench_data(size_t iterations);
+void bench_dh(size_t iterations);
+void bench_fragment(size_t iterations);
+void bench_persistence(size_t iterations);
+void bench_prekey(size_t iterations);
+void bench_profile(size_t iterations);
+void bench_proofs(size_t iterations);
+void bench_rsig(size_t iterations);
+void bench_smp(size_t iterations);
+
+#endif
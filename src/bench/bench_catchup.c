@@ -0,0 +1,83 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "keccak.h"
+#include "key_management.h"
+#include "random.h"
+
+/* how far ahead of the receiving chain the message that arrives is */
+#define BENCH_CATCHUP_SKIPPED 1000
+
+typedef struct catchup_bench_s {
+  k_receiving_chain chain_key;
+  ec_point their_ecdh;
+} catchup_bench_s;
+
+static void catch_up(void *data) {
+  catchup_bench_s *b = data;
+  key_manager_s *manager = otrng_key_manager_new();
+  receiving_ratchet_s *ratchet;
+  k_msg_enc enc_key;
+  k_msg_mac mac_key;
+
+  memcpy(manager->current->chain_r, b->chain_key, CHAIN_KEY_BYTES);
+  ratchet = otrng_receiving_ratchet_new(manager);
+  otrng_ec_point_copy(ratchet->their_ecdh, b->their_ecdh);
+
+  (void)otrng_key_manager_derive_chain_keys(
+      enc_key, mac_key, manager, ratchet, BENCH_CATCHUP_SKIPPED,
+      BENCH_CATCHUP_SKIPPED, 'r', NULL);
+
+  otrng_receiving_ratchet_destroy(ratchet);
+  otrng_key_manager_free(manager);
+}
+
+void bench_catchup(size_t iterations) {
+  catchup_bench_s b;
+  char label[64];
+  double baseline, rate;
+  size_t lanes;
+
+  /* every run derives a thousand keys */
+  iterations = iterations / 10 + 1;
+
+  random_bytes(b.chain_key, CHAIN_KEY_BYTES);
+  otrng_ec_point_copy(b.their_ecdh, goldilocks_448_point_base);
+
+  otrng_keccak_limit_lanes(1);
+  snprintf(label, sizeof(label), "catchup/skip-%d/lanes-1",
+           BENCH_CATCHUP_SKIPPED);
+  baseline = bench_run(label, catch_up, &b, iterations);
+
+  otrng_keccak_limit_lanes(OTRNG_KECCAK_MAX_LANES);
+  lanes = otrng_keccak_lanes();
+  if (lanes > 1) {
+    snprintf(label, sizeof(label), "catchup/skip-%d/lanes-%zu",
+             BENCH_CATCHUP_SKIPPED, lanes);
+    rate = bench_run(label, catch_up, &b, iterations);
+
+    snprintf(label, sizeof(label), "catchup/lanes-%zu/speedup", lanes);
+    bench_report_speedup(label, baseline, rate);
+  }
+}
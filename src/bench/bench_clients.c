@@ -0,0 +1,191 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "messaging.h"
+
+/* The keys, profiles and fingerprints live in memory only: the callbacks that
+   would load or store them do nothing */
+static void do_nothing(otrng_client_s *client) { (void)client; }
+
+static void create_prekey_profile(otrng_client_s *client) {
+  otrng_prekey_profile_s *profile =
+      otrng_client_build_default_prekey_profile(client);
+
+  if (profile) {
+    (void)otrng_client_add_prekey_profile(client, profile);
+    otrng_prekey_profile_free(profile);
+  }
+}
+
+static void create_client_profile(otrng_client_s *client) {
+  otrng_client_profile_s *profile =
+      otrng_client_build_default_client_profile(client);
+
+  if (profile) {
+    (void)otrng_client_add_client_profile(client, profile);
+    otrng_client_profile_free(profile);
+  }
+}
+
+static otrng_shared_session_state_s
+get_shared_session_state(const otrng_s *conv) {
+  otrng_shared_session_state_s result = {
+      .identifier1 = otrng_xstrdup("alice"),
+      .identifier2 = otrng_xstrdup("bob"),
+      .password = NULL,
+  };
+
+  (void)conv;
+
+  return result;
+}
+
+static void display_error_message(const otrng_error_event event,
+                                  string_p *to_display, const otrng_s *conv) {
+  (void)event;
+  (void)to_display;
+  (void)conv;
+}
+
+static otrng_policy_s define_policy(otrng_client_s *client) {
+  otrng_policy_s policy = {.allows = OTRNG_ALLOW_V4,
+                           .type = OTRNG_POLICY_ALWAYS};
+  (void)client;
+
+  return policy;
+}
+
+static otrng_bool should_not_heartbeat(long last_sent) {
+  (void)last_sent;
+
+  return otrng_false;
+}
+
+static const otrng_client_callbacks_s bench_callbacks = {
+    .create_instag = do_nothing,
+    .create_privkey_v3 = do_nothing,
+    .create_privkey_v4 = do_nothing,
+    .create_forging_key = do_nothing,
+    .create_client_profile = create_client_profile,
+    .store_expired_client_profile = do_nothing,
+    .load_expired_client_profile = do_nothing,
+    .store_expired_prekey_profile = do_nothing,
+    .load_expired_prekey_profile = do_nothing,
+    .create_prekey_profile = create_prekey_profile,
+    .display_error_message = display_error_message,
+    .get_shared_session_state = get_shared_session_state,
+    .load_privkey_v4 = do_nothing,
+    .load_privkey_v3 = do_nothing,
+    .load_client_profile = do_nothing,
+    .load_prekey_profile = do_nothing,
+    .store_client_profile = do_nothing,
+    .store_prekey_profile = do_nothing,
+    .load_prekey_messages = do_nothing,
+    .store_prekey_messages = do_nothing,
+    .store_privkey_v4 = do_nothing,
+    .store_privkey_v3 = do_nothing,
+    .load_forging_key = do_nothing,
+    .store_forging_key = do_nothing,
+    .define_policy = define_policy,
+    .store_fingerprints_v4 = do_nothing,
+    .load_fingerprints_v4 = do_nothing,
+    .store_fingerprints_v3 = do_nothing,
+    .load_fingerprints_v3 = do_nothing,
+};
+
+otrng_client_s *bench_client_new(const char *account, int byte) {
+  const otrng_client_id_s client_id = {.protocol = "bench",
+                                       .account = account};
+  uint8_t long_term_priv[ED448_PRIVATE_BYTES] = {0};
+  uint8_t forging_sym[ED448_PRIVATE_BYTES] = {0};
+  otrng_client_s *client = otrng_client_new(client_id);
+  otrng_keypair_s *forging = otrng_keypair_new();
+
+  client->global_state = otrng_global_state_new(&bench_callbacks, otrng_false);
+  otrng_global_state_add_client(client->global_state, client);
+
+  long_term_priv[0] = (uint8_t)(byte + 0xA);
+  forging_sym[0] = (uint8_t)(byte + 0xD);
+
+  (void)otrng_client_add_private_key_v4(client, long_term_priv);
+  (void)otrng_keypair_generate(forging, forging_sym);
+  (void)otrng_client_add_forging_key(client, forging->pub);
+  otrng_keypair_free(forging);
+
+  (void)otrng_client_add_instance_tag(client, 0x100 + (unsigned int)byte);
+  client->client_profile = otrng_client_build_default_client_profile(client);
+  client->should_heartbeat = should_not_heartbeat;
+
+  return client;
+}
+
+void bench_client_free(otrng_client_s *client) {
+  /* the global state frees its clients */
+  otrng_global_state_free(client->global_state);
+}
+
+otrng_s *bench_conversation_new(otrng_client_s *client) {
+  otrng_policy_s policy = {.allows = OTRNG_ALLOW_V4,
+                           .type = OTRNG_POLICY_ALWAYS};
+
+  return otrng_new(client, policy);
+}
+
+char *bench_deliver(const char *msg, otrng_s *to) {
+  otrng_response_s *response = otrng_response_new();
+  char *reply;
+
+  (void)otrng_receive_message(response, msg, to);
+
+  reply = response->to_send;
+  response->to_send = NULL;
+  otrng_response_free(response);
+
+  return reply;
+}
+
+otrng_result bench_interactive_dake(otrng_s *alice, otrng_s *bob) {
+  char *msg = NULL, *reply;
+  int turn = 0;
+
+  if (otrng_failed(otrng_build_query_message(&msg, "", alice))) {
+    return OTRNG_ERROR;
+  }
+
+  /* the query, identity, auth-r and auth-i messages, and the data message
+     the initiator sends at the end */
+  while (msg) {
+    reply = bench_deliver(msg, turn % 2 == 0 ? bob : alice);
+    otrng_free(msg);
+    msg = reply;
+    turn++;
+  }
+
+  if (alice->state != OTRNG_STATE_ENCRYPTED_MESSAGES ||
+      bob->state != OTRNG_STATE_ENCRYPTED_MESSAGES) {
+    return OTRNG_ERROR;
+  }
+
+  return OTRNG_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+
+typedef struct dake_bench_s {
+  otrng_client_s *alice_client;
+  otrng_client_s *bob_client;
+  otrng_s *alice;
+  otrng_s *bob;
+  prekey_ensemble_s *ensemble;
+  int failures;
+} dake_bench_s;
+
+static void new_conversations(dake_bench_s *b) {
+  otrng_conn_free(b->alice);
+  otrng_conn_free(b->bob);
+  b->alice = bench_conversation_new(b->alice_client);
+  b->bob = bench_conversation_new(b->bob_client);
+}
+
+static void interactive(void *data) {
+  dake_bench_s *b = data;
+
+  if (otrng_failed(bench_interactive_dake(b->alice, b->bob))) {
+    b->failures++;
+  }
+}
+
+static void prepare_interactive(void *data) { new_conversations(data); }
+
+static void non_interactive(void *data) {
+  dake_bench_s *b = data;
+  char *msg = NULL;
+
+  /* Alice sends the Non-Interactive-Auth message, and Bob receives it */
+  if (otrng_failed(
+          otrng_send_non_interactive_auth(&msg, b->ensemble, b->alice))) {
+    b->failures++;
+    return;
+  }
+
+  otrng_free(bench_deliver(msg, b->bob));
+  otrng_free(msg);
+
+  if (b->bob->state != OTRNG_STATE_WAITING_DAKE_DATA_MESSAGE) {
+    b->failures++;
+  }
+}
+
+static void prepare_non_interactive(void *data) {
+  dake_bench_s *b = data;
+
+  /* What Bob publishes and Alice would retrieve from the prekey server */
+  otrng_prekey_ensemble_free(b->ensemble);
+  new_conversations(b);
+  b->ensemble = otrng_build_prekey_ensemble(b->bob);
+}
+
+void bench_dake(size_t iterations) {
+  dake_bench_s b = {NULL, NULL, NULL, NULL, NULL, 0};
+
+  b.alice_client = bench_client_new("alice", 1);
+  b.bob_client = bench_client_new("bob", 2);
+
+  /* every run is several ring signatures and key exchanges */
+  iterations = iterations / 4 + 1;
+
+  bench_run_prepared("dake/interactive", prepare_interactive, interactive, &b,
+                     iterations);
+  bench_run_prepared("dake/non-interactive", prepare_non_interactive,
+                     non_interactive, &b, iterations);
+
+  if (b.failures > 0) {
+    fprintf(stderr, "dake: %d DAKEs failed\n", b.failures);
+  }
+
+  otrng_prekey_ensemble_free(b.ensemble);
+  otrng_conn_free(b.alice);
+  otrng_conn_free(b.bob);
+  bench_client_free(b.alice_client);
+  bench_client_free(b.bob_client);
+}
@@ -0,0 +1,171 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define BENCH_DATA_MAX_SKIPPED 500
+
+typedef struct data_bench_s {
+  otrng_client_s *alice_client;
+  otrng_client_s *bob_client;
+  otrng_s *alice;
+  otrng_s *bob;
+
+  char *plaintext;
+  char *sent[BENCH_DATA_MAX_SKIPPED + 1];
+  size_t sent_len;
+  size_t skipped;
+  int failures;
+} data_bench_s;
+
+static void send_from(data_bench_s *b, otrng_s *from) {
+  char *msg = NULL;
+
+  if (otrng_failed(otrng_send_message(&msg, b->plaintext, NULL, 0, from))) {
+    b->failures++;
+    return;
+  }
+
+  b->sent[b->sent_len++] = msg;
+}
+
+static void receive_all(data_bench_s *b, otrng_s *to) {
+  size_t i;
+
+  for (i = 0; i < b->sent_len; i++) {
+    otrng_free(bench_deliver(b->sent[i], to));
+    otrng_free(b->sent[i]);
+  }
+  b->sent_len = 0;
+}
+
+static void send_message(void *data) {
+  data_bench_s *b = data;
+
+  send_from(b, b->alice);
+  while (b->sent_len > 0) {
+    otrng_free(b->sent[--b->sent_len]);
+  }
+}
+
+static void prepare_receive(void *data) {
+  data_bench_s *b = data;
+
+  send_from(b, b->alice);
+}
+
+static void receive_message(void *data) {
+  data_bench_s *b = data;
+
+  receive_all(b, b->bob);
+}
+
+/* Every time the direction changes, the one who sends ratchets: there is a
+   new ECDH key, and a new DH key every third time */
+static void round_trip(void *data) {
+  data_bench_s *b = data;
+
+  send_from(b, b->alice);
+  receive_all(b, b->bob);
+  send_from(b, b->bob);
+  receive_all(b, b->alice);
+}
+
+static void prepare_out_of_order(void *data) {
+  data_bench_s *b = data;
+  size_t i;
+
+  for (i = 0; i <= b->skipped; i++) {
+    send_from(b, b->alice);
+  }
+}
+
+/* The newest message arrives first, so the keys for the others are derived
+   and stored; then they arrive, from the newest to the oldest */
+static void receive_out_of_order(void *data) {
+  data_bench_s *b = data;
+
+  while (b->sent_len > 0) {
+    b->sent_len--;
+    otrng_free(bench_deliver(b->sent[b->sent_len], b->bob));
+    otrng_free(b->sent[b->sent_len]);
+  }
+}
+
+static void run_data(data_bench_s *b, size_t iterations) {
+  static const size_t sizes[] = {16, 256, 4096};
+  static const size_t skips[] = {10, 100, BENCH_DATA_MAX_SKIPPED};
+  char label[64];
+  size_t i;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    b->plaintext = otrng_xmalloc_z(sizes[i] + 1);
+    memset(b->plaintext, 'a', sizes[i]);
+
+    snprintf(label, sizeof(label), "data/send-%zu", sizes[i]);
+    bench_run(label, send_message, b, iterations);
+
+    snprintf(label, sizeof(label), "data/receive-%zu", sizes[i]);
+    bench_run_prepared(label, prepare_receive, receive_message, b, iterations);
+
+    otrng_free(b->plaintext);
+  }
+
+  b->plaintext = otrng_xstrdup("hi");
+
+  bench_run("data/ratchet-round-trip", round_trip, b, iterations);
+
+  for (i = 0; i < sizeof(skips) / sizeof(skips[0]); i++) {
+    b->skipped = skips[i];
+    snprintf(label, sizeof(label), "data/out-of-order-%zu", b->skipped);
+    bench_run_prepared(label, prepare_out_of_order, receive_out_of_order, b,
+                       iterations * 10 / b->skipped + 1);
+  }
+
+  otrng_free(b->plaintext);
+
+  if (b->failures > 0) {
+    fprintf(stderr, "data: %d messages could not be sent\n", b->failures);
+  }
+}
+
+void bench_data(size_t iterations) {
+  data_bench_s b;
+
+  memset(&b, 0, sizeof(b));
+  b.alice_client = bench_client_new("alice", 1);
+  b.bob_client = bench_client_new("bob", 2);
+  b.alice = bench_conversation_new(b.alice_client);
+  b.bob = bench_conversation_new(b.bob_client);
+
+  if (otrng_failed(bench_interactive_dake(b.alice, b.bob))) {
+    fprintf(stderr, "data: the DAKE failed\n");
+  } else {
+    run_data(&b, iterations);
+  }
+
+  otrng_conn_free(b.alice);
+  otrng_conn_free(b.bob);
+  bench_client_free(b.alice_client);
+  bench_client_free(b.bob_client);
+}
@@ -0,0 +1,83 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define OTRNG_DH_PRIVATE
+
+#include <gcrypt.h>
+
+#include "bench.h"
+#include "dh.h"
+
+typedef struct dh_bench_s {
+  gcry_mpi_t exponent;
+  gcry_mpi_t result;
+} dh_bench_s;
+
+static void powm_generator(void *data) {
+  dh_bench_s *b = data;
+  gcry_mpi_powm(b->result, otrng_dh_mpi_generator(), b->exponent,
+                otrng_dh_modulus_p());
+}
+
+static void comb_generator(void *data) {
+  dh_bench_s *b = data;
+  otrng_dh_calculate_public_key(b->result, b->exponent);
+}
+
+static void keypair_generate(void *data) {
+  dh_keypair_s keypair;
+  (void)data;
+
+  otrng_dh_keypair_generate(&keypair);
+  otrng_dh_keypair_destroy(&keypair);
+}
+
+static void compare(const char *name, unsigned int exponent_bits,
+                    size_t iterations) {
+  dh_bench_s b;
+  char label[64];
+  double powm, comb;
+
+  b.exponent = gcry_mpi_new(exponent_bits);
+  b.result = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  gcry_mpi_randomize(b.exponent, exponent_bits, GCRY_WEAK_RANDOM);
+  gcry_mpi_set_bit(b.exponent, exponent_bits - 1);
+
+  snprintf(label, sizeof(label), "dh/%s/powm", name);
+  powm = bench_run(label, powm_generator, &b, iterations);
+
+  snprintf(label, sizeof(label), "dh/%s/comb", name);
+  comb = bench_run(label, comb_generator, &b, iterations);
+
+  snprintf(label, sizeof(label), "dh/%s/speedup", name);
+  bench_report_speedup(label, powm, comb);
+
+  gcry_mpi_release(b.exponent);
+  gcry_mpi_release(b.result);
+}
+
+void bench_dh(size_t iterations) {
+  /* private keys */
+  compare("public-key", DH_KEY_SIZE * 8, iterations);
+  /* values mod q, as in the prekey proofs */
+  compare("full-exponent", DH3072_MOD_LEN_BITS - 1, iterations);
+
+  bench_run("dh/keypair-generate", keypair_generate, NULL, iterations);
+}
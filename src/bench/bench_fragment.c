@@ -0,0 +1,123 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define OTRNG_FRAGMENT_PRIVATE
+
+#include "alloc.h"
+#include "bench.h"
+#include "fragment.h"
+
+/* a common limit for the size of the messages in chat networks */
+#define BENCH_FRAGMENT_MAX_SIZE 250
+
+typedef struct fragment_bench_s {
+  char *msg;
+  otrng_message_to_send_s *fragments;
+  fragment_store_s store;
+  otrng_bool reversed;
+  int failures;
+} fragment_bench_s;
+
+static void split(void *data) {
+  fragment_bench_s *b = data;
+  otrng_message_to_send_s *fragments =
+      otrng_xmalloc_z(sizeof(otrng_message_to_send_s));
+
+  if (otrng_failed(otrng_fragment_message_contiguous(
+          BENCH_FRAGMENT_MAX_SIZE, fragments, 0x101, 0x102, b->msg))) {
+    b->failures++;
+  }
+
+  otrng_message_free(fragments);
+}
+
+static void prepare_join(void *data) {
+  fragment_bench_s *b = data;
+
+  otrng_message_free(b->fragments);
+  b->fragments = otrng_xmalloc_z(sizeof(otrng_message_to_send_s));
+  if (otrng_failed(otrng_fragment_message_contiguous(
+          BENCH_FRAGMENT_MAX_SIZE, b->fragments, 0x101, 0x102, b->msg))) {
+    b->failures++;
+  }
+}
+
+static void join(void *data) {
+  fragment_bench_s *b = data;
+  char *unfragmented = NULL;
+  int i, piece;
+
+  for (i = 0; i < b->fragments->total; i++) {
+    piece = b->reversed ? b->fragments->total - 1 - i : i;
+    if (otrng_failed(otrng_unfragment_message(
+            &unfragmented, &b->store, b->fragments->pieces[piece], 0x102))) {
+      b->failures++;
+      return;
+    }
+  }
+
+  if (!unfragmented || strcmp(unfragmented, b->msg) != 0) {
+    b->failures++;
+  }
+  otrng_free(unfragmented);
+}
+
+void bench_fragment(size_t iterations) {
+  static const size_t sizes[] = {1000, 10000};
+  fragment_bench_s b;
+  char label[64];
+  size_t i, len;
+
+  memset(&b, 0, sizeof(b));
+  otrng_fragment_store_init(&b.store);
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    /* what an encoded data message looks like */
+    len = sizes[i];
+    b.msg = otrng_xmalloc_z(len + 1);
+    memset(b.msg, 'A', len);
+    memcpy(b.msg, "?OTR:", 5);
+    b.msg[len - 1] = '.';
+
+    snprintf(label, sizeof(label), "fragment/split-%zu", len);
+    bench_run(label, split, &b, iterations);
+
+    b.reversed = otrng_false;
+    snprintf(label, sizeof(label), "fragment/join-%zu", len);
+    bench_run_prepared(label, prepare_join, join, &b, iterations);
+
+    b.reversed = otrng_true;
+    snprintf(label, sizeof(label), "fragment/join-reversed-%zu", len);
+    bench_run_prepared(label, prepare_join, join, &b, iterations);
+
+    otrng_free(b.msg);
+  }
+
+  if (b.failures > 0) {
+    fprintf(stderr, "fragment: %d messages were not put back together\n",
+            b.failures);
+  }
+
+  otrng_message_free(b.fragments);
+  otrng_fragment_store_destroy(&b.store);
+}
@@ -0,0 +1,109 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "messaging.h"
+
+typedef struct persistence_bench_s {
+  otrng_client_s *client;
+  FILE *file;
+  size_t count;
+  int failures;
+} persistence_bench_s;
+
+static void write_fingerprints(FILE *file, size_t count) {
+  size_t i;
+  int j;
+
+  for (i = 0; i < count; i++) {
+    fprintf(file, "peer%zu@example.org\talice\tbench\t", i);
+    for (j = 0; j < FPRINT_LEN_BYTES; j++) {
+      fprintf(file, "%02x", (unsigned int)((i * 131 + (size_t)j * 7) & 0xff));
+    }
+    fprintf(file, "\t%s\n", i % 2 ? "trusted" : "");
+  }
+}
+
+static void rewind_file(void *data) {
+  persistence_bench_s *b = data;
+
+  rewind(b->file);
+}
+
+/* Loading replaces the fingerprints that were loaded before */
+static void load_fingerprints(void *data) {
+  persistence_bench_s *b = data;
+  otrng_global_state_s *gs = b->client->global_state;
+
+  if (otrng_failed(otrng_global_state_fingerprints_v4_read_from(gs, b->file,
+                                                                NULL))) {
+    b->failures++;
+  }
+}
+
+static void store_fingerprints(void *data) {
+  persistence_bench_s *b = data;
+  otrng_global_state_s *gs = b->client->global_state;
+
+  if (otrng_failed(otrng_global_state_fingerprints_v4_write_to(gs, b->file))) {
+    b->failures++;
+  }
+}
+
+void bench_persistence(size_t iterations) {
+  static const size_t counts[] = {100, 1000};
+  persistence_bench_s b;
+  char label[64];
+  size_t i;
+
+  b.client = bench_client_new("alice", 1);
+  b.failures = 0;
+
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    b.count = counts[i];
+    b.file = tmpfile();
+    if (!b.file) {
+      fprintf(stderr, "persistence: no temporary file\n");
+      break;
+    }
+    write_fingerprints(b.file, b.count);
+
+    snprintf(label, sizeof(label), "persistence/load-fingerprints-%zu",
+             b.count);
+    bench_run_prepared(label, rewind_file, load_fingerprints, &b,
+                       iterations * 100 / b.count + 1);
+
+    /* with the fingerprints that were just loaded */
+    snprintf(label, sizeof(label), "persistence/store-fingerprints-%zu",
+             b.count);
+    bench_run_prepared(label, rewind_file, store_fingerprints, &b,
+                       iterations * 100 / b.count + 1);
+
+    fclose(b.file);
+  }
+
+  if (b.failures > 0) {
+    fprintf(stderr, "persistence: %d runs failed\n", b.failures);
+  }
+
+  bench_client_free(b.client);
+}
@@ -0,0 +1,151 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OTRNG_PREKEY_MANAGER_PRIVATE
+
+#include "alloc.h"
+#include "bench.h"
+#include "parallel.h"
+#include "prekey_manager.h"
+#include "prekey_message.h"
+
+/* as many as a client publishes at once */
+#define BENCH_PREKEY_BATCH 100
+
+typedef struct prekey_bench_s {
+  prekey_message_s **messages;
+  size_t threads;
+} prekey_bench_s;
+
+typedef struct publication_bench_s {
+  otrng_prekey_publication_message_s pub_msg;
+  uint8_t mac_key[MAC_KEY_BYTES];
+  uint8_t mac[HASH_BYTES];
+  int failures;
+} publication_bench_s;
+
+static void generate_batch(void *data) {
+  prekey_bench_s *b = data;
+  size_t i;
+
+  if (!otrng_prekey_messages_generate(b->messages, BENCH_PREKEY_BATCH, 0x100,
+                                      b->threads)) {
+    return;
+  }
+
+  for (i = 0; i < BENCH_PREKEY_BATCH; i++) {
+    otrng_prekey_message_free(b->messages[i]);
+  }
+}
+
+/* The message, with its proofs, that goes to the prekey server at the end of
+   the DAKE with it */
+static void build_publication(void *data) {
+  publication_bench_s *b = data;
+  otrng_prekey_dake3_message_s dake_3;
+
+  memset(&dake_3, 0, sizeof(dake_3));
+  if (otrng_failed(dake3_message_append_prekey_publication_message(
+          &b->pub_msg, &dake_3, b->mac_key, b->mac))) {
+    b->failures++;
+  }
+
+  otrng_free(dake_3.msg);
+}
+
+static void bench_publication(prekey_message_s **messages, size_t iterations) {
+  otrng_client_s *client = bench_client_new("alice", 1);
+  publication_bench_s b;
+  char label[64];
+  size_t count;
+
+  memset(&b, 0, sizeof(b));
+  b.pub_msg.prekey_messages = messages;
+  b.pub_msg.client_profile = otrng_client_get_client_profile(client);
+  b.pub_msg.prekey_profile = otrng_client_get_prekey_profile(client);
+  memset(b.mac_key, 0x11, MAC_KEY_BYTES);
+  memset(b.mac, 0x22, HASH_BYTES);
+
+  for (count = 1; count <= BENCH_PREKEY_BATCH; count *= 10) {
+    b.pub_msg.num_prekey_messages = (uint8_t)count;
+    snprintf(label, sizeof(label), "prekey/publication-%zu", count);
+    bench_run(label, build_publication, &b, iterations);
+  }
+
+  if (b.failures > 0) {
+    fprintf(stderr, "prekey: %d publication messages failed\n", b.failures);
+  }
+
+  /* the client owns the profiles */
+  bench_client_free(client);
+}
+
+void bench_prekey(size_t iterations) {
+  prekey_bench_s b;
+  char label[64];
+  double baseline = 0, batches;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t threads, i;
+
+  /* every batch is a hundred keypairs, so a few of them are plenty */
+  iterations = iterations / 20 + 1;
+
+  b.messages = otrng_xmalloc_z(BENCH_PREKEY_BATCH * sizeof(prekey_message_s *));
+
+  for (threads = 1; threads <= 8; threads *= 2) {
+    if (threads > 1 && (cpus <= 0 || threads > (size_t)cpus)) {
+      break;
+    }
+
+    b.threads = threads;
+    snprintf(label, sizeof(label), "prekey/generate-%d/threads-%zu",
+             BENCH_PREKEY_BATCH, threads);
+    batches = bench_run(label, generate_batch, &b, iterations);
+
+    snprintf(label, sizeof(label), "prekey/generate/messages-per-second-%zu",
+             threads);
+    bench_report(label, batches * BENCH_PREKEY_BATCH);
+
+    if (threads == 1) {
+      baseline = batches;
+    } else {
+      snprintf(label, sizeof(label), "prekey/threads-%zu/speedup", threads);
+      bench_report_speedup(label, baseline, batches);
+    }
+  }
+
+  /* as many as a client publishes by default */
+  if (otrng_prekey_messages_generate(b.messages, BENCH_PREKEY_BATCH, 0x101,
+                                     1)) {
+    bench_publication(b.messages, iterations);
+
+    for (i = 0; i < BENCH_PREKEY_BATCH; i++) {
+      otrng_prekey_message_free(b.messages[i]);
+    }
+  }
+
+  otrng_free(b.messages);
+}
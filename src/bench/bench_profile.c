@@ -0,0 +1,86 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "messaging.h"
+
+typedef struct profile_bench_s {
+  otrng_client_s *client;
+  const otrng_client_profile_s *client_profile;
+  const otrng_prekey_profile_s *prekey_profile;
+  uint32_t instance_tag;
+  int failures;
+} profile_bench_s;
+
+static void validate(void *data) {
+  profile_bench_s *b = data;
+
+  if (!otrng_client_profile_valid(b->client_profile, b->instance_tag)) {
+    b->failures++;
+  }
+}
+
+/* What the DAKE does with the profile of the peer */
+static void validate_cached(void *data) {
+  profile_bench_s *b = data;
+
+  if (!otrng_profile_cache_client_profile_valid(
+          &b->client->global_state->profile_cache, b->client_profile,
+          b->instance_tag)) {
+    b->failures++;
+  }
+}
+
+static void validate_prekey_profile(void *data) {
+  profile_bench_s *b = data;
+
+  if (!otrng_prekey_profile_valid(b->prekey_profile, b->instance_tag,
+                                  b->client_profile->long_term_pub_key)) {
+    b->failures++;
+  }
+}
+
+void bench_profile(size_t iterations) {
+  profile_bench_s b;
+
+  b.client = bench_client_new("alice", 1);
+  b.client_profile = otrng_client_get_client_profile(b.client);
+  b.prekey_profile = otrng_client_get_prekey_profile(b.client);
+  b.instance_tag = otrng_client_get_instance_tag(b.client);
+  b.failures = 0;
+
+  if (!b.client_profile || !b.prekey_profile) {
+    fprintf(stderr, "profile: the profiles could not be built\n");
+    bench_client_free(b.client);
+    return;
+  }
+
+  bench_run("profile/client-validate", validate, &b, iterations);
+  bench_run("profile/client-validate-cached", validate_cached, &b, iterations);
+  bench_run("profile/prekey-validate", validate_prekey_profile, &b, iterations);
+
+  if (b.failures > 0) {
+    fprintf(stderr, "profile: %d validations failed\n", b.failures);
+  }
+
+  bench_client_free(b.client);
+}
@@ -0,0 +1,207 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gcrypt.h>
+#include <stdio.h>
+
+#include "alloc.h"
+#include "bench.h"
+#include "prekey_proofs.h"
+#include "random.h"
+
+/* the most prekey messages that are published at once */
+#define BENCH_PROOFS_MAX_VALUES 255
+
+/* the size of the exponents derived in the proofs */
+#define BENCH_PROOFS_EXPONENT_BYTES 44
+
+typedef struct proofs_bench_s {
+  size_t count;
+
+  dh_mpi dh_priv[BENCH_PROOFS_MAX_VALUES];
+  dh_mpi dh_pub[BENCH_PROOFS_MAX_VALUES];
+  dh_mpi dh_exponents[BENCH_PROOFS_MAX_VALUES];
+  dh_mpi dh_result;
+  dh_proof_s dh_proof;
+
+  ec_scalar ec_priv[BENCH_PROOFS_MAX_VALUES];
+  ec_point ec_pub[BENCH_PROOFS_MAX_VALUES];
+  ec_scalar ec_scalars[BENCH_PROOFS_MAX_VALUES];
+  ec_point ec_result;
+  ecdh_proof_s ec_proof;
+
+  uint8_t m[HASH_BYTES];
+} proofs_bench_s;
+
+/* One exponentiation per value, as the proofs used to be verified */
+static void dh_powm_each(void *data) {
+  proofs_bench_s *b = data;
+  gcry_mpi_t power = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  size_t i;
+
+  gcry_mpi_set_ui(b->dh_result, 1);
+  for (i = 0; i < b->count; i++) {
+    gcry_mpi_powm(power, b->dh_pub[i], b->dh_exponents[i],
+                  otrng_dh_modulus_p());
+    gcry_mpi_mulm(b->dh_result, b->dh_result, power, otrng_dh_modulus_p());
+  }
+
+  gcry_mpi_release(power);
+}
+
+static void dh_multi_powm(void *data) {
+  proofs_bench_s *b = data;
+  otrng_dh_multi_powm(b->dh_result, (const dh_mpi *)b->dh_pub,
+                      (const dh_mpi *)b->dh_exponents, b->count);
+}
+
+/* Two points at a time, as the proofs used to be verified */
+static void ec_scalarmul_pairs(void *data) {
+  proofs_bench_s *b = data;
+  goldilocks_448_point_p res;
+  size_t i;
+
+  goldilocks_448_point_copy(b->ec_result, goldilocks_448_point_identity);
+  for (i = 0; i + 1 < b->count; i += 2) {
+    goldilocks_448_point_double_scalarmul(res, b->ec_pub[i], b->ec_scalars[i],
+                                          b->ec_pub[i + 1],
+                                          b->ec_scalars[i + 1]);
+    goldilocks_448_point_add(b->ec_result, b->ec_result, res);
+  }
+
+  if (i < b->count) {
+    goldilocks_448_point_scalarmul(res, b->ec_pub[i], b->ec_scalars[i]);
+    goldilocks_448_point_add(b->ec_result, b->ec_result, res);
+  }
+}
+
+static void ec_multi_scalarmul(void *data) {
+  proofs_bench_s *b = data;
+  otrng_ec_multi_scalarmul(b->ec_result, (const ec_point *)b->ec_pub,
+                           (const ec_scalar *)b->ec_scalars, b->count);
+}
+
+static void dh_proof_verify(void *data) {
+  proofs_bench_s *b = data;
+  (void)otrng_dh_proof_verify(&b->dh_proof, (const dh_mpi *)b->dh_pub,
+                              b->count, b->m, 0x13);
+}
+
+static void ecdh_proof_verify(void *data) {
+  proofs_bench_s *b = data;
+  (void)otrng_ecdh_proof_verify(&b->ec_proof, (const ec_point *)b->ec_pub,
+                                b->count, b->m, 0x13);
+}
+
+static void proofs_bench_init(proofs_bench_s *b) {
+  uint8_t buf[ED448_SCALAR_BYTES];
+  dh_keypair_s dh;
+  size_t i;
+
+  b->count = BENCH_PROOFS_MAX_VALUES;
+  random_bytes(b->m, HASH_BYTES);
+
+  for (i = 0; i < BENCH_PROOFS_MAX_VALUES; i++) {
+    otrng_dh_keypair_generate(&dh);
+    b->dh_priv[i] = dh.priv;
+    b->dh_pub[i] = dh.pub;
+
+    b->dh_exponents[i] = gcry_mpi_new(BENCH_PROOFS_EXPONENT_BYTES * 8);
+    gcry_mpi_randomize(b->dh_exponents[i], BENCH_PROOFS_EXPONENT_BYTES * 8,
+                       GCRY_WEAK_RANDOM);
+
+    random_bytes(buf, ED448_SCALAR_BYTES);
+    goldilocks_448_scalar_decode_long(b->ec_priv[i], buf, ED448_SCALAR_BYTES);
+    otrng_ec_calculate_public_key(b->ec_pub[i], b->ec_priv[i]);
+
+    random_bytes(buf, BENCH_PROOFS_EXPONENT_BYTES);
+    goldilocks_448_scalar_decode_long(b->ec_scalars[i], buf,
+                                      BENCH_PROOFS_EXPONENT_BYTES);
+  }
+
+  b->dh_result = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+}
+
+static void proofs_bench_free(proofs_bench_s *b) {
+  size_t i;
+
+  for (i = 0; i < BENCH_PROOFS_MAX_VALUES; i++) {
+    otrng_dh_mpi_release(b->dh_priv[i]);
+    otrng_dh_mpi_release(b->dh_pub[i]);
+    otrng_dh_mpi_release(b->dh_exponents[i]);
+    otrng_ec_scalar_destroy(b->ec_priv[i]);
+  }
+
+  otrng_dh_mpi_release(b->dh_result);
+}
+
+static void compare(const char *name, bench_op before, bench_op after,
+                    proofs_bench_s *b, size_t iterations) {
+  char label[64];
+  double old_rate, new_rate;
+
+  snprintf(label, sizeof(label), "proofs/%s-%zu/each", name, b->count);
+  old_rate = bench_run(label, before, b, iterations);
+
+  snprintf(label, sizeof(label), "proofs/%s-%zu/multi", name, b->count);
+  new_rate = bench_run(label, after, b, iterations);
+
+  snprintf(label, sizeof(label), "proofs/%s-%zu/speedup", name, b->count);
+  bench_report_speedup(label, old_rate, new_rate);
+}
+
+void bench_proofs(size_t iterations) {
+  static const size_t counts[] = {1, 2, 16, 64, 128, BENCH_PROOFS_MAX_VALUES};
+  proofs_bench_s *b = otrng_xmalloc_z(sizeof(proofs_bench_s));
+  char label[64];
+  size_t i, n;
+
+  proofs_bench_init(b);
+
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    b->count = counts[i];
+    /* the work grows with the number of values */
+    n = iterations / b->count + 1;
+
+    compare("dh", dh_powm_each, dh_multi_powm, b, n);
+    compare("ec", ec_scalarmul_pairs, ec_multi_scalarmul, b, n);
+  }
+
+  b->count = BENCH_PROOFS_MAX_VALUES;
+  n = iterations / b->count + 1;
+
+  if (otrng_dh_proof_generate(&b->dh_proof, (const dh_mpi *)b->dh_priv,
+                              (const dh_mpi *)b->dh_pub, b->count, b->m, 0x13,
+                              NULL)) {
+    snprintf(label, sizeof(label), "proofs/dh-verify-%zu", b->count);
+    bench_run(label, dh_proof_verify, b, n);
+    otrng_dh_mpi_release(b->dh_proof.v);
+  }
+
+  if (otrng_ecdh_proof_generate(&b->ec_proof, (const ec_scalar *)b->ec_priv,
+                                (const ec_point *)b->ec_pub, b->count, b->m,
+                                0x13)) {
+    snprintf(label, sizeof(label), "proofs/ecdh-verify-%zu", b->count);
+    bench_run(label, ecdh_proof_verify, b, n);
+  }
+
+  proofs_bench_free(b);
+  otrng_free(b);
+}
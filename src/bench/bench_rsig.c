@@ -0,0 +1,70 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "auth.h"
+#include "bench.h"
+#include "keys.h"
+#include "random.h"
+
+typedef struct rsig_bench_s {
+  otrng_keypair_s *p1, *p2, *p3;
+  ring_sig_s sig;
+  uint8_t msg[64];
+} rsig_bench_s;
+
+static void rsig_authenticate(void *data) {
+  rsig_bench_s *b = data;
+  (void)otrng_rsig_authenticate(&b->sig, b->p1->priv, b->p1->pub, b->p1->pub,
+                                b->p2->pub, b->p3->pub, b->msg,
+                                sizeof(b->msg));
+}
+
+static void rsig_verify(void *data) {
+  rsig_bench_s *b = data;
+  (void)otrng_rsig_verify(&b->sig, b->p1->pub, b->p2->pub, b->p3->pub,
+                          b->msg, sizeof(b->msg));
+}
+
+void bench_rsig(size_t iterations) {
+  rsig_bench_s b;
+  uint8_t sym[ED448_PRIVATE_BYTES];
+
+  b.p1 = otrng_keypair_new();
+  b.p2 = otrng_keypair_new();
+  b.p3 = otrng_keypair_new();
+
+  random_bytes(sym, ED448_PRIVATE_BYTES);
+  (void)otrng_keypair_generate(b.p1, sym);
+  random_bytes(sym, ED448_PRIVATE_BYTES);
+  (void)otrng_keypair_generate(b.p2, sym);
+  random_bytes(sym, ED448_PRIVATE_BYTES);
+  (void)otrng_keypair_generate(b.p3, sym);
+  random_bytes(b.msg, sizeof(b.msg));
+
+  bench_run("rsig/authenticate", rsig_authenticate, &b, iterations);
+  bench_run("rsig/verify", rsig_verify, &b, iterations);
+
+  otrng_ring_sig_destroy(&b.sig);
+  otrng_keypair_free(b.p1);
+  otrng_keypair_free(b.p2);
+  otrng_keypair_free(b.p3);
+}
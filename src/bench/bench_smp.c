@@ -0,0 +1,91 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+typedef struct smp_bench_s {
+  otrng_s *alice;
+  otrng_s *bob;
+  int failures;
+} smp_bench_s;
+
+static void full_run(void *data) {
+  smp_bench_s *b = data;
+  const uint8_t *secret = (const uint8_t *)"the same secret";
+  const size_t secret_len = strlen("the same secret");
+  char *msg = NULL, *reply;
+  int turn;
+
+  /* SMP1: Alice starts, and Bob answers with the same secret */
+  if (otrng_failed(otrng_smp_start(&msg, NULL, 0, secret, secret_len,
+                                   b->alice))) {
+    b->failures++;
+    return;
+  }
+
+  otrng_free(bench_deliver(msg, b->bob));
+  otrng_free(msg);
+  msg = NULL;
+
+  if (otrng_failed(otrng_smp_continue(&msg, secret, secret_len, b->bob))) {
+    b->failures++;
+    return;
+  }
+
+  /* SMP2 to Alice, SMP3 to Bob, and SMP4 to Alice */
+  for (turn = 0; msg; turn++) {
+    reply = bench_deliver(msg, turn % 2 == 0 ? b->alice : b->bob);
+    otrng_free(msg);
+    msg = reply;
+  }
+
+  if (turn != 3 || b->alice->smp->state_expect != SMP_STATE_EXPECT_1) {
+    b->failures++;
+  }
+}
+
+void bench_smp(size_t iterations) {
+  otrng_client_s *alice_client = bench_client_new("alice", 1);
+  otrng_client_s *bob_client = bench_client_new("bob", 2);
+  smp_bench_s b;
+
+  b.alice = bench_conversation_new(alice_client);
+  b.bob = bench_conversation_new(bob_client);
+  b.failures = 0;
+
+  if (otrng_failed(bench_interactive_dake(b.alice, b.bob))) {
+    fprintf(stderr, "smp: the DAKE failed\n");
+  } else {
+    /* every run is a few dozen scalar multiplications */
+    bench_run("smp/full-run", full_run, &b, iterations / 4 + 1);
+  }
+
+  if (b.failures > 0) {
+    fprintf(stderr, "smp: %d runs failed\n", b.failures);
+  }
+
+  otrng_conn_free(b.alice);
+  otrng_conn_free(b.bob);
+  bench_client_free(alice_client);
+  bench_client_free(bob_client);
+}
@@ -0,0 +1,1021 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A load and soak test: many pairs of clients, all in one global state, run
+ * DAKEs and then exchange messages at a steady rate for as long as asked.
+ * Every message goes through an in-memory transport that can delay, lose,
+ * duplicate and reorder it. Every few seconds, a line tells the throughput,
+ * the latency of each phase, and how much memory and how many skipped keys
+ * are held, so leaks and things that get slower over time stand out.
+ *
+ * Clients 2i and 2i + 1 talk to each other. The messages are received on
+ * the main thread, or on the workers of an engine (see engine.h).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <gcrypt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "engine.h"
+#include "messaging.h"
+#include "otrng.h"
+#include "skipped_keys.h"
+
+#define SOAK_ACCOUNT_PREFIX "soak-"
+#define SOAK_DEFAULT_SEED UINT64_C(0x6f74726e67) /* "otrng" */
+
+typedef struct soak_options_s {
+  size_t pairs;
+  double duration;     /* seconds */
+  double interval;     /* seconds between reports */
+  double rate;         /* messages per second in each pair */
+  size_t message_size; /* bytes */
+  double latency;      /* seconds */
+  double loss;         /* probabilities, from 0 to 1 */
+  double duplication;
+  double reordering;
+  double dake_timeout;        /* seconds before a DAKE is started again */
+  uint32_t session_expiration; /* seconds */
+  size_t workers;              /* 0 to receive on the main thread */
+  uint64_t seed;
+} soak_options_s;
+
+/* A message on its way */
+typedef struct soak_packet_s {
+  double deliver_at;
+  uint64_t order; /* keeps the packets due at the same time in order */
+  double sent_at;
+  size_t from;
+  size_t to;
+  otrng_bool is_data; /* sent by the harness, not by the protocol */
+  char *msg;
+} soak_packet_s;
+
+/* The packets are kept in a binary heap, by delivery time */
+typedef struct soak_transport_s {
+  soak_packet_s *packets;
+  size_t len;
+  size_t capacity;
+  uint64_t next_order;
+  uint64_t random_state;
+  pthread_mutex_t lock;
+} soak_transport_s;
+
+typedef struct soak_samples_s {
+  double *values;
+  size_t len;
+  size_t capacity;
+} soak_samples_s;
+
+typedef enum {
+  SOAK_PHASE_SEND = 0,
+  SOAK_PHASE_RECEIVE = 1,
+  SOAK_PHASE_DELIVERY = 2,
+  SOAK_PHASE_DAKE = 3,
+  SOAK_PHASES = 4
+} soak_phase;
+
+static const char *const soak_phase_names[SOAK_PHASES] = {"send", "receive",
+                                                          "delivery", "dake"};
+
+/* What happened since the last report */
+typedef struct soak_counters_s {
+  size_t sent;
+  size_t delivered;
+  size_t injected;
+  size_t lost;
+  size_t duplicated;
+  size_t reordered;
+  size_t errors;
+  size_t dakes;
+  size_t dake_retries;
+  size_t behind; /* messages that could not be sent on time */
+} soak_counters_s;
+
+typedef struct soak_pair_s {
+  otrng_bool secure[2];
+  double dake_started; /* 0 if no DAKE is running */
+  double next_send;
+  size_t turn;
+} soak_pair_s;
+
+typedef struct soak_s {
+  soak_options_s options;
+
+  otrng_global_state_s *gs;
+  otrng_client_s **clients;
+  char **accounts;
+  soak_pair_s *pairs;
+  char *payload;
+
+  soak_transport_s transport;
+  /*@null@*/ otrng_engine_s *engine;
+
+  /* taken after any client lock, and never while calling the library */
+  pthread_mutex_t lock;
+  soak_counters_s counters;
+  soak_counters_s total;
+  soak_samples_s samples[SOAK_PHASES];
+  size_t secure_pairs;
+} soak_s;
+
+/* What the engine has to know about a message it receives */
+typedef struct soak_delivery_s {
+  soak_s *soak;
+  double sent_at;
+  double received_at;
+  size_t to;
+  otrng_bool is_data;
+} soak_delivery_s;
+
+/* The callbacks find the harness through this, as they only get a client */
+static soak_s *the_soak = NULL;
+
+static double soak_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void soak_sleep(double seconds) {
+  struct timespec wait;
+
+  wait.tv_sec = (time_t)seconds;
+  wait.tv_nsec = (long)((seconds - (double)wait.tv_sec) * 1e9);
+  (void)nanosleep(&wait, NULL);
+}
+
+/* splitmix64, so a seed gives the same losses, duplicates and reorderings */
+static double soak_random(uint64_t *state) {
+  uint64_t z;
+
+  *state += UINT64_C(0x9e3779b97f4a7c15);
+  z = *state;
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  z ^= z >> 31;
+
+  return (double)(z >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+/* The index of a client from its account, as "soak-<index>" */
+static size_t soak_endpoint(const char *account) {
+  return (size_t)strtoul(account + strlen(SOAK_ACCOUNT_PREFIX), NULL, 10);
+}
+
+static void samples_add(soak_samples_s *samples, double value) {
+  if (samples->len == samples->capacity) {
+    samples->capacity = samples->capacity ? samples->capacity * 2 : 1024;
+    samples->values = otrng_xrealloc(samples->values,
+                                     samples->capacity * sizeof(double));
+  }
+
+  samples->values[samples->len++] = value;
+}
+
+static int compare_samples(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* The median and 99th percentile, in milliseconds */
+static void samples_percentiles(double *p50, double *p99,
+                                soak_samples_s *samples) {
+  if (samples->len == 0) {
+    *p50 = 0;
+    *p99 = 0;
+    return;
+  }
+
+  qsort(samples->values, samples->len, sizeof(double), compare_samples);
+  *p50 = samples->values[samples->len / 2] * 1e3;
+  *p99 = samples->values[(samples->len * 99) / 100] * 1e3;
+}
+
+static void soak_record(soak_s *soak, soak_phase phase, double seconds) {
+  (void)pthread_mutex_lock(&soak->lock);
+  samples_add(&soak->samples[phase], seconds);
+  (void)pthread_mutex_unlock(&soak->lock);
+}
+
+static otrng_bool packet_before(const soak_packet_s *a,
+                                const soak_packet_s *b) {
+  if (a->deliver_at < b->deliver_at) {
+    return otrng_true;
+  }
+
+  if (a->deliver_at > b->deliver_at) {
+    return otrng_false;
+  }
+
+  return a->order < b->order ? otrng_true : otrng_false;
+}
+
+static void transport_push(soak_transport_s *transport, soak_packet_s packet) {
+  soak_packet_s tmp;
+  size_t i, parent;
+
+  if (transport->len == transport->capacity) {
+    transport->capacity = transport->capacity ? transport->capacity * 2 : 256;
+    transport->packets = otrng_xrealloc(
+        transport->packets, transport->capacity * sizeof(soak_packet_s));
+  }
+
+  packet.order = transport->next_order++;
+  i = transport->len++;
+  transport->packets[i] = packet;
+
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (!packet_before(&transport->packets[i], &transport->packets[parent])) {
+      break;
+    }
+
+    tmp = transport->packets[parent];
+    transport->packets[parent] = transport->packets[i];
+    transport->packets[i] = tmp;
+    i = parent;
+  }
+}
+
+/* Takes the first packet that is due at [now], if any */
+static otrng_bool transport_pop(soak_packet_s *packet,
+                                soak_transport_s *transport, double now) {
+  soak_packet_s tmp;
+  size_t i = 0, child;
+
+  (void)pthread_mutex_lock(&transport->lock);
+  if (transport->len == 0 || transport->packets[0].deliver_at > now) {
+    (void)pthread_mutex_unlock(&transport->lock);
+    return otrng_false;
+  }
+
+  *packet = transport->packets[0];
+  transport->packets[0] = transport->packets[--transport->len];
+
+  for (;;) {
+    child = 2 * i + 1;
+    if (child >= transport->len) {
+      break;
+    }
+
+    if (child + 1 < transport->len &&
+        packet_before(&transport->packets[child + 1],
+                      &transport->packets[child])) {
+      child++;
+    }
+
+    if (!packet_before(&transport->packets[child], &transport->packets[i])) {
+      break;
+    }
+
+    tmp = transport->packets[child];
+    transport->packets[child] = transport->packets[i];
+    transport->packets[i] = tmp;
+    i = child;
+  }
+  (void)pthread_mutex_unlock(&transport->lock);
+
+  return otrng_true;
+}
+
+/* Sends [msg], which is then owned by the transport, from [from] to its peer.
+   It is called with the lock of [from] held when the protocol sends it. */
+static void soak_send(soak_s *soak, size_t from, char *msg,
+                      otrng_bool is_data) {
+  soak_transport_s *transport = &soak->transport;
+  const soak_options_s *options = &soak->options;
+  soak_packet_s packet;
+  otrng_bool lost, duplicated, reordered;
+  double now = soak_now();
+
+  (void)pthread_mutex_lock(&transport->lock);
+  lost = soak_random(&transport->random_state) < options->loss;
+  duplicated = soak_random(&transport->random_state) < options->duplication;
+  reordered = soak_random(&transport->random_state) < options->reordering;
+
+  if (!lost) {
+    packet.sent_at = now;
+    packet.from = from;
+    packet.to = from ^ 1;
+    packet.is_data = is_data;
+    packet.msg = msg;
+    /* a reordered message is held long enough for the next ones to pass it */
+    packet.deliver_at = now + options->latency;
+    if (reordered) {
+      packet.deliver_at += 4 * options->latency + 0.005;
+    }
+    transport_push(transport, packet);
+
+    if (duplicated) {
+      packet.msg = otrng_xstrdup(msg);
+      packet.deliver_at += options->latency;
+      transport_push(transport, packet);
+    }
+  }
+  (void)pthread_mutex_unlock(&transport->lock);
+
+  if (lost) {
+    otrng_free(msg);
+  }
+
+  (void)pthread_mutex_lock(&soak->lock);
+  if (lost) {
+    soak->counters.lost++;
+  } else {
+    soak->counters.duplicated += duplicated ? 1 : 0;
+    soak->counters.reordered += reordered ? 1 : 0;
+  }
+  (void)pthread_mutex_unlock(&soak->lock);
+}
+
+static void soak_received(soak_delivery_s *delivery, otrng_result result,
+                          char *to_send, otrng_bool displayed) {
+  soak_s *soak = delivery->soak;
+  double now = soak_now();
+
+  if (to_send) {
+    soak_send(soak, delivery->to, to_send, otrng_false);
+  }
+
+  (void)pthread_mutex_lock(&soak->lock);
+  samples_add(&soak->samples[SOAK_PHASE_RECEIVE], now - delivery->received_at);
+  if (otrng_failed(result)) {
+    soak->counters.errors++;
+  } else if (displayed && delivery->is_data) {
+    soak->counters.delivered++;
+    samples_add(&soak->samples[SOAK_PHASE_DELIVERY], now - delivery->sent_at);
+  }
+  (void)pthread_mutex_unlock(&soak->lock);
+}
+
+static void soak_completion(otrng_engine_result_s *result, void *context) {
+  soak_delivery_s *delivery = result->data;
+
+  (void)context;
+
+  soak_received(delivery, result->result, result->to_send,
+                result->to_display != NULL);
+  result->to_send = NULL;
+  otrng_free(delivery);
+}
+
+static void soak_deliver(soak_s *soak, soak_packet_s *packet) {
+  otrng_client_s *client = soak->clients[packet->to];
+  const char *from = soak->accounts[packet->from];
+  soak_delivery_s *delivery = otrng_xmalloc_z(sizeof(soak_delivery_s));
+  char *to_send = NULL, *to_display = NULL;
+  otrng_bool should_ignore = otrng_false;
+  otrng_result result;
+
+  delivery->soak = soak;
+  delivery->sent_at = packet->sent_at;
+  delivery->received_at = soak_now();
+  delivery->to = packet->to;
+  delivery->is_data = packet->is_data;
+
+  if (soak->engine) {
+    if (otrng_failed(otrng_engine_submit(soak->engine, client, from,
+                                         packet->msg, delivery))) {
+      otrng_free(delivery);
+    }
+    otrng_free(packet->msg);
+    return;
+  }
+
+  result = otrng_client_receive(&to_send, &to_display, packet->msg, from,
+                                client, &should_ignore);
+  otrng_free(packet->msg);
+  (void)should_ignore;
+
+  soak_received(delivery, result, to_send, to_display != NULL);
+  otrng_free(to_display);
+  otrng_free(delivery);
+}
+
+static void do_nothing(otrng_client_s *client) { (void)client; }
+
+static void create_prekey_profile(otrng_client_s *client) {
+  otrng_prekey_profile_s *profile =
+      otrng_client_build_default_prekey_profile(client);
+
+  if (profile) {
+    (void)otrng_client_add_prekey_profile(client, profile);
+    otrng_prekey_profile_free(profile);
+  }
+}
+
+static void create_client_profile(otrng_client_s *client) {
+  otrng_client_profile_s *profile =
+      otrng_client_build_default_client_profile(client);
+
+  if (profile) {
+    (void)otrng_client_add_client_profile(client, profile);
+    otrng_client_profile_free(profile);
+  }
+}
+
+static otrng_shared_session_state_s
+get_shared_session_state(const otrng_s *conv) {
+  size_t from = soak_endpoint(conv->client->client_id.account);
+  size_t to = soak_endpoint(conv->peer);
+  otrng_shared_session_state_s result = {
+      .identifier1 = otrng_xstrdup(the_soak->accounts[from < to ? from : to]),
+      .identifier2 = otrng_xstrdup(the_soak->accounts[from < to ? to : from]),
+      .password = NULL,
+  };
+
+  return result;
+}
+
+static void display_error_message(const otrng_error_event event,
+                                  string_p *to_display, const otrng_s *conv) {
+  (void)event;
+  (void)to_display;
+  (void)conv;
+}
+
+static otrng_policy_s define_policy(otrng_client_s *client) {
+  otrng_policy_s policy = {.allows = OTRNG_ALLOW_V4,
+                           .type = OTRNG_POLICY_ALWAYS};
+  (void)client;
+
+  return policy;
+}
+
+static void set_secure(const otrng_s *conv, otrng_bool secure) {
+  soak_s *soak = the_soak;
+  size_t endpoint = soak_endpoint(conv->client->client_id.account);
+  soak_pair_s *pair = &soak->pairs[endpoint / 2];
+  otrng_bool was_secure, is_secure;
+  double now = soak_now();
+
+  (void)pthread_mutex_lock(&soak->lock);
+  was_secure = pair->secure[0] && pair->secure[1];
+  pair->secure[endpoint % 2] = secure;
+  is_secure = pair->secure[0] && pair->secure[1];
+
+  if (is_secure && !was_secure) {
+    soak->secure_pairs++;
+    if (pair->dake_started > 0) {
+      samples_add(&soak->samples[SOAK_PHASE_DAKE], now - pair->dake_started);
+    }
+    pair->dake_started = 0;
+    pair->next_send = now;
+  } else if (was_secure && !is_secure) {
+    soak->secure_pairs--;
+  }
+  (void)pthread_mutex_unlock(&soak->lock);
+}
+
+static void gone_secure(const otrng_s *conv) { set_secure(conv, otrng_true); }
+
+static void gone_insecure(const otrng_s *conv) {
+  set_secure(conv, otrng_false);
+}
+
+static uint32_t session_expiration_time_for(const otrng_s *conv) {
+  (void)conv;
+
+  return the_soak->options.session_expiration;
+}
+
+/* The messages the library sends by itself, like when a session expires */
+static void inject_message(const otrng_s *conv, string_p message) {
+  soak_s *soak = the_soak;
+
+  (void)pthread_mutex_lock(&soak->lock);
+  soak->counters.injected++;
+  (void)pthread_mutex_unlock(&soak->lock);
+
+  soak_send(soak, soak_endpoint(conv->client->client_id.account), message,
+            otrng_false);
+}
+
+static const otrng_client_callbacks_s soak_callbacks = {
+    .create_instag = do_nothing,
+    .create_privkey_v3 = do_nothing,
+    .create_privkey_v4 = do_nothing,
+    .create_forging_key = do_nothing,
+    .create_client_profile = create_client_profile,
+    .store_expired_client_profile = do_nothing,
+    .load_expired_client_profile = do_nothing,
+    .store_expired_prekey_profile = do_nothing,
+    .load_expired_prekey_profile = do_nothing,
+    .create_prekey_profile = create_prekey_profile,
+    .gone_secure = gone_secure,
+    .gone_insecure = gone_insecure,
+    .display_error_message = display_error_message,
+    .get_shared_session_state = get_shared_session_state,
+    .load_privkey_v4 = do_nothing,
+    .load_privkey_v3 = do_nothing,
+    .load_client_profile = do_nothing,
+    .load_prekey_profile = do_nothing,
+    .store_client_profile = do_nothing,
+    .store_prekey_profile = do_nothing,
+    .load_prekey_messages = do_nothing,
+    .store_prekey_messages = do_nothing,
+    .store_privkey_v4 = do_nothing,
+    .store_privkey_v3 = do_nothing,
+    .load_forging_key = do_nothing,
+    .store_forging_key = do_nothing,
+    .define_policy = define_policy,
+    .store_fingerprints_v4 = do_nothing,
+    .load_fingerprints_v4 = do_nothing,
+    .store_fingerprints_v3 = do_nothing,
+    .load_fingerprints_v3 = do_nothing,
+    .session_expiration_time_for = session_expiration_time_for,
+    .inject_message = inject_message,
+};
+
+static otrng_client_s *soak_client_new(soak_s *soak, size_t i) {
+  const otrng_client_id_s client_id = {.protocol = "soak",
+                                       .account = soak->accounts[i]};
+  uint8_t long_term_priv[ED448_PRIVATE_BYTES] = {0};
+  uint8_t forging_sym[ED448_PRIVATE_BYTES] = {0};
+  otrng_client_s *client = otrng_client_get(soak->gs, client_id);
+  otrng_keypair_s *forging = otrng_keypair_new();
+
+  memcpy(long_term_priv, &i, sizeof(i));
+  memcpy(forging_sym, &i, sizeof(i));
+  long_term_priv[sizeof(i)] = 0xA;
+  forging_sym[sizeof(i)] = 0xD;
+
+  (void)otrng_client_add_private_key_v4(client, long_term_priv);
+  (void)otrng_keypair_generate(forging, forging_sym);
+  (void)otrng_client_add_forging_key(client, forging->pub);
+  otrng_keypair_free(forging);
+
+  (void)otrng_client_add_instance_tag(client, 0x100 + (unsigned int)i);
+  client->client_profile = otrng_client_build_default_client_profile(client);
+
+  return client;
+}
+
+static otrng_result soak_init(soak_s *soak, const soak_options_s *options) {
+  size_t i, endpoints = 2 * options->pairs;
+  char account[32];
+
+  memset(soak, 0, sizeof(soak_s));
+  soak->options = *options;
+  the_soak = soak;
+
+  (void)pthread_mutex_init(&soak->lock, NULL);
+  (void)pthread_mutex_init(&soak->transport.lock, NULL);
+  soak->transport.random_state = options->seed;
+
+  soak->gs = otrng_global_state_new(&soak_callbacks, otrng_false);
+  soak->clients = otrng_xmalloc_z(endpoints * sizeof(otrng_client_s *));
+  soak->accounts = otrng_xmalloc_z(endpoints * sizeof(char *));
+  soak->pairs = otrng_xmalloc_z(options->pairs * sizeof(soak_pair_s));
+
+  for (i = 0; i < endpoints; i++) {
+    (void)snprintf(account, sizeof(account), SOAK_ACCOUNT_PREFIX "%zu", i);
+    soak->accounts[i] = otrng_xstrdup(account);
+    soak->clients[i] = soak_client_new(soak, i);
+  }
+
+  soak->payload = otrng_xmalloc_z(options->message_size + 1);
+  memset(soak->payload, 'x', options->message_size);
+
+  if (options->workers > 0) {
+    soak->engine = otrng_engine_new(options->workers, soak_completion, NULL);
+    if (!soak->engine) {
+      return OTRNG_ERROR;
+    }
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+static void soak_free(soak_s *soak) {
+  soak_packet_s packet;
+  size_t i;
+
+  /* waits for the messages the workers are receiving */
+  otrng_engine_free(soak->engine);
+  soak->engine = NULL;
+
+  while (transport_pop(&packet, &soak->transport, 1e300)) {
+    otrng_free(packet.msg);
+  }
+
+  otrng_global_state_free(soak->gs);
+  soak->gs = NULL;
+
+  for (i = 0; i < 2 * soak->options.pairs; i++) {
+    otrng_free(soak->accounts[i]);
+  }
+
+  for (i = 0; i < SOAK_PHASES; i++) {
+    otrng_free(soak->samples[i].values);
+  }
+
+  otrng_free(soak->transport.packets);
+  otrng_free(soak->clients);
+  otrng_free(soak->accounts);
+  otrng_free(soak->pairs);
+  otrng_free(soak->payload);
+  (void)pthread_mutex_destroy(&soak->transport.lock);
+  (void)pthread_mutex_destroy(&soak->lock);
+  the_soak = NULL;
+}
+
+/* Starts a DAKE in the pairs that are not encrypted, or whose DAKE is taking
+   too long, which happens when one of its messages is lost */
+static void start_dakes(soak_s *soak, double now) {
+  soak_pair_s *pair;
+  otrng_bool start, retry;
+  char *msg;
+  size_t i;
+
+  for (i = 0; i < soak->options.pairs; i++) {
+    pair = &soak->pairs[i];
+
+    (void)pthread_mutex_lock(&soak->lock);
+    retry = pair->dake_started > 0 &&
+            now - pair->dake_started > soak->options.dake_timeout;
+    start = !(pair->secure[0] && pair->secure[1]) &&
+            (pair->dake_started <= 0 || retry);
+    if (start) {
+      pair->dake_started = now;
+      soak->counters.dakes++;
+      soak->counters.dake_retries += retry ? 1 : 0;
+    }
+    (void)pthread_mutex_unlock(&soak->lock);
+
+    if (!start) {
+      continue;
+    }
+
+    msg = otrng_client_init_message(soak->accounts[2 * i + 1], "",
+                                    soak->clients[2 * i]);
+    if (msg) {
+      soak_send(soak, 2 * i, msg, otrng_false);
+    }
+  }
+}
+
+/* Sends the messages that are due in the encrypted pairs, taking turns */
+static void send_messages(soak_s *soak, double now) {
+  const double period = 1.0 / soak->options.rate;
+  soak_pair_s *pair;
+  otrng_bool due;
+  otrng_result result;
+  size_t i, from;
+  char *msg;
+  double start;
+
+  for (i = 0; i < soak->options.pairs; i++) {
+    pair = &soak->pairs[i];
+
+    for (;;) {
+      (void)pthread_mutex_lock(&soak->lock);
+      due = pair->secure[0] && pair->secure[1] && pair->next_send <= now;
+      if (due) {
+        /* an overloaded process does not catch up in bursts */
+        if (now - pair->next_send > 1) {
+          soak->counters.behind += (size_t)((now - pair->next_send) / period);
+          pair->next_send = now;
+        }
+        pair->next_send += period;
+      }
+      (void)pthread_mutex_unlock(&soak->lock);
+
+      if (!due) {
+        break;
+      }
+
+      from = 2 * i + (pair->turn++ % 2);
+      msg = NULL;
+      start = soak_now();
+      result = otrng_client_send(&msg, soak->payload,
+                                 soak->accounts[from ^ 1], soak->clients[from]);
+      soak_record(soak, SOAK_PHASE_SEND, soak_now() - start);
+
+      (void)pthread_mutex_lock(&soak->lock);
+      if (otrng_failed(result) || !msg) {
+        soak->counters.errors++;
+      } else {
+        soak->counters.sent++;
+      }
+      (void)pthread_mutex_unlock(&soak->lock);
+
+      if (otrng_failed(result)) {
+        otrng_free(msg);
+      } else if (msg) {
+        soak_send(soak, from, msg, otrng_true);
+      }
+    }
+  }
+}
+
+/* The number of message keys stored for messages that did not arrive yet */
+static size_t skipped_keys(soak_s *soak) {
+  otrng_conversation_s *conv;
+  otrng_client_s *client;
+  size_t i, total = 0;
+
+  for (i = 0; i < 2 * soak->options.pairs; i++) {
+    client = soak->clients[i];
+
+    otrng_client_lock(client);
+    conv = otrng_client_get_conversation(0, soak->accounts[i ^ 1], client);
+    if (conv && conv->conn && conv->conn->keys &&
+        conv->conn->keys->skipped_keys) {
+      total += otrng_skipped_keys_size(conv->conn->keys->skipped_keys);
+    }
+    otrng_client_unlock(client);
+  }
+
+  return total;
+}
+
+/* The resident set size, in bytes, or 0 if it can not be read */
+static size_t resident_memory(void) {
+  unsigned long size = 0, resident = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  if (!statm) {
+    return 0;
+  }
+
+  if (fscanf(statm, "%lu %lu", &size, &resident) != 2 || page_size <= 0) {
+    resident = 0;
+  }
+  (void)fclose(statm);
+
+  return (size_t)resident * (size_t)page_size;
+}
+
+static void counters_add(soak_counters_s *total, const soak_counters_s *c) {
+  total->sent += c->sent;
+  total->delivered += c->delivered;
+  total->injected += c->injected;
+  total->lost += c->lost;
+  total->duplicated += c->duplicated;
+  total->reordered += c->reordered;
+  total->errors += c->errors;
+  total->dakes += c->dakes;
+  total->dake_retries += c->dake_retries;
+  total->behind += c->behind;
+}
+
+static void print_header(void) {
+  char phase[32];
+  size_t i;
+
+  printf("%8s %7s %8s %8s %6s %6s %6s %6s %6s %6s %10s", "time", "secure",
+         "sent", "deliv", "lost", "dup", "reord", "inject", "errors", "behind",
+         "deliv/s");
+  for (i = 0; i < SOAK_PHASES; i++) {
+    (void)snprintf(phase, sizeof(phase), "%s p50/p99 ms", soak_phase_names[i]);
+    printf(" %19s", phase);
+  }
+  printf(" %9s %10s %8s %8s %8s\n", "rss KB", "secure KB", "slab KB",
+         "direct", "skipped");
+}
+
+static void report(soak_s *soak, double elapsed, double interval) {
+  soak_samples_s samples[SOAK_PHASES];
+  soak_counters_s counters;
+  otrng_secure_memory_stats_s secure = otrng_secure_memory_stats();
+  size_t secure_pairs, skipped = skipped_keys(soak);
+  double p50, p99;
+  size_t i;
+
+  (void)pthread_mutex_lock(&soak->lock);
+  counters = soak->counters;
+  counters_add(&soak->total, &soak->counters);
+  memset(&soak->counters, 0, sizeof(soak_counters_s));
+  for (i = 0; i < SOAK_PHASES; i++) {
+    samples[i] = soak->samples[i];
+    memset(&soak->samples[i], 0, sizeof(soak_samples_s));
+  }
+  secure_pairs = soak->secure_pairs;
+  (void)pthread_mutex_unlock(&soak->lock);
+
+  printf("%8.1f %7zu %8zu %8zu %6zu %6zu %6zu %6zu %6zu %6zu %10.1f", elapsed,
+         secure_pairs, counters.sent, counters.delivered, counters.lost,
+         counters.duplicated, counters.reordered, counters.injected,
+         counters.errors, counters.behind,
+         interval > 0 ? (double)counters.delivered / interval : 0);
+
+  for (i = 0; i < SOAK_PHASES; i++) {
+    samples_percentiles(&p50, &p99, &samples[i]);
+    printf(" %9.2f/%9.2f", p50, p99);
+    otrng_free(samples[i].values);
+  }
+
+  printf(" %9zu %10zu %8zu %8zu %8zu\n", resident_memory() / 1024,
+         secure.slab_bytes_in_use / 1024, secure.slab_bytes / 1024,
+         secure.direct_allocations, skipped);
+  (void)fflush(stdout);
+}
+
+static void soak_run(soak_s *soak) {
+  const double start = soak_now();
+  double now = start, last_report = start, last_poll = start;
+  soak_packet_s packet;
+  otrng_bool idle;
+
+  print_header();
+
+  while (now - start < soak->options.duration) {
+    start_dakes(soak, now);
+    send_messages(soak, now);
+
+    idle = otrng_true;
+    while (transport_pop(&packet, &soak->transport, now)) {
+      soak_deliver(soak, &packet);
+      idle = otrng_false;
+    }
+
+    now = soak_now();
+    if (now - last_poll >= 1) {
+      otrng_poll(soak->gs);
+      last_poll = now;
+    }
+
+    if (now - last_report >= soak->options.interval) {
+      report(soak, now - start, now - last_report);
+      last_report = now;
+    }
+
+    if (idle) {
+      soak_sleep(0.0005);
+      now = soak_now();
+    }
+  }
+
+  if (soak->engine) {
+    otrng_engine_drain(soak->engine);
+  }
+
+  now = soak_now();
+  report(soak, now - start, now - last_report);
+
+  printf("total: %zu sent, %zu delivered, %zu lost, %zu duplicated, "
+         "%zu reordered, %zu errors, %zu DAKEs (%zu retried)\n",
+         soak->total.sent, soak->total.delivered, soak->total.lost,
+         soak->total.duplicated, soak->total.reordered, soak->total.errors,
+         soak->total.dakes, soak->total.dake_retries);
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [-p pairs] [-d seconds] [-i seconds] [-r rate]\n"
+          "       [-b bytes] [-L ms] [-x loss%%] [-u duplication%%]\n"
+          "       [-o reordering%%] [-t dake timeout] [-e expiration]\n"
+          "       [-w workers] [-s seed]\n",
+          program);
+}
+
+static otrng_bool parse_options(soak_options_s *options, int argc,
+                                char **argv) {
+  const char *value;
+  int i;
+
+  for (i = 1; i < argc; i += 2) {
+    if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 >= argc) {
+      return otrng_false;
+    }
+
+    value = argv[i + 1];
+    switch (argv[i][1]) {
+    case 'p':
+      options->pairs = (size_t)strtoul(value, NULL, 10);
+      break;
+    case 'd':
+      options->duration = strtod(value, NULL);
+      break;
+    case 'i':
+      options->interval = strtod(value, NULL);
+      break;
+    case 'r':
+      options->rate = strtod(value, NULL);
+      break;
+    case 'b':
+      options->message_size = (size_t)strtoul(value, NULL, 10);
+      break;
+    case 'L':
+      options->latency = strtod(value, NULL) / 1e3;
+      break;
+    case 'x':
+      options->loss = strtod(value, NULL) / 100;
+      break;
+    case 'u':
+      options->duplication = strtod(value, NULL) / 100;
+      break;
+    case 'o':
+      options->reordering = strtod(value, NULL) / 100;
+      break;
+    case 't':
+      options->dake_timeout = strtod(value, NULL);
+      break;
+    case 'e':
+      options->session_expiration = (uint32_t)strtoul(value, NULL, 10);
+      break;
+    case 'w':
+      options->workers = (size_t)strtoul(value, NULL, 10);
+      break;
+    case 's':
+      options->seed = strtoull(value, NULL, 0);
+      break;
+    default:
+      return otrng_false;
+    }
+  }
+
+  return otrng_bool_is_true(
+      options->pairs > 0 && options->duration > 0 && options->interval > 0 &&
+      options->rate > 0 && options->message_size > 0 &&
+      options->latency >= 0 && options->loss >= 0 && options->loss < 1 &&
+      options->duplication >= 0 && options->reordering >= 0 &&
+      options->dake_timeout > 0 && options->workers <= OTRNG_MAX_THREADS);
+}
+
+int main(int argc, char **argv) {
+  soak_options_s options = {
+      .pairs = 100,
+      .duration = 60,
+      .interval = 5,
+      .rate = 10,
+      .message_size = 100,
+      .latency = 0.02,
+      .loss = 0,
+      .duplication = 0,
+      .reordering = 0,
+      .dake_timeout = 5,
+      .session_expiration = 7200,
+      .workers = 0,
+      .seed = SOAK_DEFAULT_SEED,
+  };
+  otrng_secure_memory_stats_s before, after;
+  soak_s soak;
+
+  if (!parse_options(&options, argc, argv)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if (!gcry_check_version(GCRYPT_VERSION)) {
+    return 2;
+  }
+
+  gcry_control(GCRYCTL_INIT_SECMEM, 0);
+  gcry_control(GCRYCTL_RESUME_SECMEM_WARN);
+  gcry_control(GCRYCTL_INITIALIZATION_FINISHED);
+
+  OTRNG_INIT;
+
+  before = otrng_secure_memory_stats();
+  if (otrng_failed(soak_init(&soak, &options))) {
+    fprintf(stderr, "soak: could not start the workers\n");
+    soak_free(&soak);
+    OTRNG_FREE;
+    return 1;
+  }
+
+  soak_run(&soak);
+  soak_free(&soak);
+
+  /* what is left once everything is freed was leaked */
+  after = otrng_secure_memory_stats();
+  printf("secure memory left: %zu bytes in the slab, %zu direct "
+         "allocations\n",
+         after.slab_bytes_in_use - before.slab_bytes_in_use,
+         after.direct_allocations - before.direct_allocations);
+
+  OTRNG_FREE;
+
+  return 0;
+}
@@ -58,6 +58,7 @@ tstatic otrng_conversation_s *new_conversation_with(const char *recipient,
 tstatic void conversation_free(void *data) {
   otrng_conversation_s *conv = data;
 
+  otrng_timer_cancel(&conv->session_timer);
   otrng_free(conv->recipient);
   otrng_conn_free(conv->conn);
 
@@ -81,6 +82,7 @@ API otrng_client_s *otrng_client_new(const otrng_client_id_s client_id) {
       .protocol = otrng_xstrdup(client_id.protocol),
       .account = otrng_xstrdup(client_id.account),
   };
+  pthread_mutexattr_t attr;
 
   client->client_id = cid;
   client->max_stored_msg_keys = 1000;
@@ -100,6 +102,14 @@ API otrng_client_s *otrng_client_new(const otrng_client_id_s client_id) {
 #define FRAGMENTS_EXPIRATION_SECONDS 1 * 7 * 24 * 60 * 60; /* 1 weeks */
   client->fragments_exp_time = FRAGMENTS_EXPIRATION_SECONDS;
 
+  otrng_hash_index_init(&client->conversations_index);
+
+  /* Callbacks run with the lock held, and may call back into the client */
+  (void)pthread_mutexattr_init(&attr);
+  (void)pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  (void)pthread_mutex_init(&client->lock, &attr);
+  (void)pthread_mutexattr_destroy(&attr);
+
   return client;
 }
 
@@ -117,12 +127,13 @@ API void otrng_client_free(otrng_client_s *client) {
     otrng_ec_point_destroy(*client->forging_key);
   }
   otrng_free(client->forging_key);
-  otrng_list_free(client->our_prekeys, prekey_message_free_from_list);
+  otrng_list_clear(&client->our_prekeys, prekey_message_free_from_list);
   otrng_client_profile_free(client->client_profile);
   otrng_client_profile_free(client->exp_client_profile);
   otrng_prekey_profile_free(client->prekey_profile);
   otrng_prekey_profile_free(client->exp_prekey_profile);
-  otrng_list_free(client->conversations, conversation_free);
+  otrng_list_clear(&client->conversations, conversation_free);
+  otrng_hash_index_destroy(&client->conversations_index);
   if (client->fingerprints) {
     otrng_known_fingerprints_free(client->fingerprints);
   }
@@ -131,24 +142,68 @@ API void otrng_client_free(otrng_client_s *client) {
 
   otrng_prekey_manager_free(client->prekey_manager);
 
+  (void)pthread_mutex_destroy(&client->lock);
   otrng_free(client);
 }
 
+API void otrng_client_lock(otrng_client_s *client) {
+  (void)pthread_mutex_lock(&client->lock);
+}
+
+API void otrng_client_unlock(otrng_client_s *client) {
+  (void)pthread_mutex_unlock(&client->lock);
+}
+
+typedef struct conversation_key_s {
+  const char *recipient;
+  uint32_t their_instance_tag;
+} conversation_key_s;
+
+tstatic uint64_t hash_conversation_key(const otrng_client_s *client,
+                                       const conversation_key_s *key) {
+  uint8_t tag[4];
+  uint64_t hash = otrng_hash_index_hash(&client->conversations_index, 0,
+                                        key->recipient, strlen(key->recipient));
+
+  otrng_serialize_uint32(tag, key->their_instance_tag);
+
+  return otrng_hash_index_hash(&client->conversations_index, hash, tag,
+                               sizeof(tag));
+}
+
+tstatic int conversation_matches(const void *item, const void *wanted) {
+  const otrng_conversation_s *conv = item;
+  const conversation_key_s *key = wanted;
+
+  return conv->their_instance_tag == key->their_instance_tag &&
+         strcmp(conv->recipient, key->recipient) == 0;
+}
+
 // TODO: @instance_tag There may be multiple conversations with the same
-// recipient if they use multiple instance tags. We are not allowing this yet.
+// recipient if they use multiple instance tags. The index allows it, but we
+// only create conversations that are not bound to an instance yet.
 tstatic /*@null@*/ otrng_conversation_s *
-get_conversation_with(const char *recipient, list_element_s *conversations) {
-  const list_element_s *el = NULL;
-  otrng_conversation_s *conv = NULL;
+get_conversation_with(const char *recipient, const otrng_client_s *client) {
+  conversation_key_s key;
 
-  for (el = conversations; el; el = el->next) {
-    conv = el->data;
-    if (!strcmp(conv->recipient, recipient)) {
-      return conv;
-    }
-  }
+  key.recipient = recipient;
+  key.their_instance_tag = 0;
 
-  return NULL;
+  return otrng_hash_index_find(&client->conversations_index,
+                               hash_conversation_key(client, &key),
+                               conversation_matches, &key);
+}
+
+tstatic void add_conversation(otrng_conversation_s *conv,
+                              otrng_client_s *client) {
+  conversation_key_s key;
+
+  key.recipient = conv->recipient;
+  key.their_instance_tag = conv->their_instance_tag;
+
+  otrng_list_append(&client->conversations, conv);
+  otrng_hash_index_add(&client->conversations_index,
+                       hash_conversation_key(client, &key), conv);
 }
 
 tstatic otrng_policy_s get_policy_for(otrng_client_s *client) {
@@ -220,12 +275,67 @@ create_connection_for(const char *recipient, otrng_client_s *client) {
   return conn;
 }
 
+tstatic uint32_t get_session_expiry_time_from(otrng_s *otr) {
+  return otr->client->global_state->callbacks->session_expiration_time_for(otr);
+}
+
+tstatic void expire_session(otrng_timer_s *timer, time_t now);
+
+/* The session can not expire before the keys are a full expiration time old.
+ * The keys are not followed as they are generated: when the timer fires, it
+ * is scheduled again from the time they were last generated. */
+tstatic void schedule_session_expiry(otrng_conversation_s *conv, time_t now) {
+  otrng_client_s *client = conv->conn->client;
+  time_t since = conv->conn->keys->last_generated;
+  uint32_t expiration_time;
+  time_t deadline;
+
+  if (!client->global_state || !client->global_state->callbacks ||
+      !client->global_state->callbacks->session_expiration_time_for) {
+    return;
+  }
+
+  expiration_time = get_session_expiry_time_from(conv->conn);
+  if (since == 0 || since > now) {
+    since = now;
+  }
+
+  /* A session that was kept after it expired is looked at again after
+   * another expiration time */
+  deadline = since + expiration_time + 1;
+  if (deadline <= now) {
+    deadline = now + expiration_time + 1;
+  }
+
+  if (!conv->session_timer.expire) {
+    otrng_timer_init(&conv->session_timer, expire_session, conv,
+                     &client->lock);
+  }
+
+  otrng_timer_schedule(&client->global_state->timers, &conv->session_timer,
+                       deadline);
+}
+
+tstatic void expire_session(otrng_timer_s *timer, time_t now) {
+  otrng_conversation_s *conv = timer->data;
+  time_t last_generated = conv->conn->keys->last_generated;
+
+  if (last_generated != 0 &&
+      last_generated < now - get_session_expiry_time_from(conv->conn)) {
+    /* This frees the conversation if the session is torn down */
+    otrng_client_expire_session(conv);
+    return;
+  }
+
+  schedule_session_expiry(conv, now);
+}
+
 tstatic /*@null@*/ otrng_conversation_s *
 get_or_create_conversation_with(const char *recipient, otrng_client_s *client) {
   otrng_conversation_s *conv = NULL;
   otrng_s *conn = NULL;
 
-  conv = get_conversation_with(recipient, client->conversations);
+  conv = get_conversation_with(recipient, client);
   if (conv) {
     return conv;
   }
@@ -241,7 +351,8 @@ get_or_create_conversation_with(const char *recipient, otrng_client_s *client) {
     return NULL;
   }
 
-  client->conversations = otrng_list_add(conv, client->conversations);
+  add_conversation(conv, client);
+  schedule_session_expiry(conv, time(NULL));
 
   return conv;
 }
@@ -249,11 +360,17 @@ get_or_create_conversation_with(const char *recipient, otrng_client_s *client) {
 API /*@null@*/ otrng_conversation_s *
 otrng_client_get_conversation(int force_create, const char *recipient,
                               otrng_client_s *client) {
+  otrng_conversation_s *conv;
+
+  otrng_client_lock(client);
   if (force_create) {
-    return get_or_create_conversation_with(recipient, client);
+    conv = get_or_create_conversation_with(recipient, client);
+  } else {
+    conv = get_conversation_with(recipient, client);
   }
+  otrng_client_unlock(client);
 
-  return get_conversation_with(recipient, client->conversations);
+  return conv;
 }
 
 // TODO: @client this should allow TLVs to be added to the message
@@ -290,9 +407,9 @@ localize_error_message(struct otrng_client_s *client,
   }
 }
 
-API /*@null@*/ char *otrng_client_query_message(const char *recipient,
-                                                const char *msg,
-                                                otrng_client_s *client) {
+tstatic /*@null@*/ char *client_query_message(const char *recipient,
+                                              const char *msg,
+                                              otrng_client_s *client) {
   char *ret = NULL;
   otrng_conversation_s *conv = NULL;
   conv = get_or_create_conversation_with(recipient, client);
@@ -307,8 +424,20 @@ API /*@null@*/ char *otrng_client_query_message(const char *recipient,
   return ret;
 }
 
-API /*@null@*/ char *otrng_client_identity_message(const char *recipient,
-                                                   otrng_client_s *client) {
+API /*@null@*/ char *otrng_client_query_message(const char *recipient,
+                                                const char *msg,
+                                                otrng_client_s *client) {
+  char *ret;
+
+  otrng_client_lock(client);
+  ret = client_query_message(recipient, msg, client);
+  otrng_client_unlock(client);
+
+  return ret;
+}
+
+tstatic /*@null@*/ char *client_identity_message(const char *recipient,
+                                                 otrng_client_s *client) {
   char *ret = NULL;
   otrng_conversation_s *conv = NULL;
   conv = get_or_create_conversation_with(recipient, client);
@@ -328,9 +457,20 @@ API /*@null@*/ char *otrng_client_identity_message(const char *recipient,
   return ret;
 }
 
-API /*@null@*/ char *otrng_client_init_message(const char *recipient,
-                                               const char *msg,
-                                               otrng_client_s *client) {
+API /*@null@*/ char *otrng_client_identity_message(const char *recipient,
+                                                   otrng_client_s *client) {
+  char *ret;
+
+  otrng_client_lock(client);
+  ret = client_identity_message(recipient, client);
+  otrng_client_unlock(client);
+
+  return ret;
+}
+
+tstatic /*@null@*/ char *client_init_message(const char *recipient,
+                                             const char *msg,
+                                             otrng_client_s *client) {
   char *ret = NULL;
   otrng_conversation_s *conv = NULL;
   conv = get_or_create_conversation_with(recipient, client);
@@ -355,15 +495,52 @@ API /*@null@*/ char *otrng_client_init_message(const char *recipient,
   return ret;
 }
 
+API /*@null@*/ char *otrng_client_init_message(const char *recipient,
+                                               const char *msg,
+                                               otrng_client_s *client) {
+  char *ret;
+
+  otrng_client_lock(client);
+  ret = client_init_message(recipient, msg, client);
+  otrng_client_unlock(client);
+
+  return ret;
+}
+
 API otrng_result otrng_client_send(char **new_msg, const char *msg,
                                    const char *recipient,
                                    otrng_client_s *client) {
+  otrng_result result;
+
   /* v4 client will know how to transition to v3 if a v3 conversation is
    started */
-  return send_message(new_msg, msg, recipient, client);
+  otrng_client_lock(client);
+  result = send_message(new_msg, msg, recipient, client);
+  otrng_client_unlock(client);
+
+  return result;
 }
 
-API otrng_result otrng_client_send_non_interactive_auth(
+API otrng_result otrng_client_send_batch(char **new_msgs, size_t *sent,
+                                         const char *const *msgs, size_t count,
+                                         const char *recipient,
+                                         otrng_client_s *client) {
+  otrng_conversation_s *conv = NULL;
+  otrng_result result = OTRNG_ERROR;
+
+  *sent = 0;
+
+  otrng_client_lock(client);
+  conv = get_or_create_conversation_with(recipient, client);
+  if (conv) {
+    result = otrng_send_messages(new_msgs, sent, msgs, count, 0, conv->conn);
+  }
+  otrng_client_unlock(client);
+
+  return result;
+}
+
+tstatic otrng_result client_send_non_interactive_auth(
     char **new_msg, const prekey_ensemble_s *ensemble, const char *recipient,
     otrng_client_s *client) {
   otrng_conversation_s *conv =
@@ -387,10 +564,23 @@ API otrng_result otrng_client_send_non_interactive_auth(
   return otrng_send_non_interactive_auth(new_msg, ensemble, conv->conn);
 }
 
-API otrng_result otrng_client_send_fragment(otrng_message_to_send_s **new_msg,
-                                            const char *msg, int mms,
-                                            const char *recipient,
-                                            otrng_client_s *client) {
+API otrng_result otrng_client_send_non_interactive_auth(
+    char **new_msg, const prekey_ensemble_s *ensemble, const char *recipient,
+    otrng_client_s *client) {
+  otrng_result result;
+
+  otrng_client_lock(client);
+  result =
+      client_send_non_interactive_auth(new_msg, ensemble, recipient, client);
+  otrng_client_unlock(client);
+
+  return result;
+}
+
+tstatic otrng_result client_send_fragment(otrng_message_to_send_s **new_msg,
+                                          const char *msg, int mms,
+                                          const char *recipient,
+                                          otrng_client_s *client) {
   otrng_conversation_s *conv = NULL;
   string_p to_send = NULL;
   uint32_t our_tag, their_tag;
@@ -412,13 +602,27 @@ API otrng_result otrng_client_send_fragment(otrng_message_to_send_s **new_msg,
   their_tag = conv->conn->their_instance_tag;
 
   if (to_send) {
-    ret = otrng_fragment_message(mms, *new_msg, our_tag, their_tag, to_send);
+    ret = otrng_fragment_message_contiguous(mms, *new_msg, our_tag, their_tag,
+                                            to_send);
     otrng_free(to_send);
   }
 
   return ret;
 }
 
+API otrng_result otrng_client_send_fragment(otrng_message_to_send_s **new_msg,
+                                            const char *msg, int mms,
+                                            const char *recipient,
+                                            otrng_client_s *client) {
+  otrng_result result;
+
+  otrng_client_lock(client);
+  result = client_send_fragment(new_msg, msg, mms, recipient, client);
+  otrng_client_unlock(client);
+
+  return result;
+}
+
 API otrng_result otrng_client_smp_start(char **to_send, const char *recipient,
                                         const unsigned char *question,
                                         const size_t q_len,
@@ -426,14 +630,17 @@ API otrng_result otrng_client_smp_start(char **to_send, const char *recipient,
                                         size_t secret_len,
                                         otrng_client_s *client) {
   otrng_conversation_s *conv = NULL;
+  otrng_result result = OTRNG_ERROR;
 
+  otrng_client_lock(client);
   conv = get_or_create_conversation_with(recipient, client);
-  if (!conv) {
-    return OTRNG_ERROR;
+  if (conv) {
+    result = otrng_smp_start(to_send, question, q_len, secret, secret_len,
+                             conv->conn);
   }
+  otrng_client_unlock(client);
 
-  return otrng_smp_start(to_send, question, q_len, secret, secret_len,
-                         conv->conn);
+  return result;
 }
 
 API otrng_result otrng_client_smp_respond(char **to_send, const char *recipient,
@@ -441,31 +648,38 @@ API otrng_result otrng_client_smp_respond(char **to_send, const char *recipient,
                                           size_t secret_len,
                                           otrng_client_s *client) {
   otrng_conversation_s *conv = NULL;
+  otrng_result result = OTRNG_ERROR;
 
+  otrng_client_lock(client);
   conv = get_or_create_conversation_with(recipient, client);
-  if (!conv) {
-    return OTRNG_ERROR;
+  if (conv) {
+    result = otrng_smp_continue(to_send, secret, secret_len, conv->conn);
   }
+  otrng_client_unlock(client);
 
-  return otrng_smp_continue(to_send, secret, secret_len, conv->conn);
+  return result;
 }
 
 API otrng_result otrng_client_smp_abort(char **to_send, const char *recipient,
                                         otrng_client_s *client) {
   otrng_conversation_s *conv = NULL;
+  otrng_result result = OTRNG_ERROR;
 
+  otrng_client_lock(client);
   conv = get_or_create_conversation_with(recipient, client);
-  if (!conv) {
-    return OTRNG_ERROR;
+  if (conv) {
+    result = otrng_smp_abort(to_send, conv->conn);
   }
+  otrng_client_unlock(client);
 
-  return otrng_smp_abort(to_send, conv->conn);
+  return result;
 }
 
-API otrng_result otrng_client_receive(char **new_msg, char **to_display,
-                                      const char *msg, const char *recipient,
-                                      otrng_client_s *client,
-                                      otrng_bool *should_ignore) {
+static otrng_result client_receive(char **new_msg, char **to_display,
+                                   const char *msg, otrng_bool writable,
+                                   const char *recipient,
+                                   otrng_client_s *client,
+                                   otrng_bool *should_ignore) {
   otrng_result result = OTRNG_ERROR;
   otrng_response_s *response = NULL;
   otrng_conversation_s *conv = NULL;
@@ -490,30 +704,80 @@ API otrng_result otrng_client_receive(char **new_msg, char **to_display,
 
   response = otrng_response_new();
 
-  result = otrng_receive_message(response, msg, conv->conn);
-
-  if (response->to_send) {
-    *new_msg = otrng_xstrdup(response->to_send);
+  if (writable) {
+    result = otrng_receive_message_in_place(response, (char *)msg, conv->conn);
+  } else {
+    result = otrng_receive_message(response, msg, conv->conn);
   }
 
-  *to_display = NULL;
-  if (response->to_display) {
-    char *plain = otrng_xstrdup(response->to_display);
-    *to_display = plain;
-    otrng_response_free(response);
+  /* Hand the response over, instead of copying it */
+  *new_msg = response->to_send;
+  response->to_send = NULL;
+
+  *to_display = response->to_display;
+  response->to_display = NULL;
+
+  otrng_response_free(response);
+
+  if (*to_display) {
     return OTRNG_SUCCESS;
   }
 
-  otrng_response_free(response);
+  return result;
+}
+
+API otrng_result otrng_client_receive(char **new_msg, char **to_display,
+                                      const char *msg, const char *recipient,
+                                      otrng_client_s *client,
+                                      otrng_bool *should_ignore) {
+  otrng_result result;
+
+  if (!client) {
+    return OTRNG_ERROR;
+  }
+
+  otrng_client_lock(client);
+  result = client_receive(new_msg, to_display, msg, otrng_false, recipient,
+                          client, should_ignore);
+  otrng_client_unlock(client);
+
+  return result;
+}
+
+API otrng_result otrng_client_receive_in_place(char **new_msg,
+                                               char **to_display, char *msg,
+                                               const char *recipient,
+                                               otrng_client_s *client,
+                                               otrng_bool *should_ignore) {
+  otrng_result result;
+
+  if (!client) {
+    return OTRNG_ERROR;
+  }
+
+  otrng_client_lock(client);
+  result = client_receive(new_msg, to_display, msg, otrng_true, recipient,
+                          client, should_ignore);
+  otrng_client_unlock(client);
 
   return result;
 }
 
 tstatic void destroy_client_conversation(const otrng_conversation_s *conv,
                                          otrng_client_s *client) {
-  list_element_s *elem = otrng_list_get_by_value(conv, client->conversations);
-  client->conversations =
-      otrng_list_remove_element(elem, client->conversations);
+  conversation_key_s key;
+  list_element_s *elem =
+      otrng_list_get_by_value(conv, client->conversations.head);
+  if (!elem) {
+    return;
+  }
+
+  key.recipient = conv->recipient;
+  key.their_instance_tag = conv->their_instance_tag;
+  otrng_hash_index_remove(&client->conversations_index,
+                          hash_conversation_key(client, &key), conv);
+
+  otrng_list_unlink(&client->conversations, elem);
   otrng_list_free_nodes(elem);
 }
 
@@ -531,16 +795,17 @@ INTERNAL otrng_result otrng_client_disconnect_conversation(
 
 API otrng_result otrng_client_disconnect(char **new_msg, const char *recipient,
                                          otrng_client_s *client) {
-  otrng_conversation_s *conv =
-      get_conversation_with(recipient, client->conversations);
-  if (!conv) {
-    return OTRNG_ERROR;
+  otrng_conversation_s *conv;
+  otrng_result result = OTRNG_ERROR;
+
+  otrng_client_lock(client);
+  conv = get_conversation_with(recipient, client);
+  if (conv) {
+    result = otrng_client_disconnect_conversation(new_msg, conv);
   }
-  return otrng_client_disconnect_conversation(new_msg, conv);
-}
+  otrng_client_unlock(client);
 
-tstatic uint32_t get_session_expiry_time_from(otrng_s *otr) {
-  return otr->client->global_state->callbacks->session_expiration_time_for(otr);
+  return result;
 }
 
 INTERNAL void otrng_client_expire_session(otrng_conversation_s *conv) {
@@ -557,12 +822,23 @@ INTERNAL void otrng_client_expire_session(otrng_conversation_s *conv) {
 
   switch (expiration_policy) {
   case OTRNG_SESSION_EXPIRY_DO_TEARDOWN:
-    res = otrng_client_disconnect_conversation(&msg, conv);
-    if (msg != NULL && !otrng_failed(res)) {
+    res = otrng_close(&msg, otr);
+    if (otrng_failed(res)) {
+      schedule_session_expiry(conv, time(NULL));
+      break;
+    }
+
+    /* The callback is given the connection, so the message is sent before
+     * the conversation is freed */
+    if (msg != NULL) {
       otr->client->global_state->callbacks->inject_message(otr, msg);
     }
+
+    destroy_client_conversation(conv, otr->client);
+    conversation_free(conv);
     break;
   case OTRNG_SESSION_EXPIRY_DO_NOTHING:
+    schedule_session_expiry(conv, time(NULL));
     break;
   /* case OTRNG_SESSION_EXPIRY_DO_RESTART_WITH_QUERY: */
   /*   break; */
@@ -573,36 +849,13 @@ INTERNAL void otrng_client_expire_session(otrng_conversation_s *conv) {
   }
 }
 
-INTERNAL void otrng_client_expire_sessions(otrng_client_s *client) {
-  const list_element_s *el = NULL;
-  otrng_conversation_s *conv = NULL;
-  time_t now;
-  uint32_t expiration_time;
-
-  now = time(NULL);
-
-  for (el = client->conversations; el; el = el->next) {
-
-    if (!conv) {
-      return;
-    }
-
-    conv = el->data;
-    expiration_time = get_session_expiry_time_from(conv->conn);
-
-    if (conv->conn->keys->last_generated < now - expiration_time) {
-      otrng_client_expire_session(conv);
-    }
-  }
-}
-
 INTERNAL otrng_result otrng_client_expire_fragments(otrng_client_s *client) {
   const list_element_s *el = NULL;
   otrng_conversation_s *conv = NULL;
   time_t now;
 
   now = time(NULL);
-  for (el = client->conversations; el; el = el->next) {
+  for (el = client->conversations.head; el; el = el->next) {
     conv = el->data;
     if (otrng_failed(otrng_expire_fragments(now, client->fragments_exp_time,
                                             &conv->conn->pending_fragments))) {
@@ -644,7 +897,7 @@ INTERNAL void otrng_client_store_my_prekey_message(prekey_message_s *msg,
     return;
   }
 
-  client->our_prekeys = otrng_list_add(msg, client->our_prekeys);
+  otrng_list_append(&client->our_prekeys, msg);
 }
 
 API /*@null@*/ prekey_message_s **
@@ -652,7 +905,8 @@ otrng_client_build_prekey_messages(uint8_t num_messages,
                                    otrng_client_s *client) {
   uint32_t instance_tag;
   prekey_message_s **messages;
-  int i, j;
+  size_t threads = 1;
+  int i;
 
   if (num_messages > MAX_NUMBER_PUBLISHED_PREKEY_MSGS) {
     otrng_client_callbacks_handle_event(
@@ -661,31 +915,28 @@ otrng_client_build_prekey_messages(uint8_t num_messages,
     return NULL;
   }
 
+  otrng_client_lock(client);
   instance_tag = otrng_client_get_instance_tag(client);
+  otrng_client_unlock(client);
 
   messages = otrng_xmalloc_z(num_messages * sizeof(prekey_message_s *));
 
-  for (i = 0; i < num_messages; i++) {
-    ecdh_keypair_s ecdh;
-    dh_keypair_s dh;
-    if (!otrng_generate_ephemeral_keys(&ecdh, &dh)) {
-      otrng_free(messages);
-      return NULL;
-    }
-
-    messages[i] = otrng_prekey_message_build(instance_tag, &ecdh, &dh);
-    otrng_dh_keypair_destroy(&dh);
+  if (client->global_state) {
+    threads = client->global_state->worker_threads;
+  }
 
-    if (!messages[i]) {
-      for (j = 0; j < i; j++) {
-        otrng_prekey_message_free(messages[j]);
-      }
-      otrng_free(messages);
-      return NULL;
-    }
+  if (!otrng_prekey_messages_generate(messages, num_messages, instance_tag,
+                                      threads)) {
+    otrng_free(messages);
+    return NULL;
+  }
 
+  /* The messages are generated without holding the lock */
+  otrng_client_lock(client);
+  for (i = 0; i < num_messages; i++) {
     otrng_client_store_my_prekey_message(messages[i], client);
   }
+  otrng_client_unlock(client);
 
   return messages;
 }
@@ -713,7 +964,7 @@ API void otrng_client_debug_print(FILE *f, int indent, otrng_client_s *c) {
   } else {
     debug_api_print(f, "conversations = {\n");
     ix = 0;
-    curr = c->conversations;
+    curr = c->conversations.head;
     while (curr) {
       otrng_print_indent(f, indent + 4);
       debug_api_print(f, "[%d] = {\n", ix);
@@ -808,9 +1059,15 @@ API void otrng_conversation_debug_print(FILE *f, int indent,
 
 INTERNAL OtrlPrivKey *
 otrng_client_get_private_key_v3(const otrng_client_s *client) {
-  return otrl_privkey_find(client->global_state->user_state_v3,
-                           client->client_id.account,
-                           client->client_id.protocol);
+  OtrlPrivKey *key;
+
+  otrng_global_state_lock_v3(client->global_state);
+  key = otrl_privkey_find(client->global_state->user_state_v3,
+                          client->client_id.account,
+                          client->client_id.protocol);
+  otrng_global_state_unlock_v3(client->global_state);
+
+  return key;
 }
 
 INTERNAL otrng_keypair_s *otrng_client_get_keypair_v4(otrng_client_s *client) {
@@ -1035,33 +1292,44 @@ tstatic void otrl_userstate_instance_tag_add(OtrlUserState us,
   us->instag_root = instag;
 }
 
-INTERNAL unsigned int otrng_client_get_instance_tag(otrng_client_s *client) {
+INTERNAL void otrng_client_refresh_instance_tag(otrng_client_s *client) {
   OtrlInsTag *instag;
 
-  if (client->global_state->user_state_v3 == NULL) {
-    return (unsigned int)0;
+  client->instance_tag = 0;
+
+  if (!client->global_state || client->global_state->user_state_v3 == NULL) {
+    return;
   }
 
-  //  fprintf(stderr,"first: %s\n",
-  //  client->global_state->user_state_v3->instag_root->accountname);
+  otrng_global_state_lock_v3(client->global_state);
   instag =
       otrl_instag_find(client->global_state->user_state_v3,
                        client->client_id.account, client->client_id.protocol);
 
-  if (!instag) {
-    otrng_client_callbacks_create_instag(client->global_state->callbacks,
-                                         client);
+  if (instag) {
+    client->instance_tag = instag->instag;
   }
+  otrng_global_state_unlock_v3(client->global_state);
+}
 
-  instag =
-      otrl_instag_find(client->global_state->user_state_v3,
-                       client->client_id.account, client->client_id.protocol);
+INTERNAL unsigned int otrng_client_get_instance_tag(otrng_client_s *client) {
+  if (client->instance_tag) {
+    return client->instance_tag;
+  }
 
-  if (!instag) {
+  if (client->global_state->user_state_v3 == NULL) {
     return (unsigned int)0;
   }
 
-  return instag->instag;
+  otrng_client_refresh_instance_tag(client);
+  if (!client->instance_tag) {
+    /* The callback may add the tag to the v3 user state directly */
+    otrng_client_callbacks_create_instag(client->global_state->callbacks,
+                                         client);
+    otrng_client_refresh_instance_tag(client);
+  }
+
+  return client->instance_tag;
 }
 
 INTERNAL otrng_result otrng_client_add_instance_tag(otrng_client_s *client,
@@ -1076,9 +1344,11 @@ INTERNAL otrng_result otrng_client_add_instance_tag(otrng_client_s *client,
     return OTRNG_ERROR;
   }
 
+  otrng_global_state_lock_v3(client->global_state);
   p = otrl_instag_find(client->global_state->user_state_v3,
                        client->client_id.account, client->client_id.protocol);
   if (p) {
+    otrng_global_state_unlock_v3(client->global_state);
     return OTRNG_ERROR;
   }
 
@@ -1086,10 +1356,14 @@ INTERNAL otrng_result otrng_client_add_instance_tag(otrng_client_s *client,
                              client->client_id.account, instag);
 
   if (!p) {
+    otrng_global_state_unlock_v3(client->global_state);
     return OTRNG_ERROR;
   }
 
   otrl_userstate_instance_tag_add(client->global_state->user_state_v3, p);
+  otrng_global_state_unlock_v3(client->global_state);
+  client->instance_tag = instag;
+
   return OTRNG_SUCCESS;
 }
 
@@ -1113,7 +1387,8 @@ get_stored_prekey_node_by_id(uint32_t id, list_element_s *l) {
 
 INTERNAL /*@null@*/ const prekey_message_s *
 otrng_client_get_prekey_by_id(uint32_t id, const otrng_client_s *client) {
-  list_element_s *node = get_stored_prekey_node_by_id(id, client->our_prekeys);
+  list_element_s *node =
+      get_stored_prekey_node_by_id(id, client->our_prekeys.head);
   if (!node) {
     return NULL;
   }
@@ -1124,12 +1399,13 @@ otrng_client_get_prekey_by_id(uint32_t id, const otrng_client_s *client) {
 INTERNAL void
 otrng_client_delete_my_prekey_message_by_id(uint32_t id,
                                             otrng_client_s *client) {
-  list_element_s *node = get_stored_prekey_node_by_id(id, client->our_prekeys);
+  list_element_s *node =
+      get_stored_prekey_node_by_id(id, client->our_prekeys.head);
   if (!node) {
     return;
   }
 
-  client->our_prekeys = otrng_list_remove_element(node, client->our_prekeys);
+  otrng_list_unlink(&client->our_prekeys, node);
   otrng_list_free(node, prekey_message_free_from_list);
   client->global_state->callbacks->store_prekey_messages(client);
 }
@@ -1211,7 +1487,7 @@ API void otrng_client_failed_published(otrng_client_s *client) {
 
   client->client_profile->is_publishing = otrng_false;
   client->prekey_profile->is_publishing = otrng_false;
-  for (current = client->our_prekeys; current != NULL;
+  for (current = client->our_prekeys.head; current != NULL;
        current = current->next) {
     prekey_message_s *pm = current->data;
     pm->is_publishing = otrng_false;
@@ -1236,7 +1512,7 @@ API void otrng_client_published(otrng_client_s *client) {
     client->global_state->callbacks->store_prekey_profile(client);
   }
 
-  for (current = client->our_prekeys; current != NULL;
+  for (current = client->our_prekeys.head; current != NULL;
        current = current->next) {
     prekey_message_s *pm = current->data;
     if (pm->is_publishing) {
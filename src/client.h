@@ -28,10 +28,14 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <pthread.h>
+
+#include "hash_index.h"
 #include "list.h"
 #include "otrng.h"
 #include "prekey_manager.h"
 #include "shared.h"
+#include "timers.h"
 
 // TODO: @client REMOVE
 typedef struct otrng_conversation_s {
@@ -41,7 +45,11 @@ typedef struct otrng_conversation_s {
                           Pidgin) this could be a PurpleConversation */
 
   char *recipient;
+  uint32_t their_instance_tag; /* 0 if the conversation is not bound to one of
+                                  the recipient's instances */
   otrng_s *conn;
+
+  otrng_timer_s session_timer; /* when the session may have expired */
 } otrng_conversation_s;
 
 typedef struct otrng_client_id_s {
@@ -51,7 +59,8 @@ typedef struct otrng_client_id_s {
 
 /* A client handle messages from/to a sender to/from multiple recipients. */
 typedef struct otrng_client_s {
-  list_element_s *conversations;
+  list_s conversations;
+  hash_index_s conversations_index; /* by (recipient, their_instance_tag) */
 
   otrng_client_id_s client_id;
 
@@ -64,7 +73,7 @@ typedef struct otrng_client_s {
   otrng_client_profile_s *exp_client_profile;
   otrng_prekey_profile_s *prekey_profile;
   otrng_prekey_profile_s *exp_prekey_profile;
-  list_element_s *our_prekeys; /* prekey_message_s */
+  list_s our_prekeys; /* prekey_message_s */
 
   unsigned int max_stored_msg_keys;
   unsigned int max_published_prekey_msg;
@@ -87,8 +96,11 @@ typedef struct otrng_client_s {
   uint32_t prekey_msgs_num_to_publish;
 
   // OtrlPrivKey *privkeyv3; // ???
-  // otrng_instag_s *instag; // TODO: @client Store the instance tag here rather
-  // than use v3 User State as a store for instance tags
+
+  /* Our instance tag, or 0 if it is not known yet. The v3 user state is still
+     where instance tags are read from and written to, but looking a tag up
+     there walks every account, so it is done only when the tag changes. */
+  uint32_t instance_tag;
 
   otrng_known_fingerprints_s *fingerprints;
 
@@ -99,12 +111,34 @@ typedef struct otrng_client_s {
   */
   // TODO: @prekey - this should be freed
   /*@null@*/ otrng_prekey_manager_s *prekey_manager;
+
+  /* Held by every function that uses the conversations, the keys or the
+     prekey manager of this client, and while calling back into the
+     messaging application for one of them. It is recursive, so callbacks may
+     call back into the client. */
+  pthread_mutex_t lock;
 } otrng_client_s;
 
 API otrng_client_s *otrng_client_new(const otrng_client_id_s client_id);
 
 API void otrng_client_free(otrng_client_s *client);
 
+/**
+ * @brief Takes the lock of the client. The API functions that receive a
+ * client take it themselves; this is for using the conversations returned by
+ * otrng_client_get_conversation() from more than one thread.
+ *
+ * @param [client]  The client.
+ */
+API void otrng_client_lock(otrng_client_s *client);
+
+/**
+ * @brief Releases the lock taken by otrng_client_lock().
+ *
+ * @param [client]  The client.
+ */
+API void otrng_client_unlock(otrng_client_s *client);
+
 API /*@null@*/ otrng_conversation_s *
 otrng_client_get_conversation(int force_create, const char *recipient,
                               otrng_client_s *client);
@@ -128,6 +162,29 @@ API otrng_result otrng_client_send(char **new_msg, const char *msg,
                                    const char *recipient,
                                    otrng_client_s *client);
 
+/**
+ * @brief Sends several messages to the same recipient at once. In an OTRv4
+ * conversation, the consecutive keys are derived in one pass and the messages
+ * are built in a shared buffer, which is cheaper than calling
+ * otrng_client_send for each of them.
+ *
+ * If a message fails, the ones after it are not sent. The ones before it
+ * have used up their keys, so they are still returned: send them, or the
+ * other side will see them as lost.
+ *
+ * @param [new_msgs]  An array of [count] messages to send, in order. Only the
+ *                    first [sent] are set, and each of them has to be freed.
+ * @param [sent]      How many messages were prepared to send.
+ * @param [msgs]      The [count] messages.
+ * @param [count]     The number of messages.
+ * @param [recipient] Who to send them to.
+ * @param [client]    The client.
+ */
+API otrng_result otrng_client_send_batch(char **new_msgs, size_t *sent,
+                                         const char *const *msgs, size_t count,
+                                         const char *recipient,
+                                         otrng_client_s *client);
+
 API otrng_result otrng_client_send_non_interactive_auth(
     char **new_msg, const prekey_ensemble_s *ensemble, const char *recipient,
     otrng_client_s *client);
@@ -157,13 +214,28 @@ API otrng_result otrng_client_receive(char **new_msg, char **to_display,
                                       otrng_client_s *client,
                                       otrng_bool *should_ignore);
 
+/**
+ * @brief Receives a message like otrng_client_receive, but [msg] is used as
+ * the working buffer: it is decoded over itself, so its contents are lost.
+ *
+ * @param [new_msg]       The message to send in response, if any.
+ * @param [to_display]    The message to display, if any.
+ * @param [msg]           The received message. It is overwritten.
+ * @param [recipient]     Who the message comes from.
+ * @param [client]        The client.
+ * @param [should_ignore] Set if the message should be ignored.
+ */
+API otrng_result otrng_client_receive_in_place(char **new_msg,
+                                               char **to_display, char *msg,
+                                               const char *recipient,
+                                               otrng_client_s *client,
+                                               otrng_bool *should_ignore);
+
 API otrng_result otrng_client_disconnect(char **new_msg, const char *recipient,
                                          otrng_client_s *client);
 
 INTERNAL void otrng_client_expire_session(otrng_conversation_s *conv);
 
-INTERNAL void otrng_client_expire_sessions(otrng_client_s *client);
-
 /**
  * @brief Expires old fragments based on the threshold set in the client struct
  *
@@ -236,6 +308,15 @@ INTERNAL unsigned int otrng_client_get_instance_tag(otrng_client_s *client);
 INTERNAL otrng_result otrng_client_add_instance_tag(otrng_client_s *client,
                                                     unsigned int instag);
 
+/**
+ * @brief Looks up the instance tag of the client in the v3 user state again.
+ * This must be called whenever instance tags are read into, or generated in,
+ * the v3 user state without going through the client.
+ *
+ * @param [client]  The client.
+ */
+INTERNAL void otrng_client_refresh_instance_tag(otrng_client_s *client);
+
 INTERNAL /*@null@*/ const prekey_message_s *
 otrng_client_get_prekey_by_id(uint32_t id, const otrng_client_s *client);
 
@@ -289,6 +370,11 @@ API void otrng_conversation_debug_print(FILE *, int, otrng_conversation_s *);
 
 #ifdef OTRNG_CLIENT_PRIVATE
 
+tstatic void conversation_free(void *data);
+
+tstatic void destroy_client_conversation(const otrng_conversation_s *conv,
+                                         otrng_client_s *client);
+
 tstatic uint64_t
 otrng_client_get_client_profile_exp_time(otrng_client_s *client);
 
@@ -443,7 +443,7 @@ tstatic void create_new_prekey_messages(otrng_client_s *client) {
   prekey_message_s **messages;
   size_t ix;
   uint8_t to_publish =
-      client->max_published_prekey_msg - otrng_list_len(client->our_prekeys);
+      client->max_published_prekey_msg - client->our_prekeys.len;
 
   if (client->prekey_msgs_num_to_publish > to_publish) {
     to_publish = client->prekey_msgs_num_to_publish;
@@ -470,7 +470,7 @@ tstatic void load_prekey_messages_from_storage(otrng_client_s *client) {
 }
 
 tstatic otrng_bool verify_enough_prekey_messages(otrng_client_s *client) {
-  if (otrng_list_len(client->our_prekeys) >=
+  if (client->our_prekeys.len >=
       client->minimum_stored_prekey_msg) {
     return otrng_true;
   }
@@ -556,7 +556,7 @@ tstatic void load_fingerprints_v3_from_storage(otrng_client_s *client) {
 }
 
 tstatic void create_fingerprints(otrng_client_s *client) {
-  client->fingerprints = otrng_xmalloc_z(sizeof(otrng_known_fingerprints_s));
+  client->fingerprints = otrng_known_fingerprints_new();
 }
 
 tstatic void create_fingerprints_v3(otrng_client_s *client) {
@@ -752,7 +752,7 @@ verify_transitional_signature(const otrng_client_profile_s *client_profile) {
   return otrng_true;
 }
 
-static otrng_bool client_profile_valid_without_expiry(
+INTERNAL otrng_bool otrng_client_profile_valid_without_expiry(
     const otrng_client_profile_s *client_profile,
     const uint32_t sender_instance_tag) {
   if (!client_profile_verify_signature(client_profile)) {
@@ -785,8 +785,8 @@ static otrng_bool client_profile_valid_without_expiry(
 INTERNAL otrng_bool
 otrng_client_profile_valid(const otrng_client_profile_s *client_profile,
                            const uint32_t sender_instance_tag) {
-  if (!client_profile_valid_without_expiry(client_profile,
-                                           sender_instance_tag)) {
+  if (!otrng_client_profile_valid_without_expiry(client_profile,
+                                                 sender_instance_tag)) {
     return otrng_false;
   }
 
@@ -818,7 +818,7 @@ INTERNAL otrng_bool otrng_client_profile_is_close_to_expiry(
 INTERNAL otrng_bool otrng_client_profile_is_expired_but_valid(
     const otrng_client_profile_s *profile, uint32_t itag,
     uint64_t extra_valid_time) {
-  return client_profile_valid_without_expiry(profile, itag) &&
+  return otrng_client_profile_valid_without_expiry(profile, itag) &&
          client_profile_expired(profile->expires) &&
          !client_profile_invalid(profile->expires, extra_valid_time);
 }
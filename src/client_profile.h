@@ -130,6 +130,13 @@ INTERNAL otrng_bool otrng_client_profile_is_expired_but_valid(
 INTERNAL otrng_bool otrng_client_profile_valid(
     const otrng_client_profile_s *profile, const uint32_t sender_instance_tag);
 
+/**
+ * @brief Checks everything otrng_client_profile_valid does, except for the
+ * expiration: the signatures, the instance tag, the versions and the keys.
+ */
+INTERNAL otrng_bool otrng_client_profile_valid_without_expiry(
+    const otrng_client_profile_s *profile, const uint32_t sender_instance_tag);
+
 INTERNAL otrng_bool otrng_client_profile_fast_valid(
     otrng_client_profile_s *profile, const uint32_t sender_instance_tag);
 
@@ -662,7 +662,8 @@ INTERNAL otrng_result otrng_dake_non_interactive_auth_message_deserialize(
 
 INTERNAL otrng_bool otrng_valid_received_values(
     const uint32_t sender_instance_tag, const ec_point their_ecdh,
-    const dh_mpi their_dh, const otrng_client_profile_s *profile) {
+    const dh_mpi their_dh, const otrng_client_profile_s *profile,
+    otrng_profile_cache_s *profiles) {
   /* Verify that the point their_ecdh received is on curve 448. */
   if (!otrng_ec_point_valid(their_ecdh)) {
     return otrng_false;
@@ -674,7 +675,8 @@ INTERNAL otrng_bool otrng_valid_received_values(
   }
 
   /* Verify their profile is valid (and not expired). */
-  if (!otrng_client_profile_valid(profile, sender_instance_tag)) {
+  if (!otrng_profile_cache_client_profile_valid(profiles, profile,
+                                                sender_instance_tag)) {
     return otrng_false;
   }
 
@@ -28,6 +28,7 @@
 #include "ed448.h"
 #include "prekey_message.h"
 #include "prekey_profile.h"
+#include "profile_cache.h"
 #include "shared.h"
 
 typedef struct dake_identity_message_s {
@@ -77,9 +78,19 @@ typedef struct {
   dh_mpi dh;
 } otrng_dake_participant_data_s;
 
+/**
+ * @brief Validates the keys and the client profile received in a DAKE message.
+ *
+ * @param [sender_instance_tag]  The instance tag the message was sent from.
+ * @param [their_ecdh]           Their ECDH key.
+ * @param [their_dh]             Their DH key.
+ * @param [profile]              Their client profile.
+ * @param [profiles]             Where verdicts on profiles are cached, or NULL.
+ */
 INTERNAL otrng_bool otrng_valid_received_values(
     const uint32_t sender_instance_tag, const ec_point their_ecdh,
-    const dh_mpi their_dh, const otrng_client_profile_s *profile);
+    const dh_mpi their_dh, const otrng_client_profile_s *profile,
+    /*@null@*/ otrng_profile_cache_s *profiles);
 
 INTERNAL otrng_result otrng_dake_non_interactive_auth_message_deserialize(
     dake_non_interactive_auth_message_s *dst, const uint8_t *buffer,
@@ -46,20 +46,23 @@ INTERNAL void otrng_data_message_free(data_message_s *data_msg) {
   otrng_ec_point_destroy(data_msg->ecdh);
   otrng_dh_mpi_release(data_msg->dh);
   otrng_secure_wipe(data_msg->nonce, DATA_MSG_NONCE_BYTES);
-  otrng_free(data_msg->enc_msg);
+  if (!data_msg->body) {
+    otrng_free(data_msg->enc_msg);
+  }
   otrng_secure_wipe(data_msg->mac, DATA_MSG_MAC_BYTES);
 
   otrng_free(data_msg);
 }
 
-INTERNAL otrng_result otrng_data_message_body_serialize(
-    uint8_t **body, size_t *body_len, const data_message_s *data_msg) {
-  size_t size = DATA_MSG_MAX_BYTES + data_msg->enc_msg_len;
-  uint8_t *cursor;
+INTERNAL size_t otrng_data_message_body_serialize_into(
+    uint8_t *dst, size_t dst_len, const data_message_s *data_msg) {
+  uint8_t *cursor = dst;
   size_t len = 0;
-  uint8_t *dst = otrng_xmalloc_z(size);
 
-  cursor = dst;
+  if (dst_len < DATA_MSG_MAX_BYTES + data_msg->enc_msg_len) {
+    return 0;
+  }
+
   cursor += otrng_serialize_uint16(cursor, OTRNG_PROTOCOL_VERSION_4);
   cursor += otrng_serialize_uint8(cursor, DATA_MSG_TYPE);
   cursor += otrng_serialize_uint32(cursor, data_msg->sender_instance_tag);
@@ -68,43 +71,65 @@ INTERNAL otrng_result otrng_data_message_body_serialize(
   cursor += otrng_serialize_uint32(cursor, data_msg->previous_chain_n);
   cursor += otrng_serialize_uint32(cursor, data_msg->ratchet_id);
   cursor += otrng_serialize_uint32(cursor, data_msg->message_id);
-  cursor += otrng_serialize_ec_point(cursor, data_msg->ecdh);
 
-  // TODO: @freeing @sanitizer This could be NULL. We need to test.
-  if (!otrng_serialize_dh_public_key(cursor, (size - (cursor - dst)), &len,
-                                     data_msg->dh)) {
-    otrng_free(dst);
-    return OTRNG_ERROR;
+  if (data_msg->keys_enc) {
+    memcpy(cursor, data_msg->keys_enc->ecdh_enc, ED448_POINT_BYTES);
+    cursor += ED448_POINT_BYTES;
+    memcpy(cursor, data_msg->keys_enc->dh_enc, data_msg->keys_enc->dh_enc_len);
+    cursor += data_msg->keys_enc->dh_enc_len;
+  } else {
+    cursor += otrng_serialize_ec_point(cursor, data_msg->ecdh);
+
+    // TODO: @freeing @sanitizer This could be NULL. We need to test.
+    if (!otrng_serialize_dh_public_key(cursor, (dst_len - (cursor - dst)), &len,
+                                       data_msg->dh)) {
+      return 0;
+    }
+    cursor += len;
   }
-  cursor += len;
+
   cursor += otrng_serialize_bytes_array(cursor, data_msg->nonce,
                                         DATA_MSG_NONCE_BYTES);
   cursor +=
       otrng_serialize_data(cursor, data_msg->enc_msg, data_msg->enc_msg_len);
 
+  return cursor - dst;
+}
+
+INTERNAL otrng_result otrng_data_message_body_serialize(
+    uint8_t **body, size_t *body_len, const data_message_s *data_msg) {
+  size_t size = DATA_MSG_MAX_BYTES + data_msg->enc_msg_len;
+  uint8_t *dst = otrng_xmalloc_z(size);
+  size_t written = otrng_data_message_body_serialize_into(dst, size, data_msg);
+
+  if (!written) {
+    otrng_free(dst);
+    return OTRNG_ERROR;
+  }
+
   if (body) {
     *body = dst;
+  } else {
+    otrng_free(dst);
   }
 
   if (body_len) {
-    *body_len = cursor - dst;
+    *body_len = written;
   }
 
   return OTRNG_SUCCESS;
 }
 
-INTERNAL otrng_result otrng_data_message_deserialize(data_message_s *dst,
-                                                     const uint8_t *buffer,
-                                                     size_t buff_len,
-                                                     size_t *nread) {
+static otrng_result
+deserialize_data_message(data_message_s *dst, const uint8_t *buffer,
+                         size_t buff_len, otrng_bool as_view,
+                         const ratchet_keys_enc_s *known) {
   const uint8_t *cursor = buffer;
   int64_t len = buff_len;
   size_t read = 0;
   uint16_t protocol_version = 0;
   uint8_t msg_type = 0;
 
-  (void)nread;
-
   if (!otrng_deserialize_uint16(&protocol_version, cursor, len, &read)) {
     return OTRNG_ERROR;
   }
@@ -171,10 +196,18 @@ INTERNAL otrng_result otrng_data_message_deserialize(data_message_s *dst,
   cursor += read;
   len -= read;
 
-  if (!otrng_deserialize_ec_point(dst->ecdh, cursor, len)) {
+  if (known && known->valid && len >= ED448_POINT_BYTES &&
+      memcmp(cursor, known->ecdh_enc, ED448_POINT_BYTES) == 0) {
+    otrng_ec_point_copy(dst->ecdh, known->ecdh);
+    dst->ecdh_known = otrng_true;
+  } else if (!otrng_deserialize_ec_point(dst->ecdh, cursor, len)) {
     return OTRNG_ERROR;
   }
 
+  if (as_view) {
+    dst->ecdh_enc = cursor;
+  }
+
   cursor += ED448_POINT_BYTES;
   len -= ED448_POINT_BYTES;
 
@@ -186,6 +219,16 @@ INTERNAL otrng_result otrng_data_message_deserialize(data_message_s *dst,
     return OTRNG_ERROR;
   }
 
+  if (dst->dh && known && known->dh_enc_len == read &&
+      memcmp(cursor, known->dh_enc, read) == 0) {
+    dst->dh_known = otrng_true;
+  }
+
+  if (as_view) {
+    dst->dh_enc = cursor;
+    dst->dh_enc_len = read;
+  }
+
   cursor += read;
   len -= read;
 
@@ -197,18 +240,77 @@ INTERNAL otrng_result otrng_data_message_deserialize(data_message_s *dst,
   cursor += DATA_MSG_NONCE_BYTES;
   len -= DATA_MSG_NONCE_BYTES;
 
-  if (!otrng_deserialize_data(&dst->enc_msg, &dst->enc_msg_len, cursor, len,
-                              &read)) {
+  if (as_view) {
+    uint32_t enc_msg_len = 0;
+
+    if (!otrng_deserialize_uint32(&enc_msg_len, cursor, len, &read)) {
+      return OTRNG_ERROR;
+    }
+
+    cursor += read;
+    len -= read;
+
+    if (len < enc_msg_len) {
+      return OTRNG_ERROR;
+    }
+
+    /* The encrypted message is only read from */
+    dst->enc_msg = enc_msg_len ? (uint8_t *)cursor : NULL;
+    dst->enc_msg_len = enc_msg_len;
+    read = enc_msg_len;
+  } else if (!otrng_deserialize_data(&dst->enc_msg, &dst->enc_msg_len, cursor,
+                                     len, &read)) {
     return OTRNG_ERROR;
   }
 
   cursor += read;
   len -= read;
 
+  if (as_view) {
+    dst->body = buffer;
+    dst->body_len = cursor - buffer;
+  }
+
   return otrng_deserialize_bytes_array((uint8_t *)&dst->mac, DATA_MSG_MAC_BYTES,
                                        cursor, len);
 }
 
+INTERNAL otrng_result otrng_data_message_deserialize(data_message_s *dst,
+                                                     const uint8_t *buffer,
+                                                     size_t buff_len,
+                                                     size_t *nread) {
+  (void)nread;
+
+  return deserialize_data_message(dst, buffer, buff_len, otrng_false, NULL);
+}
+
+INTERNAL otrng_result otrng_data_message_deserialize_view(
+    data_message_s *dst, const uint8_t *buffer, size_t buff_len, size_t *nread,
+    const ratchet_keys_enc_s *known) {
+  (void)nread;
+
+  return deserialize_data_message(dst, buffer, buff_len, otrng_true, known);
+}
+
+INTERNAL void otrng_data_message_remember_keys(ratchet_keys_enc_s *known,
+                                               const data_message_s *data_msg) {
+  if (!data_msg->ecdh_enc) {
+    return;
+  }
+
+  if (!data_msg->ecdh_known) {
+    memcpy(known->ecdh_enc, data_msg->ecdh_enc, ED448_POINT_BYTES);
+    otrng_ec_point_copy(known->ecdh, data_msg->ecdh);
+    known->valid = otrng_true;
+  }
+
+  if (data_msg->dh && !data_msg->dh_known &&
+      data_msg->dh_enc_len <= DH_MPI_MAX_BYTES) {
+    memcpy(known->dh_enc, data_msg->dh_enc, data_msg->dh_enc_len);
+    known->dh_enc_len = data_msg->dh_enc_len;
+  }
+}
+
 INTERNAL otrng_result otrng_data_message_authenticator(uint8_t *dst,
                                                        size_t dst_len,
                                                        const k_msg_mac mac_key,
@@ -240,28 +342,35 @@ INTERNAL otrng_bool otrng_valid_data_message(k_msg_mac mac_key,
   // We don't need this tag to be in secure memory
   uint8_t mac_tag[DATA_MSG_MAC_BYTES];
 
-  if (!otrng_data_message_body_serialize(&body, &body_len, data_msg)) {
-    return otrng_false;
-  }
+  if (data_msg->body) {
+    if (!otrng_data_message_authenticator(mac_tag, DATA_MSG_MAC_BYTES, mac_key,
+                                          data_msg->body, data_msg->body_len)) {
+      return otrng_false;
+    }
+  } else {
+    if (!otrng_data_message_body_serialize(&body, &body_len, data_msg)) {
+      return otrng_false;
+    }
+
+    if (!otrng_data_message_authenticator(mac_tag, DATA_MSG_MAC_BYTES, mac_key,
+                                          body, body_len)) {
+      otrng_free(body);
+      return otrng_false;
+    }
 
-  if (!otrng_data_message_authenticator(mac_tag, DATA_MSG_MAC_BYTES, mac_key,
-                                        body, body_len)) {
     otrng_free(body);
-    return otrng_false;
   }
 
-  otrng_free(body);
-
   if (sodium_memcmp(mac_tag, data_msg->mac, DATA_MSG_MAC_BYTES) != 0) {
     otrng_secure_wipe(mac_tag, DATA_MSG_MAC_BYTES);
     return otrng_false;
   }
 
-  if (!otrng_ec_point_valid(data_msg->ecdh)) {
+  if (!data_msg->ecdh_known && !otrng_ec_point_valid(data_msg->ecdh)) {
     return otrng_false;
   }
 
-  if (!data_msg->dh) {
+  if (!data_msg->dh || data_msg->dh_known) {
     return otrng_true;
   }
 
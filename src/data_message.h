@@ -43,6 +43,24 @@ typedef struct data_message_s {
   uint8_t *enc_msg;
   size_t enc_msg_len;
   uint8_t mac[DATA_MSG_MAC_BYTES];
+
+  /* Set when the message is a view into the buffer it was deserialized from:
+     enc_msg is not owned, and the body is authenticated as received. */
+  /*@null@*/ const uint8_t *body;
+  size_t body_len;
+
+  /* When sending: the encoding of ecdh and dh, to be copied instead of
+     encoding them again. dh is not needed when it is set. */
+  /*@null@*/ const ratchet_keys_enc_s *keys_enc;
+
+  /* When received as a view: where ecdh and dh are in the buffer, and whether
+     they are the keys of the last message that was accepted, which were
+     already validated. */
+  /*@null@*/ const uint8_t *ecdh_enc;
+  /*@null@*/ const uint8_t *dh_enc;
+  size_t dh_enc_len;
+  otrng_bool ecdh_known;
+  otrng_bool dh_known;
 } data_message_s;
 
 INTERNAL data_message_s *otrng_data_message_new(void);
@@ -52,11 +70,53 @@ INTERNAL void otrng_data_message_free(data_message_s *data_msg);
 INTERNAL otrng_result otrng_data_message_body_serialize(
     uint8_t **body, size_t *bodylen, const data_message_s *data_msg);
 
+/**
+ * @brief Serializes the body of the data message (everything but the
+ * authenticator) into [dst].
+ *
+ * @param [dst]       Where to write it.
+ * @param [dst_len]   The room there is in [dst]. DATA_MSG_MAX_BYTES plus the
+ *                    length of the encrypted message is always enough.
+ * @param [data_msg]  The data message.
+ *
+ * @return The number of bytes written, or 0 on error.
+ */
+INTERNAL size_t otrng_data_message_body_serialize_into(
+    uint8_t *dst, size_t dst_len, const data_message_s *data_msg);
+
 INTERNAL otrng_result otrng_data_message_deserialize(data_message_s *dst,
                                                      const uint8_t *buff,
                                                      size_t buff_len,
                                                      size_t *nread);
 
+/**
+ * @brief Deserializes a data message without copying its encrypted message,
+ * which will point into [buff]. [buff] must outlive [dst].
+ *
+ * The public keys are not decoded again if they are the ones in [known]: they
+ * are copied from it, and not validated again by otrng_valid_data_message.
+ *
+ * @param [dst]       The data message.
+ * @param [buff]      The serialized data message.
+ * @param [buff_len]  The length of [buff].
+ * @param [nread]     Unused.
+ * @param [known]     The keys of the last accepted message, or NULL.
+ */
+INTERNAL otrng_result otrng_data_message_deserialize_view(
+    data_message_s *dst, const uint8_t *buff, size_t buff_len, size_t *nread,
+    /*@null@*/ const ratchet_keys_enc_s *known);
+
+/**
+ * @brief Remembers the public keys of a data message that was received as a
+ * view and accepted, so the messages that follow with the same keys can skip
+ * decoding and validating them.
+ *
+ * @param [known]     Where the keys are remembered.
+ * @param [data_msg]  The accepted data message.
+ */
+INTERNAL void otrng_data_message_remember_keys(ratchet_keys_enc_s *known,
+                                               const data_message_s *data_msg);
+
 INTERNAL otrng_result otrng_data_message_authenticator(uint8_t *dst,
                                                        size_t dst_len,
                                                        const k_msg_mac mac_key,
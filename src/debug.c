@@ -51,6 +51,7 @@ INTERNAL /*@null@*/ char *_otrng_memdump(const uint8_t *src, size_t len) {
   return buffer;
 }
 
+/* Set from any thread, so it is read and written atomically */
 static int debug_printing_enabled = 0;
 
 API void otrng_debug_init(void) {
@@ -63,13 +64,16 @@ API void otrng_debug_init(void) {
 }
 
 API void otrng_debug_enable(void) {
-  debug_printing_enabled = 1;
+  __atomic_store_n(&debug_printing_enabled, 1, __ATOMIC_RELAXED);
   otrng_debug_fprintf(stderr, "OTRNG debug printing enabled\n");
 }
 
-API void otrng_debug_disable(void) { debug_printing_enabled = 0; }
+API void otrng_debug_disable(void) {
+  __atomic_store_n(&debug_printing_enabled, 0, __ATOMIC_RELAXED);
+}
 
-static int debug_indent = 0;
+/* Each thread has its own call depth */
+static __thread int debug_indent = 0;
 
 API void otrng_debug_enter(const char *name) {
   otrng_debug_fprintf(stderr, "-> %s()\n", name);
@@ -87,7 +91,7 @@ API void otrng_debug_exit(const char *name) {
 API void otrng_debug_fprintf(FILE *f, const char *fmt, ...) {
   int ix;
   va_list args;
-  if (debug_printing_enabled) {
+  if (__atomic_load_n(&debug_printing_enabled, __ATOMIC_RELAXED)) {
     for (ix = 0; ix < debug_indent; ix++) {
       fprintf(f, "  ");
     }
@@ -73,6 +73,224 @@ static /*@null@*/ gcry_mpi_t DH3072_GENERATOR = NULL;
 
 static int dh_initialized = 0;
 
+/*
+ * Public keys are g^x for a fixed g, so they are computed with a fixed-base
+ * comb (Lim-Lee) instead of with gcry_mpi_powm.
+ *
+ * The exponent is cut into blocks of DH_COMB_TEETH * DH_COMB_SPACING bits. Bit
+ * j of every tooth t of a block b is read at the same time, making a
+ * DH_COMB_TEETH bit index into the table of that block, which holds the
+ * product of g^(2^(b * DH_COMB_BLOCK_BITS + t * DH_COMB_SPACING)) for every
+ * bit t set in the index. g^x then takes DH_COMB_SPACING squarings and one
+ * multiplication per block and squaring. A private key fits in one block, so
+ * it takes 107 squarings and 107 multiplications instead of one squaring per
+ * bit and a multiplication per window.
+ *
+ * The table holds enough blocks for any exponent below the modulus. Entries
+ * are stored as big-endian numbers, in words, and are read by scanning the
+ * whole table of a block, so which entry is used can not be told from the
+ * memory accesses of the table. This is all it hides: the number of blocks
+ * depends on the length of the exponent (every private key takes one), and
+ * the multiplications are done with gcry_mpi_mulm, which does not run in
+ * constant time, on entries read back with gcry_mpi_scan, which drops their
+ * leading zero bytes. So the time it takes can still depend on the exponent.
+ */
+#define DH_COMB_TEETH 6
+#define DH_COMB_ENTRIES (1 << DH_COMB_TEETH)
+#define DH_COMB_SPACING ((DH_KEY_SIZE * 8 + DH_COMB_TEETH - 1) / DH_COMB_TEETH)
+#define DH_COMB_BLOCK_BITS (DH_COMB_TEETH * DH_COMB_SPACING)
+#define DH_COMB_BLOCKS                                                         \
+  ((DH3072_MOD_LEN_BITS + DH_COMB_BLOCK_BITS - 1) / DH_COMB_BLOCK_BITS)
+#define DH_COMB_ENTRY_WORDS (DH3072_MOD_LEN_BYTES / sizeof(uint64_t))
+
+static /*@null@*/ uint64_t *DH3072_COMB = NULL;
+
+static uint64_t *dh_comb_entry(size_t block, size_t index) {
+  return DH3072_COMB + (block * DH_COMB_ENTRIES + index) * DH_COMB_ENTRY_WORDS;
+}
+
+static otrng_result dh_comb_store(uint64_t *dst, const gcry_mpi_t n) {
+  uint8_t *bytes = (uint8_t *)dst;
+  size_t len = (gcry_mpi_get_nbits(n) + 7) / 8;
+  size_t written = 0;
+
+  memset(bytes, 0, DH3072_MOD_LEN_BYTES);
+  if (gcry_mpi_print(GCRYMPI_FMT_USG, bytes + DH3072_MOD_LEN_BYTES - len, len,
+                     &written, n)) {
+    return OTRNG_ERROR;
+  }
+
+  if (written != len) {
+    return OTRNG_ERROR;
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+static otrng_result dh_comb_init(void) {
+  gcry_mpi_t teeth[DH_COMB_TEETH];
+  gcry_mpi_t entries[DH_COMB_ENTRIES];
+  gcry_mpi_t base;
+  otrng_result result = OTRNG_SUCCESS;
+  size_t b, i, t, j;
+
+  DH3072_COMB = otrng_xmalloc_z(DH_COMB_BLOCKS * DH_COMB_ENTRIES *
+                                DH3072_MOD_LEN_BYTES);
+
+  for (i = 0; i < DH_COMB_ENTRIES; i++) {
+    entries[i] = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  }
+  for (t = 0; t < DH_COMB_TEETH; t++) {
+    teeth[t] = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  }
+
+  /* g^(2^(b * DH_COMB_BLOCK_BITS + t * DH_COMB_SPACING)) */
+  base = gcry_mpi_copy(DH3072_GENERATOR);
+
+  for (b = 0; b < DH_COMB_BLOCKS && result == OTRNG_SUCCESS; b++) {
+    for (t = 0; t < DH_COMB_TEETH; t++) {
+      gcry_mpi_set(teeth[t], base);
+      for (j = 0; j < DH_COMB_SPACING; j++) {
+        gcry_mpi_mulm(base, base, base, DH3072_MODULUS);
+      }
+    }
+
+    gcry_mpi_set_ui(entries[0], 1);
+    for (i = 1; i < DH_COMB_ENTRIES; i++) {
+      size_t top = DH_COMB_TEETH - 1;
+      while (!(i & ((size_t)1 << top))) {
+        top--;
+      }
+      gcry_mpi_mulm(entries[i], entries[i ^ ((size_t)1 << top)], teeth[top],
+                    DH3072_MODULUS);
+    }
+
+    for (i = 0; i < DH_COMB_ENTRIES; i++) {
+      if (!dh_comb_store(dh_comb_entry(b, i), entries[i])) {
+        result = OTRNG_ERROR;
+        break;
+      }
+    }
+  }
+
+  gcry_mpi_release(base);
+  for (t = 0; t < DH_COMB_TEETH; t++) {
+    gcry_mpi_release(teeth[t]);
+  }
+  for (i = 0; i < DH_COMB_ENTRIES; i++) {
+    gcry_mpi_release(entries[i]);
+  }
+
+  if (result == OTRNG_ERROR) {
+    otrng_free(DH3072_COMB);
+    DH3072_COMB = NULL;
+  }
+
+  return result;
+}
+
+static void dh_comb_free(void) {
+  otrng_free(DH3072_COMB);
+  DH3072_COMB = NULL;
+}
+
+/* Copies the entry [index] of [block] to [dst], reading every entry. */
+static void dh_comb_select(uint64_t *dst, size_t block, size_t index) {
+  size_t i, w;
+
+  memset(dst, 0, DH3072_MOD_LEN_BYTES);
+  for (i = 0; i < DH_COMB_ENTRIES; i++) {
+    const uint64_t *entry = dh_comb_entry(block, i);
+    uint64_t diff = (uint64_t)(i ^ index);
+    uint64_t mask = (uint64_t)0 - ((diff - 1) >> 63);
+
+    for (w = 0; w < DH_COMB_ENTRY_WORDS; w++) {
+      dst[w] |= entry[w] & mask;
+    }
+  }
+}
+
+static size_t dh_comb_bit(const uint8_t *exponent, size_t bit) {
+  if (bit >= DH3072_MOD_LEN_BITS) {
+    return 0;
+  }
+
+  return (exponent[DH3072_MOD_LEN_BYTES - 1 - bit / 8] >> (bit % 8)) & 1;
+}
+
+tstatic otrng_result dh_comb_powm(gcry_mpi_t dst, const gcry_mpi_t exponent) {
+  uint8_t *bytes;
+  uint64_t *selected;
+  gcry_mpi_t entry = NULL;
+  size_t len = (gcry_mpi_get_nbits(exponent) + 7) / 8;
+  size_t blocks, b, t, j;
+  otrng_result result = OTRNG_SUCCESS;
+
+  if (!DH3072_COMB || len > DH3072_MOD_LEN_BYTES) {
+    return OTRNG_ERROR;
+  }
+
+  bytes = otrng_secure_alloc(DH3072_MOD_LEN_BYTES);
+  selected = otrng_secure_alloc(DH3072_MOD_LEN_BYTES);
+
+  if (len > 0 &&
+      gcry_mpi_print(GCRYMPI_FMT_USG, bytes + DH3072_MOD_LEN_BYTES - len, len,
+                     NULL, exponent)) {
+    otrng_secure_free(bytes);
+    otrng_secure_free(selected);
+    return OTRNG_ERROR;
+  }
+
+  /* Every exponent up to the size of a private key takes one block */
+  blocks = (len * 8 + DH_COMB_BLOCK_BITS - 1) / DH_COMB_BLOCK_BITS;
+  if (blocks == 0) {
+    blocks = 1;
+  }
+
+  gcry_mpi_set_ui(dst, 1);
+  for (j = DH_COMB_SPACING; j-- > 0;) {
+    gcry_mpi_mulm(dst, dst, dst, DH3072_MODULUS);
+
+    for (b = 0; b < blocks; b++) {
+      size_t index = 0;
+      for (t = 0; t < DH_COMB_TEETH; t++) {
+        index |= dh_comb_bit(bytes, b * DH_COMB_BLOCK_BITS +
+                                        t * DH_COMB_SPACING + j)
+                 << t;
+      }
+
+      dh_comb_select(selected, b, index);
+      if (gcry_mpi_scan(&entry, GCRYMPI_FMT_USG, selected,
+                        DH3072_MOD_LEN_BYTES, NULL)) {
+        result = OTRNG_ERROR;
+        break;
+      }
+
+      gcry_mpi_mulm(dst, dst, entry, DH3072_MODULUS);
+      gcry_mpi_release(entry);
+      entry = NULL;
+    }
+
+    if (result == OTRNG_ERROR) {
+      break;
+    }
+  }
+
+  otrng_secure_free(bytes);
+  otrng_secure_free(selected);
+
+  return result;
+}
+
+/* g^x mod p. Falls back to gcry_mpi_powm if the comb can't be used. */
+static void dh_generator_powm(gcry_mpi_t dst, const gcry_mpi_t exponent) {
+  if (dh_comb_powm(dst, exponent)) {
+    return;
+  }
+
+  gcry_mpi_powm(dst, DH3072_GENERATOR, exponent, DH3072_MODULUS);
+}
+
 INTERNAL otrng_result otrng_dh_init(otrng_bool die) {
   gcry_error_t err;
 
@@ -129,6 +347,18 @@ INTERNAL otrng_result otrng_dh_init(otrng_bool die) {
 
   gcry_mpi_sub_ui(DH3072_MODULUS_MINUS_2, DH3072_MODULUS, 2);
 
+  if (!dh_comb_init()) {
+    gcry_mpi_release(DH3072_MODULUS);
+    gcry_mpi_release(DH3072_MODULUS_Q);
+    gcry_mpi_release(DH3072_GENERATOR);
+    gcry_mpi_release(DH3072_MODULUS_MINUS_2);
+    fprintf(stderr, "dh - comb - initialization failed\n");
+    if (die) {
+      exit(EXIT_FAILURE);
+    }
+    return OTRNG_ERROR;
+  }
+
   return OTRNG_SUCCESS;
 }
 
@@ -149,6 +379,8 @@ INTERNAL void otrng_dh_free(void) {
   gcry_mpi_release(DH3072_MODULUS_MINUS_2);
   DH3072_MODULUS_MINUS_2 = NULL;
 
+  dh_comb_free();
+
   dh_initialized = 0;
 }
 
@@ -158,7 +390,7 @@ INTERNAL /*@null@*/ dh_mpi otrng_dh_mpi_generator(void) {
 
 INTERNAL void otrng_dh_calculate_public_key(dh_public_key pub,
                                             const dh_private_key priv) {
-  gcry_mpi_powm(pub, DH3072_GENERATOR, priv, DH3072_MODULUS);
+  dh_generator_powm(pub, priv);
 }
 
 INTERNAL otrng_result otrng_dh_keypair_generate(dh_keypair_s *keypair) {
@@ -185,7 +417,7 @@ INTERNAL otrng_result otrng_dh_keypair_generate(dh_keypair_s *keypair) {
 
   keypair->priv = privkey;
   keypair->pub = gcry_mpi_new(DH3072_MOD_LEN_BITS);
-  gcry_mpi_powm(keypair->pub, DH3072_GENERATOR, privkey, DH3072_MODULUS);
+  dh_generator_powm(keypair->pub, privkey);
 
   return OTRNG_SUCCESS;
 }
@@ -218,10 +450,10 @@ INTERNAL otrng_result otrng_dh_keypair_generate_from_shared_secret(
   if (participant == 'u') {
     keypair->priv = privkey;
     keypair->pub = gcry_mpi_new(DH3072_MOD_LEN_BITS);
-    gcry_mpi_powm(keypair->pub, DH3072_GENERATOR, privkey, DH3072_MODULUS);
+    dh_generator_powm(keypair->pub, privkey);
   } else if (participant == 't') {
     keypair->pub = gcry_mpi_new(DH3072_MOD_LEN_BITS);
-    gcry_mpi_powm(keypair->pub, DH3072_GENERATOR, privkey, DH3072_MODULUS);
+    dh_generator_powm(keypair->pub, privkey);
     gcry_mpi_release(privkey);
   }
 
@@ -262,6 +494,126 @@ INTERNAL otrng_result otrng_dh_shared_secret(dh_shared_secret buffer,
   return OTRNG_SUCCESS;
 }
 
+/*
+ * Products of powers of public values, as in the prekey proofs, are computed
+ * with Straus' method: the exponents are walked from the top bit down at the
+ * same time, so every base shares the same squarings. Each exponent is recoded
+ * in sliding windows of DH_MULTI_POWM_WINDOW bits, which only need the odd
+ * powers of its base. The bases are taken DH_MULTI_POWM_CHUNK at a time to
+ * bound the size of the tables.
+ */
+#define DH_MULTI_POWM_WINDOW 4
+#define DH_MULTI_POWM_ODD_POWERS (1 << (DH_MULTI_POWM_WINDOW - 1))
+#define DH_MULTI_POWM_CHUNK 64
+
+/* Leaves a digit below 2^DH_MULTI_POWM_WINDOW in the lowest bit of every
+ * window, and zeroes in the rest, so that the exponent is the sum of
+ * digits[i] * 2^i and every digit is either zero or odd. */
+static void dh_sliding_window(uint8_t *digits, const gcry_mpi_t exponent,
+                              size_t bits) {
+  size_t i, b;
+
+  for (i = 0; i < bits; i++) {
+    digits[i] = gcry_mpi_test_bit(exponent, i) ? 1 : 0;
+  }
+
+  for (i = 0; i < bits; i++) {
+    if (!digits[i]) {
+      continue;
+    }
+
+    for (b = 1; b < DH_MULTI_POWM_WINDOW && i + b < bits; b++) {
+      if (digits[i + b]) {
+        digits[i] |= 1 << b;
+        digits[i + b] = 0;
+      }
+    }
+  }
+}
+
+static void dh_multi_powm_chunk(gcry_mpi_t dst, const dh_mpi *bases,
+                                const dh_mpi *exponents, size_t count) {
+  gcry_mpi_t *powers, square;
+  uint8_t *digits;
+  size_t bits = 0, i, k, j;
+  otrng_bool started = otrng_false;
+
+  for (k = 0; k < count; k++) {
+    size_t n = gcry_mpi_get_nbits(exponents[k]);
+    if (n > bits) {
+      bits = n;
+    }
+  }
+
+  gcry_mpi_set_ui(dst, 1);
+  if (bits == 0) {
+    return;
+  }
+
+  digits = otrng_xmalloc(count * bits);
+  powers =
+      otrng_xmalloc_z(count * DH_MULTI_POWM_ODD_POWERS * sizeof(gcry_mpi_t));
+  square = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+
+  for (k = 0; k < count; k++) {
+    gcry_mpi_t *odd = powers + k * DH_MULTI_POWM_ODD_POWERS;
+
+    dh_sliding_window(digits + k * bits, exponents[k], bits);
+
+    /* base, base^3, base^5, ... */
+    odd[0] = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+    gcry_mpi_mod(odd[0], bases[k], DH3072_MODULUS);
+    gcry_mpi_mulm(square, odd[0], odd[0], DH3072_MODULUS);
+    for (j = 1; j < DH_MULTI_POWM_ODD_POWERS; j++) {
+      odd[j] = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+      gcry_mpi_mulm(odd[j], odd[j - 1], square, DH3072_MODULUS);
+    }
+  }
+
+  for (i = bits; i-- > 0;) {
+    if (started) {
+      gcry_mpi_mulm(dst, dst, dst, DH3072_MODULUS);
+    }
+
+    for (k = 0; k < count; k++) {
+      const gcry_mpi_t *odd = powers + k * DH_MULTI_POWM_ODD_POWERS;
+      uint8_t digit = digits[k * bits + i];
+
+      if (digit) {
+        gcry_mpi_mulm(dst, dst, odd[digit / 2], DH3072_MODULUS);
+        started = otrng_true;
+      }
+    }
+  }
+
+  for (k = 0; k < count * DH_MULTI_POWM_ODD_POWERS; k++) {
+    gcry_mpi_release(powers[k]);
+  }
+  gcry_mpi_release(square);
+  otrng_free(powers);
+  otrng_free(digits);
+}
+
+INTERNAL void otrng_dh_multi_powm(dh_mpi dst, const dh_mpi *bases,
+                                  const dh_mpi *exponents, size_t count) {
+  gcry_mpi_t chunk = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  size_t i, n;
+
+  gcry_mpi_set_ui(dst, 1);
+
+  for (i = 0; i < count; i += n) {
+    n = count - i;
+    if (n > DH_MULTI_POWM_CHUNK) {
+      n = DH_MULTI_POWM_CHUNK;
+    }
+
+    dh_multi_powm_chunk(chunk, bases + i, exponents + i, n);
+    gcry_mpi_mulm(dst, dst, chunk, DH3072_MODULUS);
+  }
+
+  gcry_mpi_release(chunk);
+}
+
 INTERNAL otrng_result otrng_dh_mpi_serialize(uint8_t *dst, size_t dst_len,
                                              size_t *written,
                                              const dh_mpi src) {
@@ -70,6 +70,22 @@ INTERNAL otrng_result otrng_dh_shared_secret(dh_shared_secret buffer,
                                              const dh_private_key our_priv,
                                              const dh_public_key their_pub);
 
+/**
+ * @brief Computes the product of bases[i]^exponents[i] mod p, sharing the
+ * squarings between all the bases.
+ *
+ * @param [dst]        Where the product will be stored. Must not be one of
+ *                     the bases or exponents.
+ * @param [bases]      The bases.
+ * @param [exponents]  The exponents.
+ * @param [count]      How many bases and exponents there are.
+ *
+ * @warning It does not run in constant time, so it must only be used with
+ * public values, like when verifying proofs.
+ */
+INTERNAL void otrng_dh_multi_powm(dh_mpi dst, const dh_mpi *bases,
+                                  const dh_mpi *exponents, size_t count);
+
 INTERNAL otrng_result otrng_dh_mpi_serialize(uint8_t *dst, size_t dst_len,
                                              size_t *written, const dh_mpi src);
 
@@ -96,6 +112,8 @@ API void otrng_dh_private_key_debug_print(FILE *, dh_private_key);
 
 INTERNAL /*@null@*/ dh_mpi otrng_dh_mpi_generator(void);
 
+tstatic otrng_result dh_comb_powm(gcry_mpi_t dst, const gcry_mpi_t exponent);
+
 #endif
 
 #endif
@@ -130,6 +130,133 @@ INTERNAL void otrng_ec_calculate_public_key(ec_point pub,
                                        priv);
 }
 
+/*
+ * Sums of multiples of public points are computed with Straus' method, like
+ * otrng_dh_multi_powm: every point shares the same doublings. Scalars are
+ * recoded in width-EC_MULTI_WINDOW NAF, so each point only needs its odd
+ * multiples up to 2^(EC_MULTI_WINDOW - 1), and the negative digits are
+ * subtractions.
+ */
+#define EC_MULTI_WINDOW 5
+#define EC_MULTI_ODD_MULTIPLES (1 << (EC_MULTI_WINDOW - 2))
+#define EC_MULTI_DIGIT_MAX ((1 << (EC_MULTI_WINDOW - 1)) - 1)
+#define EC_MULTI_CHUNK 64
+/* one more byte than a scalar, for the carry of the recoding */
+#define EC_MULTI_BITS ((ED448_SCALAR_BYTES + 1) * 8)
+
+static void ec_wnaf(int8_t naf[EC_MULTI_BITS], const ec_scalar s) {
+  uint8_t enc[ED448_SCALAR_BYTES];
+  size_t i, b, k;
+
+  goldilocks_448_scalar_encode(enc, s);
+
+  memset(naf, 0, EC_MULTI_BITS);
+  for (i = 0; i < ED448_SCALAR_BYTES * 8; i++) {
+    naf[i] = 1 & (enc[i / 8] >> (i % 8));
+  }
+
+  for (i = 0; i < EC_MULTI_BITS; i++) {
+    if (!naf[i]) {
+      continue;
+    }
+
+    for (b = 1; b < EC_MULTI_WINDOW && i + b < EC_MULTI_BITS; b++) {
+      int shifted;
+
+      if (!naf[i + b]) {
+        continue;
+      }
+
+      shifted = naf[i + b] << b;
+      if (naf[i] + shifted <= EC_MULTI_DIGIT_MAX) {
+        naf[i] += shifted;
+        naf[i + b] = 0;
+      } else if (naf[i] - shifted >= -EC_MULTI_DIGIT_MAX) {
+        naf[i] -= shifted;
+        for (k = i + b; k < EC_MULTI_BITS; k++) {
+          if (!naf[k]) {
+            naf[k] = 1;
+            break;
+          }
+          naf[k] = 0;
+        }
+      } else {
+        break;
+      }
+    }
+  }
+}
+
+static void ec_multi_scalarmul_chunk(ec_point dst, const ec_point *points,
+                                     const ec_scalar *scalars, size_t count) {
+  goldilocks_448_point_p *multiples, twice;
+  int8_t *naf;
+  size_t i, k, j;
+  otrng_bool started = otrng_false;
+
+  naf = otrng_xmalloc(count * EC_MULTI_BITS);
+  multiples = otrng_xmalloc(count * EC_MULTI_ODD_MULTIPLES *
+                            sizeof(goldilocks_448_point_p));
+
+  for (k = 0; k < count; k++) {
+    goldilocks_448_point_p *odd = multiples + k * EC_MULTI_ODD_MULTIPLES;
+
+    ec_wnaf(naf + k * EC_MULTI_BITS, scalars[k]);
+
+    /* P, 3P, 5P, ... */
+    goldilocks_448_point_copy(odd[0], points[k]);
+    goldilocks_448_point_double(twice, points[k]);
+    for (j = 1; j < EC_MULTI_ODD_MULTIPLES; j++) {
+      goldilocks_448_point_add(odd[j], odd[j - 1], twice);
+    }
+  }
+
+  goldilocks_448_point_copy(dst, goldilocks_448_point_identity);
+
+  for (i = EC_MULTI_BITS; i-- > 0;) {
+    if (started) {
+      goldilocks_448_point_double(dst, dst);
+    }
+
+    for (k = 0; k < count; k++) {
+      goldilocks_448_point_p *odd = multiples + k * EC_MULTI_ODD_MULTIPLES;
+      int digit = naf[k * EC_MULTI_BITS + i];
+
+      if (digit > 0) {
+        goldilocks_448_point_add(dst, dst, odd[(unsigned int)digit / 2]);
+        started = otrng_true;
+      } else if (digit < 0) {
+        goldilocks_448_point_sub(dst, dst, odd[(unsigned int)-digit / 2]);
+        started = otrng_true;
+      }
+    }
+  }
+
+  otrng_free(multiples);
+  otrng_free(naf);
+}
+
+INTERNAL void otrng_ec_multi_scalarmul(ec_point dst, const ec_point *points,
+                                       const ec_scalar *scalars,
+                                       size_t count) {
+  goldilocks_448_point_p chunk;
+  size_t i, n;
+
+  goldilocks_448_point_copy(dst, goldilocks_448_point_identity);
+
+  for (i = 0; i < count; i += n) {
+    n = count - i;
+    if (n > EC_MULTI_CHUNK) {
+      n = EC_MULTI_CHUNK;
+    }
+
+    ec_multi_scalarmul_chunk(chunk, points + i, scalars + i, n);
+    goldilocks_448_point_add(dst, dst, chunk);
+  }
+
+  goldilocks_448_point_destroy(chunk);
+}
+
 INTERNAL otrng_result otrng_ecdh_keypair_generate(
     ecdh_keypair_s *keypair, const uint8_t sym[ED448_PRIVATE_BYTES]) {
   /*
@@ -191,6 +191,22 @@ otrng_ec_derive_public_key(uint8_t pub[ED448_POINT_BYTES],
 
 INTERNAL void otrng_ec_calculate_public_key(ec_point pub, const ec_scalar priv);
 
+/**
+ * @brief Computes the sum of scalars[i] * points[i], sharing the doublings
+ * between all the points.
+ *
+ * @param [dst]      Where the sum will be stored.
+ * @param [points]   The points.
+ * @param [scalars]  The scalars.
+ * @param [count]    How many points and scalars there are.
+ *
+ * @warning It does not run in constant time, so it must only be used with
+ * public values, like when verifying proofs.
+ */
+INTERNAL void otrng_ec_multi_scalarmul(ec_point dst, const ec_point *points,
+                                       const ec_scalar *scalars,
+                                       size_t count);
+
 /**
  * @brief Keypair generation.
  *
@@ -0,0 +1,343 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#define OTRNG_ENGINE_PRIVATE
+
+#include "alloc.h"
+#include "engine.h"
+#include "parallel.h"
+#include "str.h"
+
+/* How many messages of a conversation a worker receives before it looks at
+ * the other conversations */
+#define ENGINE_BATCH 8
+
+typedef struct engine_job_s {
+  char *msg;
+  void *data;
+  struct engine_job_s *next;
+} engine_job_s;
+
+/* The messages of one conversation that are waiting to be received */
+typedef struct engine_strand_s {
+  otrng_client_s *client;
+  char *recipient;
+  uint64_t hash;
+
+  /* the worker it is queued on, or that handled it last */
+  size_t worker;
+  /* set while it is in a worker queue, or being handled by a worker */
+  otrng_bool queued;
+
+  /*@null@*/ engine_job_s *head;
+  /*@null@*/ engine_job_s *tail;
+
+  /*@null@*/ struct engine_strand_s *next; /* in the worker queue */
+} engine_strand_s;
+
+typedef struct strand_key_s {
+  const otrng_client_s *client;
+  const char *recipient;
+} strand_key_s;
+
+static uint64_t hash_strand_key(const otrng_engine_s *engine,
+                                const strand_key_s *key) {
+  uint64_t hash = otrng_hash_index_hash(&engine->strands, 0, &key->client,
+                                        sizeof(key->client));
+
+  return otrng_hash_index_hash(&engine->strands, hash, key->recipient,
+                               strlen(key->recipient));
+}
+
+static int strand_matches(const void *item, const void *wanted) {
+  const engine_strand_s *strand = item;
+  const strand_key_s *key = wanted;
+
+  return strand->client == key->client &&
+         strcmp(strand->recipient, key->recipient) == 0;
+}
+
+static void push_strand(otrng_engine_s *engine, size_t worker,
+                        engine_strand_s *strand) {
+  engine_worker_s *w = &engine->workers[worker];
+
+  strand->worker = worker;
+  strand->next = NULL;
+  if (w->tail) {
+    w->tail->next = strand;
+  } else {
+    w->head = strand;
+  }
+  w->tail = strand;
+}
+
+static /*@null@*/ engine_strand_s *pop_strand(engine_worker_s *w) {
+  engine_strand_s *strand = w->head;
+
+  if (strand) {
+    w->head = strand->next;
+    if (!w->head) {
+      w->tail = NULL;
+    }
+    strand->next = NULL;
+  }
+
+  return strand;
+}
+
+/* The worker takes from its own queue first, then from the others */
+tstatic /*@null@*/ engine_strand_s *
+engine_take_strand(otrng_engine_s *engine, size_t worker) {
+  engine_strand_s *strand;
+  size_t i;
+
+  for (i = 0; i < engine->num_workers; i++) {
+    strand =
+        pop_strand(&engine->workers[(worker + i) % engine->num_workers]);
+    if (strand) {
+      strand->worker = worker;
+      return strand;
+    }
+  }
+
+  return NULL;
+}
+
+static void receive_job(otrng_engine_s *engine, const engine_strand_s *strand,
+                        engine_job_s *job) {
+  otrng_engine_result_s result;
+
+  memset(&result, 0, sizeof(otrng_engine_result_s));
+  result.client = strand->client;
+  result.recipient = strand->recipient;
+  result.data = job->data;
+
+  /* The message is our own copy, so it can be decoded in place */
+  result.result = otrng_client_receive_in_place(
+      &result.to_send, &result.to_display, job->msg, strand->recipient,
+      strand->client, &result.should_ignore);
+
+  if (engine->completion) {
+    engine->completion(&result, engine->context);
+  }
+
+  otrng_free(result.to_send);
+  otrng_free(result.to_display);
+  otrng_free(job->msg);
+  otrng_free(job);
+}
+
+static void strand_free(engine_strand_s *strand) {
+  otrng_free(strand->recipient);
+  otrng_free(strand);
+}
+
+static void *engine_worker(void *arg) {
+  engine_worker_s *w = arg;
+  otrng_engine_s *engine = w->engine;
+
+  (void)pthread_mutex_lock(&engine->lock);
+  for (;;) {
+    engine_strand_s *strand = engine_take_strand(engine, w->index);
+    int handled;
+
+    if (!strand) {
+      if (engine->stopping) {
+        break;
+      }
+
+      (void)pthread_cond_wait(&engine->work, &engine->lock);
+      continue;
+    }
+
+    /* Nobody else takes the strand while it is handled here, so the messages
+     * of the conversation are received one after the other */
+    for (handled = 0; handled < ENGINE_BATCH && strand->head; handled++) {
+      engine_job_s *job = strand->head;
+
+      strand->head = job->next;
+      if (!strand->head) {
+        strand->tail = NULL;
+      }
+
+      (void)pthread_mutex_unlock(&engine->lock);
+      receive_job(engine, strand, job);
+      (void)pthread_mutex_lock(&engine->lock);
+
+      engine->pending--;
+    }
+
+    if (strand->head) {
+      /* More came in: the others get a turn, and an idle worker can take it */
+      push_strand(engine, w->index, strand);
+      (void)pthread_cond_signal(&engine->work);
+    } else {
+      strand->queued = otrng_false;
+      (void)otrng_hash_index_remove(&engine->strands, strand->hash, strand);
+      strand_free(strand);
+    }
+
+    if (engine->pending == 0) {
+      (void)pthread_cond_broadcast(&engine->idle);
+    }
+  }
+  (void)pthread_mutex_unlock(&engine->lock);
+
+  return NULL;
+}
+
+API otrng_engine_s *otrng_engine_new(size_t workers,
+                                     otrng_engine_completion completion,
+                                     void *context) {
+  otrng_engine_s *engine = otrng_xmalloc_z(sizeof(otrng_engine_s));
+  size_t i;
+
+  if (workers == 0) {
+    workers = 1;
+  }
+
+  if (workers > OTRNG_MAX_THREADS) {
+    workers = OTRNG_MAX_THREADS;
+  }
+
+  engine->completion = completion;
+  engine->context = context;
+  engine->workers = otrng_xmalloc_z(workers * sizeof(engine_worker_s));
+  otrng_hash_index_init(&engine->strands);
+  (void)pthread_mutex_init(&engine->lock, NULL);
+  (void)pthread_cond_init(&engine->work, NULL);
+  (void)pthread_cond_init(&engine->idle, NULL);
+
+  /* The workers wait for the lock, so they only see the final count */
+  (void)pthread_mutex_lock(&engine->lock);
+  for (i = 0; i < workers; i++) {
+    engine->workers[i].engine = engine;
+    engine->workers[i].index = i;
+    if (pthread_create(&engine->workers[i].thread, NULL, engine_worker,
+                       &engine->workers[i]) != 0) {
+      break;
+    }
+    engine->num_workers++;
+  }
+  (void)pthread_mutex_unlock(&engine->lock);
+
+  if (engine->num_workers == 0) {
+    otrng_engine_free(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+API void otrng_engine_free(otrng_engine_s *engine) {
+  size_t i;
+
+  if (!engine) {
+    return;
+  }
+
+  otrng_engine_drain(engine);
+
+  (void)pthread_mutex_lock(&engine->lock);
+  engine->stopping = otrng_true;
+  (void)pthread_cond_broadcast(&engine->work);
+  (void)pthread_mutex_unlock(&engine->lock);
+
+  for (i = 0; i < engine->num_workers; i++) {
+    (void)pthread_join(engine->workers[i].thread, NULL);
+  }
+
+  otrng_hash_index_destroy(&engine->strands);
+  (void)pthread_mutex_destroy(&engine->lock);
+  (void)pthread_cond_destroy(&engine->work);
+  (void)pthread_cond_destroy(&engine->idle);
+  otrng_free(engine->workers);
+  otrng_free(engine);
+}
+
+API otrng_result otrng_engine_submit(otrng_engine_s *engine,
+                                     otrng_client_s *client,
+                                     const char *recipient, const char *msg,
+                                     void *data) {
+  engine_job_s *job;
+  engine_strand_s *strand;
+  strand_key_s key;
+  uint64_t hash;
+
+  if (!engine || !client || !recipient || !msg) {
+    return OTRNG_ERROR;
+  }
+
+  job = otrng_xmalloc_z(sizeof(engine_job_s));
+  job->msg = otrng_xstrdup(msg);
+  job->data = data;
+
+  key.client = client;
+  key.recipient = recipient;
+
+  (void)pthread_mutex_lock(&engine->lock);
+
+  if (engine->stopping) {
+    (void)pthread_mutex_unlock(&engine->lock);
+    otrng_free(job->msg);
+    otrng_free(job);
+    return OTRNG_ERROR;
+  }
+
+  hash = hash_strand_key(engine, &key);
+  strand = otrng_hash_index_find(&engine->strands, hash, strand_matches, &key);
+  if (!strand) {
+    strand = otrng_xmalloc_z(sizeof(engine_strand_s));
+    strand->client = client;
+    strand->recipient = otrng_xstrdup(recipient);
+    strand->hash = hash;
+    strand->worker = hash % engine->num_workers;
+    otrng_hash_index_add(&engine->strands, hash, strand);
+  }
+
+  if (strand->tail) {
+    strand->tail->next = job;
+  } else {
+    strand->head = job;
+  }
+  strand->tail = job;
+  engine->pending++;
+
+  /* Otherwise, the worker that has it will get to the message */
+  if (!strand->queued) {
+    strand->queued = otrng_true;
+    push_strand(engine, strand->worker, strand);
+    (void)pthread_cond_signal(&engine->work);
+  }
+
+  (void)pthread_mutex_unlock(&engine->lock);
+
+  return OTRNG_SUCCESS;
+}
+
+API void otrng_engine_drain(otrng_engine_s *engine) {
+  (void)pthread_mutex_lock(&engine->lock);
+  while (engine->pending > 0) {
+    (void)pthread_cond_wait(&engine->idle, &engine->lock);
+  }
+  (void)pthread_mutex_unlock(&engine->lock);
+}
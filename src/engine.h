@@ -0,0 +1,147 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The engine receives messages on its own threads. It relies on the locking
+ * described in messaging.h, and its functions can be called from any thread.
+ */
+
+#ifndef OTRNG_ENGINE_H
+#define OTRNG_ENGINE_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "client.h"
+#include "error.h"
+#include "hash_index.h"
+#include "shared.h"
+
+/* What came out of receiving a submitted message */
+typedef struct otrng_engine_result_s {
+  otrng_client_s *client;
+  const char *recipient;
+  /*@null@*/ void *data; /* as given to otrng_engine_submit() */
+
+  otrng_result result;
+  otrng_bool should_ignore;
+  /* The completion callback may take these and set them to NULL. Whatever is
+     left is freed once it returns. */
+  /*@null@*/ char *to_send;
+  /*@null@*/ char *to_display;
+} otrng_engine_result_s;
+
+typedef void (*otrng_engine_completion)(otrng_engine_result_s *result,
+                                        /*@null@*/ void *context);
+
+struct engine_strand_s;
+
+typedef struct engine_worker_s {
+  struct otrng_engine_s *engine;
+  size_t index;
+  pthread_t thread;
+
+  /* the conversations that have messages waiting, in FIFO order */
+  /*@null@*/ struct engine_strand_s *head;
+  /*@null@*/ struct engine_strand_s *tail;
+} engine_worker_s;
+
+/*
+ * Receives messages on a set of worker threads.
+ *
+ * Messages are queued by conversation (a client and a recipient). A
+ * conversation is handled by one worker at a time, so its messages are
+ * received, and completed, in the order they were submitted. It stays with
+ * the worker that last handled it, and a worker with nothing to do takes
+ * waiting conversations from the others, so slow messages (a DAKE, a new
+ * ratchet) only hold back the conversation they belong to.
+ */
+typedef struct otrng_engine_s {
+  engine_worker_s *workers;
+  size_t num_workers;
+
+  otrng_engine_completion completion;
+  /*@null@*/ void *context;
+
+  hash_index_s strands; /* by (client, recipient) */
+  size_t pending;       /* submitted and not completed yet */
+  otrng_bool stopping;
+
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t idle;
+} otrng_engine_s;
+
+/**
+ * @brief Starts an engine.
+ *
+ * @param [workers]     How many worker threads to start, from 1 to
+ *                      OTRNG_MAX_THREADS.
+ * @param [completion]  Called from a worker thread, without any lock held,
+ *                      once each message has been received.
+ * @param [context]     Passed to [completion].
+ *
+ * @return The engine, or NULL if no thread could be started.
+ */
+API /*@null@*/ otrng_engine_s *
+otrng_engine_new(size_t workers, otrng_engine_completion completion,
+                 /*@null@*/ void *context);
+
+/**
+ * @brief Waits for the messages that were submitted, stops the workers and
+ * frees the engine.
+ *
+ * @param [engine]  The engine.
+ */
+API void otrng_engine_free(/*@only@*/ /*@null@*/ otrng_engine_s *engine);
+
+/**
+ * @brief Queues a received message, like otrng_client_receive() would
+ * receive it. The message and the recipient are copied.
+ *
+ * @param [engine]     The engine.
+ * @param [client]     The client that received the message.
+ * @param [recipient]  Who the message comes from.
+ * @param [msg]        The received message.
+ * @param [data]       Given back in the result.
+ *
+ * @return OTRNG_ERROR if the engine is being freed.
+ */
+API otrng_result otrng_engine_submit(otrng_engine_s *engine,
+                                     otrng_client_s *client,
+                                     const char *recipient, const char *msg,
+                                     /*@null@*/ void *data);
+
+/**
+ * @brief Waits until every message submitted so far has been completed.
+ * It must not be called from the completion callback.
+ *
+ * @param [engine]  The engine.
+ */
+API void otrng_engine_drain(otrng_engine_s *engine);
+
+#ifdef OTRNG_ENGINE_PRIVATE
+
+tstatic /*@null@*/ struct engine_strand_s *
+engine_take_strand(otrng_engine_s *engine, size_t worker);
+
+#endif
+
+#endif
@@ -118,52 +118,88 @@ tstatic void otrng_known_fingerprint_free(otrng_known_fingerprint_s *kf) {
 
 static void free_fp_proxy(void *kf) { otrng_known_fingerprint_free(kf); }
 
+INTERNAL otrng_known_fingerprints_s *otrng_known_fingerprints_new(void) {
+  otrng_known_fingerprints_s *kf =
+      otrng_xmalloc_z(sizeof(otrng_known_fingerprints_s));
+
+  otrng_hash_index_init(&kf->by_fp);
+  otrng_hash_index_init(&kf->by_username);
+
+  return kf;
+}
+
 API void otrng_known_fingerprints_free(otrng_known_fingerprints_s *kf) {
   if (kf == NULL) {
     return;
   }
-  otrng_list_free(kf->fps, free_fp_proxy);
+  otrng_list_clear(&kf->fps, free_fp_proxy);
+  otrng_hash_index_destroy(&kf->by_fp);
+  otrng_hash_index_destroy(&kf->by_username);
   otrng_free(kf);
 }
 
+static uint64_t hash_fp(const otrng_known_fingerprints_s *kf,
+                        const otrng_fingerprint fp) {
+  return otrng_hash_index_hash(&kf->by_fp, 0, fp, FPRINT_LEN_BYTES);
+}
+
+static uint64_t hash_username(const otrng_known_fingerprints_s *kf,
+                              const char *username) {
+  return otrng_hash_index_hash(&kf->by_username, 0, username,
+                               strlen(username));
+}
+
+static int fp_matches(const void *item, const void *wanted) {
+  const otrng_known_fingerprint_s *kf = item;
+  return memcmp(kf->fp, wanted, FPRINT_LEN_BYTES) == 0;
+}
+
+static int username_matches(const void *item, const void *wanted) {
+  const otrng_known_fingerprint_s *kf = item;
+  return strcmp(kf->username, wanted) == 0;
+}
+
+static int fp_and_username_match(const void *item, const void *wanted) {
+  const otrng_known_fingerprint_s *kf = item;
+  const otrng_known_fingerprint_s *w = wanted;
+  return memcmp(kf->fp, w->fp, FPRINT_LEN_BYTES) == 0 &&
+         strcmp(kf->username, w->username) == 0;
+}
+
+INTERNAL void otrng_known_fingerprints_add(otrng_known_fingerprints_s *kf,
+                                           otrng_known_fingerprint_s *fp) {
+  otrng_list_append(&kf->fps, fp);
+  otrng_hash_index_add(&kf->by_fp, hash_fp(kf, fp->fp), fp);
+  otrng_hash_index_add(&kf->by_username, hash_username(kf, fp->username), fp);
+}
+
 API /*@null@*/ otrng_known_fingerprint_s *
 otrng_fingerprint_get_by_fp(const otrng_client_s *client,
                             const otrng_fingerprint fp) {
-  list_element_s *c;
+  const otrng_known_fingerprints_s *kf;
   assert(client != NULL);
 
-  if (client->fingerprints == NULL) {
+  kf = client->fingerprints;
+  if (kf == NULL) {
     return NULL;
   }
 
-  for (c = client->fingerprints->fps; c; c = c->next) {
-    otrng_known_fingerprint_s *kf = c->data;
-    if (memcmp(fp, kf->fp, FPRINT_LEN_BYTES) == 0) {
-      return kf;
-    }
-  }
-
-  return NULL;
+  return otrng_hash_index_find(&kf->by_fp, hash_fp(kf, fp), fp_matches, fp);
 }
 
 API /*@null@*/ otrng_known_fingerprint_s *
 otrng_fingerprint_get_by_username(const otrng_client_s *client,
                                   const char *username) {
-  list_element_s *c;
+  const otrng_known_fingerprints_s *kf;
   assert(client != NULL);
 
-  if (client->fingerprints == NULL) {
+  kf = client->fingerprints;
+  if (kf == NULL) {
     return NULL;
   }
 
-  for (c = client->fingerprints->fps; c; c = c->next) {
-    otrng_known_fingerprint_s *kf = c->data;
-    if (strcmp(username, kf->username) == 0) {
-      return kf;
-    }
-  }
-
-  return NULL;
+  return otrng_hash_index_find(&kf->by_username, hash_username(kf, username),
+                               username_matches, username);
 }
 
 API otrng_known_fingerprint_s *otrng_fingerprint_add(otrng_client_s *client,
@@ -174,7 +210,7 @@ API otrng_known_fingerprint_s *otrng_fingerprint_add(otrng_client_s *client,
   assert(client != NULL);
 
   if (client->fingerprints == NULL) {
-    client->fingerprints = otrng_xmalloc_z(sizeof(otrng_known_fingerprints_s));
+    client->fingerprints = otrng_known_fingerprints_new();
   }
 
   nfp = otrng_xmalloc_z(sizeof(otrng_known_fingerprint_s));
@@ -182,7 +218,7 @@ API otrng_known_fingerprint_s *otrng_fingerprint_add(otrng_client_s *client,
   nfp->trusted = trusted;
   memcpy(nfp->fp, fp, FPRINT_LEN_BYTES);
 
-  client->fingerprints->fps = otrng_list_add(nfp, client->fingerprints->fps);
+  otrng_known_fingerprints_add(client->fingerprints, nfp);
 
   return nfp;
 }
@@ -199,38 +235,45 @@ API void otrng_fingerprints_do_all(const struct otrng_client_s *client,
     return;
   }
 
-  for (c = client->fingerprints->fps; c; c = c->next) {
+  for (c = client->fingerprints->fps.head; c; c = c->next) {
     fn(client, c->data, context);
   }
 }
 
 API void otrng_fingerprint_forget(const otrng_client_s *client,
                                   otrng_known_fingerprint_s *fp) {
-  list_element_s *prev = NULL, *c, *work;
+  otrng_known_fingerprints_s *kf;
+  otrng_known_fingerprint_s wanted;
+  otrng_known_fingerprint_s *found;
+  uint64_t fp_hash;
   assert(client != NULL);
 
-  if (client->fingerprints == NULL) {
+  kf = client->fingerprints;
+  if (kf == NULL) {
     return;
   }
 
-  for (c = client->fingerprints->fps; c;) {
-    otrng_known_fingerprint_s *kf = c->data;
-    if (memcmp(fp->fp, kf->fp, FPRINT_LEN_BYTES) == 0 &&
-        strcmp(fp->username, kf->username) == 0) {
-      work = c;
-      c = work->next;
-      if (prev) {
-        prev->next = c;
-      } else {
-        client->fingerprints->fps = c;
-      }
-      otrng_known_fingerprint_free(kf);
-      otrng_free(work);
-    } else {
-      prev = c;
-      c = c->next;
+  /* [fp] can be one of the fingerprints we free */
+  memcpy(wanted.fp, fp->fp, FPRINT_LEN_BYTES);
+  wanted.username = otrng_xstrdup(fp->username);
+  fp_hash = hash_fp(kf, wanted.fp);
+
+  while ((found = otrng_hash_index_find(&kf->by_fp, fp_hash,
+                                        fp_and_username_match, &wanted))) {
+    list_element_s *node = otrng_list_get_by_value(found, kf->fps.head);
+
+    otrng_hash_index_remove(&kf->by_fp, fp_hash, found);
+    otrng_hash_index_remove(&kf->by_username,
+                            hash_username(kf, found->username), found);
+    if (node) {
+      otrng_list_unlink(&kf->fps, node);
+      otrng_list_free_nodes(node);
     }
+
+    otrng_known_fingerprint_free(found);
   }
+
+  otrng_free(wanted.username);
 }
 
 /* This returns the fingerprint of the peer, not the self.
@@ -31,6 +31,7 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "hash_index.h"
 #include "keys.h"
 #include "list.h"
 #include "shared.h"
@@ -64,9 +65,12 @@ typedef struct otrng_known_fingerprint_v3_s {
   Fingerprint *fp;
 } otrng_known_fingerprint_v3_s;
 
-/* a list of known fingerprints */
+/* the known fingerprints, in the order they were added, indexed by
+   fingerprint and by username */
 typedef struct otrng_known_fingerprints_s {
-  list_element_s *fps;
+  list_s fps;
+  hash_index_s by_fp;
+  hash_index_s by_username;
 } otrng_known_fingerprints_s;
 
 /**
@@ -99,6 +103,22 @@ INTERNAL otrng_result otrng_serialize_fingerprint(
     otrng_fingerprint fp, const otrng_public_key long_term_pub_key,
     const otrng_public_key long_term_forging_pub_key);
 
+/**
+ * @brief Creates an empty store of known fingerprints.
+ *
+ * @return A new store [otrng_known_fingerprints_s].
+ */
+INTERNAL otrng_known_fingerprints_s *otrng_known_fingerprints_new(void);
+
+/**
+ * @brief Adds the fingerprint to the store, which takes ownership of it.
+ *
+ * @param [kf]  The store.
+ * @param [fp]  The fingerprint.
+ */
+INTERNAL void otrng_known_fingerprints_add(otrng_known_fingerprints_s *kf,
+                                           otrng_known_fingerprint_s *fp);
+
 /**
  * @brief Free a known fingerprints.
  *
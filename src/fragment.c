@@ -22,7 +22,6 @@
 #include <gcrypt.h>
 #endif
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -31,12 +30,9 @@
 
 #include "alloc.h"
 #include "fragment.h"
-#include "list.h"
 
 /* Example:
    ?OTR|00000000|00000001|00000002,00001,00002,one , */
-#define FRAGMENT_FORMAT "?OTR|%08x|%08x|%08x,%05hu,%05hu,%.*s,"
-#define UNFRAGMENT_FORMAT "?OTR|%08x|%08x|%08x,%05hu,%05hu,%n%*[^,],%n"
 
 otrng_message_to_send_s *otrng_message_new(void) {
   otrng_message_to_send_s *msg =
@@ -52,93 +48,116 @@ tstatic void otrng_message_free(otrng_message_to_send_s *msg) {
     return;
   }
 
-  for (i = 0; i < msg->total; i++) {
-    otrng_free(msg->pieces[i]);
+  if (!msg->contiguous) {
+    for (i = 0; i < msg->total; i++) {
+      otrng_free(msg->pieces[i]);
+    }
   }
 
   otrng_free(msg->pieces);
   otrng_free(msg);
 }
 
-tstatic void initialize_fragment_context(fragment_context_s *context) {
-  context->identifier = 0;
-  context->count = 0;
-  context->total = 0;
-  context->last_fragment_received_at = 0;
-  context->total_message_len = 0;
-  context->fragments = NULL;
+INTERNAL void otrng_fragment_context_free(fragment_context_s *context) {
+  otrng_free(context->buffer);
+  otrng_free(context->pieces);
+  otrng_free(context);
 }
 
-tstatic void free_fragments_in_context(fragment_context_s *context) {
-  unsigned int i;
+INTERNAL void otrng_fragment_store_init(fragment_store_s *store) {
+  memset(store, 0, sizeof(fragment_store_s));
+  otrng_hash_index_init(&store->index);
+  store->max_buffered_bytes = FRAGMENT_DEFAULT_MAX_BUFFERED_BYTES;
+}
 
-  if (!context->fragments) {
-    return;
-  }
+INTERNAL void otrng_fragment_store_destroy(fragment_store_s *store) {
+  fragment_context_s *context = store->oldest;
 
-  for (i = 0; i < context->total; i++) {
-    otrng_free(context->fragments[i]);
-    context->fragments[i] = NULL;
+  while (context) {
+    fragment_context_s *newer = context->newer;
+    otrng_fragment_context_free(context);
+    context = newer;
   }
-}
 
-tstatic void reset_fragment_context(fragment_context_s *context) {
-  free_fragments_in_context(context);
-  initialize_fragment_context(context);
+  otrng_hash_index_destroy(&store->index);
+  store->oldest = NULL;
+  store->newest = NULL;
+  store->count = 0;
+  store->buffered_bytes = 0;
 }
 
-tstatic /*@notnull@*/ fragment_context_s *otrng_fragment_context_new(void) {
-  fragment_context_s *context = otrng_xmalloc_z(sizeof(fragment_context_s));
-  initialize_fragment_context(context);
-  return context;
+static const char hex_digits[] = "0123456789abcdef";
+
+static char *write_hex32(char *dst, uint32_t value) {
+  int i;
+
+  for (i = 7; i >= 0; i--) {
+    dst[i] = hex_digits[value & 0xf];
+    value >>= 4;
+  }
+
+  return dst + 8;
 }
 
-INTERNAL void otrng_fragment_context_free(fragment_context_s *context) {
-  free_fragments_in_context(context);
-  otrng_free(context->fragments);
-  otrng_free(context);
+static char *write_dec5(char *dst, uint16_t value) {
+  int i;
+
+  for (i = 4; i >= 0; i--) {
+    dst[i] = (char)('0' + value % 10);
+    value /= 10;
+  }
+
+  return dst + 5;
 }
 
-static otrng_result create_fragment_message(char **dst, const char *piece,
-                                            size_t piece_len,
-                                            uint32_t identifier,
-                                            uint32_t our_instance,
-                                            uint32_t their_instance,
-                                            uint16_t current, uint16_t total) {
-  int res;
+/* Writes "?OTR|%08x|%08x|%08x,%05hu,%05hu,<piece>," and its NUL.
+   Returns where the next piece can be written. */
+static char *write_fragment(char *dst, const char *piece, size_t piece_len,
+                            uint32_t identifier, uint32_t our_instance,
+                            uint32_t their_instance, uint16_t current,
+                            uint16_t total) {
+  memcpy(dst, "?OTR|", 5);
+  dst = write_hex32(dst + 5, identifier);
+  *dst++ = '|';
+  dst = write_hex32(dst, our_instance);
+  *dst++ = '|';
+  dst = write_hex32(dst, their_instance);
+  *dst++ = ',';
+  dst = write_dec5(dst, current);
+  *dst++ = ',';
+  dst = write_dec5(dst, total);
+  *dst++ = ',';
+  memcpy(dst, piece, piece_len);
+  dst += piece_len;
+  *dst++ = ',';
+  *dst++ = '\0';
+
+  return dst;
+}
 
-  if (strlen(piece) < piece_len) {
+static otrng_result count_fragments(int *total, size_t *limit, int max_size,
+                                    size_t msg_len) {
+  if (max_size <= FRAGMENT_HEADER_LEN || msg_len == 0) {
     return OTRNG_ERROR;
   }
 
-  *dst = otrng_xmalloc_z(FRAGMENT_HEADER_LEN + piece_len + 1);
-
-  res = snprintf(*dst, FRAGMENT_HEADER_LEN + piece_len + 1, FRAGMENT_FORMAT,
-                 identifier, our_instance, their_instance, current, total,
-                 (int)piece_len, piece);
-  if (res < 0) {
+  *limit = max_size - FRAGMENT_HEADER_LEN;
+  if ((msg_len - 1) / *limit + 1 > 65535) {
     return OTRNG_ERROR;
   }
 
-  (*dst)[FRAGMENT_HEADER_LEN + piece_len] = '\0';
+  *total = (int)((msg_len - 1) / *limit + 1);
 
   return OTRNG_SUCCESS;
 }
 
-static otrng_result
-init_message_to_send_with_total(otrng_message_to_send_s *fragments, int total) {
-  size_t pieces_len;
+static uint32_t new_fragment_identifier(void) {
+  uint32_t identifier;
 
-  if (total < 1 || total > 65535) {
-    return OTRNG_ERROR;
-  }
-
-  fragments->total = total;
-
-  pieces_len = fragments->total * sizeof(string_p);
-  fragments->pieces = otrng_xmalloc_z(pieces_len);
+  /* It only needs to tell our messages apart, so a nonce is enough */
+  gcry_create_nonce(&identifier, sizeof(identifier));
 
-  return OTRNG_SUCCESS;
+  return identifier;
 }
 
 INTERNAL otrng_result otrng_fragment_message(int max_size,
@@ -147,212 +166,504 @@ INTERNAL otrng_result otrng_fragment_message(int max_size,
                                              uint32_t their_instance,
                                              const string_p msg) {
   size_t msg_len = strlen(msg);
-  size_t limit = max_size - FRAGMENT_HEADER_LEN;
-  int total = ((msg_len - 1) / limit) + 1;
-  uint32_t *identifier;
-  int i;
+  size_t limit;
+  uint32_t identifier;
+  int total, i;
 
-  if (otrng_failed(init_message_to_send_with_total(fragments, total))) {
+  if (otrng_failed(count_fragments(&total, &limit, max_size, msg_len))) {
     return OTRNG_ERROR;
   }
 
-  identifier = gcry_random_bytes(4, GCRY_STRONG_RANDOM);
-  if (!identifier) {
+  identifier = new_fragment_identifier();
+
+  fragments->total = total;
+  fragments->contiguous = otrng_false;
+  fragments->pieces = otrng_xmalloc_z(total * sizeof(string_p));
+
+  for (i = 0; i < total; i++) {
+    size_t piece_len = msg_len < limit ? msg_len : limit;
+
+    fragments->pieces[i] = otrng_xmalloc(FRAGMENT_HEADER_LEN + piece_len + 1);
+    (void)write_fragment(fragments->pieces[i], msg, piece_len, identifier,
+                         our_instance, their_instance, i + 1, total);
+
+    msg += piece_len;
+    msg_len -= piece_len;
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_fragment_message_contiguous(
+    int max_size, otrng_message_to_send_s *fragments, uint32_t our_instance,
+    uint32_t their_instance, const string_p msg) {
+  size_t msg_len = strlen(msg);
+  size_t limit, pieces_len;
+  uint32_t identifier;
+  char *dst;
+  int total, i;
+
+  if (otrng_failed(count_fragments(&total, &limit, max_size, msg_len))) {
     return OTRNG_ERROR;
   }
 
-  for (i = 0; i < fragments->total; i++) {
-    int piece_len = msg_len < limit ? msg_len : limit;
-    char **dst = fragments->pieces + i;
+  identifier = new_fragment_identifier();
 
-    if (otrng_failed(create_fragment_message(dst, msg, piece_len, *identifier,
-                                             our_instance, their_instance,
-                                             i + 1, fragments->total))) {
-      otrng_message_free(fragments);
-      return OTRNG_ERROR;
-    }
+  /* The array of pieces, followed by the pieces themselves */
+  pieces_len = total * sizeof(string_p);
+  fragments->total = total;
+  fragments->contiguous = otrng_true;
+  fragments->pieces =
+      otrng_xmalloc(pieces_len + total * (FRAGMENT_HEADER_LEN + 1) + msg_len);
+
+  dst = (char *)fragments->pieces + pieces_len;
+  for (i = 0; i < total; i++) {
+    size_t piece_len = msg_len < limit ? msg_len : limit;
+
+    fragments->pieces[i] = dst;
+    dst = write_fragment(dst, msg, piece_len, identifier, our_instance,
+                         their_instance, i + 1, total);
 
     msg += piece_len;
     msg_len -= piece_len;
   }
 
-  gcry_free(identifier);
-
   return OTRNG_SUCCESS;
 }
 
 tstatic otrng_bool is_fragment_generic(const string_p msg, const char *prefix) {
-  if (msg != NULL && strstr(msg, prefix) == msg) {
+  if (msg != NULL && strncmp(msg, prefix, strlen(prefix)) == 0) {
     return otrng_true;
   }
 
   return otrng_false;
 }
 
-tstatic otrng_result initialize_fragments(fragment_context_s *context) {
-  context->fragments = otrng_xmalloc_z(sizeof(string_p) * context->total);
+INTERNAL otrng_bool otrng_is_fragment(const string_p msg) {
+  return is_fragment_generic(msg, "?OTR|");
+}
 
-  return OTRNG_SUCCESS;
+typedef struct fragment_header_s {
+  uint32_t identifier;
+  uint32_t sender_tag;
+  uint32_t receiver_tag;
+  uint16_t index;
+  uint16_t total;
+  const char *piece;
+  size_t piece_len; /* 0 if there is no piece terminated by a comma */
+} fragment_header_s;
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
 }
 
-tstatic otrng_result join_fragments(char **unfrag_msg,
-                                    fragment_context_s *context) {
-  char *end_msg;
-  unsigned int i;
+/* Reads up to 8 hex digits followed by [separator] */
+static otrng_bool scan_hex32(uint32_t *dst, const char **cursor,
+                             char separator) {
+  const char *c = *cursor;
+  uint32_t value = 0;
+  int digits = 0;
+
+  while (digits < 8 && hex_value(*c) >= 0) {
+    value = (value << 4) | (uint32_t)hex_value(*c);
+    digits++;
+    c++;
+  }
+
+  if (digits == 0 || *c != separator) {
+    return otrng_false;
+  }
+
+  *dst = value;
+  *cursor = c + 1;
+  return otrng_true;
+}
 
-  *unfrag_msg = otrng_xmalloc_z(context->total_message_len + 1);
+/* Reads up to 5 decimal digits followed by a comma */
+static otrng_bool scan_dec16(uint16_t *dst, const char **cursor) {
+  const char *c = *cursor;
+  uint32_t value = 0;
+  int digits = 0;
 
-  end_msg = *unfrag_msg;
-  for (i = 0; i < context->total; i++) {
-    end_msg = otrng_stpcpy(end_msg, context->fragments[i]);
+  while (digits < 5 && *c >= '0' && *c <= '9') {
+    value = value * 10 + (uint32_t)(*c - '0');
+    digits++;
+    c++;
   }
 
-  return OTRNG_SUCCESS;
+  if (digits == 0 || *c != ',' || value > UINT16_MAX) {
+    return otrng_false;
+  }
+
+  *dst = (uint16_t)value;
+  *cursor = c + 1;
+  return otrng_true;
 }
 
-tstatic otrng_result copy_fragment_to_context(fragment_context_s *context,
-                                              unsigned short i,
-                                              const string_p msg,
-                                              uint32_t fragment_len) {
-  char *fragment = otrng_xmalloc(fragment_len + 1);
+/* Parses "identifier|sender_tag|receiver_tag,index,total,piece," */
+static otrng_result parse_fragment_header(fragment_header_s *header,
+                                          const char *msg) {
+  const char *cursor = msg;
+  const char *piece_end;
+
+  if (!scan_hex32(&header->identifier, &cursor, '|') ||
+      !scan_hex32(&header->sender_tag, &cursor, '|') ||
+      !scan_hex32(&header->receiver_tag, &cursor, ',') ||
+      !scan_dec16(&header->index, &cursor) ||
+      !scan_dec16(&header->total, &cursor)) {
+    return OTRNG_ERROR;
+  }
+
+  header->piece = cursor;
+  header->piece_len = 0;
+
+  piece_end = strchr(cursor, ',');
+  if (piece_end) {
+    header->piece_len = piece_end - cursor;
+  }
 
-  memcpy(fragment, msg, fragment_len);
-  fragment[fragment_len] = '\0';
-  context->fragments[i - 1] = fragment;
-  context->total_message_len += fragment_len;
   return OTRNG_SUCCESS;
 }
 
-INTERNAL otrng_result otrng_unfragment_message_generic(
-    char **unfrag_msg, list_element_s **contexts, const string_p msg,
-    const uint32_t our_instance_tag, const char *prefix, const char *format) {
-  int start = 0, end = 0;
-  uint32_t fragment_identifier = 0, sender_tag = 0, receiver_tag = 0;
-  uint16_t i = 0, t = 0;
-  fragment_context_s *context = NULL;
-  list_element_s *current = NULL;
-  fragment_context_s *ctx = NULL;
-  uint32_t fragment_len = 0;
+typedef struct fragment_context_key_s {
+  uint32_t identifier;
+  uint32_t sender_tag;
+} fragment_context_key_s;
+
+static uint64_t hash_context_key(const fragment_store_s *store,
+                                 uint32_t identifier, uint32_t sender_tag) {
+  uint8_t key[8];
+
+  key[0] = (uint8_t)(identifier >> 24);
+  key[1] = (uint8_t)(identifier >> 16);
+  key[2] = (uint8_t)(identifier >> 8);
+  key[3] = (uint8_t)identifier;
+  key[4] = (uint8_t)(sender_tag >> 24);
+  key[5] = (uint8_t)(sender_tag >> 16);
+  key[6] = (uint8_t)(sender_tag >> 8);
+  key[7] = (uint8_t)sender_tag;
+
+  return otrng_hash_index_hash(&store->index, 0, key, sizeof(key));
+}
 
-  *unfrag_msg = NULL;
+static int context_matches(const void *item, const void *wanted) {
+  const fragment_context_s *context = item;
+  const fragment_context_key_s *key = wanted;
+
+  return context->identifier == key->identifier &&
+         context->sender_tag == key->sender_tag;
+}
+
+static void unlink_context(fragment_store_s *store,
+                           fragment_context_s *context) {
+  if (context->older) {
+    context->older->newer = context->newer;
+  } else {
+    store->oldest = context->newer;
+  }
 
-  if (!contexts) {
+  if (context->newer) {
+    context->newer->older = context->older;
+  } else {
+    store->newest = context->older;
+  }
+
+  context->older = NULL;
+  context->newer = NULL;
+}
+
+static void link_as_newest(fragment_store_s *store,
+                           fragment_context_s *context) {
+  context->older = store->newest;
+  if (store->newest) {
+    store->newest->newer = context;
+  } else {
+    store->oldest = context;
+  }
+  store->newest = context;
+}
+
+static void remove_context(fragment_store_s *store,
+                           fragment_context_s *context) {
+  otrng_hash_index_remove(
+      &store->index,
+      hash_context_key(store, context->identifier, context->sender_tag),
+      context);
+  unlink_context(store, context);
+
+  store->count--;
+  store->buffered_bytes -= context->footprint;
+  otrng_fragment_context_free(context);
+}
+
+/* Drops the messages that have waited the longest for a fragment, but not
+ * [keep], until [needed] more bytes fit in the store */
+static otrng_result make_room(fragment_store_s *store,
+                              const fragment_context_s *keep, size_t needed) {
+  if (needed > store->max_buffered_bytes) {
     return OTRNG_ERROR;
   }
 
-  if (!is_fragment_generic(msg, prefix)) {
-    *unfrag_msg = otrng_xstrdup(msg);
+  while (store->buffered_bytes + needed > store->max_buffered_bytes) {
+    fragment_context_s *oldest = store->oldest;
 
-    return OTRNG_SUCCESS;
+    if (oldest && oldest == keep) {
+      oldest = oldest->newer;
+    }
+
+    if (!oldest) {
+      return OTRNG_ERROR;
+    }
+
+    remove_context(store, oldest);
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+static /*@null@*/ fragment_context_s *
+create_context(fragment_store_s *store, const fragment_header_s *header) {
+  fragment_context_s *context;
+  size_t pieces_len = header->total * sizeof(fragment_piece_s);
+  size_t footprint = sizeof(fragment_context_s) + pieces_len;
+
+  if (otrng_failed(make_room(store, NULL, footprint))) {
+    return NULL;
   }
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-nonliteral"
-#pragma GCC diagnostic ignored "-Wformat-nonliteral"
-  if (sscanf(msg, format, &fragment_identifier, &sender_tag, &receiver_tag, &i,
-             &t, &start, &end) == EOF) {
+  context = otrng_xmalloc_z(sizeof(fragment_context_s));
+  context->identifier = header->identifier;
+  context->sender_tag = header->sender_tag;
+  context->total = header->total;
+  context->in_order = otrng_true;
+  context->pieces = otrng_xmalloc_z(pieces_len);
+  context->footprint = footprint;
+  link_as_newest(store, context);
+
+  store->count++;
+  store->buffered_bytes += footprint;
+
+  otrng_hash_index_add(
+      &store->index,
+      hash_context_key(store, header->identifier, header->sender_tag),
+      context);
+
+  return context;
+}
+
+static otrng_result grow_buffer(fragment_store_s *store,
+                                fragment_context_s *context, size_t needed,
+                                size_t wanted) {
+  size_t capacity = needed;
+  size_t free_bytes;
+
+  /* Only what the piece needs may drop other messages */
+  if (otrng_failed(
+          make_room(store, context, needed - context->buffer_capacity))) {
     return OTRNG_ERROR;
   }
-#pragma GCC diagnostic error "-Wformat-nonliteral"
-#pragma clang diagnostic pop
 
-  if (our_instance_tag != receiver_tag && 0 != receiver_tag) {
-    return OTRNG_SUCCESS;
+  /* Anything more is only taken from the memory that is still free */
+  free_bytes = store->max_buffered_bytes - store->buffered_bytes -
+               (needed - context->buffer_capacity);
+  if (wanted > needed) {
+    capacity += wanted - needed < free_bytes ? wanted - needed : free_bytes;
   }
 
-  if (end <= start) {
+  context->buffer = otrng_xrealloc(context->buffer, capacity);
+  store->buffered_bytes += capacity - context->buffer_capacity;
+  context->footprint += capacity - context->buffer_capacity;
+  context->buffer_capacity = capacity;
+
+  return OTRNG_SUCCESS;
+}
+
+static otrng_result store_piece(fragment_store_s *store,
+                                fragment_context_s *context,
+                                const fragment_header_s *header) {
+  fragment_piece_s *piece = &context->pieces[header->index - 1];
+  /* Leave room for the NUL, as the buffer can become the message */
+  size_t needed = context->total_message_len + header->piece_len + 1;
+
+  if (needed > UINT32_MAX) {
     return OTRNG_ERROR;
   }
 
-  for (current = *contexts; current; current = current->next) {
-    if (!current->data) {
-      continue;
+  if (needed > context->buffer_capacity) {
+    /* Until we know better, expect the other pieces to be as long as this
+     * one. Afterwards, grow geometrically. */
+    size_t wanted = context->buffer
+                        ? context->buffer_capacity * 2
+                        : context->total * header->piece_len + 1;
+
+    if (otrng_failed(grow_buffer(store, context, needed, wanted))) {
+      return OTRNG_ERROR;
     }
+  }
+
+  memcpy(context->buffer + context->total_message_len, header->piece,
+         header->piece_len);
 
-    ctx = current->data;
-    if (ctx->identifier == fragment_identifier) {
-      context = ctx;
-      break;
+  piece->offset = (uint32_t)context->total_message_len;
+  piece->len = (uint32_t)header->piece_len;
+
+  if (header->index != context->count + 1) {
+    context->in_order = otrng_false;
+  }
+
+  context->count++;
+  context->total_message_len += header->piece_len;
+  context->last_fragment_received_at = time(NULL);
+
+  /* Keep the contexts in the order their last fragment arrived */
+  if (context != store->newest) {
+    unlink_context(store, context);
+    link_as_newest(store, context);
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+static char *join_pieces(fragment_context_s *context) {
+  size_t len = context->total_message_len;
+  char *msg;
+  unsigned int i;
+
+  if (context->in_order) {
+    /* The buffer already holds the message, so we hand it over */
+    msg = context->buffer;
+    context->buffer = NULL;
+
+    if (context->buffer_capacity > 2 * (len + 1)) {
+      msg = otrng_xrealloc(msg, len + 1);
+    }
+  } else {
+    char *cursor;
+
+    msg = otrng_xmalloc(len + 1);
+    cursor = msg;
+    for (i = 0; i < context->total; i++) {
+      memcpy(cursor, context->buffer + context->pieces[i].offset,
+             context->pieces[i].len);
+      cursor += context->pieces[i].len;
     }
   }
 
-  if (!context) {
-    context = otrng_fragment_context_new();
-    context->identifier = fragment_identifier;
-    *contexts = otrng_list_add(context, *contexts);
+  msg[len] = '\0';
+
+  return msg;
+}
+
+INTERNAL otrng_result otrng_unfragment_message_generic(
+    char **unfrag_msg, fragment_store_s *store, const string_p msg,
+    const uint32_t our_instance_tag, const char *prefix) {
+  fragment_header_s header;
+  fragment_context_key_s key;
+  fragment_context_s *context;
+
+  *unfrag_msg = NULL;
+
+  if (!store) {
+    return OTRNG_ERROR;
+  }
+
+  if (!is_fragment_generic(msg, prefix)) {
+    *unfrag_msg = otrng_xstrdup(msg);
+
+    return OTRNG_SUCCESS;
+  }
+
+  if (otrng_failed(parse_fragment_header(&header, msg + strlen(prefix)))) {
+    return OTRNG_ERROR;
   }
 
-  if (i == 0 || t == 0 || i > t) {
-    reset_fragment_context(context);
+  if (our_instance_tag != header.receiver_tag && 0 != header.receiver_tag) {
     return OTRNG_SUCCESS;
   }
 
-  if (context->total != 0 && context->total != t) {
+  if (header.piece_len == 0) {
     return OTRNG_ERROR;
   }
 
-  context->total = t;
+  key.identifier = header.identifier;
+  key.sender_tag = header.sender_tag;
+  context = otrng_hash_index_find(
+      &store->index,
+      hash_context_key(store, header.identifier, header.sender_tag),
+      context_matches, &key);
+
+  if (header.index == 0 || header.total == 0 || header.index > header.total) {
+    if (context) {
+      remove_context(store, context);
+    }
+    return OTRNG_SUCCESS;
+  }
 
-  if (context->fragments == NULL) {
-    if (otrng_failed(initialize_fragments(context))) {
+  if (!context) {
+    context = create_context(store, &header);
+    if (!context) {
       return OTRNG_ERROR;
     }
   }
 
-  if (context->fragments[i - 1] != NULL) {
+  if (context->total != header.total) {
     return OTRNG_ERROR;
   }
 
-  fragment_len = end - start - 1;
-  if (otrng_failed(
-          copy_fragment_to_context(context, i, msg + start, fragment_len))) {
+  if (context->pieces[header.index - 1].len != 0) {
     return OTRNG_ERROR;
   }
 
-  context->count++;
-  context->last_fragment_received_at = time(NULL);
-
-  if (context->count == t) {
-    if (otrng_succeeded(join_fragments(unfrag_msg, context))) {
-      list_element_s *to_remove = otrng_list_get_by_value(context, *contexts);
-      *contexts = otrng_list_remove_element(to_remove, *contexts);
-      otrng_fragment_context_free(context);
-      otrng_list_free_nodes(to_remove);
-      return OTRNG_SUCCESS;
-    }
+  if (otrng_failed(store_piece(store, context, &header))) {
+    /* This message alone does not fit in the store */
+    remove_context(store, context);
     return OTRNG_ERROR;
   }
 
+  if (context->count == context->total) {
+    *unfrag_msg = join_pieces(context);
+    remove_context(store, context);
+  }
+
   return OTRNG_SUCCESS;
 }
+
 INTERNAL otrng_result
-otrng_unfragment_message(char **unfrag_msg, list_element_s **contexts,
+otrng_unfragment_message(char **unfrag_msg, fragment_store_s *store,
                          const string_p msg, const uint32_t our_instance_tag) {
-  return otrng_unfragment_message_generic(
-      unfrag_msg, contexts, msg, our_instance_tag, "?OTR|", UNFRAGMENT_FORMAT);
+  return otrng_unfragment_message_generic(unfrag_msg, store, msg,
+                                          our_instance_tag, "?OTR|");
 }
 
 INTERNAL otrng_result otrng_expire_fragments(time_t now,
                                              uint32_t expiration_time,
-                                             list_element_s **contexts) {
-  list_element_s *current = *contexts;
-
-  while (current) {
-    fragment_context_s *ctx = current->data;
-
-    list_element_s *to_free = NULL;
-    if ((ctx != NULL) &&
-        (difftime(now, ctx->last_fragment_received_at) < expiration_time)) {
-      *contexts = otrng_list_remove_element(current, *contexts);
-      otrng_fragment_context_free(ctx);
-      to_free = current;
-    }
-
-    current = current->next;
-    if (to_free) {
-      otrng_list_free_nodes(to_free);
-    }
+                                             fragment_store_s *store) {
+  /* The oldest context is the one that has waited the longest */
+  while (store->oldest &&
+         difftime(now, store->oldest->last_fragment_received_at) >=
+             expiration_time) {
+    remove_context(store, store->oldest);
   }
 
   return OTRNG_SUCCESS;
 }
+
+INTERNAL otrng_bool otrng_fragments_next_expiry(time_t *at,
+                                                uint32_t expiration_time,
+                                                const fragment_store_s *store) {
+  if (!store->oldest) {
+    return otrng_false;
+  }
+
+  *at = store->oldest->last_fragment_received_at + (time_t)expiration_time;
+  return otrng_true;
+}
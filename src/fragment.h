@@ -28,8 +28,10 @@
 #ifndef OTRNG_FRAGMENT_H
 #define OTRNG_FRAGMENT_H
 
+#include <time.h>
+
 #include "error.h"
-#include "list.h"
+#include "hash_index.h"
 #include "shared.h"
 #include "str.h"
 
@@ -40,36 +42,133 @@
 typedef struct otrng_message_to_send_s {
   string_p *pieces;
   int total;
+  /* the pieces live in the same allocation as the [pieces] array */
+  otrng_bool contiguous;
 } otrng_message_to_send_s;
 
+/* The default bound on the memory used by the fragments we are waiting to
+   complete, per connection */
+#define FRAGMENT_DEFAULT_MAX_BUFFERED_BYTES (8 * 1024 * 1024)
+
+/* where a piece is in the context buffer */
+typedef struct fragment_piece_s {
+  uint32_t offset;
+  uint32_t len; /* 0 if the piece has not arrived yet */
+} fragment_piece_s;
+
 typedef struct fragment_context_s {
   uint32_t identifier;
+  uint32_t sender_tag;
   unsigned int total, count;
   size_t total_message_len;
   time_t last_fragment_received_at;
-  string_p *fragments;
+
+  /* The pieces, in the order they arrived. If they arrived in order, the
+     buffer is already the message */
+  /*@null@*/ char *buffer;
+  size_t buffer_capacity;
+  otrng_bool in_order;
+  /*@null@*/ fragment_piece_s *pieces;
+
+  size_t footprint; /* the memory this context holds */
+
+  /*@null@*/ struct fragment_context_s *older;
+  /*@null@*/ struct fragment_context_s *newer;
 } fragment_context_s;
 
+/* The fragments we are waiting to complete, indexed by (identifier, sender
+   instance tag), from the one that has waited the longest for a fragment to
+   the one that got a fragment last. The memory they use is bounded: when it
+   goes over the bound, the messages that have waited the longest are
+   dropped. */
+typedef struct fragment_store_s {
+  /*@null@*/ fragment_context_s *oldest;
+  /*@null@*/ fragment_context_s *newest;
+  size_t count;
+
+  hash_index_s index;
+  size_t buffered_bytes;
+  size_t max_buffered_bytes;
+} fragment_store_s;
+
 INTERNAL void otrng_fragment_context_free(fragment_context_s *context);
 
+/**
+ * @brief Initializes an empty store, bounded to
+ * FRAGMENT_DEFAULT_MAX_BUFFERED_BYTES.
+ *
+ * @param [store]   The store.
+ */
+INTERNAL void otrng_fragment_store_init(fragment_store_s *store);
+
+/**
+ * @brief Frees all the pending fragments in the store.
+ *
+ * @param [store]   The store.
+ */
+INTERNAL void otrng_fragment_store_destroy(fragment_store_s *store);
+
 INTERNAL otrng_result otrng_fragment_message(int max_size,
                                              otrng_message_to_send_s *fragments,
                                              uint32_t our_instance,
                                              uint32_t their_instance,
                                              const string_p msg);
 
+/**
+ * @brief Fragments a message like otrng_fragment_message, but all the pieces
+ * and the array pointing to them are written into a single allocation.
+ *
+ * @param [max_size]        The maximum size of a piece, including its header.
+ * @param [fragments]       The fragments. Free them with otrng_message_free.
+ * @param [our_instance]    Our instance tag.
+ * @param [their_instance]  Their instance tag.
+ * @param [msg]             The message to fragment.
+ */
+INTERNAL otrng_result otrng_fragment_message_contiguous(
+    int max_size, otrng_message_to_send_s *fragments, uint32_t our_instance,
+    uint32_t their_instance, const string_p msg);
+
+/**
+ * @brief Tells if the message is a fragment of a bigger one.
+ *
+ * @param [msg] The received message.
+ */
+INTERNAL otrng_bool otrng_is_fragment(const string_p msg);
+
 INTERNAL otrng_result otrng_unfragment_message(char **unfrag_msg,
-                                               list_element_s **contexts,
+                                               fragment_store_s *store,
                                                const string_p msg,
                                                const uint32_t our_instance_tag);
 
 INTERNAL otrng_result otrng_unfragment_message_generic(
-    char **unfrag_msg, list_element_s **contexts, const string_p msg,
-    const uint32_t our_instance_tag, const char *prefix, const char *format);
+    char **unfrag_msg, fragment_store_s *store, const string_p msg,
+    const uint32_t our_instance_tag, const char *prefix);
 
+/**
+ * @brief Drops the messages that have not received any fragment in the last
+ * [expiration_time] seconds.
+ *
+ * @param [now]             The current time.
+ * @param [expiration_time] The time, in seconds, to wait for a fragment.
+ * @param [store]           The store.
+ */
 INTERNAL otrng_result otrng_expire_fragments(time_t now,
                                              uint32_t expiration_time,
-                                             list_element_s **contexts);
+                                             fragment_store_s *store);
+
+/**
+ * @brief Finds when the next message in the store will expire, if no more
+ * fragments arrive for it.
+ *
+ * @param [at]              Where the time will be written to.
+ * @param [expiration_time] The time, in seconds, to wait for a fragment.
+ * @param [store]           The store.
+ *
+ * @return otrng_false if there are no messages in the store.
+ */
+INTERNAL otrng_bool otrng_fragments_next_expiry(time_t *at,
+                                                uint32_t expiration_time,
+                                                const fragment_store_s *store);
 
 #ifdef OTRNG_FRAGMENT_PRIVATE
 
@@ -77,7 +176,7 @@ otrng_message_to_send_s *otrng_message_new(void);
 
 tstatic void otrng_message_free(otrng_message_to_send_s *msg);
 
-tstatic /*@notnull@*/ fragment_context_s *otrng_fragment_context_new(void);
+tstatic otrng_bool is_fragment_generic(const string_p msg, const char *prefix);
 
 #endif
 
@@ -0,0 +1,208 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#define OTRNG_HASH_INDEX_PRIVATE
+
+#include "alloc.h"
+#include "hash_index.h"
+
+#ifndef S_SPLINT_S
+#include <gcrypt.h>
+#endif
+
+#define HASH_INDEX_MIN_CAPACITY 16
+
+INTERNAL void otrng_hash_index_init(hash_index_s *index) {
+  memset(index, 0, sizeof(hash_index_s));
+
+  /* The key is only there to prevent the peer from choosing colliding
+   * keys. It does not need to come from the main generator. */
+  gcry_create_nonce(index->hash_key, crypto_shorthash_KEYBYTES);
+}
+
+INTERNAL void otrng_hash_index_destroy(hash_index_s *index) {
+  otrng_free(index->buckets);
+  index->buckets = NULL;
+  index->mask = 0;
+  index->count = 0;
+}
+
+INTERNAL uint64_t
+otrng_keyed_hash(const uint8_t hash_key[crypto_shorthash_KEYBYTES],
+                 uint64_t seed, const void *data, size_t len) {
+  uint8_t key[crypto_shorthash_KEYBYTES];
+  uint8_t out[crypto_shorthash_BYTES];
+  uint64_t hash = 0;
+  size_t i;
+
+  memcpy(key, hash_key, crypto_shorthash_KEYBYTES);
+  for (i = 0; i < sizeof(uint64_t); i++) {
+    key[i] ^= (uint8_t)(seed >> (8 * i));
+  }
+
+  crypto_shorthash(out, data, len, key);
+
+  for (i = 0; i < crypto_shorthash_BYTES; i++) {
+    hash = (hash << 8) | out[i];
+  }
+
+  return hash;
+}
+
+INTERNAL uint64_t otrng_hash_index_hash(const hash_index_s *index,
+                                        uint64_t seed, const void *data,
+                                        size_t len) {
+  return otrng_keyed_hash(index->hash_key, seed, data, len);
+}
+
+static void insert_bucket(hash_index_bucket_s *buckets, size_t mask,
+                          uint64_t hash, void *item) {
+  size_t bucket = hash & mask;
+
+  while (buckets[bucket].item) {
+    bucket = (bucket + 1) & mask;
+  }
+
+  buckets[bucket].hash = hash;
+  buckets[bucket].item = item;
+}
+
+tstatic void hash_index_grow(hash_index_s *index) {
+  size_t old_capacity = index->buckets ? index->mask + 1 : 0;
+  size_t capacity =
+      old_capacity ? old_capacity * 2 : (size_t)HASH_INDEX_MIN_CAPACITY;
+  hash_index_bucket_s *buckets =
+      otrng_xmalloc_z(capacity * sizeof(hash_index_bucket_s));
+  size_t i;
+
+  for (i = 0; i < old_capacity; i++) {
+    if (index->buckets[i].item) {
+      insert_bucket(buckets, capacity - 1, index->buckets[i].hash,
+                    index->buckets[i].item);
+    }
+  }
+
+  otrng_free(index->buckets);
+  index->buckets = buckets;
+  index->mask = capacity - 1;
+}
+
+INTERNAL void otrng_hash_index_add(hash_index_s *index, uint64_t hash,
+                                   void *item) {
+  /* Keep the load under 3/4, so probing stays short */
+  if (!index->buckets || (index->count + 1) * 4 > (index->mask + 1) * 3) {
+    hash_index_grow(index);
+  }
+
+  insert_bucket(index->buckets, index->mask, hash, item);
+  index->count++;
+}
+
+INTERNAL void *
+otrng_hash_index_find_next(const hash_index_s *index, uint64_t hash,
+                           int (*matches)(const void *item, const void *key),
+                           const void *key, size_t *cursor) {
+  size_t bucket;
+
+  if (!index->buckets) {
+    return NULL;
+  }
+
+  bucket = (hash + *cursor) & index->mask;
+  while (index->buckets[bucket].item) {
+    void *item = index->buckets[bucket].item;
+
+    (*cursor)++;
+    if (index->buckets[bucket].hash == hash && matches(item, key)) {
+      return item;
+    }
+
+    bucket = (bucket + 1) & index->mask;
+  }
+
+  return NULL;
+}
+
+INTERNAL void *
+otrng_hash_index_find(const hash_index_s *index, uint64_t hash,
+                      int (*matches)(const void *item, const void *key),
+                      const void *key) {
+  size_t cursor = 0;
+
+  return otrng_hash_index_find_next(index, hash, matches, key, &cursor);
+}
+
+/* Empties the bucket and shifts back the items that probed past it, so no
+ * tombstones are needed */
+static void remove_bucket(hash_index_s *index, size_t bucket) {
+  hash_index_bucket_s *buckets = index->buckets;
+  size_t hole = bucket;
+  size_t next = bucket;
+
+  for (;;) {
+    size_t home;
+
+    next = (next + 1) & index->mask;
+    if (!buckets[next].item) {
+      break;
+    }
+
+    home = buckets[next].hash & index->mask;
+
+    /* The item can move to the hole only if its home bucket is not
+     * cyclically in (hole, next] */
+    if (((next > hole) && (home <= hole || home > next)) ||
+        ((next < hole) && (home <= hole && home > next))) {
+      buckets[hole] = buckets[next];
+      hole = next;
+    }
+  }
+
+  buckets[hole].hash = 0;
+  buckets[hole].item = NULL;
+}
+
+INTERNAL otrng_result otrng_hash_index_remove(hash_index_s *index,
+                                              uint64_t hash, const void *item) {
+  size_t bucket;
+
+  if (!index->buckets) {
+    return OTRNG_ERROR;
+  }
+
+  bucket = hash & index->mask;
+  while (index->buckets[bucket].item) {
+    if (index->buckets[bucket].item == item) {
+      remove_bucket(index, bucket);
+      index->count--;
+      return OTRNG_SUCCESS;
+    }
+
+    bucket = (bucket + 1) & index->mask;
+  }
+
+  return OTRNG_ERROR;
+}
+
+INTERNAL size_t otrng_hash_index_size(const hash_index_s *index) {
+  return index->count;
+}
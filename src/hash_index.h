@@ -0,0 +1,169 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The functions in this file only operate on their arguments, and doesn't touch
+ * any global state. It is safe to call these functions concurrently from
+ * different threads, as long as arguments pointing to the same memory areas are
+ * not used from different threads.
+ */
+
+#ifndef OTRNG_HASH_INDEX_H
+#define OTRNG_HASH_INDEX_H
+
+#include <sodium.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "shared.h"
+
+typedef struct hash_index_bucket_s {
+  uint64_t hash;
+  /*@null@*/ void *item; /* NULL for an empty bucket */
+} hash_index_bucket_s;
+
+/*
+ * An index from keys to items owned by some other collection (usually a
+ * list_s, which keeps the iteration order).
+ *
+ * The index does not know how to compare keys: the caller hashes the key with
+ * otrng_hash_index_hash and gives a function to match an item against a key.
+ * It is an open addressing table (linear probing). The hash is keyed, so the
+ * peer can not choose colliding keys.
+ */
+typedef struct hash_index_s {
+  /*@null@*/ hash_index_bucket_s *buckets;
+  size_t mask;
+  size_t count;
+
+  uint8_t hash_key[crypto_shorthash_KEYBYTES];
+} hash_index_s;
+
+/**
+ * @brief Initializes an empty index.
+ *
+ * @param [index]   The index.
+ */
+INTERNAL void otrng_hash_index_init(hash_index_s *index);
+
+/**
+ * @brief Frees the memory used by the index, but not the items in it.
+ *
+ * @param [index]   The index.
+ */
+INTERNAL void otrng_hash_index_destroy(hash_index_s *index);
+
+/**
+ * @brief Hashes a part of a key with a secret [hash_key]. Keys with several
+ * parts are hashed by giving the hash of the previous parts as the [seed] of
+ * the next one.
+ *
+ * @param [hash_key]  The key of the hash function.
+ * @param [seed]      The hash of the previous parts, or 0.
+ * @param [data]      The data to hash.
+ * @param [len]       The length of the data.
+ */
+INTERNAL uint64_t
+otrng_keyed_hash(const uint8_t hash_key[crypto_shorthash_KEYBYTES],
+                 uint64_t seed, const void *data, size_t len);
+
+/**
+ * @brief Hashes a part of a key. Keys with several parts are hashed by giving
+ * the hash of the previous parts as the [seed] of the next one.
+ *
+ * @param [index]   The index.
+ * @param [seed]    The hash of the previous parts, or 0.
+ * @param [data]    The data to hash.
+ * @param [len]     The length of the data.
+ */
+INTERNAL uint64_t otrng_hash_index_hash(const hash_index_s *index,
+                                        uint64_t seed, const void *data,
+                                        size_t len);
+
+/**
+ * @brief Adds the item to the index. The index allows several items with the
+ * same key.
+ *
+ * @param [index]   The index.
+ * @param [hash]    The hash of the item's key.
+ * @param [item]    The item.
+ */
+INTERNAL void otrng_hash_index_add(hash_index_s *index, uint64_t hash,
+                                   void *item);
+
+/**
+ * @brief Finds an item that matches the key.
+ *
+ * @param [index]   The index.
+ * @param [hash]    The hash of the key.
+ * @param [matches] Returns non-zero if the item matches the key.
+ * @param [key]     The key.
+ *
+ * @return The first item found, or NULL.
+ */
+INTERNAL /*@null@*/ void *
+otrng_hash_index_find(const hash_index_s *index, uint64_t hash,
+                      int (*matches)(const void *item, const void *key),
+                      const void *key);
+
+/**
+ * @brief Finds the next item that matches the key. The [cursor] should be 0
+ * for the first call, and the index should not be modified between calls.
+ *
+ * @param [index]   The index.
+ * @param [hash]    The hash of the key.
+ * @param [matches] Returns non-zero if the item matches the key.
+ * @param [key]     The key.
+ * @param [cursor]  Where the search starts, and where it stopped.
+ *
+ * @return The next item found, or NULL if there are no more.
+ */
+INTERNAL /*@null@*/ void *
+otrng_hash_index_find_next(const hash_index_s *index, uint64_t hash,
+                           int (*matches)(const void *item, const void *key),
+                           const void *key, size_t *cursor);
+
+/**
+ * @brief Removes the item from the index.
+ *
+ * @param [index]   The index.
+ * @param [hash]    The hash of the item's key.
+ * @param [item]    The item.
+ *
+ * @return OTRNG_SUCCESS if the item was in the index, OTRNG_ERROR otherwise.
+ */
+INTERNAL otrng_result otrng_hash_index_remove(hash_index_s *index,
+                                              uint64_t hash, const void *item);
+
+/**
+ * @brief Returns the number of items in the index.
+ *
+ * @param [index]   The index.
+ */
+INTERNAL size_t otrng_hash_index_size(const hash_index_s *index);
+
+#ifdef OTRNG_HASH_INDEX_PRIVATE
+
+tstatic void hash_index_grow(hash_index_s *index);
+
+#endif
+
+#endif
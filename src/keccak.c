@@ -0,0 +1,312 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "alloc.h"
+#include "keccak.h"
+#include "shake.h"
+
+#if !defined(OTRNG_KECCAK_LANES_DISABLED) && defined(__GNUC__) &&             \
+    defined(__x86_64__)
+#define KECCAK_LANES_X86 1
+#endif
+
+static size_t max_lanes = OTRNG_KECCAK_MAX_LANES;
+
+INTERNAL void otrng_keccak_limit_lanes(size_t lanes) {
+  __atomic_store_n(&max_lanes, lanes < 1 ? 1 : lanes, __ATOMIC_RELAXED);
+}
+
+#ifdef KECCAK_LANES_X86
+
+/* The bytes absorbed or squeezed per permutation by SHAKE-256 */
+#define SHAKE_256_RATE 136
+
+static const uint64_t keccak_round_constants[24] = {
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+    0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+    0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+    0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+    0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+    0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+    0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+    0x8000000000008080, 0x0000000080000001, 0x8000000080008008,
+};
+
+static uint64_t load_64_le(const uint8_t *src) {
+  uint64_t word = 0;
+  int i;
+
+  for (i = 7; i >= 0; i--) {
+    word = (word << 8) | src[i];
+  }
+
+  return word;
+}
+
+static void store_64_le(uint8_t *dst, uint64_t word) {
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    dst[i] = (uint8_t)(word >> (8 * i));
+  }
+}
+
+/* Copies [len] bytes of (prefix || src) from [offset] */
+static void copy_input(uint8_t *dst, const uint8_t *prefix, size_t prefix_len,
+                       const uint8_t *src, size_t offset, size_t len) {
+  size_t from_prefix = 0;
+
+  if (offset < prefix_len) {
+    from_prefix = prefix_len - offset;
+    if (from_prefix > len) {
+      from_prefix = len;
+    }
+    memcpy(dst, prefix + offset, from_prefix);
+  }
+
+  if (len > from_prefix) {
+    memcpy(dst + from_prefix, src + offset + from_prefix - prefix_len,
+           len - from_prefix);
+  }
+}
+
+#define ROL_64(v, n) (((v) << (n)) | ((v) >> (64 - (n))))
+
+/*
+ * The Keccak-f[1600] permutation, applied to every lane of a state made of
+ * 25 vectors at once. The rounds are written out so every rotation is by a
+ * constant.
+ */
+#define KECCAK_F1600(A, B, C, D)                                               \
+  do {                                                                         \
+    int round;                                                                 \
+    for (round = 0; round < 24; round++) {                                     \
+      C[0] = A[0] ^ A[5] ^ A[10] ^ A[15] ^ A[20];                              \
+      C[1] = A[1] ^ A[6] ^ A[11] ^ A[16] ^ A[21];                              \
+      C[2] = A[2] ^ A[7] ^ A[12] ^ A[17] ^ A[22];                              \
+      C[3] = A[3] ^ A[8] ^ A[13] ^ A[18] ^ A[23];                              \
+      C[4] = A[4] ^ A[9] ^ A[14] ^ A[19] ^ A[24];                              \
+      D[0] = C[4] ^ ROL_64(C[1], 1);                                           \
+      D[1] = C[0] ^ ROL_64(C[2], 1);                                           \
+      D[2] = C[1] ^ ROL_64(C[3], 1);                                           \
+      D[3] = C[2] ^ ROL_64(C[4], 1);                                           \
+      D[4] = C[3] ^ ROL_64(C[0], 1);                                           \
+      B[0] = A[0] ^ D[0];                                                      \
+      B[10] = ROL_64(A[1] ^ D[1], 1);                                          \
+      B[20] = ROL_64(A[2] ^ D[2], 62);                                         \
+      B[5] = ROL_64(A[3] ^ D[3], 28);                                          \
+      B[15] = ROL_64(A[4] ^ D[4], 27);                                         \
+      B[16] = ROL_64(A[5] ^ D[0], 36);                                         \
+      B[1] = ROL_64(A[6] ^ D[1], 44);                                          \
+      B[11] = ROL_64(A[7] ^ D[2], 6);                                          \
+      B[21] = ROL_64(A[8] ^ D[3], 55);                                         \
+      B[6] = ROL_64(A[9] ^ D[4], 20);                                          \
+      B[7] = ROL_64(A[10] ^ D[0], 3);                                          \
+      B[17] = ROL_64(A[11] ^ D[1], 10);                                        \
+      B[2] = ROL_64(A[12] ^ D[2], 43);                                         \
+      B[12] = ROL_64(A[13] ^ D[3], 25);                                        \
+      B[22] = ROL_64(A[14] ^ D[4], 39);                                        \
+      B[23] = ROL_64(A[15] ^ D[0], 41);                                        \
+      B[8] = ROL_64(A[16] ^ D[1], 45);                                         \
+      B[18] = ROL_64(A[17] ^ D[2], 15);                                        \
+      B[3] = ROL_64(A[18] ^ D[3], 21);                                         \
+      B[13] = ROL_64(A[19] ^ D[4], 8);                                         \
+      B[14] = ROL_64(A[20] ^ D[0], 18);                                        \
+      B[24] = ROL_64(A[21] ^ D[1], 2);                                         \
+      B[9] = ROL_64(A[22] ^ D[2], 61);                                         \
+      B[19] = ROL_64(A[23] ^ D[3], 56);                                        \
+      B[4] = ROL_64(A[24] ^ D[4], 14);                                         \
+      A[0] = B[0] ^ (~B[1] & B[2]);                                            \
+      A[1] = B[1] ^ (~B[2] & B[3]);                                            \
+      A[2] = B[2] ^ (~B[3] & B[4]);                                            \
+      A[3] = B[3] ^ (~B[4] & B[0]);                                            \
+      A[4] = B[4] ^ (~B[0] & B[1]);                                            \
+      A[5] = B[5] ^ (~B[6] & B[7]);                                            \
+      A[6] = B[6] ^ (~B[7] & B[8]);                                            \
+      A[7] = B[7] ^ (~B[8] & B[9]);                                            \
+      A[8] = B[8] ^ (~B[9] & B[5]);                                            \
+      A[9] = B[9] ^ (~B[5] & B[6]);                                            \
+      A[10] = B[10] ^ (~B[11] & B[12]);                                        \
+      A[11] = B[11] ^ (~B[12] & B[13]);                                        \
+      A[12] = B[12] ^ (~B[13] & B[14]);                                        \
+      A[13] = B[13] ^ (~B[14] & B[10]);                                        \
+      A[14] = B[14] ^ (~B[10] & B[11]);                                        \
+      A[15] = B[15] ^ (~B[16] & B[17]);                                        \
+      A[16] = B[16] ^ (~B[17] & B[18]);                                        \
+      A[17] = B[17] ^ (~B[18] & B[19]);                                        \
+      A[18] = B[18] ^ (~B[19] & B[15]);                                        \
+      A[19] = B[19] ^ (~B[15] & B[16]);                                        \
+      A[20] = B[20] ^ (~B[21] & B[22]);                                        \
+      A[21] = B[21] ^ (~B[22] & B[23]);                                        \
+      A[22] = B[22] ^ (~B[23] & B[24]);                                        \
+      A[23] = B[23] ^ (~B[24] & B[20]);                                        \
+      A[24] = B[24] ^ (~B[20] & B[21]);                                        \
+      A[0] ^= keccak_round_constants[round];                                   \
+    }                                                                          \
+  } while (0)
+
+/*
+ * SHAKE-256 on [count] <= [lanes] inputs at once. The state keeps the same
+ * word of every lane in one vector; unused lanes hash zeroes.
+ */
+#define SHAKE_256_LANES(lanes)                                                 \
+  typedef uint64_t vec __attribute__((vector_size(8 * (lanes))));             \
+  vec A[25], B[25], C[5], D[5], word;                                          \
+  uint64_t words[lanes];                                                       \
+  uint8_t block[lanes][SHAKE_256_RATE];                                        \
+  size_t total = prefix_len + src_len, offset = 0, len, lane, w;              \
+                                                                               \
+  memset(A, 0, sizeof(A));                                                     \
+  memset(block, 0, sizeof(block));                                             \
+                                                                               \
+  for (;;) {                                                                   \
+    len = total - offset < SHAKE_256_RATE ? total - offset : SHAKE_256_RATE;   \
+    for (lane = 0; lane < count; lane++) {                                     \
+      copy_input(block[lane], prefix, prefix_len, src[lane], offset, len);    \
+      if (len < SHAKE_256_RATE) {                                              \
+        memset(block[lane] + len, 0, SHAKE_256_RATE - len);                    \
+        block[lane][len] = 0x1f;                                               \
+        block[lane][SHAKE_256_RATE - 1] |= 0x80;                               \
+      }                                                                        \
+    }                                                                          \
+    for (w = 0; w < SHAKE_256_RATE / 8; w++) {                                 \
+      for (lane = 0; lane < (lanes); lane++) {                                 \
+        words[lane] = load_64_le(block[lane] + 8 * w);                         \
+      }                                                                        \
+      memcpy(&word, words, sizeof(word));                                      \
+      A[w] ^= word;                                                            \
+    }                                                                          \
+    KECCAK_F1600(A, B, C, D);                                                  \
+    if (len < SHAKE_256_RATE) {                                                \
+      break;                                                                   \
+    }                                                                          \
+    offset += len;                                                             \
+  }                                                                            \
+                                                                               \
+  for (offset = 0; offset < dst_len; offset += len) {                          \
+    if (offset > 0) {                                                          \
+      KECCAK_F1600(A, B, C, D);                                                \
+    }                                                                          \
+    len = dst_len - offset < SHAKE_256_RATE ? dst_len - offset                 \
+                                            : SHAKE_256_RATE;                  \
+    for (w = 0; w < SHAKE_256_RATE / 8; w++) {                                 \
+      memcpy(words, &A[w], sizeof(words));                                     \
+      for (lane = 0; lane < count; lane++) {                                   \
+        store_64_le(block[lane] + 8 * w, words[lane]);                         \
+      }                                                                        \
+    }                                                                          \
+    for (lane = 0; lane < count; lane++) {                                     \
+      memcpy(dst[lane] + offset, block[lane], len);                            \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  otrng_secure_wipe(A, sizeof(A));                                             \
+  otrng_secure_wipe(B, sizeof(B));                                             \
+  otrng_secure_wipe(C, sizeof(C));                                             \
+  otrng_secure_wipe(D, sizeof(D));                                             \
+  otrng_secure_wipe(&word, sizeof(word));                                      \
+  otrng_secure_wipe(words, sizeof(words));                                     \
+  otrng_secure_wipe(block, sizeof(block))
+
+__attribute__((target("avx2"))) static void
+shake_256_x4(uint8_t *const *dst, size_t dst_len, const uint8_t *prefix,
+             size_t prefix_len, const uint8_t *const *src, size_t src_len,
+             size_t count) {
+  SHAKE_256_LANES(4);
+}
+
+__attribute__((target("avx512f"))) static void
+shake_256_x8(uint8_t *const *dst, size_t dst_len, const uint8_t *prefix,
+             size_t prefix_len, const uint8_t *const *src, size_t src_len,
+             size_t count) {
+  SHAKE_256_LANES(8);
+}
+
+#endif
+
+INTERNAL size_t otrng_keccak_lanes(void) {
+  size_t lanes = 1, limit;
+
+#ifdef KECCAK_LANES_X86
+  if (__builtin_cpu_supports("avx512f")) {
+    lanes = 8;
+  } else if (__builtin_cpu_supports("avx2")) {
+    lanes = 4;
+  }
+#endif
+
+  limit = __atomic_load_n(&max_lanes, __ATOMIC_RELAXED);
+  return lanes < limit ? lanes : limit;
+}
+
+static otrng_result shake_256_one(uint8_t *dst, size_t dst_len,
+                                  const uint8_t *prefix, size_t prefix_len,
+                                  const uint8_t *src, size_t src_len) {
+  goldilocks_shake256_ctx_p hd;
+
+  hash_init(hd);
+  if ((prefix_len > 0 &&
+       hash_update(hd, prefix, prefix_len) == GOLDILOCKS_FAILURE) ||
+      hash_update(hd, src, src_len) == GOLDILOCKS_FAILURE) {
+    hash_destroy(hd);
+    return OTRNG_ERROR;
+  }
+
+  hash_final(hd, dst, dst_len);
+  hash_destroy(hd);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_shake_256_lanes(uint8_t *const *dst, size_t dst_len,
+                                            const uint8_t *prefix,
+                                            size_t prefix_len,
+                                            const uint8_t *const *src,
+                                            size_t src_len, size_t count) {
+  size_t lanes = otrng_keccak_lanes();
+  size_t i, n;
+
+  for (i = 0; i < count; i += n) {
+    n = count - i < lanes ? count - i : lanes;
+
+#ifdef KECCAK_LANES_X86
+    if (lanes == 8 && n > 4) {
+      shake_256_x8(dst + i, dst_len, prefix, prefix_len, src + i, src_len, n);
+      continue;
+    }
+
+    if (lanes >= 4 && n > 1) {
+      n = n < 4 ? n : 4;
+      shake_256_x4(dst + i, dst_len, prefix, prefix_len, src + i, src_len, n);
+      continue;
+    }
+#endif
+
+    n = 1;
+    if (!shake_256_one(dst[i], dst_len, prefix, prefix_len, src[i],
+                       src_len)) {
+      return OTRNG_ERROR;
+    }
+  }
+
+  return OTRNG_SUCCESS;
+}
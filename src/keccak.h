@@ -0,0 +1,72 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SHAKE-256 over several independent inputs at once, one per lane of the
+ * widest SIMD unit the CPU has: 8 lanes with AVX-512, 4 with AVX2. Elsewhere,
+ * or when built with OTRNG_KECCAK_LANES_DISABLED, the inputs are hashed one
+ * after the other with libgoldilocks. The outputs are the same either way.
+ */
+
+#ifndef OTRNG_KECCAK_H
+#define OTRNG_KECCAK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "shared.h"
+
+/* No backend runs more lanes than this at once */
+#define OTRNG_KECCAK_MAX_LANES 8
+
+/**
+ * @brief Returns how many inputs the best backend available hashes at once.
+ */
+INTERNAL size_t otrng_keccak_lanes(void);
+
+/**
+ * @brief Never use more than [lanes] lanes from now on. It exists so tests and
+ * benchmarks can compare the backends, and must not be called while other
+ * threads are hashing.
+ *
+ * @param [lanes]  The maximum number of lanes, 1 to always use libgoldilocks.
+ */
+INTERNAL void otrng_keccak_limit_lanes(size_t lanes);
+
+/**
+ * @brief Computes dst[i] = SHAKE-256(prefix || src[i], dst_len) for every i in
+ * [0, count).
+ *
+ * @param [dst]         The outputs, each of [dst_len] bytes.
+ * @param [dst_len]     The length of every output.
+ * @param [prefix]      What every input starts with.
+ * @param [prefix_len]  The length of [prefix].
+ * @param [src]         The rest of the inputs, each of [src_len] bytes.
+ * @param [src_len]     The length of every [src].
+ * @param [count]       The number of inputs.
+ */
+INTERNAL otrng_result otrng_shake_256_lanes(uint8_t *const *dst, size_t dst_len,
+                                            const uint8_t *prefix,
+                                            size_t prefix_len,
+                                            const uint8_t *const *src,
+                                            size_t src_len, size_t count);
+
+#endif
@@ -25,8 +25,8 @@
 #define OTRNG_KEY_MANAGEMENT_PRIVATE
 
 #include "alloc.h"
+#include "keccak.h"
 #include "key_management.h"
-#include "random.h"
 #include "serialize.h"
 #include "shake.h"
 #include "util.h"
@@ -66,6 +66,8 @@ INTERNAL void otrng_key_manager_init(key_manager_s *manager) {
   manager->our_dh_first = otrng_secure_alloc(sizeof(dh_keypair_s));
   manager->our_dh_first->pub = NULL;
   manager->our_dh_first->priv = NULL;
+
+  manager->skipped_keys = otrng_skipped_keys_new();
 }
 
 INTERNAL key_manager_s *otrng_key_manager_new(void) {
@@ -116,11 +118,13 @@ INTERNAL void otrng_key_manager_destroy(key_manager_s *manager) {
   manager->ssid_half_first = otrng_false;
   otrng_secure_wipe(manager->extra_symmetric_key, EXTRA_SYMMETRIC_KEY_BYTES);
 
-  otrng_list_free(manager->skipped_keys, otrng_secure_free);
+  otrng_skipped_keys_free(manager->skipped_keys);
   manager->skipped_keys = NULL;
 
-  otrng_list_free(manager->old_mac_keys, otrng_secure_free);
-  manager->old_mac_keys = NULL;
+  otrng_list_clear(&manager->old_mac_keys, otrng_secure_free);
+
+  otrng_dh_mpi_release(manager->our_keys_enc.dh);
+  manager->our_keys_enc.dh = NULL;
 
   otrng_secure_wipe(manager, sizeof(key_manager_s));
 }
@@ -161,6 +165,8 @@ otrng_receiving_ratchet_new(key_manager_s *manager) {
          EXTRA_SYMMETRIC_KEY_BYTES);
 
   ratchet->skipped_keys = manager->skipped_keys;
+  ratchet->staged_keys = NULL;
+  ratchet->used_stored_key = otrng_false;
 
   return ratchet;
 }
@@ -197,7 +203,19 @@ INTERNAL void otrng_receiving_ratchet_copy(key_manager_s *dst,
   memcpy(dst->extra_symmetric_key, src->extra_symmetric_key,
          EXTRA_SYMMETRIC_KEY_BYTES);
 
-  dst->skipped_keys = src->skipped_keys;
+  (void)otrng_receiving_ratchet_commit_skipped_keys(dst, src);
+}
+
+INTERNAL otrng_result otrng_receiving_ratchet_commit_skipped_keys(
+    key_manager_s *dst, receiving_ratchet_s *src) {
+  if (src->used_stored_key) {
+    (void)otrng_skipped_keys_remove(dst->skipped_keys, src->used_ecdh,
+                                    src->used_k);
+    src->used_stored_key = otrng_false;
+  }
+
+  return otrng_skipped_keys_move(dst->skipped_keys, src->staged_keys,
+                                 src->max_stored);
 }
 
 INTERNAL void otrng_receiving_ratchet_destroy(receiving_ratchet_s *ratchet) {
@@ -217,9 +235,52 @@ INTERNAL void otrng_receiving_ratchet_destroy(receiving_ratchet_s *ratchet) {
   otrng_secure_wipe(ratchet->chain_r, CHAIN_KEY_BYTES);
   otrng_secure_wipe(ratchet->extra_symmetric_key, EXTRA_SYMMETRIC_KEY_BYTES);
 
+  otrng_skipped_keys_free(ratchet->staged_keys);
+  otrng_ec_point_destroy(ratchet->used_ecdh);
+
   otrng_secure_free(ratchet);
 }
 
+static otrng_bool same_dh_key(const dh_public_key a, const dh_public_key b) {
+  if (!a || !b) {
+    return a == b;
+  }
+
+  return gcry_mpi_cmp(a, b) == 0;
+}
+
+INTERNAL const ratchet_keys_enc_s *
+otrng_key_manager_our_keys_enc(key_manager_s *manager) {
+  ratchet_keys_enc_s *enc = &manager->our_keys_enc;
+  const dh_public_key dh = manager->our_dh->pub;
+
+  /* The same representation of the same point, so the same encoding */
+  if (enc->valid &&
+      memcmp(enc->ecdh, manager->our_ecdh->pub, sizeof(ec_point)) == 0 &&
+      same_dh_key(enc->dh, dh)) {
+    return enc;
+  }
+
+  enc->valid = otrng_false;
+  otrng_dh_mpi_release(enc->dh);
+  enc->dh = NULL;
+
+  if (!otrng_serialize_ec_point(enc->ecdh_enc, manager->our_ecdh->pub)) {
+    return NULL;
+  }
+
+  if (!otrng_serialize_dh_public_key(enc->dh_enc, DH_MPI_MAX_BYTES,
+                                     &enc->dh_enc_len, dh)) {
+    return NULL;
+  }
+
+  otrng_ec_point_copy(enc->ecdh, manager->our_ecdh->pub);
+  enc->dh = otrng_dh_mpi_copy(dh);
+  enc->valid = otrng_true;
+
+  return enc;
+}
+
 INTERNAL void otrng_key_manager_set_their_tmp_keys(
     ec_point their_ecdh, dh_public_key their_dh,
     receiving_ratchet_s *tmp_receiving_ratchet) {
@@ -256,11 +317,6 @@ otrng_key_manager_set_their_first_dh(const dh_public_key their_first_dh,
 INTERNAL otrng_result
 otrng_key_manager_generate_ephemeral_keys(key_manager_s *manager) {
   time_t now;
-  uint8_t *sym = otrng_secure_alloc(ED448_PRIVATE_BYTES);
-  uint8_t *sym_first = otrng_secure_alloc(ED448_PRIVATE_BYTES);
-
-  random_bytes(sym, ED448_PRIVATE_BYTES);
-  random_bytes(sym_first, ED448_PRIVATE_BYTES);
 
   now = time(NULL);
   otrng_ecdh_keypair_destroy(manager->our_ecdh);
@@ -269,18 +325,15 @@ otrng_key_manager_generate_ephemeral_keys(key_manager_s *manager) {
      1. for the first generation: until the ratchet is initialized
      2. when receiving a new dh ratchet
   */
-  if (!otrng_ecdh_keypair_generate(manager->our_ecdh, sym)) {
-    otrng_secure_free(sym);
-    otrng_secure_free(sym_first);
+  if (!otrng_keypair_pool_take_ecdh(manager->our_ecdh,
+                                    manager->keypair_pool)) {
     return OTRNG_ERROR;
   }
-  otrng_secure_free(sym);
 
-  if (!otrng_ecdh_keypair_generate(manager->our_ecdh_first, sym_first)) {
-    otrng_secure_free(sym_first);
+  if (!otrng_keypair_pool_take_ecdh(manager->our_ecdh_first,
+                                    manager->keypair_pool)) {
     return OTRNG_ERROR;
   }
-  otrng_secure_free(sym_first);
 
   manager->last_generated = now;
 
@@ -292,11 +345,12 @@ otrng_key_manager_generate_ephemeral_keys(key_manager_s *manager) {
        1. for the first generation: until the ratchet is initialized
        2. when receiving a new dh ratchet
     */
-    if (!otrng_dh_keypair_generate(manager->our_dh)) {
+    if (!otrng_keypair_pool_take_dh(manager->our_dh, manager->keypair_pool)) {
       return OTRNG_ERROR;
     }
 
-    if (!otrng_dh_keypair_generate(manager->our_dh_first)) {
+    if (!otrng_keypair_pool_take_dh(manager->our_dh_first,
+                                    manager->keypair_pool)) {
       return OTRNG_ERROR;
     }
   }
@@ -898,207 +952,162 @@ static uint8_t usage_message_key = 0x17;
 static uint8_t usage_mac_key = 0x18;
 static uint8_t usage_extra_symm_key = 0x19;
 
-static otrng_result
-derive_next_chain_key(key_manager_s *manager,
-                      receiving_ratchet_s *tmp_receiving_ratchet,
-                      const char action) {
-  /* chain_key_s[i-1][j+1] = KDF_1(usage_next_chain_key || chain_key_s[i-1][j],
-   * 64) */
-  assert(action == 's' || action == 'r');
-  if (action == 's') {
-    if (!shake_256_kdf1(manager->current->chain_s, CHAIN_KEY_BYTES,
-                        usage_next_chain_key, manager->current->chain_s,
-                        CHAIN_KEY_BYTES)) {
-      return OTRNG_ERROR;
-    }
-
-  } else if (action == 'r') {
-    if (!shake_256_kdf1(tmp_receiving_ratchet->chain_r, CHAIN_KEY_BYTES,
-                        usage_next_chain_key, tmp_receiving_ratchet->chain_r,
-                        CHAIN_KEY_BYTES)) {
-      return OTRNG_ERROR;
-    }
-  }
-
-  return OTRNG_SUCCESS;
-}
-
-static otrng_result derive_encryption_and_mac_keys(
-    k_msg_enc enc_key, k_msg_mac mac_key, key_manager_s *manager,
-    receiving_ratchet_s *tmp_receiving_ratchet, const char action) {
-  assert(action == 's' || action == 'r');
+/*
+   Derives, from the chain key chain_key[i-1][j], the keys for one message, and
+   replaces the chain key with the next one:
 
-  /* MKenc, MKmac = derive_enc_mac_keys(chain_key_s[i-1][j])
-     MKenc = KDF_1(usage_message_key || chain_key, 64)
-     MKmac = KDF_1(usage_mac_key || MKenc, 64)
-  */
-  if (action == 's') {
-    if (!shake_256_kdf1(enc_key, ENC_KEY_BYTES, usage_message_key,
-                        manager->current->chain_s, CHAIN_KEY_BYTES)) {
-      return OTRNG_ERROR;
-    }
-  } else if (action == 'r') {
-    if (!shake_256_kdf1(enc_key, ENC_KEY_BYTES, usage_message_key,
-                        tmp_receiving_ratchet->chain_r, CHAIN_KEY_BYTES)) {
-      return OTRNG_ERROR;
-    }
-  }
+   MKenc = KDF_1(usage_message_key || chain_key, 64)
+   extra_symm_key = KDF_1(usage_extra_symm_key || 0xFF || chain_key, 64)
+   chain_key[i-1][j+1] = KDF_1(usage_next_chain_key || chain_key, 64)
+*/
+tstatic otrng_result derive_message_keys(
+    k_msg_enc enc_key, uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES],
+    uint8_t chain_key[CHAIN_KEY_BYTES]) {
+  goldilocks_shake256_ctx_p hd;
+  uint8_t magic[1] = {0xFF};
 
-  if (!shake_256_kdf1(mac_key, MAC_KEY_BYTES, usage_mac_key, enc_key,
-                      ENC_KEY_BYTES)) {
+  if (!shake_256_kdf1(enc_key, ENC_KEY_BYTES, usage_message_key, chain_key,
+                      CHAIN_KEY_BYTES)) {
     return OTRNG_ERROR;
   }
 
-  return OTRNG_SUCCESS;
-}
-
-tstatic otrng_result calculate_extra_key(
-    key_manager_s *manager, receiving_ratchet_s *tmp_receiving_ratchet,
-    const char action) {
-  goldilocks_shake256_ctx_p hd;
-  uint8_t *extra_key_buffer = otrng_secure_alloc(EXTRA_SYMMETRIC_KEY_BYTES);
-  uint8_t magic[1] = {0xFF};
-
   if (!hash_init_with_usage(hd, usage_extra_symm_key)) {
-    otrng_secure_free(extra_key_buffer);
     return OTRNG_ERROR;
   }
 
-  if (hash_update(hd, magic, 1) == GOLDILOCKS_FAILURE) {
+  if (hash_update(hd, magic, 1) == GOLDILOCKS_FAILURE ||
+      hash_update(hd, chain_key, CHAIN_KEY_BYTES) == GOLDILOCKS_FAILURE) {
     hash_destroy(hd);
-    otrng_secure_free(extra_key_buffer);
     return OTRNG_ERROR;
   }
 
-  /* extra_symm_key = KDF_1(usage_extra_symm_key || 0xFF || chain_key_s[i-1][j],
-   * 64) */
-  assert(action == 's' || action == 'r');
-  if (action == 's') {
-    if (hash_update(hd, manager->current->chain_s, CHAIN_KEY_BYTES) ==
-        GOLDILOCKS_FAILURE) {
-      hash_destroy(hd);
-      otrng_secure_free(extra_key_buffer);
-      return OTRNG_ERROR;
-    }
+  hash_final(hd, extra_key, EXTRA_SYMMETRIC_KEY_BYTES);
+  hash_destroy(hd);
 
-    hash_final(hd, extra_key_buffer, EXTRA_SYMMETRIC_KEY_BYTES);
-    hash_destroy(hd);
+  /* @secret the previous chain key is overwritten here */
+  if (!shake_256_kdf1(chain_key, CHAIN_KEY_BYTES, usage_next_chain_key,
+                      chain_key, CHAIN_KEY_BYTES)) {
+    return OTRNG_ERROR;
+  }
 
-    memcpy(manager->extra_symmetric_key, extra_key_buffer,
-           EXTRA_SYMMETRIC_KEY_BYTES);
-  } else if (action == 'r') {
-    if (hash_update(hd, tmp_receiving_ratchet->chain_r, CHAIN_KEY_BYTES) ==
-        GOLDILOCKS_FAILURE) {
-      hash_destroy(hd);
-      otrng_secure_wipe(extra_key_buffer, EXTRA_SYMMETRIC_KEY_BYTES);
-      otrng_free(extra_key_buffer);
+  return OTRNG_SUCCESS;
+}
+
+/* The keys for a run of skipped messages, derived together */
+typedef struct skipped_batch_s {
+  uint8_t chain_keys[OTRNG_KECCAK_MAX_LANES][CHAIN_KEY_BYTES];
+  uint8_t enc_keys[OTRNG_KECCAK_MAX_LANES][ENC_KEY_BYTES];
+  uint8_t extra_keys[OTRNG_KECCAK_MAX_LANES][EXTRA_SYMMETRIC_KEY_BYTES];
+} skipped_batch_s;
+
+/*
+   Derives the keys for the next [count] messages of a chain, the same ones
+   derive_message_keys would. Every chain key depends on the one before it, so
+   they are derived one after the other, but the message and extra keys of all
+   of them are then derived at once, in the lanes of a SIMD Keccak.
+*/
+static otrng_result derive_skipped_keys(skipped_batch_s *batch, size_t count,
+                                        uint8_t chain_key[CHAIN_KEY_BYTES]) {
+  const uint8_t *chain_keys[OTRNG_KECCAK_MAX_LANES];
+  uint8_t *enc_keys[OTRNG_KECCAK_MAX_LANES];
+  uint8_t *extra_keys[OTRNG_KECCAK_MAX_LANES];
+  uint8_t magic[1] = {0xFF};
+  size_t i;
+
+  assert(count <= OTRNG_KECCAK_MAX_LANES);
+
+  for (i = 0; i < count; i++) {
+    memcpy(batch->chain_keys[i], chain_key, CHAIN_KEY_BYTES);
+    if (!shake_256_kdf1(chain_key, CHAIN_KEY_BYTES, usage_next_chain_key,
+                        chain_key, CHAIN_KEY_BYTES)) {
       return OTRNG_ERROR;
     }
 
-    hash_final(hd, extra_key_buffer, EXTRA_SYMMETRIC_KEY_BYTES);
-    hash_destroy(hd);
+    chain_keys[i] = batch->chain_keys[i];
+    enc_keys[i] = batch->enc_keys[i];
+    extra_keys[i] = batch->extra_keys[i];
+  }
 
-    memcpy(tmp_receiving_ratchet->extra_symmetric_key, extra_key_buffer,
-           EXTRA_SYMMETRIC_KEY_BYTES);
+  if (!shake_256_kdf1_lanes(enc_keys, ENC_KEY_BYTES, usage_message_key, NULL,
+                            0, chain_keys, CHAIN_KEY_BYTES, count)) {
+    return OTRNG_ERROR;
   }
-  otrng_secure_free(extra_key_buffer);
 
-// TODO: add to tmp
-#ifdef DEBUG
-  debug_print("\n");
-  debug_print("EXTRA KEY = ");
-  otrng_memdump(manager->extra_symmetric_key, EXTRA_SYMMETRIC_KEY_BYTES);
-#endif
+  if (!shake_256_kdf1_lanes(extra_keys, EXTRA_SYMMETRIC_KEY_BYTES,
+                            usage_extra_symm_key, magic, sizeof(magic),
+                            chain_keys, CHAIN_KEY_BYTES, count)) {
+    return OTRNG_ERROR;
+  }
 
   return OTRNG_SUCCESS;
 }
 
-tstatic otrng_result store_enc_keys(
-    k_msg_enc enc_key, receiving_ratchet_s *tmp_receiving_ratchet,
-    const uint32_t until, const unsigned int max_skip, const char ratchet_type,
-    const otrng_client_callbacks_s *cb, key_manager_s *manager) {
-  goldilocks_shake256_ctx_p hd;
-  uint8_t *extra_key = otrng_secure_alloc(EXTRA_SYMMETRIC_KEY_BYTES);
-  uint8_t magic[1] = {0xFF};
-  skipped_keys_s *skipped_msg_enc_key;
+tstatic otrng_result store_enc_keys(receiving_ratchet_s *tmp_receiving_ratchet,
+                                    const uint32_t until,
+                                    const unsigned int max_skip,
+                                    const char ratchet_type,
+                                    const otrng_client_callbacks_s *cb,
+                                    key_manager_s *manager) {
+  skipped_batch_s *batch;
+  size_t count, i;
+  otrng_result result = OTRNG_SUCCESS;
 
   if ((tmp_receiving_ratchet->k + max_skip) < until) {
     otrng_client_callbacks_handle_event(cb,
                                         OTRNG_MSG_EVENT_MSG_KEYS_STORAGE_FULL);
 
-    otrng_secure_free(extra_key);
     return OTRNG_SUCCESS;
   }
 
-  if (!otrng_bool_is_true(otrng_is_empty_array(tmp_receiving_ratchet->chain_r,
-                                               CHAIN_KEY_BYTES))) {
-    while (tmp_receiving_ratchet->k < until) {
-      if (!shake_256_kdf1(enc_key, ENC_KEY_BYTES, usage_message_key,
-                          tmp_receiving_ratchet->chain_r, CHAIN_KEY_BYTES)) {
-        otrng_secure_free(extra_key);
-        return OTRNG_ERROR;
-      }
-
-      if (!hash_init_with_usage(hd, usage_extra_symm_key)) {
-        otrng_secure_free(extra_key);
-        return OTRNG_ERROR;
-      }
-
-      if (hash_update(hd, magic, 1) == GOLDILOCKS_FAILURE) {
-        hash_destroy(hd);
-        otrng_secure_free(extra_key);
-        return OTRNG_ERROR;
-      }
-
-      if (hash_update(hd, tmp_receiving_ratchet->chain_r, CHAIN_KEY_BYTES) ==
-          GOLDILOCKS_FAILURE) {
-        hash_destroy(hd);
-        otrng_secure_free(extra_key);
-        return OTRNG_ERROR;
-      }
-
-      hash_final(hd, extra_key, EXTRA_SYMMETRIC_KEY_BYTES);
-      hash_destroy(hd);
-
-      if (!shake_256_kdf1(tmp_receiving_ratchet->chain_r, CHAIN_KEY_BYTES,
-                          usage_next_chain_key, tmp_receiving_ratchet->chain_r,
-                          CHAIN_KEY_BYTES)) {
-        otrng_secure_free(extra_key);
-        return OTRNG_ERROR;
-      }
+  if (otrng_bool_is_true(otrng_is_empty_array(tmp_receiving_ratchet->chain_r,
+                                              CHAIN_KEY_BYTES))) {
+    return OTRNG_SUCCESS;
+  }
 
-      skipped_msg_enc_key = otrng_secure_alloc(sizeof(skipped_keys_s));
+  assert(ratchet_type == 'd' || ratchet_type == 'c');
 
-      assert(ratchet_type == 'd' || ratchet_type == 'c');
+  if (!tmp_receiving_ratchet->staged_keys) {
+    tmp_receiving_ratchet->staged_keys = otrng_skipped_keys_new();
+  }
+  tmp_receiving_ratchet->max_stored = max_skip;
 
-      if (ratchet_type == 'd') {
-        otrng_ec_point_copy(skipped_msg_enc_key->their_ecdh,
-                            manager->their_ecdh);
-      } else if (ratchet_type == 'c') {
-        otrng_ec_point_copy(skipped_msg_enc_key->their_ecdh,
-                            tmp_receiving_ratchet->their_ecdh);
-      }
+  batch = otrng_secure_alloc(sizeof(skipped_batch_s));
 
-      skipped_msg_enc_key->k = tmp_receiving_ratchet->k;
+  while (result == OTRNG_SUCCESS && tmp_receiving_ratchet->k < until) {
+    count = until - tmp_receiving_ratchet->k;
+    if (count > OTRNG_KECCAK_MAX_LANES) {
+      count = OTRNG_KECCAK_MAX_LANES;
+    }
 
-      memcpy(skipped_msg_enc_key->extra_symmetric_key, extra_key,
-             EXTRA_SYMMETRIC_KEY_BYTES);
-      memcpy(skipped_msg_enc_key->enc_key, enc_key, ENC_KEY_BYTES);
+    if (!derive_skipped_keys(batch, count, tmp_receiving_ratchet->chain_r)) {
+      result = OTRNG_ERROR;
+      break;
+    }
 
+    for (i = 0; i < count; i++) {
       /*
          @secret: should be deleted when:
          1. session expired
          2. the key is retrieved
+         3. it is the oldest one and the storage is full
       */
-      tmp_receiving_ratchet->skipped_keys = otrng_list_add(
-          skipped_msg_enc_key, tmp_receiving_ratchet->skipped_keys);
-      otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
+      if (!otrng_skipped_keys_add(tmp_receiving_ratchet->staged_keys,
+                                  ratchet_type == 'd'
+                                      ? manager->their_ecdh
+                                      : tmp_receiving_ratchet->their_ecdh,
+                                  tmp_receiving_ratchet->k,
+                                  batch->enc_keys[i], batch->extra_keys[i],
+                                  max_skip)) {
+        result = OTRNG_ERROR;
+        break;
+      }
       tmp_receiving_ratchet->k++;
     }
   }
-  otrng_secure_free(extra_key);
 
-  return OTRNG_SUCCESS;
+  otrng_secure_free(batch);
+
+  return result;
 }
 
 /*
@@ -1109,65 +1118,60 @@ INTERNAL otrng_result otrng_key_get_skipped_keys(
     k_msg_enc enc_key, k_msg_mac mac_key, ec_point msg_ecdh,
     unsigned int msg_id, key_manager_s *manager,
     receiving_ratchet_s *tmp_receiving_ratchet) {
-  list_element_s *current = tmp_receiving_ratchet->skipped_keys;
   (void)manager;
 
-  while (current) {
-    skipped_keys_s *skipped_keys = current->data;
-
-    if ((goldilocks_448_point_eq(msg_ecdh, skipped_keys->their_ecdh) ==
-         GOLDILOCKS_TRUE) &&
-        skipped_keys->k == msg_id) {
-      memcpy(enc_key, skipped_keys->enc_key, ENC_KEY_BYTES);
-      if (!shake_256_kdf1(mac_key, MAC_KEY_BYTES, usage_mac_key, enc_key,
-                          ENC_KEY_BYTES)) {
-        return OTRNG_ERROR;
-      }
-
-      memcpy(tmp_receiving_ratchet->extra_symmetric_key,
-             skipped_keys->extra_symmetric_key, EXTRA_SYMMETRIC_KEY_BYTES);
-
-      tmp_receiving_ratchet->skipped_keys = otrng_list_remove_element(
-          current, tmp_receiving_ratchet->skipped_keys);
-      otrng_list_free(current, otrng_secure_free);
+  if (!otrng_skipped_keys_get(enc_key,
+                              tmp_receiving_ratchet->extra_symmetric_key,
+                              tmp_receiving_ratchet->skipped_keys, msg_ecdh,
+                              msg_id)) {
+    /* This is not an actual error, it is just that the key we need was not
+    skipped */
+    return OTRNG_ERROR;
+  }
 
-      return OTRNG_SUCCESS;
-    }
+  /* removed from the store once the message is verified */
+  otrng_ec_point_copy(tmp_receiving_ratchet->used_ecdh, msg_ecdh);
+  tmp_receiving_ratchet->used_k = msg_id;
+  tmp_receiving_ratchet->used_stored_key = otrng_true;
 
-    current = current->next;
+  if (!shake_256_kdf1(mac_key, MAC_KEY_BYTES, usage_mac_key, enc_key,
+                      ENC_KEY_BYTES)) {
+    return OTRNG_ERROR;
   }
 
-  /* This is not an actual error, it is just that the key we need was not
-  skipped */
-  return OTRNG_ERROR;
+  return OTRNG_SUCCESS;
 }
 
 INTERNAL otrng_result otrng_key_manager_derive_chain_keys(
     k_msg_enc enc_key, k_msg_mac mac_key, key_manager_s *manager,
     receiving_ratchet_s *tmp_receiving_ratchet, unsigned int max_skip,
     uint32_t msg_id, const char action, const otrng_client_callbacks_s *cb) {
+  uint8_t *chain_key;
+  uint8_t *extra_key;
 
   assert(action == 's' || action == 'r');
   if (action == 'r') {
-    if (!store_enc_keys(enc_key, tmp_receiving_ratchet, msg_id, max_skip, 'c',
-                        cb, manager)) {
+    if (!store_enc_keys(tmp_receiving_ratchet, msg_id, max_skip, 'c', cb,
+                        manager)) {
       return OTRNG_ERROR;
     }
-  }
 
-  /* @secret should be deleted after being used to encrypt and mac the message
-   */
-  if (!derive_encryption_and_mac_keys(enc_key, mac_key, manager,
-                                      tmp_receiving_ratchet, action)) {
-    return OTRNG_ERROR;
+    chain_key = tmp_receiving_ratchet->chain_r;
+    extra_key = tmp_receiving_ratchet->extra_symmetric_key;
+  } else {
+    chain_key = manager->current->chain_s;
+    extra_key = manager->extra_symmetric_key;
   }
 
-  if (!calculate_extra_key(manager, tmp_receiving_ratchet, action)) {
+  /* @secret enc_key should be deleted after being used to encrypt and mac the
+   * message, the chain key is deleted when the next one is derived */
+  if (!derive_message_keys(enc_key, extra_key, chain_key)) {
     return OTRNG_ERROR;
   }
 
-  /* @secret should be deleted when the new chain key is derived */
-  if (!derive_next_chain_key(manager, tmp_receiving_ratchet, action)) {
+  /* MKmac = KDF_1(usage_mac_key || MKenc, 64) */
+  if (!shake_256_kdf1(mac_key, MAC_KEY_BYTES, usage_mac_key, enc_key,
+                      ENC_KEY_BYTES)) {
     return OTRNG_ERROR;
   }
 
@@ -1189,8 +1193,6 @@ INTERNAL otrng_result otrng_key_manager_derive_dh_ratchet_keys(
     uint32_t previous_n, const char action,
     const otrng_client_callbacks_s *cb) {
   /* Derive new ECDH and DH keys */
-  k_msg_enc enc_key;
-
   assert(action == 's' || action == 'r');
 
   if (action == 's') {
@@ -1203,8 +1205,8 @@ INTERNAL otrng_result otrng_key_manager_derive_dh_ratchet_keys(
     if (goldilocks_448_point_eq(msg_ecdh, manager->their_ecdh) ==
         GOLDILOCKS_FALSE) {
       /* Store any message keys from the previous DH Ratchet */
-      if (!store_enc_keys(enc_key, tmp_receiving_ratchet, previous_n, max_skip,
-                          'd', cb, manager)) {
+      if (!store_enc_keys(tmp_receiving_ratchet, previous_n, max_skip, 'd',
+                          cb, manager)) {
         return OTRNG_ERROR;
       }
       return rotate_keys(manager, tmp_receiving_ratchet, action);
@@ -1219,14 +1221,14 @@ INTERNAL otrng_result otrng_store_old_mac_keys(key_manager_s *manager,
   uint8_t *to_store_mac = otrng_secure_alloc(MAC_KEY_BYTES);
 
   memcpy(to_store_mac, mac_key, ENC_KEY_BYTES);
-  manager->old_mac_keys = otrng_list_add(to_store_mac, manager->old_mac_keys);
+  otrng_list_prepend(&manager->old_mac_keys, to_store_mac);
 
   return OTRNG_SUCCESS;
 }
 
 INTERNAL /*@null@*/ uint8_t *
 otrng_reveal_mac_keys_on_tlv(key_manager_s *manager) {
-  size_t num_stored_keys = otrng_list_len(manager->skipped_keys);
+  size_t num_stored_keys = otrng_skipped_keys_size(manager->skipped_keys);
   size_t serlen = num_stored_keys * MAC_KEY_BYTES;
   uint8_t *ser_mac_keys;
   k_msg_mac mac_key;
@@ -1240,22 +1242,22 @@ otrng_reveal_mac_keys_on_tlv(key_manager_s *manager) {
     memset(mac_key, 0, MAC_KEY_BYTES);
 
     for (i = 0; i < num_stored_keys; i++) {
-      list_element_s *last = otrng_list_get_last(manager->skipped_keys);
-      skipped_keys_s *skipped_keys = last->data;
-      memcpy(enc_key, skipped_keys->enc_key, ENC_KEY_BYTES);
+      if (!otrng_skipped_keys_pop_oldest(enc_key, manager->skipped_keys)) {
+        otrng_secure_free(ser_mac_keys);
+        return NULL;
+      }
 
       if (!shake_256_kdf1(mac_key, MAC_KEY_BYTES, usage_mac_key, enc_key,
                           ENC_KEY_BYTES)) {
+        otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
         otrng_secure_free(ser_mac_keys);
         return NULL;
       }
 
       memcpy(ser_mac_keys + i * MAC_KEY_BYTES, mac_key, MAC_KEY_BYTES);
-      manager->skipped_keys =
-          otrng_list_remove_element(last, manager->skipped_keys);
-      otrng_list_free(last, otrng_secure_free);
     }
-    otrng_list_free_nodes(manager->skipped_keys);
+    otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
+    otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
 
     return ser_mac_keys;
   }
@@ -32,9 +32,11 @@
 #include "constants.h"
 #include "dh.h"
 #include "ed448.h"
+#include "keypair_pool.h"
 #include "keys.h"
 #include "list.h"
 #include "shared.h"
+#include "skipped_keys.h"
 
 /* the different kind of keys for the key management */
 typedef uint8_t k_brace[BRACE_KEY_BYTES];
@@ -55,14 +57,6 @@ typedef struct ratchet_s {
   k_receiving_chain chain_r;
 } ratchet_s;
 
-/* the list of stored message and extra symmetric keys */
-typedef struct skipped_keys_s {
-  ec_point their_ecdh; /* Current their_ecdh key */
-  uint32_t k;          /* Counter of the receiving messages */
-  k_extra_symmetric extra_symmetric_key;
-  k_msg_enc enc_key;
-} skipped_keys_s;
-
 /* a temporary structure used to hold the values of the receiving ratchet */
 typedef struct receiving_ratchet_s {
   ec_scalar our_ecdh_priv;
@@ -83,9 +77,28 @@ typedef struct receiving_ratchet_s {
 
   k_extra_symmetric extra_symmetric_key;
 
-  list_element_s *skipped_keys;
+  /* The stored keys are only looked up: a message can be forged until its MAC
+     is verified, so what it changes in the store is staged here, and applied
+     by otrng_receiving_ratchet_commit_skipped_keys. */
+  skipped_keys_store_s *skipped_keys;
+  /*@null@*/ skipped_keys_store_s *staged_keys; /* the keys it skipped */
+  unsigned int max_stored;
+  otrng_bool used_stored_key;
+  ec_point used_ecdh; /* the stored keys it used, if any */
+  uint32_t used_k;
 } receiving_ratchet_s;
 
+/* The wire encoding of a pair of ratchet public keys, which only change once
+   per ratchet, together with the keys it was made from or decoded into. */
+typedef struct ratchet_keys_enc_s {
+  ec_point ecdh;
+  /*@null@*/ dh_public_key dh;
+  uint8_t ecdh_enc[ED448_POINT_BYTES];
+  uint8_t dh_enc[DH_MPI_MAX_BYTES];
+  size_t dh_enc_len; /* 0 when nothing is encoded */
+  otrng_bool valid;
+} ratchet_keys_enc_s;
+
 /* represents the different values needed for key management */
 typedef struct key_manager_s {
   /* AKE context */
@@ -123,10 +136,19 @@ typedef struct key_manager_s {
   k_extra_symmetric extra_symmetric_key;
   uint8_t tmp_key[HASH_BYTES];
 
-  list_element_s *skipped_keys;
-  list_element_s *old_mac_keys;
+  skipped_keys_store_s *skipped_keys;
+  list_s old_mac_keys; /* newest first */
 
   time_t last_generated;
+
+  /* Where ephemeral keypairs are taken from. Not owned by the key manager. */
+  /*@null@*/ otrng_keypair_pool_s *keypair_pool;
+
+  /* Our current public keys, as put in the data messages we send */
+  ratchet_keys_enc_s our_keys_enc;
+  /* The public keys of the last data message we accepted, already validated.
+     Its dh is not kept, only its encoding. */
+  ratchet_keys_enc_s their_keys_enc;
 } key_manager_s;
 
 /*
@@ -185,6 +207,17 @@ otrng_receiving_ratchet_new(key_manager_s *manager);
 INTERNAL void otrng_receiving_ratchet_copy(key_manager_s *dst,
                                            receiving_ratchet_s *src);
 
+/**
+ * @brief Applies to the store of skipped keys of the key manager what the
+ * message changed: the stored keys it used are removed, and the keys of the
+ * messages it skipped are added. It is done by otrng_receiving_ratchet_copy.
+ *
+ * @param [dst]   The key manager.
+ * @param [src]   The receiving ratchet.
+ */
+INTERNAL otrng_result otrng_receiving_ratchet_commit_skipped_keys(
+    key_manager_s *dst, receiving_ratchet_s *src);
+
 /**
  * @brief Destroy a temporary receiving ratchet to be used to prevent a ratchet
  * corruption.
@@ -193,6 +226,17 @@ INTERNAL void otrng_receiving_ratchet_copy(key_manager_s *dst,
  */
 INTERNAL void otrng_receiving_ratchet_destroy(receiving_ratchet_s *ratchet);
 
+/**
+ * @brief Returns the encoding of our current ECDH and DH public keys, as sent
+ * in data messages. It is only computed again when the keys have changed.
+ *
+ * @param [manager]   The key manager.
+ *
+ * @return The encoded keys, or NULL if they can't be encoded.
+ */
+INTERNAL /*@null@*/ const ratchet_keys_enc_s *
+otrng_key_manager_our_keys_enc(key_manager_s *manager);
+
 /**
  * @brief Securely replace their ecdh and their dh keys.
  *
@@ -311,7 +355,8 @@ INTERNAL otrng_result otrng_key_manager_ratcheting_init(key_manager_s *manager,
                                                         const char participant);
 
 /**
- * @brief Get the correct message keys.
+ * @brief Get the correct message keys. They stay in the store until the
+ * ratchet is committed.
  *
  * @param [enc_key]     The encryption key.
  * @param [mac_key]     The mac key.
@@ -393,14 +438,16 @@ tstatic otrng_result key_manager_derive_ratchet_keys(
 tstatic otrng_result calculate_ssid(key_manager_s *manager);
 
 /**
- * @brief Calculate the extra symmetric key.
+ * @brief Derives the message key and the extra symmetric key from a chain key,
+ * and replaces the chain key with the next one.
  *
- * @param [manager]   The key manager.
- * @param [action]    's' for sending chain, 'r' for receiving
+ * @param [enc_key]     The message encryption key.
+ * @param [extra_key]   The extra symmetric key.
+ * @param [chain_key]   The chain key.
  */
-tstatic otrng_result calculate_extra_key(
-    key_manager_s *manager, receiving_ratchet_s *tmp_receiving_ratchet,
-    const char action);
+tstatic otrng_result derive_message_keys(
+    k_msg_enc enc_key, uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES],
+    uint8_t chain_key[CHAIN_KEY_BYTES]);
 
 #endif
 
@@ -0,0 +1,234 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#define OTRNG_KEYPAIR_POOL_PRIVATE
+
+#include "alloc.h"
+#include "keypair_pool.h"
+#include "random.h"
+
+INTERNAL void otrng_keypair_pool_init(otrng_keypair_pool_s *pool,
+                                      size_t ecdh_size, size_t dh_size) {
+  memset(pool, 0, sizeof(otrng_keypair_pool_s));
+  (void)pthread_mutex_init(&pool->lock, NULL);
+  otrng_keypair_pool_resize(pool, ecdh_size, dh_size);
+}
+
+INTERNAL void otrng_keypair_pool_destroy(otrng_keypair_pool_s *pool) {
+  otrng_keypair_pool_resize(pool, 0, 0);
+  (void)pthread_mutex_destroy(&pool->lock);
+}
+
+INTERNAL void otrng_keypair_pool_resize(otrng_keypair_pool_s *pool,
+                                        size_t ecdh_size, size_t dh_size) {
+  ecdh_keypair_s *ecdh = NULL;
+  dh_keypair_s *dh = NULL;
+
+  (void)pthread_mutex_lock(&pool->lock);
+
+  while (pool->ecdh_len > ecdh_size) {
+    otrng_ecdh_keypair_destroy(&pool->ecdh[--pool->ecdh_len]);
+  }
+
+  while (pool->dh_len > dh_size) {
+    otrng_dh_keypair_destroy(&pool->dh[--pool->dh_len]);
+  }
+
+  if (ecdh_size > 0) {
+    ecdh = otrng_secure_alloc_array(ecdh_size, sizeof(ecdh_keypair_s));
+    if (pool->ecdh_len > 0) {
+      memcpy(ecdh, pool->ecdh, pool->ecdh_len * sizeof(ecdh_keypair_s));
+    }
+  }
+
+  if (dh_size > 0) {
+    dh = otrng_secure_alloc_array(dh_size, sizeof(dh_keypair_s));
+    if (pool->dh_len > 0) {
+      memcpy(dh, pool->dh, pool->dh_len * sizeof(dh_keypair_s));
+    }
+  }
+
+  /* secure memory is wiped when it is freed */
+  if (pool->ecdh) {
+    otrng_secure_free(pool->ecdh);
+  }
+
+  if (pool->dh) {
+    otrng_secure_free(pool->dh);
+  }
+
+  pool->ecdh = ecdh;
+  pool->ecdh_size = ecdh_size;
+  pool->dh = dh;
+  pool->dh_size = dh_size;
+
+  (void)pthread_mutex_unlock(&pool->lock);
+}
+
+tstatic otrng_result keypair_pool_generate_ecdh(ecdh_keypair_s *dst) {
+  uint8_t *sym = otrng_secure_alloc(ED448_PRIVATE_BYTES);
+  otrng_result result;
+
+  random_bytes(sym, ED448_PRIVATE_BYTES);
+  result = otrng_ecdh_keypair_generate(dst, sym);
+  otrng_secure_free(sym);
+
+  return result;
+}
+
+/* Adds the keypair if there is still room for it, as another thread may have
+ * filled the pool while it was generated */
+static otrng_bool keypair_pool_put_dh(otrng_keypair_pool_s *pool,
+                                      dh_keypair_s *keypair) {
+  otrng_bool stored = otrng_false;
+
+  (void)pthread_mutex_lock(&pool->lock);
+  if (pool->dh_len < pool->dh_size) {
+    pool->dh[pool->dh_len].pub = keypair->pub;
+    pool->dh[pool->dh_len].priv = keypair->priv;
+    pool->dh_len++;
+    stored = otrng_true;
+  }
+  (void)pthread_mutex_unlock(&pool->lock);
+
+  return stored;
+}
+
+static otrng_bool keypair_pool_put_ecdh(otrng_keypair_pool_s *pool,
+                                        const ecdh_keypair_s *keypair) {
+  otrng_bool stored = otrng_false;
+
+  (void)pthread_mutex_lock(&pool->lock);
+  if (pool->ecdh_len < pool->ecdh_size) {
+    memcpy(&pool->ecdh[pool->ecdh_len], keypair, sizeof(ecdh_keypair_s));
+    pool->ecdh_len++;
+    stored = otrng_true;
+  }
+  (void)pthread_mutex_unlock(&pool->lock);
+
+  return stored;
+}
+
+INTERNAL size_t otrng_keypair_pool_refill(otrng_keypair_pool_s *pool,
+                                          size_t max_keypairs) {
+  size_t generated = 0;
+  otrng_bool wants_dh, wants_ecdh;
+  dh_keypair_s dh;
+  ecdh_keypair_s *ecdh;
+
+  while (max_keypairs == 0 || generated < max_keypairs) {
+    (void)pthread_mutex_lock(&pool->lock);
+    wants_dh = pool->dh_len < pool->dh_size;
+    wants_ecdh = pool->ecdh_len < pool->ecdh_size;
+    (void)pthread_mutex_unlock(&pool->lock);
+
+    if (wants_dh) {
+      if (!otrng_dh_keypair_generate(&dh)) {
+        return generated;
+      }
+
+      if (!keypair_pool_put_dh(pool, &dh)) {
+        otrng_dh_keypair_destroy(&dh);
+      }
+    } else if (wants_ecdh) {
+      ecdh = otrng_secure_alloc(sizeof(ecdh_keypair_s));
+      if (!keypair_pool_generate_ecdh(ecdh)) {
+        otrng_secure_free(ecdh);
+        return generated;
+      }
+
+      if (!keypair_pool_put_ecdh(pool, ecdh)) {
+        otrng_ecdh_keypair_destroy(ecdh);
+      }
+      otrng_secure_free(ecdh);
+    } else {
+      break;
+    }
+
+    generated++;
+  }
+
+  return generated;
+}
+
+INTERNAL otrng_result otrng_keypair_pool_take_ecdh(
+    ecdh_keypair_s *dst, /*@null@*/ otrng_keypair_pool_s *pool) {
+  ecdh_keypair_s *src;
+
+  if (!pool) {
+    return keypair_pool_generate_ecdh(dst);
+  }
+
+  (void)pthread_mutex_lock(&pool->lock);
+  if (pool->ecdh_len == 0) {
+    pool->stats.ecdh_misses++;
+    (void)pthread_mutex_unlock(&pool->lock);
+    return keypair_pool_generate_ecdh(dst);
+  }
+
+  pool->stats.ecdh_hits++;
+  src = &pool->ecdh[--pool->ecdh_len];
+  memcpy(dst, src, sizeof(ecdh_keypair_s));
+  otrng_secure_wipe(src, sizeof(ecdh_keypair_s));
+  (void)pthread_mutex_unlock(&pool->lock);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_keypair_pool_take_dh(
+    dh_keypair_s *dst, /*@null@*/ otrng_keypair_pool_s *pool) {
+  dh_keypair_s *src;
+
+  if (!pool) {
+    return otrng_dh_keypair_generate(dst);
+  }
+
+  (void)pthread_mutex_lock(&pool->lock);
+  if (pool->dh_len == 0) {
+    pool->stats.dh_misses++;
+    (void)pthread_mutex_unlock(&pool->lock);
+    return otrng_dh_keypair_generate(dst);
+  }
+
+  pool->stats.dh_hits++;
+  src = &pool->dh[--pool->dh_len];
+  dst->pub = src->pub;
+  dst->priv = src->priv;
+  src->pub = NULL;
+  src->priv = NULL;
+  (void)pthread_mutex_unlock(&pool->lock);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_keypair_pool_stats_s
+otrng_keypair_pool_stats(const otrng_keypair_pool_s *pool) {
+  /* The lock is not part of the value of the pool */
+  pthread_mutex_t *lock = (pthread_mutex_t *)&pool->lock;
+  otrng_keypair_pool_stats_s stats;
+
+  (void)pthread_mutex_lock(lock);
+  stats = pool->stats;
+  (void)pthread_mutex_unlock(lock);
+
+  return stats;
+}
@@ -0,0 +1,150 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The pool is shared by all the clients of a global state, so it has its own
+ * lock, and the functions in this file can be called concurrently on the same
+ * pool. Its lock is never held while calling other parts of the library.
+ */
+
+#ifndef OTRNG_KEYPAIR_POOL_H
+#define OTRNG_KEYPAIR_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dh.h"
+#include "ed448.h"
+#include "error.h"
+#include "shared.h"
+
+#define KEYPAIR_POOL_DEFAULT_ECDH 4
+#define KEYPAIR_POOL_DEFAULT_DH 2
+/* How many keypairs otrng_poll generates each time it is called */
+#define KEYPAIR_POOL_POLL_BUDGET 1
+
+typedef struct otrng_keypair_pool_stats_s {
+  uint64_t ecdh_hits;   /* ECDH keypairs taken from the pool */
+  uint64_t ecdh_misses; /* ECDH keypairs generated because it was empty */
+  uint64_t dh_hits;
+  uint64_t dh_misses;
+} otrng_keypair_pool_stats_s;
+
+/*
+ * Ephemeral keypairs generated ahead of time, so a ratchet rotation does not
+ * have to wait for them (a DH-3072 keypair takes milliseconds).
+ *
+ * The pool is filled by otrng_keypair_pool_refill, which is meant to be called
+ * when the application is idle. Every keypair is handed out once, and removed
+ * from the pool. When the pool is empty, keypairs are generated on demand.
+ */
+typedef struct otrng_keypair_pool_s {
+  /*@null@*/ ecdh_keypair_s *ecdh; /* in secure memory */
+  size_t ecdh_len;
+  size_t ecdh_size; /* how many to keep */
+
+  /*@null@*/ dh_keypair_s *dh; /* in secure memory */
+  size_t dh_len;
+  size_t dh_size;
+
+  otrng_keypair_pool_stats_s stats;
+
+  /* The conversations of all clients take from the same pool. Keypairs are
+     never generated while holding it. */
+  pthread_mutex_t lock;
+} otrng_keypair_pool_s;
+
+/**
+ * @brief Initializes an empty pool.
+ *
+ * @param [pool]       The pool.
+ * @param [ecdh_size]  How many ECDH keypairs to keep.
+ * @param [dh_size]    How many DH keypairs to keep.
+ */
+INTERNAL void otrng_keypair_pool_init(otrng_keypair_pool_s *pool,
+                                      size_t ecdh_size, size_t dh_size);
+
+/**
+ * @brief Destroys all the keypairs in the pool.
+ *
+ * @param [pool]  The pool.
+ */
+INTERNAL void otrng_keypair_pool_destroy(otrng_keypair_pool_s *pool);
+
+/**
+ * @brief Changes how many keypairs the pool keeps. Keypairs over the new sizes
+ * are destroyed.
+ *
+ * @param [pool]       The pool.
+ * @param [ecdh_size]  How many ECDH keypairs to keep.
+ * @param [dh_size]    How many DH keypairs to keep.
+ */
+INTERNAL void otrng_keypair_pool_resize(otrng_keypair_pool_s *pool,
+                                        size_t ecdh_size, size_t dh_size);
+
+/**
+ * @brief Generates keypairs until the pool is full, or [max_keypairs] have
+ * been generated. DH keypairs, which are the slowest to generate, go first.
+ *
+ * @param [pool]          The pool.
+ * @param [max_keypairs]  The most keypairs to generate, or 0 for no limit.
+ *
+ * @return The number of keypairs generated.
+ */
+INTERNAL size_t otrng_keypair_pool_refill(otrng_keypair_pool_s *pool,
+                                          size_t max_keypairs);
+
+/**
+ * @brief Takes an ECDH keypair out of the pool, or generates one if the pool
+ * is empty.
+ *
+ * @param [dst]   Where the keypair will be moved to.
+ * @param [pool]  The pool. If NULL, the keypair is always generated.
+ */
+INTERNAL otrng_result otrng_keypair_pool_take_ecdh(
+    ecdh_keypair_s *dst, /*@null@*/ otrng_keypair_pool_s *pool);
+
+/**
+ * @brief Takes a DH keypair out of the pool, or generates one if the pool is
+ * empty.
+ *
+ * @param [dst]   Where the keypair will be moved to. It must not hold a
+ *                keypair.
+ * @param [pool]  The pool. If NULL, the keypair is always generated.
+ */
+INTERNAL otrng_result otrng_keypair_pool_take_dh(
+    dh_keypair_s *dst, /*@null@*/ otrng_keypair_pool_s *pool);
+
+/**
+ * @brief Returns how often the pool had keypairs when they were needed.
+ *
+ * @param [pool]  The pool.
+ */
+INTERNAL otrng_keypair_pool_stats_s
+otrng_keypair_pool_stats(const otrng_keypair_pool_s *pool);
+
+#ifdef OTRNG_KEYPAIR_POOL_PRIVATE
+
+tstatic otrng_result keypair_pool_generate_ecdh(ecdh_keypair_s *dst);
+
+#endif
+
+#endif
@@ -193,3 +193,69 @@ INTERNAL size_t otrng_list_len(list_element_s *head) {
 
   return size;
 }
+
+INTERNAL void otrng_list_append(list_s *list, void *data) {
+  list_element_s *n = list_new();
+
+  n->data = data;
+
+  if (!list->tail) {
+    list->head = n;
+  } else {
+    list->tail->next = n;
+  }
+
+  list->tail = n;
+  list->len++;
+}
+
+INTERNAL void otrng_list_prepend(list_s *list, void *data) {
+  list_element_s *n = list_new();
+
+  n->data = data;
+  n->next = list->head;
+
+  list->head = n;
+  if (!list->tail) {
+    list->tail = n;
+  }
+
+  list->len++;
+}
+
+INTERNAL void otrng_list_unlink(list_s *list, list_element_s *wanted) {
+  list_element_s *previous = NULL;
+  list_element_s *cursor;
+
+  for (cursor = list->head; cursor; cursor = cursor->next) {
+    if (cursor == wanted) {
+      break;
+    }
+    previous = cursor;
+  }
+
+  if (!cursor) {
+    return;
+  }
+
+  if (previous) {
+    previous->next = cursor->next;
+  } else {
+    list->head = cursor->next;
+  }
+
+  if (list->tail == cursor) {
+    list->tail = previous;
+  }
+
+  cursor->next = NULL;
+  list->len--;
+}
+
+INTERNAL void otrng_list_clear(list_s *list, void (*free_data)(void *data)) {
+  otrng_list_free(list->head, free_data);
+
+  list->head = NULL;
+  list->tail = NULL;
+  list->len = 0;
+}
@@ -37,6 +37,15 @@ typedef struct list_element_s {
   struct list_element_s *next;
 } list_element_s;
 
+/* A list that keeps track of its last element and of its length, so appending
+   to it and asking for its length do not need to walk it. An all-zero list_s
+   is an empty list. */
+typedef struct list_s {
+  /*@null@*/ list_element_s *head;
+  /*@null@*/ list_element_s *tail;
+  size_t len;
+} list_s;
+
 INTERNAL void otrng_list_foreach(list_element_s *head,
                                  void (*fn)(list_element_s *node,
                                             void *context),
@@ -70,6 +79,18 @@ INTERNAL list_element_s *otrng_list_remove_element(const list_element_s *wanted,
 
 INTERNAL size_t otrng_list_len(list_element_s *head);
 
+INTERNAL void otrng_list_append(list_s *list, void *data);
+
+INTERNAL void otrng_list_prepend(list_s *list, void *data);
+
+// Unlinks the element from the list, but does not free it
+INTERNAL void otrng_list_unlink(list_s *list, list_element_s *wanted);
+
+// Free the list's nodes and invoke fn to free the nodes' data. The list will
+// be empty afterwards
+INTERNAL void otrng_list_clear(list_s *list,
+                               /*@null@*/ void (*fn)(void *data));
+
 #ifdef OTRNG_LIST_PRIVATE
 
 tstatic /*@only@*/ /*@notnull@*/ list_element_s *list_new(void);
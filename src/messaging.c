@@ -37,6 +37,8 @@
 API otrng_global_state_s *
 otrng_global_state_new(const otrng_client_callbacks_s *cb, otrng_bool die) {
   otrng_global_state_s *gs = otrng_xmalloc_z(sizeof(otrng_global_state_s));
+  pthread_mutexattr_t attr;
+
   if (!otrng_client_callbacks_ensure_needed_exist(cb)) {
     otrng_debug_fprintf(stderr,
                         "otrng global state initialization failed - expected "
@@ -47,6 +49,17 @@ otrng_global_state_new(const otrng_client_callbacks_s *cb, otrng_bool die) {
   }
 
   gs->callbacks = cb;
+  otrng_published_index_init(&gs->clients_index);
+  (void)pthread_mutex_init(&gs->clients_lock, NULL);
+  (void)pthread_mutexattr_init(&attr);
+  (void)pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  (void)pthread_mutex_init(&gs->user_state_v3_lock, &attr);
+  (void)pthread_mutexattr_destroy(&attr);
+  otrng_keypair_pool_init(&gs->keypair_pool, KEYPAIR_POOL_DEFAULT_ECDH,
+                          KEYPAIR_POOL_DEFAULT_DH);
+  gs->worker_threads = 1;
+  otrng_profile_cache_init(&gs->profile_cache, PROFILE_CACHE_DEFAULT_SIZE);
+  otrng_timers_init(&gs->timers);
   gs->user_state_v3 = otrl_userstate_create();
   if (gs->user_state_v3 == NULL) {
     if (die) {
@@ -64,8 +77,14 @@ API void otrng_global_state_free(otrng_global_state_s *gs) {
     return;
   }
 
-  otrng_list_free(gs->clients, free_client);
+  otrng_list_clear(&gs->clients, free_client);
+  otrng_published_index_destroy(&gs->clients_index);
+  (void)pthread_mutex_destroy(&gs->clients_lock);
   otrl_userstate_free(gs->user_state_v3);
+  (void)pthread_mutex_destroy(&gs->user_state_v3_lock);
+  otrng_keypair_pool_destroy(&gs->keypair_pool);
+  otrng_profile_cache_destroy(&gs->profile_cache);
+  otrng_timers_destroy(&gs->timers);
 
   otrng_free(gs);
 }
@@ -77,34 +96,117 @@ tstatic int find_client_by_client_id(const void *current, const void *wanted) {
          strcmp(client->client_id.account, cid->account) == 0;
 }
 
+tstatic uint64_t hash_client_id(const otrng_global_state_s *gs,
+                                const otrng_client_id_s *client_id) {
+  uint64_t hash =
+      otrng_published_index_hash(&gs->clients_index, 0, client_id->protocol,
+                                 strlen(client_id->protocol));
+
+  return otrng_published_index_hash(&gs->clients_index, hash,
+                                    client_id->account,
+                                    strlen(client_id->account));
+}
+
+/* It does not take any lock */
+tstatic /*@null@*/ otrng_client_s *
+find_client(const otrng_global_state_s *gs,
+            const otrng_client_id_s *client_id) {
+  return otrng_published_index_find(&gs->clients_index,
+                                    hash_client_id(gs, client_id),
+                                    find_client_by_client_id, client_id);
+}
+
+static void add_client(otrng_global_state_s *gs, otrng_client_s *client) {
+  otrng_list_append(&gs->clients, client);
+  otrng_published_index_add(&gs->clients_index,
+                            hash_client_id(gs, &client->client_id), client);
+}
+
+INTERNAL void otrng_global_state_add_client(otrng_global_state_s *gs,
+                                            otrng_client_s *client) {
+  (void)pthread_mutex_lock(&gs->clients_lock);
+  add_client(gs, client);
+  (void)pthread_mutex_unlock(&gs->clients_lock);
+}
+
+INTERNAL void otrng_global_state_lock_v3(otrng_global_state_s *gs) {
+  (void)pthread_mutex_lock(&gs->user_state_v3_lock);
+}
+
+INTERNAL void otrng_global_state_unlock_v3(otrng_global_state_s *gs) {
+  (void)pthread_mutex_unlock(&gs->user_state_v3_lock);
+}
+
+tstatic void forget_instance_tag(list_element_s *node, void *context) {
+  otrng_client_s *client = node->data;
+
+  (void)context;
+  client->instance_tag = 0;
+}
+
+INTERNAL void
+otrng_global_state_refresh_instance_tags(otrng_global_state_s *gs) {
+  const OtrlInsTag *instag;
+
+  if (!gs->user_state_v3) {
+    return;
+  }
+
+  /* This only runs while reading the tags, when no other call uses the
+   * clients, so they are not locked: that would also take a client lock
+   * after the v3 one */
+  (void)pthread_mutex_lock(&gs->clients_lock);
+  otrng_list_foreach(gs->clients.head, forget_instance_tag, NULL);
+
+  /* One walk over the tags, instead of one otrl_instag_find per client. As
+   * with otrl_instag_find, the first tag of an account is the one used. */
+  otrng_global_state_lock_v3(gs);
+  for (instag = gs->user_state_v3->instag_root; instag;
+       instag = instag->next) {
+    otrng_client_id_s client_id;
+    otrng_client_s *client;
+
+    client_id.protocol = instag->protocol;
+    client_id.account = instag->accountname;
+    client = find_client(gs, &client_id);
+    if (!client) {
+      continue;
+    }
+
+    if (!client->instance_tag) {
+      client->instance_tag = instag->instag;
+    }
+  }
+  otrng_global_state_unlock_v3(gs);
+
+  (void)pthread_mutex_unlock(&gs->clients_lock);
+}
+
 tstatic otrng_client_s *get_client(otrng_global_state_s *gs,
                                    const otrng_client_id_s client_id) {
-  otrng_client_s *client;
-  list_element_s *el =
-      otrng_list_get(&client_id, gs->clients, find_client_by_client_id);
-  if (el) {
-    return el->data;
+  otrng_client_s *client = find_client(gs, &client_id);
+  if (client) {
+    return client;
   }
 
-  client = otrng_client_new(client_id);
+  (void)pthread_mutex_lock(&gs->clients_lock);
+
+  /* Another thread may have added it since */
+  client = find_client(gs, &client_id);
   if (!client) {
-    return NULL;
+    /* Its instance tag is looked up the first time it is needed */
+    client = otrng_client_new(client_id);
+    client->global_state = gs;
+    add_client(gs, client);
   }
 
-  client->global_state = gs;
-  gs->clients = otrng_list_add(client, gs->clients);
+  (void)pthread_mutex_unlock(&gs->clients_lock);
 
   return client;
 }
 
 API otrng_client_s *otrng_client_get(otrng_global_state_s *gs,
-
                                      const otrng_client_id_s client_id) {
-  list_element_s *el =
-      otrng_list_get(&client_id, gs->clients, find_client_by_client_id);
-  if (el) {
-    return el->data;
-  }
   return get_client(gs, client_id);
 }
 
@@ -240,7 +342,7 @@ tstatic otrng_result global_state_write_to(const otrng_global_state_s *gs,
     return OTRNG_ERROR;
   }
 
-  otrng_list_foreach(gs->clients, fn, f);
+  otrng_list_foreach(gs->clients.head, fn, f);
 
   return OTRNG_SUCCESS;
 }
@@ -325,6 +427,9 @@ API otrng_result otrng_global_state_instance_tags_read_from(
   if (res) {
     return OTRNG_ERROR;
   }
+
+  otrng_global_state_refresh_instance_tags(gs);
+
   return OTRNG_SUCCESS;
 }
 
@@ -482,15 +587,14 @@ tstatic void prekey_global_state_message_free_from_list(void *prekeys) {
 tstatic void free_prekeys_from(list_element_s *node, void *ignored) {
   otrng_client_s *client = node->data;
   (void)ignored;
-  otrng_list_free(client->our_prekeys,
-                  prekey_global_state_message_free_from_list);
-  client->our_prekeys = NULL;
+  otrng_list_clear(&client->our_prekeys,
+                   prekey_global_state_message_free_from_list);
 }
 
 API otrng_result otrng_global_state_prekeys_read_from(
     otrng_global_state_s *gs, FILE *f,
     otrng_client_id_s (*read_client_id_for_line)(FILE *)) {
-  otrng_list_foreach(gs->clients, free_prekeys_from, NULL);
+  otrng_list_foreach(gs->clients.head, free_prekeys_from, NULL);
   return global_state_read_from(gs, f, read_client_id_for_line,
                                 otrng_client_prekey_messages_read_from);
 }
@@ -514,7 +618,7 @@ tstatic void remove_fingerprints_from(list_element_s *node, void *ignored) {
 }
 
 API void otrng_global_state_clean_all(otrng_global_state_s *gs) {
-  otrng_list_foreach(gs->clients, remove_fingerprints_from, NULL);
+  otrng_list_foreach(gs->clients.head, remove_fingerprints_from, NULL);
 }
 
 tstatic void free_fingerprints_from(list_element_s *node, void *ignored) {
@@ -528,7 +632,7 @@ API otrng_result otrng_global_state_fingerprints_v4_read_from(
     otrng_global_state_s *gs, FILE *f, otrng_client_id_s (*ignored)(FILE *)) {
   (void)ignored;
 
-  otrng_list_foreach(gs->clients, free_fingerprints_from, NULL);
+  otrng_list_foreach(gs->clients.head, free_fingerprints_from, NULL);
 
   if (!f) {
     return OTRNG_ERROR;
@@ -571,7 +675,11 @@ typedef struct all_fingerprints_ctx {
 
 static void do_all_fingerprints(list_element_s *node, void *ctx) {
   all_fingerprints_ctx *fctx = ctx;
-  otrng_fingerprints_do_all(node->data, fctx->fn, fctx->context);
+  otrng_client_s *client = node->data;
+
+  otrng_client_lock(client);
+  otrng_fingerprints_do_all(client, fctx->fn, fctx->context);
+  otrng_client_unlock(client);
 }
 
 API void otrng_global_state_do_all_fingerprints(
@@ -582,7 +690,12 @@ API void otrng_global_state_do_all_fingerprints(
       .fn = fn,
       .context = context,
   };
-  otrng_list_foreach(gs->clients, do_all_fingerprints, &fctx);
+  /* The lock is not part of the value of the global state */
+  pthread_mutex_t *lock = (pthread_mutex_t *)&gs->clients_lock;
+
+  (void)pthread_mutex_lock(lock);
+  otrng_list_foreach(gs->clients.head, do_all_fingerprints, &fctx);
+  (void)pthread_mutex_unlock(lock);
 }
 
 /* This function will actually not return ALL fingerprints.
@@ -597,7 +710,7 @@ API void otrng_global_state_do_all_fingerprints_v3(
   otrng_client_id_s cid;
   ConnContext *cc;
   Fingerprint *fprint;
-  list_element_s *el;
+  otrng_client_s *client;
   otrng_known_fingerprint_v3_s fp;
 
   for (cc = gs->user_state_v3->context_root; cc; cc = cc->next) {
@@ -606,30 +719,89 @@ API void otrng_global_state_do_all_fingerprints_v3(
       continue;
 
     /* Don't bother with the first (fingerprintless) entry. */
+    if (!cc->fingerprint_root.next) {
+      continue;
+    }
+
+    cid.protocol = cc->protocol;
+    cid.account = cc->accountname;
+    client = find_client(gs, &cid);
+    if (!client) {
+      continue;
+    }
+
     for (fprint = cc->fingerprint_root.next; fprint; fprint = fprint->next) {
-      cid.protocol = cc->protocol;
-      cid.account = cc->accountname;
-      el = otrng_list_get(&cid, gs->clients, find_client_by_client_id);
-      if (el) {
-        fp.username = cc->username;
-        fp.fp = fprint;
-        fn(el->data, &fp, context);
-      }
+      fp.username = cc->username;
+      fp.fp = fprint;
+      fn(client, &fp, context);
     }
   }
 }
 
-tstatic void poll_for_client(list_element_s *node, void *context) {
-  otrng_client_s *client = node->data;
-  (void)context;
-  otrng_client_expire_sessions(client);
-  (void)otrng_client_expire_fragments(client);
-  otrng_prekey_check_account_request(client);
-}
-
 API void otrng_poll(otrng_global_state_s *gs) {
-  otrng_list_foreach(gs->clients, poll_for_client, NULL);
+  (void)otrng_timers_expire(&gs->timers, time(NULL));
+
+  otrng_global_state_lock_v3(gs);
   otrl_message_poll(gs->user_state_v3, NULL, NULL);
+  otrng_global_state_unlock_v3(gs);
+
+  /* A DH keypair takes milliseconds, so a tick only generates one. The pool
+   * can be filled faster with otrng_global_state_refill_keypair_pool. */
+  (void)otrng_keypair_pool_refill(&gs->keypair_pool, KEYPAIR_POOL_POLL_BUDGET);
+}
+
+API long otrng_next_timeout(const otrng_global_state_s *gs) {
+  time_t deadline, now;
+
+  if (!otrng_timers_next_deadline(&deadline, &gs->timers)) {
+    return -1;
+  }
+
+  now = time(NULL);
+  if (deadline <= now) {
+    return 0;
+  }
+
+  return (long)(deadline - now);
+}
+
+API size_t otrng_global_state_refill_keypair_pool(otrng_global_state_s *gs,
+                                                  size_t max_keypairs) {
+  return otrng_keypair_pool_refill(&gs->keypair_pool, max_keypairs);
+}
+
+API void otrng_global_state_set_keypair_pool_size(otrng_global_state_s *gs,
+                                                  size_t ecdh_size,
+                                                  size_t dh_size) {
+  otrng_keypair_pool_resize(&gs->keypair_pool, ecdh_size, dh_size);
+}
+
+API otrng_keypair_pool_stats_s
+otrng_global_state_keypair_pool_stats(const otrng_global_state_s *gs) {
+  return otrng_keypair_pool_stats(&gs->keypair_pool);
+}
+
+API void otrng_global_state_set_worker_threads(otrng_global_state_s *gs,
+                                               size_t threads) {
+  if (threads == 0) {
+    threads = 1;
+  }
+
+  if (threads > OTRNG_MAX_THREADS) {
+    threads = OTRNG_MAX_THREADS;
+  }
+
+  gs->worker_threads = threads;
+}
+
+API void otrng_global_state_set_profile_cache_size(otrng_global_state_s *gs,
+                                                   size_t size) {
+  otrng_profile_cache_resize(&gs->profile_cache, size);
+}
+
+API otrng_profile_cache_stats_s
+otrng_global_state_profile_cache_stats(const otrng_global_state_s *gs) {
+  return otrng_profile_cache_stats(&gs->profile_cache);
 }
 
 INTERNAL void
@@ -644,8 +816,10 @@ otrng_global_state_fingerprints_v3_loaded(otrng_global_state_s *gs) {
 static const char **debug_print_ignores = NULL;
 static size_t debug_print_ignores_len;
 static size_t debug_print_ignores_cap;
+static pthread_mutex_t debug_print_ignores_lock = PTHREAD_MUTEX_INITIALIZER;
 
 API void otrng_add_debug_print_ignore(const char *ign) {
+  (void)pthread_mutex_lock(&debug_print_ignores_lock);
   if (debug_print_ignores == NULL) {
     debug_print_ignores = otrng_xmalloc(7 * sizeof(char *));
 
@@ -661,18 +835,29 @@ API void otrng_add_debug_print_ignore(const char *ign) {
 
   debug_print_ignores[debug_print_ignores_len] = ign;
   debug_print_ignores_len++;
+  (void)pthread_mutex_unlock(&debug_print_ignores_lock);
 }
 
-API void otrng_clear_debug_print_ignores() { debug_print_ignores_len = 0; }
+API void otrng_clear_debug_print_ignores() {
+  (void)pthread_mutex_lock(&debug_print_ignores_lock);
+  debug_print_ignores_len = 0;
+  (void)pthread_mutex_unlock(&debug_print_ignores_lock);
+}
 
 API otrng_bool otrng_debug_print_should_ignore(const char *ign) {
+  otrng_bool ignore = otrng_false;
   size_t ix;
+
+  (void)pthread_mutex_lock(&debug_print_ignores_lock);
   for (ix = 0; ix < debug_print_ignores_len; ix++) {
     if (strcmp(ign, debug_print_ignores[ix]) == 0) {
-      return otrng_true;
+      ignore = otrng_true;
+      break;
     }
   }
-  return otrng_false;
+  (void)pthread_mutex_unlock(&debug_print_ignores_lock);
+
+  return ignore;
 }
 
 API void otrng_client_id_debug_print(FILE *f,
@@ -707,7 +892,7 @@ API void otrng_global_state_debug_print(FILE *f, int indent,
     otrng_print_indent(f, indent + 2);
     debug_api_print(f, "clients = {\n");
     ix = 0;
-    curr = gs->clients;
+    curr = gs->clients.head;
     while (curr) {
       otrng_print_indent(f, indent + 4);
       debug_api_print(f, "[%d] = {\n", ix);
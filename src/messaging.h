@@ -19,13 +19,34 @@
  */
 
 /**
- * The functions in this file only operate on their arguments, and doesn't touch
- * any global state. It is safe to call these functions concurrently from
- * different threads, as long as arguments pointing to the same memory areas are
- * not used from different threads. However, since the global state points to
- * everything related to a specific OTR clients functionality, it has a lot of
- * references to subordinate objects. To be on the safe side, it's a good idea
- * to serialize access.
+ * Concurrency model
+ *
+ * otrng_init() must be called, and the global state created, before other
+ * threads use the library. After that, messages can be sent and received from
+ * any thread:
+ *
+ * - Every client has a lock, taken by the otrng_client_* and otrng_prekey_*
+ *   functions that use its conversations, keys or prekey manager. Different
+ *   clients are used in parallel; calls on the same client are serialized.
+ *   The callbacks for a client are called with its lock held. It is
+ *   recursive, so they may call back into the same client.
+ * - otrng_client_get() looks clients up without taking any lock. Clients are
+ *   never removed from the global state before it is freed.
+ * - The keypair pool, the profile cache and the timers are shared by all the
+ *   clients, and each has its own lock. otrng_poll() fires every timer with
+ *   the lock of the client it belongs to.
+ * - libotr keeps all accounts in a single user state, so the v3 protocol runs
+ *   under one lock for the whole global state.
+ * - The locks are taken in that order: a client, then any shared structure.
+ *   No lock is held while waiting for another client.
+ *
+ * The functions that read or write keys, profiles, instance tags and
+ * fingerprints (the *_read_from, *_write_to and *_generate_* functions), and
+ * the setters of the global state, are meant to be used while setting up,
+ * and must not run at the same time as other calls on the same global state.
+ * A conversation returned by otrng_client_get_conversation() must only be
+ * used while holding the client lock (see otrng_client_lock()) if other
+ * threads use the same client.
  */
 
 #ifndef OTRNG_MESSAGING_H_
@@ -51,16 +72,40 @@
  * otrng_messaging_client_receiving(client, alice_talking_to_bob);
  */
 
+#include <pthread.h>
+
 #include "client.h"
+#include "keypair_pool.h"
 #include "list.h"
+#include "parallel.h"
+#include "profile_cache.h"
+#include "published_index.h"
 #include "shared.h"
+#include "timers.h"
 
 typedef struct otrng_global_state_s {
-  list_element_s *clients;
+  list_s clients;
+  published_index_s clients_index; /* by (protocol, account) */
+  /* held while adding a client, or walking the list of clients */
+  pthread_mutex_t clients_lock;
 
   const otrng_client_callbacks_s *callbacks;
   OtrlUserState user_state_v3;
+  /* libotr keeps the contexts of all accounts in the user state */
+  pthread_mutex_t user_state_v3_lock;
   otrng_bool fingerprints_v3_loaded;
+
+  /* ephemeral keypairs shared by the conversations of all clients */
+  otrng_keypair_pool_s keypair_pool;
+
+  /* how many threads batch jobs, like generating prekey messages, may use */
+  size_t worker_threads;
+
+  /* verdicts on the profiles received from peers */
+  otrng_profile_cache_s profile_cache;
+
+  /* when sessions, pending fragments and prekey requests expire */
+  otrng_timers_s timers;
 } otrng_global_state_s;
 
 API otrng_global_state_s *
@@ -71,6 +116,41 @@ API void otrng_global_state_free(otrng_global_state_s *gs);
 API otrng_client_s *otrng_client_get(otrng_global_state_s *gs,
                                      const otrng_client_id_s client_id);
 
+/**
+ * @brief Adds the client to the global state, which takes ownership of it.
+ *
+ * @param [gs]      The global state.
+ * @param [client]  The client. There must be no other client with the same
+ *                  client id.
+ */
+INTERNAL void otrng_global_state_add_client(otrng_global_state_s *gs,
+                                            otrng_client_s *client);
+
+/**
+ * @brief Takes the lock of the v3 user state, which is shared by all the
+ * clients. It is recursive, as libotr calls back into the clients.
+ *
+ * @param [gs]  The global state.
+ */
+INTERNAL void otrng_global_state_lock_v3(otrng_global_state_s *gs);
+
+/**
+ * @brief Releases the lock taken by otrng_global_state_lock_v3().
+ *
+ * @param [gs]  The global state.
+ */
+INTERNAL void otrng_global_state_unlock_v3(otrng_global_state_s *gs);
+
+/**
+ * @brief Looks up the instance tags of every client again, after they have
+ * been read into the v3 user state. The tags are walked once, and each is
+ * given to its client through the index of clients.
+ *
+ * @param [gs]  The global state.
+ */
+INTERNAL void
+otrng_global_state_refresh_instance_tags(otrng_global_state_s *gs);
+
 API otrng_result otrng_global_state_instag_generate_into(
     otrng_global_state_s *gs, const otrng_client_id_s client_id, FILE *instag);
 
@@ -182,10 +262,92 @@ API void otrng_global_state_do_all_fingerprints_v3(
  *
  * The function should be called every few minutes in order to clean
  * up expired resources. If it's not called properly, forward secrecy
- * could be impacted.
+ * could be impacted. Only the sessions, pending fragments and prekey
+ * requests whose deadline has passed are looked at, so it can also be called
+ * exactly when otrng_next_timeout says. It also generates up to
+ * KEYPAIR_POOL_POLL_BUDGET keypairs for the keypair pool.
  */
 API void otrng_poll(otrng_global_state_s *gs);
 
+/**
+ * @brief Tells how long the application can wait before calling otrng_poll.
+ *
+ * @param [gs]  The global state.
+ *
+ * @return The number of seconds until the next session, pending fragments or
+ *         prekey request expires, 0 if something has already expired, or -1
+ *         if nothing is waiting to expire.
+ */
+API long otrng_next_timeout(const otrng_global_state_s *gs);
+
+/**
+ * @brief Generates ephemeral keypairs ahead of time, so ratchet rotations don't
+ * have to. otrng_poll does this too, a few at a time, but this can also be
+ * called whenever the application is idle.
+ *
+ * @param [gs]            The global state.
+ * @param [max_keypairs]  The most keypairs to generate, or 0 for no limit. A
+ *                        DH keypair takes a few milliseconds to generate.
+ *
+ * @return The number of keypairs generated.
+ */
+API size_t otrng_global_state_refill_keypair_pool(otrng_global_state_s *gs,
+                                                  size_t max_keypairs);
+
+/**
+ * @brief Sets how many ephemeral keypairs are generated ahead of time. Setting
+ * both to 0 disables the pool.
+ *
+ * @param [gs]         The global state.
+ * @param [ecdh_size]  How many ECDH keypairs to keep.
+ * @param [dh_size]    How many DH keypairs to keep.
+ */
+API void otrng_global_state_set_keypair_pool_size(otrng_global_state_s *gs,
+                                                  size_t ecdh_size,
+                                                  size_t dh_size);
+
+/**
+ * @brief Returns how many ephemeral keypairs were taken from the pool, and how
+ * many had to be generated because it was empty.
+ *
+ * @param [gs]  The global state.
+ */
+API otrng_keypair_pool_stats_s
+otrng_global_state_keypair_pool_stats(const otrng_global_state_s *gs);
+
+/**
+ * @brief Sets how many threads batch jobs may use. Generating prekey messages
+ * is one of them: with more than one thread, the keypairs of a batch are
+ * generated in parallel. The default is 1, which keeps all the work in the
+ * calling thread.
+ *
+ * @param [gs]       The global state.
+ * @param [threads]  The number of threads, up to OTRNG_MAX_THREADS.
+ */
+API void otrng_global_state_set_worker_threads(otrng_global_state_s *gs,
+                                               size_t threads);
+
+/**
+ * @brief Sets how many verdicts on the client and prekey profiles received
+ * from peers are kept, so the same profile is not validated again in every
+ * DAKE. Changing the size drops the verdicts already kept. The default is
+ * PROFILE_CACHE_DEFAULT_SIZE; 0 disables the cache.
+ *
+ * @param [gs]    The global state.
+ * @param [size]  How many verdicts to keep.
+ */
+API void otrng_global_state_set_profile_cache_size(otrng_global_state_s *gs,
+                                                   size_t size);
+
+/**
+ * @brief Returns how many profile validations were answered by the cache,
+ * how many were not, and how many verdicts were evicted.
+ *
+ * @param [gs]    The global state.
+ */
+API otrng_profile_cache_stats_s
+otrng_global_state_profile_cache_stats(const otrng_global_state_s *gs);
+
 INTERNAL void
 otrng_global_state_fingerprints_v3_loaded(otrng_global_state_s *gs);
 
@@ -209,6 +371,8 @@ tstatic otrng_result otrng_global_state_add_forging_key(
     otrng_global_state_s *gs, const otrng_client_id_s clientop,
     otrng_public_key *fk);
 
+tstatic void forget_instance_tag(list_element_s *node, void *context);
+
 tstatic otrng_client_s *get_client(otrng_global_state_s *gs,
                                    const otrng_client_id_s client_id);
 
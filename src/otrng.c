@@ -36,6 +36,7 @@
 
 #define OTRNG_OTRNG_PRIVATE
 
+#include "base64.h"
 #include "constants.h"
 #include "dake.h"
 #include "data_message.h"
@@ -59,6 +60,44 @@ static inline dh_public_key their_dh(const otrng_s *otr) {
   return otr->keys->their_dh;
 }
 
+static inline otrng_profile_cache_s *otrng_profile_cache(const otrng_s *otr) {
+  if (!otr->client || !otr->client->global_state) {
+    return NULL;
+  }
+
+  return &otr->client->global_state->profile_cache;
+}
+
+static inline otrng_timers_s *otrng_timers(const otrng_s *otr) {
+  if (!otr->client || !otr->client->global_state) {
+    return NULL;
+  }
+
+  return &otr->client->global_state->timers;
+}
+
+static void schedule_fragments_expiry(otrng_s *otr) {
+  otrng_timers_s *timers = otrng_timers(otr);
+  time_t at;
+
+  if (!timers || !otrng_fragments_next_expiry(&at,
+                                              otr->client->fragments_exp_time,
+                                              &otr->pending_fragments)) {
+    otrng_timer_cancel(&otr->fragments_timer);
+    return;
+  }
+
+  otrng_timer_schedule(timers, &otr->fragments_timer, at);
+}
+
+static void expire_pending_fragments(otrng_timer_s *timer, time_t now) {
+  otrng_s *otr = timer->data;
+
+  (void)otrng_expire_fragments(now, otr->client->fragments_exp_time,
+                               &otr->pending_fragments);
+  schedule_fragments_expiry(otr);
+}
+
 static const char tag_base[] = {'\x20', '\x09', '\x20', '\x20', '\x09', '\x09',
                                 '\x09', '\x09', '\x20', '\x09', '\x20', '\x09',
                                 '\x20', '\x09', '\x20', '\x20', '\0'};
@@ -162,15 +201,19 @@ INTERNAL otrng_s *otrng_new(otrng_client_s *client, otrng_policy_s policy) {
   otr->running_version = OTRNG_PROTOCOL_VERSION_NONE;
 
   otr->keys = otrng_key_manager_new();
+  if (client && client->global_state) {
+    otr->keys->keypair_pool = &client->global_state->keypair_pool;
+  }
   otr->smp = otrng_secure_alloc(sizeof(smp_protocol_s));
 
   otrng_smp_protocol_init(otr->smp);
+  otrng_fragment_store_init(&otr->pending_fragments);
+  otrng_timer_init(&otr->fragments_timer, expire_pending_fragments, otr,
+                   client ? &client->lock : NULL);
 
   return otr;
 }
 
-static void free_fragment_context(void *p) { otrng_fragment_context_free(p); }
-
 tstatic void otrng_destroy(/*@only@ */ otrng_s *otr) {
   otrng_free(otr->peer);
 
@@ -187,8 +230,8 @@ tstatic void otrng_destroy(/*@only@ */ otrng_s *otr) {
   otrng_secure_free(otr->smp);
   otr->smp = NULL;
 
-  otrng_list_free(otr->pending_fragments, free_fragment_context);
-  otr->pending_fragments = NULL;
+  otrng_timer_cancel(&otr->fragments_timer);
+  otrng_fragment_store_destroy(&otr->pending_fragments);
 
   otrng_v3_conn_free(otr->v3_conn);
   otr->v3_conn = NULL;
@@ -1116,7 +1159,8 @@ tstatic otrng_result prekey_message_received(const prekey_message_s *msg,
   }
 
   if (!otrng_valid_received_values(msg->sender_instance_tag, msg->Y, msg->B,
-                                   otr->their_client_profile)) {
+                                   otr->their_client_profile,
+                                   otrng_profile_cache(otr))) {
     return OTRNG_ERROR;
   }
 
@@ -1151,7 +1195,7 @@ tstatic otrng_result ensure_client_profile_version(char *versions,
 
 tstatic otrng_result receive_prekey_ensemble(const prekey_ensemble_s *ensemble,
                                              otrng_s *otr) {
-  if (!otrng_prekey_ensemble_validate(ensemble)) {
+  if (!otrng_prekey_ensemble_validate(ensemble, otrng_profile_cache(otr))) {
     return OTRNG_ERROR;
   }
 
@@ -1323,7 +1367,7 @@ tstatic otrng_result non_interactive_auth_message_received(
   }
 
   if (!otrng_valid_received_values(auth->sender_instance_tag, auth->X, auth->A,
-                                   auth->profile)) {
+                                   auth->profile, otrng_profile_cache(otr))) {
     return OTRNG_ERROR;
   }
 
@@ -1470,8 +1514,11 @@ tstatic otrng_result receive_identity_message_on_state_start(
 }
 
 tstatic void forget_our_keys(otrng_s *otr) {
+  otrng_keypair_pool_s *keypair_pool = otr->keys->keypair_pool;
+
   otrng_key_manager_destroy(otr->keys);
   otrng_key_manager_init(otr->keys);
+  otr->keys->keypair_pool = keypair_pool;
 }
 
 tstatic otrng_result receive_identity_message_on_waiting_auth_r(
@@ -1523,14 +1570,15 @@ tstatic otrng_result receive_identity_message(string_p *dst,
   }
 
   if (!otrng_valid_received_values(msg.sender_instance_tag, msg.Y, msg.B,
-                                   msg.profile)) {
+                                   msg.profile, otrng_profile_cache(otr))) {
     otrng_dake_identity_message_destroy(&msg);
     return result;
   }
 
   // Validating twice
   if (!otrng_valid_received_values(msg.sender_instance_tag, msg.Y_first,
-                                   msg.B_first, msg.profile)) {
+                                   msg.B_first, msg.profile,
+                                   otrng_profile_cache(otr))) {
     otrng_dake_identity_message_destroy(&msg);
     return result;
   }
@@ -1638,13 +1686,14 @@ tstatic otrng_bool valid_auth_r_message(const dake_auth_r_s *auth,
   };
 
   if (!otrng_valid_received_values(auth->sender_instance_tag, auth->X, auth->A,
-                                   auth->profile)) {
+                                   auth->profile, otrng_profile_cache(otr))) {
     return otrng_false;
   }
 
   // Repeat validation
   if (!otrng_valid_received_values(auth->sender_instance_tag, auth->X_first,
-                                   auth->A_first, auth->profile)) {
+                                   auth->A_first, auth->profile,
+                                   otrng_profile_cache(otr))) {
     return otrng_false;
   }
 
@@ -1867,6 +1916,7 @@ tstatic otrng_result decrypt_data_message(otrng_response_s *response,
                                           const data_message_s *msg) {
   string_p *dst = &response->to_display;
   uint8_t *plain;
+  size_t display_len;
   uint8_t actual_enc_key[ENC_ACTUAL_KEY_BYTES];
   int err;
 
@@ -1879,8 +1929,9 @@ tstatic otrng_result decrypt_data_message(otrng_response_s *response,
   otrng_memdump(msg->nonce, DATA_MSG_NONCE_BYTES);
 #endif
 
-  // TODO: @initialization What if message->enc_msg_len == 0?
-  plain = otrng_secure_alloc(msg->enc_msg_len);
+  /* The plaintext is the message to display followed by the TLVs. It stays
+     in secure memory: only the message to display is copied out. */
+  plain = otrng_secure_alloc(msg->enc_msg_len + 1);
 
   memcpy(actual_enc_key, enc_key, ENC_ACTUAL_KEY_BYTES);
   err = crypto_stream_xor(plain, msg->enc_msg, msg->enc_msg_len, msg->nonce,
@@ -1892,12 +1943,14 @@ tstatic otrng_result decrypt_data_message(otrng_response_s *response,
     return OTRNG_ERROR;
   }
 
-  /* If plain != "" and msg->enc_msg_len != 0 */
-  if (otrng_strnlen((string_p)plain, msg->enc_msg_len)) {
-    *dst = otrng_xstrndup((char *)plain, msg->enc_msg_len);
+  plain[msg->enc_msg_len] = '\0';
+  response->tlvs = deserialize_received_tlvs(plain, msg->enc_msg_len);
+
+  display_len = strlen((char *)plain);
+  if (display_len) {
+    *dst = otrng_xstrndup((char *)plain, display_len);
   }
 
-  response->tlvs = deserialize_received_tlvs(plain, msg->enc_msg_len);
   otrng_secure_free(plain);
   return OTRNG_SUCCESS;
 }
@@ -1986,8 +2039,9 @@ tstatic otrng_result otrng_receive_data_message_after_dake(
 
   response->to_display = NULL;
 
-  if (otrng_failed(
-          otrng_data_message_deserialize(msg, buffer, buff_len, &read))) {
+  /* The message only lives while buffer does */
+  if (otrng_failed(otrng_data_message_deserialize_view(
+          msg, buffer, buff_len, &read, &otr->keys->their_keys_enc))) {
     otrng_data_message_free(msg);
     return OTRNG_ERROR;
   }
@@ -2048,9 +2102,6 @@ tstatic otrng_result otrng_receive_data_message_after_dake(
       otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
       otrng_data_message_free(msg);
 
-      if (tmp_receiving_ratchet->skipped_keys) {
-        otrng_list_free(tmp_receiving_ratchet->skipped_keys, otrng_secure_free);
-      }
       otrng_receiving_ratchet_destroy(tmp_receiving_ratchet);
 
       otrng_client_callbacks_handle_event(otr->client->global_state->callbacks,
@@ -2059,6 +2110,8 @@ tstatic otrng_result otrng_receive_data_message_after_dake(
       return OTRNG_ERROR;
     }
 
+    otrng_data_message_remember_keys(&otr->keys->their_keys_enc, msg);
+
     if (otrng_failed(decrypt_data_message(response, enc_key, msg))) {
 
       if (msg->flags != MSG_FLAGS_IGNORE_UNREADABLE) {
@@ -2066,10 +2119,6 @@ tstatic otrng_result otrng_receive_data_message_after_dake(
         otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
         otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
 
-        if (tmp_receiving_ratchet->skipped_keys) {
-          otrng_list_free(tmp_receiving_ratchet->skipped_keys,
-                          otrng_secure_free);
-        }
         otrng_receiving_ratchet_destroy(tmp_receiving_ratchet);
 
         otrng_data_message_free(msg);
@@ -2079,10 +2128,6 @@ tstatic otrng_result otrng_receive_data_message_after_dake(
       if (msg->flags == MSG_FLAGS_IGNORE_UNREADABLE) {
         otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
         otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
-        if (tmp_receiving_ratchet->skipped_keys) {
-          otrng_list_free(tmp_receiving_ratchet->skipped_keys,
-                          otrng_secure_free);
-        }
         otrng_receiving_ratchet_destroy(tmp_receiving_ratchet);
         otrng_data_message_free(msg);
 
@@ -2225,12 +2270,24 @@ tstatic otrng_result receive_decoded_message(otrng_response_s *response,
   }
 }
 
+/* If [writable], the message is decoded over itself */
 tstatic otrng_result receive_encoded_message(otrng_response_s *response,
-                                             const string_p msg, otrng_s *otr) {
+                                             const string_p msg,
+                                             otrng_bool writable,
+                                             otrng_s *otr) {
   size_t dec_len = 0;
   uint8_t *decoded = NULL;
   otrng_result result;
 
+  if (writable) {
+    if (otrng_failed(otrng_base64_otr_decode_in_place(&decoded, &dec_len,
+                                                      (char *)msg))) {
+      return OTRNG_ERROR;
+    }
+
+    return receive_decoded_message(response, decoded, dec_len, otr);
+  }
+
   if (otrl_base64_otr_decode(msg, &decoded, &dec_len)) {
     return OTRNG_ERROR;
   }
@@ -2299,7 +2356,9 @@ static int get_message_type(const string_p msg) {
 }
 
 tstatic otrng_result receive_message_v4_only(otrng_response_s *response,
-                                             const string_p msg, otrng_s *otr) {
+                                             const string_p msg,
+                                             otrng_bool writable,
+                                             otrng_s *otr) {
   switch (get_message_type(msg)) {
   case MSG_PLAINTEXT:
     receive_plaintext(response, msg, otr);
@@ -2312,7 +2371,7 @@ tstatic otrng_result receive_message_v4_only(otrng_response_s *response,
     return receive_query_message(response, msg, otr);
 
   case MSG_OTR_ENCODED:
-    return receive_encoded_message(response, msg, otr);
+    return receive_encoded_message(response, msg, writable, otr);
 
   case MSG_OTR_ERROR:
     return receive_error_message(response, msg + strlen(ERROR_PREFIX), otr);
@@ -2325,6 +2384,7 @@ tstatic otrng_result receive_message_v4_only(otrng_response_s *response,
 
 static otrng_result receive_defragmented_message(otrng_response_s *response,
                                                  const string_p msg,
+                                                 otrng_bool writable,
                                                  otrng_s *otr) {
   if (!msg || !response) {
     return OTRNG_ERROR;
@@ -2346,7 +2406,7 @@ static otrng_result receive_defragmented_message(otrng_response_s *response,
   case OTRNG_PROTOCOL_VERSION_4:
   default:
     // V4 handles every message BUT v3 messages
-    return receive_message_v4_only(response, msg, otr);
+    return receive_message_v4_only(response, msg, writable, otr);
   }
 }
 
@@ -2358,16 +2418,34 @@ INTERNAL otrng_result otrng_receive_message(otrng_response_s *response,
 
   response->to_display = NULL;
 
-  if (otrng_failed(otrng_unfragment_message(&defrag, &otr->pending_fragments,
-                                            msg, our_instance_tag(otr)))) {
+  if (!otrng_is_fragment(msg)) {
+    return receive_defragmented_message(response, msg, otrng_false, otr);
+  }
+
+  ret = otrng_unfragment_message(&defrag, &otr->pending_fragments, msg,
+                                 our_instance_tag(otr));
+  schedule_fragments_expiry(otr);
+  if (otrng_failed(ret)) {
     return OTRNG_ERROR;
   }
 
-  ret = receive_defragmented_message(response, defrag, otr);
+  /* The message is ours now, so it can be decoded over itself */
+  ret = receive_defragmented_message(response, defrag, otrng_true, otr);
   otrng_free(defrag);
   return ret;
 }
 
+INTERNAL otrng_result otrng_receive_message_in_place(otrng_response_s *response,
+                                                     char *msg, otrng_s *otr) {
+  response->to_display = NULL;
+
+  if (!otrng_is_fragment(msg)) {
+    return receive_defragmented_message(response, msg, otrng_true, otr);
+  }
+
+  return otrng_receive_message(response, msg, otr);
+}
+
 INTERNAL otrng_result otrng_send_message(string_p *to_send, const string_p msg,
                                          const tlv_list_s *tlvs, uint8_t flags,
                                          otrng_s *otr) {
@@ -2398,6 +2476,37 @@ INTERNAL otrng_result otrng_send_message(string_p *to_send, const string_p msg,
   }
 }
 
+INTERNAL otrng_result otrng_send_messages(string_p *to_send, size_t *sent,
+                                          const char *const *msgs,
+                                          size_t count, uint8_t flags,
+                                          otrng_s *otr) {
+  size_t i;
+
+  *sent = 0;
+
+  if (!otr) {
+    return OTRNG_ERROR;
+  }
+
+  if (otr->running_version == OTRNG_PROTOCOL_VERSION_4) {
+    return otrng_prepare_to_send_data_messages(to_send, sent, msgs, count, otr,
+                                               flags);
+  }
+
+  memset(to_send, 0, count * sizeof(string_p));
+
+  for (i = 0; i < count; i++) {
+    if (!msgs[i] || otrng_failed(otrng_send_message(to_send + i, msgs[i],
+                                                    NULL, flags, otr))) {
+      *sent = i;
+      return OTRNG_ERROR;
+    }
+  }
+
+  *sent = count;
+  return OTRNG_SUCCESS;
+}
+
 tstatic otrng_result otrng_close_v4(string_p *to_send, otrng_s *otr) {
   size_t ser_len;
   uint8_t *ser_mac_keys;
@@ -2408,9 +2517,8 @@ tstatic otrng_result otrng_close_v4(string_p *to_send, otrng_s *otr) {
     return OTRNG_SUCCESS;
   }
 
-  ser_len = otrng_list_len(otr->keys->skipped_keys) * MAC_KEY_BYTES;
+  ser_len = otrng_skipped_keys_size(otr->keys->skipped_keys) * MAC_KEY_BYTES;
   ser_mac_keys = otrng_reveal_mac_keys_on_tlv(otr->keys);
-  otr->keys->skipped_keys = NULL;
 
   disconnected = otrng_tlv_list_one(
       otrng_tlv_new(OTRNG_TLV_DISCONNECTED, ser_len, ser_mac_keys));
@@ -2584,5 +2692,12 @@ API otrng_result otrng_init(otrng_bool die) {
 
   otrng_debug_init();
 
+  if (!otrng_shake_init()) {
+    if (die) {
+      exit(EXIT_FAILURE);
+    }
+    return OTRNG_ERROR;
+  }
+
   return otrng_dh_init(die);
 }
@@ -87,10 +87,41 @@ INTERNAL void otrng_response_free(otrng_response_s *response);
 INTERNAL otrng_result otrng_receive_message(otrng_response_s *response,
                                             const string_p msg, otrng_s *otr);
 
+/**
+ * @brief Receives a message like otrng_receive_message, but the message can
+ * be overwritten while it is processed. This saves decoding it into a copy.
+ *
+ * @param [response]  The response.
+ * @param [msg]       The received message. Its contents are lost.
+ * @param [otr]       The protocol state.
+ */
+INTERNAL otrng_result otrng_receive_message_in_place(otrng_response_s *response,
+                                                     char *msg, otrng_s *otr);
+
 INTERNAL otrng_result otrng_send_message(string_p *to_send, const string_p msg,
                                          /*@null@*/ const tlv_list_s *tlvs,
                                          uint8_t flags, otrng_s *otr);
 
+/**
+ * @brief Sends several messages, like calling otrng_send_message for each of
+ * them. In an OTRv4 conversation, they are encrypted as one batch.
+ *
+ * If a message fails, the ones after it are not sent. The ones before it are
+ * still returned, and have to be sent.
+ *
+ * @param [to_send] An array of [count] messages to send. Only the first
+ *                  [sent] are set, the others are NULL.
+ * @param [sent]    How many messages were prepared to send.
+ * @param [msgs]    The [count] messages.
+ * @param [count]   The number of messages.
+ * @param [flags]   The flags of the data messages.
+ * @param [otr]     The protocol state.
+ */
+INTERNAL otrng_result otrng_send_messages(string_p *to_send, size_t *sent,
+                                          const char *const *msgs,
+                                          size_t count, uint8_t flags,
+                                          otrng_s *otr);
+
 INTERNAL otrng_result otrng_close(string_p *to_send, otrng_s *otr);
 
 API otrng_result otrng_send_symkey_message(string_p *to_send, unsigned int use,
@@ -21,6 +21,7 @@
 #include "padding.h"
 #include "alloc.h"
 #include "client.h"
+#include "serialize.h"
 #include "tlv.h"
 
 static size_t calculate_padding_len(size_t msg_len, size_t max) {
@@ -59,3 +60,21 @@ INTERNAL otrng_result generate_padding(uint8_t **dst, size_t *dst_len,
   }
   return OTRNG_SUCCESS;
 }
+
+INTERNAL size_t otrng_padding_size(size_t msg_len, const otrng_s *otr) {
+  size_t padding_len = calculate_padding_len(msg_len, otr->client->padding);
+
+  if (!padding_len) {
+    return 0;
+  }
+
+  return padding_len + 4;
+}
+
+INTERNAL void otrng_padding_serialize(uint8_t *dst, size_t size) {
+  size_t w = 0;
+
+  w += otrng_serialize_uint16(dst + w, OTRNG_TLV_PADDING);
+  w += otrng_serialize_uint16(dst + w, size - 4);
+  memset(dst + w, 0, size - w);
+}
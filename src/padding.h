@@ -38,4 +38,21 @@
 INTERNAL otrng_result generate_padding(uint8_t **dst, size_t *dst_len,
                                        size_t msg_len, const otrng_s *otr);
 
+/**
+ * @brief Returns how many bytes the padding TLV for a message of [msg_len]
+ * bytes takes, header included, or 0 if there is no padding.
+ *
+ * @param [msg_len] The length of the message and its other TLVs.
+ * @param [otr]     The protocol state.
+ */
+INTERNAL size_t otrng_padding_size(size_t msg_len, const otrng_s *otr);
+
+/**
+ * @brief Writes a padding TLV of [size] bytes, as given by otrng_padding_size.
+ *
+ * @param [dst]   Where to write it.
+ * @param [size]  The size of the TLV, header included.
+ */
+INTERNAL void otrng_padding_serialize(uint8_t *dst, size_t size);
+
 #endif
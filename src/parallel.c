@@ -0,0 +1,77 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+
+#include "parallel.h"
+
+typedef struct parallel_job_s {
+  size_t next; /* the next index to hand out, updated atomically */
+  size_t count;
+  void (*fn)(size_t index, void *context);
+  void *context;
+} parallel_job_s;
+
+static void *parallel_worker(void *arg) {
+  parallel_job_s *job = arg;
+  size_t index;
+
+  while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+         job->count) {
+    job->fn(index, job->context);
+  }
+
+  return NULL;
+}
+
+INTERNAL void otrng_parallel_for(size_t threads, size_t count,
+                                 void (*fn)(size_t index, void *context),
+                                 /*@null@*/ void *context) {
+  pthread_t workers[OTRNG_MAX_THREADS - 1];
+  parallel_job_s job;
+  size_t started = 0, i;
+
+  job.next = 0;
+  job.count = count;
+  job.fn = fn;
+  job.context = context;
+
+  if (threads > count) {
+    threads = count;
+  }
+
+  if (threads > OTRNG_MAX_THREADS) {
+    threads = OTRNG_MAX_THREADS;
+  }
+
+  while (started + 1 < threads) {
+    if (pthread_create(&workers[started], NULL, parallel_worker, &job) != 0) {
+      break;
+    }
+    started++;
+  }
+
+  /* the calling thread works too, and does everything if no thread started */
+  (void)parallel_worker(&job);
+
+  for (i = 0; i < started; i++) {
+    (void)pthread_join(workers[i], NULL);
+  }
+}
@@ -0,0 +1,50 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OTRNG_PARALLEL_H
+#define OTRNG_PARALLEL_H
+
+#include <stddef.h>
+
+#include "shared.h"
+
+/* No more than this many threads are ever started for one call */
+#define OTRNG_MAX_THREADS 64
+
+/**
+ * @brief Calls [fn] once for every index in [0, count), spreading the calls
+ * over up to [threads] threads, the calling one included. Returns when all the
+ * calls have returned.
+ *
+ * The order of the calls is not defined, so [fn] must only touch what belongs
+ * to its index, or what is safe to share between threads. If threads can't be
+ * started, the calls are made from the calling thread.
+ *
+ * @param [threads]  How many threads to use. 0 and 1 mean the calling thread
+ *                   only.
+ * @param [count]    The number of indexes.
+ * @param [fn]       The function to call.
+ * @param [context]  Passed to [fn].
+ */
+INTERNAL void otrng_parallel_for(size_t threads, size_t count,
+                                 void (*fn)(size_t index, void *context),
+                                 /*@null@*/ void *context);
+
+#endif
@@ -341,7 +341,7 @@ INTERNAL otrng_result otrng_client_fingerprint_v4_read_from(
   client = get_client(gs, client_id);
 
   if (client->fingerprints == NULL) {
-    client->fingerprints = otrng_xmalloc_z(sizeof(otrng_known_fingerprints_s));
+    client->fingerprints = otrng_known_fingerprints_new();
   }
 
   fpr = otrng_xmalloc_z(sizeof(otrng_known_fingerprint_s));
@@ -352,7 +352,7 @@ INTERNAL otrng_result otrng_client_fingerprint_v4_read_from(
   free(line);
   free(items);
 
-  client->fingerprints->fps = otrng_list_add(fpr, client->fingerprints->fps);
+  otrng_known_fingerprints_add(client->fingerprints, fpr);
 
   return OTRNG_SUCCESS;
 }
@@ -437,6 +437,9 @@ INTERNAL otrng_result otrng_client_instance_tag_write_to(otrng_client_s *client,
   if (ret) {
     return OTRNG_ERROR;
   }
+
+  otrng_client_refresh_instance_tag(client);
+
   return OTRNG_SUCCESS;
 }
 
@@ -453,6 +456,11 @@ otrng_client_instance_tag_read_from(otrng_client_s *client, FILE *instagf) {
   if (ret) {
     return OTRNG_ERROR;
   }
+
+  /* The file may hold the tags of other accounts too */
+  otrng_client_refresh_instance_tag(client);
+  otrng_global_state_refresh_instance_tags(client->global_state);
+
   return OTRNG_SUCCESS;
 }
 
@@ -659,7 +667,7 @@ otrng_client_prekeys_write_to(const otrng_client_s *client, FILE *prekeyf) {
     return OTRNG_ERROR;
   }
 
-  if (!client->our_prekeys) {
+  if (!client->our_prekeys.head) {
     return OTRNG_ERROR;
   }
 
@@ -668,7 +676,7 @@ otrng_client_prekeys_write_to(const otrng_client_s *client, FILE *prekeyf) {
     return OTRNG_ERROR;
   }
 
-  current = client->our_prekeys;
+  current = client->our_prekeys.head;
   while (current) {
     if (!serialize_and_store_prekey(current->data, storage_id, prekeyf)) {
       otrng_free(storage_id);
@@ -704,7 +712,7 @@ static otrng_result read_and_deserialize_prekey(otrng_client_s *client,
     return result;
   }
 
-  client->our_prekeys = otrng_list_add(prekey_msg, client->our_prekeys);
+  otrng_list_append(&client->our_prekeys, prekey_msg);
 
   return OTRNG_SUCCESS;
 }
@@ -901,7 +909,8 @@ otrng_client_fingerprints_v4_write_to(const otrng_client_s *client, FILE *fp) {
     return OTRNG_ERROR;
   }
 
-  otrng_list_foreach(client->fingerprints->fps, add_fingerprint_to_file, &ctx);
+  otrng_list_foreach(client->fingerprints->fps.head, add_fingerprint_to_file,
+                     &ctx);
 
   return OTRNG_SUCCESS;
 }
@@ -32,7 +32,8 @@ INTERNAL prekey_ensemble_s *otrng_prekey_ensemble_new() {
 }
 
 INTERNAL otrng_result
-otrng_prekey_ensemble_validate(const prekey_ensemble_s *dst) {
+otrng_prekey_ensemble_validate(const prekey_ensemble_s *dst,
+                               otrng_profile_cache_s *profiles) {
   /* Check that all the instance tags on the Prekey Ensemble's values are the
    * same. */
   char *versions;
@@ -46,14 +47,14 @@ otrng_prekey_ensemble_validate(const prekey_ensemble_s *dst) {
     return OTRNG_ERROR;
   }
 
-  if (!otrng_client_profile_valid(dst->client_profile,
-                                  dst->message->sender_instance_tag)) {
+  if (!otrng_profile_cache_client_profile_valid(
+          profiles, dst->client_profile, dst->message->sender_instance_tag)) {
     return OTRNG_ERROR;
   }
 
-  if (!otrng_prekey_profile_valid(dst->prekey_profile,
-                                  dst->message->sender_instance_tag,
-                                  dst->client_profile->long_term_pub_key)) {
+  if (!otrng_profile_cache_prekey_profile_valid(
+          profiles, dst->prekey_profile, dst->message->sender_instance_tag,
+          dst->client_profile->long_term_pub_key)) {
     return OTRNG_ERROR;
   }
 
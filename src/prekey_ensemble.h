@@ -34,6 +34,7 @@
 #include "dake.h"
 #include "error.h"
 #include "prekey_profile.h"
+#include "profile_cache.h"
 
 typedef struct {
   otrng_client_profile_s *client_profile;
@@ -43,8 +44,15 @@ typedef struct {
 
 INTERNAL prekey_ensemble_s *otrng_prekey_ensemble_new(void);
 
+/**
+ * @brief Validates a prekey ensemble retrieved from the prekey server.
+ *
+ * @param [dst]       The ensemble.
+ * @param [profiles]  Where verdicts on profiles are cached, or NULL.
+ */
 INTERNAL otrng_result
-otrng_prekey_ensemble_validate(const prekey_ensemble_s *dst);
+otrng_prekey_ensemble_validate(const prekey_ensemble_s *dst,
+                               /*@null@*/ otrng_profile_cache_s *profiles);
 
 INTERNAL otrng_result otrng_prekey_ensemble_deserialize(prekey_ensemble_s *dst,
                                                         const uint8_t *src,
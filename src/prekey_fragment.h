@@ -32,11 +32,11 @@
 #include <time.h>
 
 #include "error.h"
-#include "list.h"
+#include "fragment.h"
 #include "shared.h"
 
 INTERNAL otrng_result otrng_fragment_message_receive(
-    char **unfrag_msg, list_element_s **contexts, const char *msg,
+    char **unfrag_msg, fragment_store_s *store, const char *msg,
     const uint32_t our_instance_tag);
 
 #ifdef OTRNG_PREKEY_FRAGMENT_PRIVATE
@@ -25,6 +25,7 @@
 #include "base64.h"
 #include "client.h"
 #include "deserialize.h"
+#include "messaging.h"
 #include "prekey_client_dake.h"
 #include "prekey_client_shared.h"
 #include "prekey_fragment.h"
@@ -243,10 +244,14 @@ serialize_dake1(/*@notnull@*/ otrng_prekey_dake1_message_s *dake1) {
   return result;
 }
 
-/*
-   TODO: if a request gets lost, manager->request_for_account will never be
-   reset We should probably do a bit of cleanup on it now and again
-*/
+#define ACCOUNT_REQUEST_EXPIRY 10 * 60 /* 10 minutes */
+
+/* If a request gets lost, the request_for_account is cleaned once it
+   expires */
+static void expire_account_request(otrng_timer_s *timer, time_t now) {
+  (void)now;
+  otrng_prekey_check_account_request(timer->data);
+}
 
 static otrng_result prekey_manager_register_account_request(
     /*@notnull@*/ otrng_prekey_manager_s *manager,
@@ -257,9 +262,40 @@ static otrng_result prekey_manager_register_account_request(
 
   manager->request_for_account_at = time(NULL);
   manager->request_for_account = request;
+
+  if (manager->client->global_state) {
+    otrng_timer_schedule(&manager->client->global_state->timers,
+                         &manager->request_for_account_timer,
+                         manager->request_for_account_at +
+                             ACCOUNT_REQUEST_EXPIRY);
+  }
+
   return OTRNG_SUCCESS;
 }
 
+static void schedule_fragments_expiry(otrng_prekey_manager_s *manager) {
+  otrng_client_s *client = manager->client;
+  time_t at;
+
+  if (!client->global_state ||
+      !otrng_fragments_next_expiry(&at, client->fragments_exp_time,
+                                   &manager->pending_fragments)) {
+    otrng_timer_cancel(&manager->fragments_timer);
+    return;
+  }
+
+  otrng_timer_schedule(&client->global_state->timers,
+                       &manager->fragments_timer, at);
+}
+
+static void expire_pending_fragments(otrng_timer_s *timer, time_t now) {
+  otrng_prekey_manager_s *manager = timer->data;
+
+  (void)otrng_expire_fragments(now, manager->client->fragments_exp_time,
+                               &manager->pending_fragments);
+  schedule_fragments_expiry(manager);
+}
+
 static otrng_result start_dake1(
     /*@notnull@*/ char **new_msg,
     /*@notnull@*/ otrng_client_s *client,
@@ -348,7 +384,13 @@ API otrng_result otrng_prekey_request_storage_information(
     /*@notnull@*/ char **new_msg,
     /*@notnull@*/ otrng_client_s *client,
     /*@null@*/ void *ctx) {
-  return start_dake1(new_msg, client, ctx, storage_request_after_dake);
+  otrng_result result;
+
+  otrng_client_lock(client);
+  result = start_dake1(new_msg, client, ctx, storage_request_after_dake);
+  otrng_client_unlock(client);
+
+  return result;
 }
 
 API otrng_bool
@@ -362,6 +404,12 @@ otrng_prekey_ensure_manager(/*@notnull@*/ struct otrng_client_s *client,
 
   client->prekey_manager->our_identity = otrng_xstrdup(identity);
   client->prekey_manager->client = client;
+  otrng_fragment_store_init(&client->prekey_manager->pending_fragments);
+  otrng_timer_init(&client->prekey_manager->request_for_account_timer,
+                   expire_account_request, client, &client->lock);
+  otrng_timer_init(&client->prekey_manager->fragments_timer,
+                   expire_pending_fragments, client->prekey_manager,
+                   &client->lock);
   client->prekey_manager->publication_policy =
       otrng_xmalloc_z(sizeof(otrng_prekey_publication_policy_s));
 
@@ -626,14 +674,13 @@ process_received_dake2(otrng_client_s *client, otrng_prekey_request_s *request,
   return send_dake3(client, request, msg);
 }
 
-#define ACCOUNT_REQUEST_EXPIRY 10 * 60 /* 10 minutes */
-
 static void clean_request_for_account(otrng_client_s *client) {
   if (client->prekey_manager != NULL &&
       client->prekey_manager->request_for_account != NULL) {
     prekey_request_free(client->prekey_manager->request_for_account);
     client->prekey_manager->request_for_account = NULL;
     client->prekey_manager->request_for_account_at = 0;
+    otrng_timer_cancel(&client->prekey_manager->request_for_account_timer);
   }
 }
 
@@ -817,6 +864,15 @@ void otrng_prekey_check_account_request(otrng_client_s *client) {
   return NULL;
 }
 
+static /*@null@*/ otrng_profile_cache_s *
+profile_cache(const otrng_client_s *client) {
+  if (!client->global_state) {
+    return NULL;
+  }
+
+  return &client->global_state->profile_cache;
+}
+
 static otrng_result process_received_prekey_ensemble_retrieval(
     otrng_client_s *client, otrng_prekey_ensemble_retrieval_message_s *msg) {
   int i;
@@ -828,7 +884,8 @@ static otrng_result process_received_prekey_ensemble_retrieval(
   }
 
   for (i = 0; i < msg->num_ensembles; i++) {
-    if (!otrng_prekey_ensemble_validate(msg->ensembles[i])) {
+    if (!otrng_prekey_ensemble_validate(msg->ensembles[i],
+                                        profile_cache(client))) {
       otrng_prekey_ensemble_destroy(msg->ensembles[i]);
       msg->ensembles[i] = NULL;
       msg->num_ensembles = msg->num_ensembles - 1;
@@ -968,13 +1025,14 @@ find_server_for_identity(/*@notnull@*/ otrng_prekey_manager_s *manager,
   that doesn't map to an active prekey conversation, this function
   returns false - that means someone else needs to handle the message.
 */
-API otrng_bool otrng_prekey_receive(/*@notnull@*/ char **to_send,
-                                    /*@notnull@*/ otrng_client_s *client,
-                                    /*@notnull@*/ const char *from,
-                                    /*@notnull@*/ const char *msg) {
+static otrng_bool prekey_receive(/*@notnull@*/ char **to_send,
+                                 /*@notnull@*/ otrng_client_s *client,
+                                 /*@notnull@*/ const char *from,
+                                 /*@notnull@*/ const char *msg) {
   char *defrag = NULL;
   uint8_t *ser = NULL;
   size_t ser_len = 0;
+  otrng_result result;
 
   assert(to_send);
   assert(client);
@@ -991,9 +1049,11 @@ API otrng_bool otrng_prekey_receive(/*@notnull@*/ char **to_send,
     return otrng_false;
   }
 
-  if (otrng_failed(otrng_fragment_message_receive(
-          &defrag, &client->prekey_manager->pending_fragments, msg,
-          otrng_client_get_instance_tag(client)))) {
+  result = otrng_fragment_message_receive(
+      &defrag, &client->prekey_manager->pending_fragments, msg,
+      otrng_client_get_instance_tag(client));
+  schedule_fragments_expiry(client->prekey_manager);
+  if (otrng_failed(result)) {
     return otrng_false;
   }
 
@@ -1010,6 +1070,19 @@ API otrng_bool otrng_prekey_receive(/*@notnull@*/ char **to_send,
   return otrng_true;
 }
 
+API otrng_bool otrng_prekey_receive(/*@notnull@*/ char **to_send,
+                                    /*@notnull@*/ otrng_client_s *client,
+                                    /*@notnull@*/ const char *from,
+                                    /*@notnull@*/ const char *msg) {
+  otrng_bool handled;
+
+  otrng_client_lock(client);
+  handled = prekey_receive(to_send, client, from, msg);
+  otrng_client_unlock(client);
+
+  return handled;
+}
+
 API void otrng_prekey_retrieve_prekeys(/*@notnull@*/ char **new_msg,
                                        /*@notnull@*/ otrng_client_s *client,
                                        /*@notnull@*/ const char *identity_for,
@@ -1266,7 +1339,7 @@ static void hash_prekey_profile_for_publication_message(
   }
 }
 
-static otrng_result dake3_message_append_prekey_publication_message(
+tstatic otrng_result dake3_message_append_prekey_publication_message(
     otrng_prekey_publication_message_s *pub_msg,
     otrng_prekey_dake3_message_s *dake_3, uint8_t mac_key[MAC_KEY_BYTES],
     uint8_t mac[HASH_BYTES]) {
@@ -1367,16 +1440,22 @@ static otrng_result publication_after_dake(
 API otrng_result otrng_prekey_publish(/*@notnull@*/ char **new_msg,
                                       /*@notnull@*/ otrng_client_s *client,
                                       /*@null@*/ void *ctx) {
-  return start_dake1(new_msg, client, ctx, publication_after_dake);
+  otrng_result result;
+
+  otrng_client_lock(client);
+  result = start_dake1(new_msg, client, ctx, publication_after_dake);
+  otrng_client_unlock(client);
+
+  return result;
 }
 
 API void otrng_prekey_add_prekey_messages_for_publication(
     /*@notnull@*/ otrng_client_s *client,
     /*@notnull@*/ otrng_prekey_publication_message_s *msg) {
-  const size_t max = otrng_list_len(client->our_prekeys);
+  const size_t max = client->our_prekeys.len;
   size_t real = 0;
   prekey_message_s **msg_list = otrng_xmalloc(max * sizeof(prekey_message_s *));
-  list_element_s *current = client->our_prekeys;
+  list_element_s *current = client->our_prekeys.head;
 
   assert(client);
   assert(msg);
@@ -1423,7 +1502,6 @@ static void otrng_prekey_server_free(otrng_prekey_server_s *server) {
   otrng_free(server);
 }
 
-static void free_fragment_context(void *p) { otrng_fragment_context_free(p); }
 static void free_server_identity(void *p) { otrng_prekey_server_free(p); }
 
 INTERNAL void otrng_prekey_manager_free(otrng_prekey_manager_s *manager) {
@@ -1435,7 +1513,9 @@ INTERNAL void otrng_prekey_manager_free(otrng_prekey_manager_s *manager) {
   otrng_free(manager->publication_policy);
   otrng_free(manager->callbacks);
 
-  otrng_list_free(manager->pending_fragments, free_fragment_context);
+  otrng_timer_cancel(&manager->request_for_account_timer);
+  otrng_timer_cancel(&manager->fragments_timer);
+  otrng_fragment_store_destroy(&manager->pending_fragments);
   otrng_list_free(manager->server_identities, free_server_identity);
   if (manager->request_for_account != NULL) {
     prekey_request_free(manager->request_for_account);
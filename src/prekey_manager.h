@@ -33,11 +33,13 @@
 #define OTRNG_PREKEY_MANAGER_H
 
 #include "error.h"
+#include "fragment.h"
 #include "keys.h"
 #include "list.h"
 #include "prekey_client_dake.h"
 #include "prekey_client_messages.h"
 #include "shared.h"
+#include "timers.h"
 
 struct otrng_client_s;
 struct otrng_prekey_request_s;
@@ -167,8 +169,10 @@ typedef struct {
    * set - this allows us to clean it, if it hasn't been removed for a while
    */
   time_t request_for_account_at;
+  otrng_timer_s request_for_account_timer;
 
-  /*@null@*/ list_element_s *pending_fragments;
+  fragment_store_s pending_fragments;
+  otrng_timer_s fragments_timer; /* when the oldest pending fragments expire */
 
   /*@notnull@*/ otrng_prekey_publication_policy_s *publication_policy;
 
@@ -334,8 +338,8 @@ INTERNAL void
 otrng_prekey_manager_free(/*@null@*/ otrng_prekey_manager_s *manager);
 
 /**
- * @brief Should be called regularly to see that the request_for_account
- *    request hasn't expired.
+ * @brief Cleans the request_for_account request, if it has expired. otrng_poll
+ *    calls this when the request is due to expire.
  **/
 INTERNAL void
 otrng_prekey_check_account_request(/*@notnull@*/ struct otrng_client_s *client);
@@ -356,6 +360,11 @@ tstatic char *send_dake3(struct otrng_client_s *client,
                          otrng_prekey_request_s *request,
                          const otrng_prekey_dake2_message_s *msg);
 
+tstatic otrng_result dake3_message_append_prekey_publication_message(
+    otrng_prekey_publication_message_s *pub_msg,
+    otrng_prekey_dake3_message_s *dake_3, uint8_t mac_key[MAC_KEY_BYTES],
+    uint8_t mac[HASH_BYTES]);
+
 #endif
 
 #endif
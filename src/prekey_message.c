@@ -24,6 +24,8 @@
 
 #include "base64.h"
 #include "deserialize.h"
+#include "parallel.h"
+#include "random.h"
 #include "serialize.h"
 
 tstatic /*@notnull@*/ prekey_message_s *otrng_prekey_message_new(void) {
@@ -96,6 +98,83 @@ otrng_prekey_message_build(uint32_t instance_tag, const ecdh_keypair_s *y,
   return msg;
 }
 
+typedef struct prekey_messages_job_s {
+  prekey_message_s **messages;
+  const uint8_t *syms; /* ED448_PRIVATE_BYTES for each message */
+  uint32_t instance_tag;
+} prekey_messages_job_s;
+
+tstatic void generate_prekey_message(size_t index, void *context) {
+  prekey_messages_job_s *job = context;
+  ecdh_keypair_s ecdh;
+  dh_keypair_s dh;
+
+  job->messages[index] = NULL;
+
+  if (!otrng_ecdh_keypair_generate(&ecdh,
+                                   job->syms + index * ED448_PRIVATE_BYTES)) {
+    return;
+  }
+
+  if (!otrng_dh_keypair_generate(&dh)) {
+    otrng_ecdh_keypair_destroy(&ecdh);
+    return;
+  }
+
+  job->messages[index] =
+      otrng_prekey_message_build(job->instance_tag, &ecdh, &dh);
+
+  otrng_ecdh_keypair_destroy(&ecdh);
+  otrng_dh_keypair_destroy(&dh);
+}
+
+INTERNAL otrng_result otrng_prekey_messages_generate(prekey_message_s **dst,
+                                                     size_t count,
+                                                     uint32_t instance_tag,
+                                                     size_t threads) {
+  prekey_messages_job_s job;
+  uint8_t *syms;
+  otrng_result result = OTRNG_SUCCESS;
+  size_t i;
+
+  if (count == 0) {
+    return OTRNG_SUCCESS;
+  }
+
+  syms = otrng_secure_alloc_array(count, ED448_PRIVATE_BYTES);
+  if (!syms) {
+    return OTRNG_ERROR;
+  }
+
+  for (i = 0; i < count; i++) {
+    random_bytes(syms + i * ED448_PRIVATE_BYTES, ED448_PRIVATE_BYTES);
+  }
+
+  job.messages = dst;
+  job.syms = syms;
+  job.instance_tag = instance_tag;
+
+  otrng_parallel_for(threads, count, generate_prekey_message, &job);
+
+  otrng_secure_wipe(syms, count * ED448_PRIVATE_BYTES);
+  otrng_secure_free(syms);
+
+  for (i = 0; i < count; i++) {
+    if (!dst[i]) {
+      result = OTRNG_ERROR;
+    }
+  }
+
+  if (result == OTRNG_ERROR) {
+    for (i = 0; i < count; i++) {
+      otrng_prekey_message_free(dst[i]);
+      dst[i] = NULL;
+    }
+  }
+
+  return result;
+}
+
 static void otrng_prekey_message_destroy(prekey_message_s *prekey_msg) {
   prekey_msg->id = 0;
   otrng_ec_point_destroy(prekey_msg->Y);
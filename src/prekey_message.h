@@ -53,6 +53,28 @@ INTERNAL /*@null@*/ prekey_message_s *
 otrng_prekey_message_build(uint32_t instance_tag, const ecdh_keypair_s *y,
                            const dh_keypair_s *b);
 
+/**
+ * @brief Generates [count] prekey messages, each one with new ECDH and DH
+ * keypairs. The keypairs are generated by up to [threads] threads, as the DH
+ * ones take milliseconds each.
+ *
+ * The ECDH secrets are drawn from random_bytes by the calling thread, in
+ * order, before any other thread starts. So a randomness function set with
+ * otrng_set_current_randomness is never called from more than one thread, and
+ * yields the same ECDH keys whatever the number of threads. Everything else
+ * comes from libgcrypt, which is safe to use from many threads.
+ *
+ * @param [dst]           An array of [count] pointers. On success, it holds
+ *                        the new messages, in order.
+ * @param [count]         The number of messages to generate.
+ * @param [instance_tag]  Our instance tag.
+ * @param [threads]       The number of threads to use.
+ */
+INTERNAL otrng_result otrng_prekey_messages_generate(prekey_message_s **dst,
+                                                     size_t count,
+                                                     uint32_t instance_tag,
+                                                     size_t threads);
+
 INTERNAL void otrng_prekey_message_free(prekey_message_s *prekey_msg);
 
 INTERNAL otrng_result otrng_prekey_message_deserialize(prekey_message_s *dst,
@@ -77,6 +99,8 @@ INTERNAL otrng_result otrng_prekey_message_serialize_with_metadata(
 
 tstatic /*@notnull@*/ prekey_message_s *otrng_prekey_message_new(void);
 
+tstatic void generate_prekey_message(size_t index, void *context);
+
 #endif
 
 #endif
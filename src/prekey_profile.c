@@ -223,7 +223,7 @@ prekey_profile_body_serialize_into(uint8_t **dst, size_t *dst_len,
 }
 
 INTERNAL otrng_result otrng_prekey_profile_serialize(
-    uint8_t **dst, size_t *dst_len, otrng_prekey_profile_s *profile) {
+    uint8_t **dst, size_t *dst_len, const otrng_prekey_profile_s *profile) {
   size_t size = PREKEY_PROFILE_BODY_BYTES + ED448_SIGNATURE_BYTES;
   uint8_t *buffer = otrng_xmalloc_z(size);
   size_t written;
@@ -377,7 +377,7 @@ static otrng_bool prekey_profile_invalid(time_t expires,
   return difftime(expires + extra_valid_time, time(NULL)) <= 0;
 }
 
-tstatic otrng_bool otrng_prekey_profile_valid_without_expiry(
+INTERNAL otrng_bool otrng_prekey_profile_valid_without_expiry(
     const otrng_prekey_profile_s *profile, const uint32_t sender_instance_tag,
     const otrng_public_key pub) {
   /* 1. Verify that the Prekey Profile signature is valid. */
@@ -70,13 +70,21 @@ INTERNAL otrng_bool otrng_prekey_profile_valid(
     const otrng_prekey_profile_s *profile, const uint32_t sender_instance_tag,
     const otrng_public_key pub);
 
+/**
+ * @brief Checks everything otrng_prekey_profile_valid does, except for the
+ * expiration: the signature, the instance tag and the shared prekey.
+ */
+INTERNAL otrng_bool otrng_prekey_profile_valid_without_expiry(
+    const otrng_prekey_profile_s *profile, const uint32_t sender_instance_tag,
+    const otrng_public_key pub);
+
 INTERNAL otrng_bool otrng_prekey_profile_fast_valid(
     otrng_prekey_profile_s *profile, const uint32_t sender_instance_tag,
     const otrng_public_key pub);
 
-INTERNAL otrng_result otrng_prekey_profile_serialize(uint8_t **dst,
-                                                     size_t *dst_len,
-                                                     otrng_prekey_profile_s *p);
+INTERNAL otrng_result
+otrng_prekey_profile_serialize(uint8_t **dst, size_t *dst_len,
+                               const otrng_prekey_profile_s *p);
 
 INTERNAL otrng_result otrng_prekey_profile_deserialize(
     otrng_prekey_profile_s *target, const uint8_t *buffer, size_t buflen,
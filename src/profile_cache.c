@@ -0,0 +1,325 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#define OTRNG_PROFILE_CACHE_PRIVATE
+
+#include "alloc.h"
+#include "profile_cache.h"
+#include "serialize.h"
+#include "shake.h"
+
+#define PROFILE_CACHE_CLIENT_PROFILE 0x01
+#define PROFILE_CACHE_PREKEY_PROFILE 0x02
+
+static otrng_bool profile_expired(uint64_t expires) {
+  return difftime((time_t)expires, time(NULL)) <= 0;
+}
+
+INTERNAL void otrng_profile_cache_init(otrng_profile_cache_s *cache,
+                                       size_t capacity) {
+  memset(cache, 0, sizeof(otrng_profile_cache_s));
+  (void)pthread_mutex_init(&cache->lock, NULL);
+  otrng_hash_index_init(&cache->index);
+  otrng_profile_cache_resize(cache, capacity);
+}
+
+INTERNAL void otrng_profile_cache_destroy(otrng_profile_cache_s *cache) {
+  otrng_profile_cache_resize(cache, 0);
+  otrng_hash_index_destroy(&cache->index);
+  (void)pthread_mutex_destroy(&cache->lock);
+}
+
+static void profile_cache_reset(otrng_profile_cache_s *cache,
+                                size_t capacity) {
+  size_t i;
+
+  otrng_free(cache->entries);
+  cache->entries = NULL;
+  cache->capacity = 0;
+  cache->count = 0;
+  cache->oldest = 0;
+  cache->newest = 0;
+  cache->free_list = 0;
+
+  otrng_hash_index_destroy(&cache->index);
+  otrng_hash_index_init(&cache->index);
+
+  if (capacity > UINT32_MAX - 1) {
+    capacity = UINT32_MAX - 1;
+  }
+
+  if (capacity == 0) {
+    return;
+  }
+
+  cache->entries = otrng_xmalloc_z(capacity * sizeof(profile_cache_entry_s));
+  cache->capacity = capacity;
+
+  for (i = 0; i < capacity; i++) {
+    cache->entries[i].newer = i + 1 < capacity ? (uint32_t)(i + 2) : 0;
+  }
+  cache->free_list = 1;
+}
+
+INTERNAL void otrng_profile_cache_resize(otrng_profile_cache_s *cache,
+                                         size_t capacity) {
+  (void)pthread_mutex_lock(&cache->lock);
+  profile_cache_reset(cache, capacity);
+  (void)pthread_mutex_unlock(&cache->lock);
+}
+
+INTERNAL otrng_profile_cache_stats_s
+otrng_profile_cache_stats(const otrng_profile_cache_s *cache) {
+  /* The lock is not part of the value of the cache */
+  pthread_mutex_t *lock = (pthread_mutex_t *)&cache->lock;
+  otrng_profile_cache_stats_s stats;
+
+  (void)pthread_mutex_lock(lock);
+  stats = cache->stats;
+  (void)pthread_mutex_unlock(lock);
+
+  return stats;
+}
+
+static otrng_bool profile_cache_enabled(otrng_profile_cache_s *cache) {
+  otrng_bool enabled;
+
+  if (!cache) {
+    return otrng_false;
+  }
+
+  (void)pthread_mutex_lock(&cache->lock);
+  enabled = cache->capacity > 0;
+  (void)pthread_mutex_unlock(&cache->lock);
+
+  return enabled;
+}
+
+static profile_cache_entry_s *entry_at(const otrng_profile_cache_s *cache,
+                                       uint32_t position) {
+  return &cache->entries[position - 1];
+}
+
+static uint32_t position_of(const otrng_profile_cache_s *cache,
+                            const profile_cache_entry_s *entry) {
+  return (uint32_t)(entry - cache->entries) + 1;
+}
+
+static void unlink_entry(otrng_profile_cache_s *cache,
+                         profile_cache_entry_s *entry) {
+  if (entry->older) {
+    entry_at(cache, entry->older)->newer = entry->newer;
+  } else {
+    cache->oldest = entry->newer;
+  }
+
+  if (entry->newer) {
+    entry_at(cache, entry->newer)->older = entry->older;
+  } else {
+    cache->newest = entry->older;
+  }
+
+  entry->older = 0;
+  entry->newer = 0;
+}
+
+static void link_newest(otrng_profile_cache_s *cache,
+                        profile_cache_entry_s *entry) {
+  uint32_t position = position_of(cache, entry);
+
+  entry->older = cache->newest;
+  entry->newer = 0;
+
+  if (cache->newest) {
+    entry_at(cache, cache->newest)->newer = position;
+  } else {
+    cache->oldest = position;
+  }
+  cache->newest = position;
+}
+
+static int entry_matches(const void *item, const void *key) {
+  const profile_cache_entry_s *entry = item;
+  return memcmp(entry->key, key, HASH_BYTES) == 0;
+}
+
+tstatic otrng_bool profile_cache_lookup(otrng_profile_cache_s *cache,
+                                        otrng_bool *valid,
+                                        const uint8_t key[HASH_BYTES]) {
+  uint64_t hash;
+  profile_cache_entry_s *entry;
+
+  (void)pthread_mutex_lock(&cache->lock);
+  hash = otrng_hash_index_hash(&cache->index, 0, key, HASH_BYTES);
+  entry = otrng_hash_index_find(&cache->index, hash, entry_matches, key);
+
+  if (!entry) {
+    cache->stats.misses++;
+    (void)pthread_mutex_unlock(&cache->lock);
+    return otrng_false;
+  }
+
+  /* it is now the most recently used */
+  unlink_entry(cache, entry);
+  link_newest(cache, entry);
+
+  cache->stats.hits++;
+  *valid = entry->valid && !profile_expired(entry->expires);
+  (void)pthread_mutex_unlock(&cache->lock);
+
+  return otrng_true;
+}
+
+static void profile_cache_store(otrng_profile_cache_s *cache,
+                                const uint8_t key[HASH_BYTES],
+                                otrng_bool valid, uint64_t expires) {
+  profile_cache_entry_s *entry;
+
+  (void)pthread_mutex_lock(&cache->lock);
+
+  /* It may have been resized since it was looked up */
+  if (cache->capacity == 0) {
+    (void)pthread_mutex_unlock(&cache->lock);
+    return;
+  }
+
+  if (cache->free_list) {
+    entry = entry_at(cache, cache->free_list);
+    cache->free_list = entry->newer;
+    cache->count++;
+  } else {
+    entry = entry_at(cache, cache->oldest);
+    unlink_entry(cache, entry);
+    (void)otrng_hash_index_remove(&cache->index, entry->hash, entry);
+    cache->stats.evictions++;
+  }
+
+  memcpy(entry->key, key, HASH_BYTES);
+  entry->hash = otrng_hash_index_hash(&cache->index, 0, key, HASH_BYTES);
+  entry->valid = valid;
+  entry->expires = expires;
+
+  link_newest(cache, entry);
+  otrng_hash_index_add(&cache->index, entry->hash, entry);
+
+  (void)pthread_mutex_unlock(&cache->lock);
+}
+
+/* The key covers what the verdict depends on: the kind of profile, the
+ * instance tag and key it was checked against and every byte of it. */
+static otrng_result profile_cache_key(uint8_t key[HASH_BYTES], uint8_t kind,
+                                      uint32_t sender_instance_tag,
+                                      /*@null@*/ const otrng_public_key pub,
+                                      const uint8_t *ser, size_t ser_len) {
+  goldilocks_shake256_ctx_p hd;
+  uint8_t prefix[1 + 4 + ED448_POINT_BYTES];
+  size_t prefix_len = 0;
+
+  prefix[prefix_len++] = kind;
+  prefix_len +=
+      otrng_serialize_uint32(prefix + prefix_len, sender_instance_tag);
+
+  if (pub) {
+    if (!otrng_ec_point_encode(prefix + prefix_len, ED448_POINT_BYTES, pub)) {
+      return OTRNG_ERROR;
+    }
+    prefix_len += ED448_POINT_BYTES;
+  }
+
+  hash_init(hd);
+  if (hash_update(hd, prefix, prefix_len) == GOLDILOCKS_FAILURE ||
+      hash_update(hd, ser, ser_len) == GOLDILOCKS_FAILURE) {
+    hash_destroy(hd);
+    return OTRNG_ERROR;
+  }
+  hash_final(hd, key, HASH_BYTES);
+  hash_destroy(hd);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_bool otrng_profile_cache_client_profile_valid(
+    otrng_profile_cache_s *cache, const otrng_client_profile_s *profile,
+    uint32_t sender_instance_tag) {
+  uint8_t key[HASH_BYTES];
+  uint8_t *ser = NULL;
+  size_t ser_len = 0;
+  otrng_bool valid;
+
+  if (!profile_cache_enabled(cache)) {
+    return otrng_client_profile_valid(profile, sender_instance_tag);
+  }
+
+  if (!otrng_client_profile_serialize(&ser, &ser_len, profile)) {
+    return otrng_client_profile_valid(profile, sender_instance_tag);
+  }
+
+  if (!profile_cache_key(key, PROFILE_CACHE_CLIENT_PROFILE,
+                         sender_instance_tag, NULL, ser, ser_len)) {
+    otrng_free(ser);
+    return otrng_client_profile_valid(profile, sender_instance_tag);
+  }
+  otrng_free(ser);
+
+  if (!profile_cache_lookup(cache, &valid, key)) {
+    valid = otrng_client_profile_valid_without_expiry(profile,
+                                                      sender_instance_tag);
+    profile_cache_store(cache, key, valid, profile->expires);
+    valid = valid && !profile_expired(profile->expires);
+  }
+
+  return valid;
+}
+
+INTERNAL otrng_bool otrng_profile_cache_prekey_profile_valid(
+    otrng_profile_cache_s *cache, const otrng_prekey_profile_s *profile,
+    uint32_t sender_instance_tag, const otrng_public_key pub) {
+  uint8_t key[HASH_BYTES];
+  uint8_t *ser = NULL;
+  size_t ser_len = 0;
+  otrng_bool valid;
+
+  if (!profile_cache_enabled(cache)) {
+    return otrng_prekey_profile_valid(profile, sender_instance_tag, pub);
+  }
+
+  if (!otrng_prekey_profile_serialize(&ser, &ser_len, profile)) {
+    return otrng_prekey_profile_valid(profile, sender_instance_tag, pub);
+  }
+
+  if (!profile_cache_key(key, PROFILE_CACHE_PREKEY_PROFILE,
+                         sender_instance_tag, pub, ser, ser_len)) {
+    otrng_free(ser);
+    return otrng_prekey_profile_valid(profile, sender_instance_tag, pub);
+  }
+  otrng_free(ser);
+
+  if (!profile_cache_lookup(cache, &valid, key)) {
+    valid = otrng_prekey_profile_valid_without_expiry(
+        profile, sender_instance_tag, pub);
+    profile_cache_store(cache, key, valid, profile->expires);
+    valid = valid && !profile_expired(profile->expires);
+  }
+
+  return valid;
+}
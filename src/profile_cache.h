@@ -0,0 +1,161 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The cache is shared by all the clients of a global state, so it has its own
+ * lock, and the functions in this file can be called concurrently on the same
+ * cache. Its lock is never held while calling other parts of the library.
+ */
+
+#ifndef OTRNG_PROFILE_CACHE_H
+#define OTRNG_PROFILE_CACHE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "client_profile.h"
+#include "constants.h"
+#include "error.h"
+#include "hash_index.h"
+#include "keys.h"
+#include "prekey_profile.h"
+#include "shared.h"
+
+#define PROFILE_CACHE_DEFAULT_SIZE 256
+
+typedef struct otrng_profile_cache_stats_s {
+  uint64_t hits;      /* validations answered from the cache */
+  uint64_t misses;    /* validations that had to check the signatures */
+  uint64_t evictions; /* verdicts dropped to make room for newer ones */
+} otrng_profile_cache_stats_s;
+
+typedef struct profile_cache_entry_s {
+  /* hash of the serialized profile, and of what it was validated against */
+  uint8_t key[HASH_BYTES];
+  uint64_t hash; /* of the key, for the index */
+
+  otrng_bool valid; /* the verdict, not counting the expiration */
+  uint64_t expires;
+
+  uint32_t older; /* position + 1 of the previous entry in use order */
+  uint32_t newer; /* position + 1 of the next one, or in the free list */
+} profile_cache_entry_s;
+
+/*
+ * Verdicts on the peer profiles we have validated, so the same profile is not
+ * checked again every time it arrives: in every DAKE, and in every prekey
+ * ensemble we retrieve.
+ *
+ * Entries are kept in least recently used order, and the least recently used
+ * one is evicted when the cache is full. They are indexed by a hash of the
+ * serialized profile together with the instance tag (and, for prekey
+ * profiles, the long-term key) it was validated against. The expiration is
+ * always checked again, so only the signatures and the points are skipped.
+ */
+typedef struct otrng_profile_cache_s {
+  /*@null@*/ profile_cache_entry_s *entries;
+  size_t capacity;
+  size_t count;
+
+  uint32_t oldest; /* position + 1, or 0 when empty */
+  uint32_t newest;
+  uint32_t free_list;
+
+  hash_index_s index;
+
+  otrng_profile_cache_stats_s stats;
+
+  /* The conversations of all clients share the cache. Profiles are never
+     validated while holding it. */
+  pthread_mutex_t lock;
+} otrng_profile_cache_s;
+
+/**
+ * @brief Initializes an empty cache.
+ *
+ * @param [cache]     The cache.
+ * @param [capacity]  How many verdicts to keep. With 0, nothing is cached.
+ */
+INTERNAL void otrng_profile_cache_init(otrng_profile_cache_s *cache,
+                                       size_t capacity);
+
+/**
+ * @brief Frees the memory used by the cache.
+ *
+ * @param [cache]     The cache.
+ */
+INTERNAL void otrng_profile_cache_destroy(otrng_profile_cache_s *cache);
+
+/**
+ * @brief Drops every verdict and changes how many are kept. The statistics
+ * are kept.
+ *
+ * @param [cache]     The cache.
+ * @param [capacity]  How many verdicts to keep. With 0, nothing is cached.
+ */
+INTERNAL void otrng_profile_cache_resize(otrng_profile_cache_s *cache,
+                                         size_t capacity);
+
+/**
+ * @brief Returns how often verdicts were reused.
+ *
+ * @param [cache]     The cache.
+ */
+INTERNAL otrng_profile_cache_stats_s
+otrng_profile_cache_stats(const otrng_profile_cache_s *cache);
+
+/**
+ * @brief Validates a client profile received from a peer, like
+ * otrng_client_profile_valid, reusing the verdict for a profile that was
+ * already validated.
+ *
+ * @param [cache]                The cache, or NULL to always validate.
+ * @param [profile]              The profile.
+ * @param [sender_instance_tag]  The instance tag the profile was sent from.
+ */
+INTERNAL otrng_bool otrng_profile_cache_client_profile_valid(
+    /*@null@*/ otrng_profile_cache_s *cache,
+    const otrng_client_profile_s *profile, uint32_t sender_instance_tag);
+
+/**
+ * @brief Validates a prekey profile received from a peer, like
+ * otrng_prekey_profile_valid, reusing the verdict for a profile that was
+ * already validated.
+ *
+ * @param [cache]                The cache, or NULL to always validate.
+ * @param [profile]              The profile.
+ * @param [sender_instance_tag]  The instance tag the profile was sent from.
+ * @param [pub]                  The long-term key it must be signed with.
+ */
+INTERNAL otrng_bool otrng_profile_cache_prekey_profile_valid(
+    /*@null@*/ otrng_profile_cache_s *cache,
+    const otrng_prekey_profile_s *profile, uint32_t sender_instance_tag,
+    const otrng_public_key pub);
+
+#ifdef OTRNG_PROFILE_CACHE_PRIVATE
+
+tstatic otrng_bool profile_cache_lookup(otrng_profile_cache_s *cache,
+                                        otrng_bool *valid,
+                                        const uint8_t key[HASH_BYTES]);
+
+#endif
+
+#endif
@@ -173,7 +173,12 @@ generate_data_message(const otrng_s *otr, const uint32_t ratchet_id) {
   data_msg->ratchet_id = ratchet_id;
   data_msg->message_id = otr->keys->j;
   otrng_ec_point_copy(data_msg->ecdh, our_ecdh(otr));
-  data_msg->dh = otrng_dh_mpi_copy(our_dh(otr));
+
+  /* Our keys only change once per ratchet, and so does their encoding */
+  data_msg->keys_enc = otrng_key_manager_our_keys_enc(otr->keys);
+  if (!data_msg->keys_enc) {
+    data_msg->dh = otrng_dh_mpi_copy(our_dh(otr));
+  }
 
   return data_msg;
 }
@@ -265,11 +270,9 @@ tstatic otrng_result send_data_message(string_p *to_send, const uint8_t *msg,
   /* Authenticator = KDF_1(0x1A || MKmac || KDF_1(usage_authenticator ||
    * data_message_sections, 64), 64) */
   if (otr->keys->j == 0) {
-    size_t ser_mac_keys_len =
-        otrng_list_len(otr->keys->old_mac_keys) * MAC_KEY_BYTES;
+    size_t ser_mac_keys_len = otr->keys->old_mac_keys.len * MAC_KEY_BYTES;
     uint8_t *ser_mac_keys =
-        otrng_serialize_old_mac_keys(otr->keys->old_mac_keys);
-    otr->keys->old_mac_keys = NULL;
+        otrng_serialize_old_mac_keys(&otr->keys->old_mac_keys);
 
     if (!serialize_and_encode_data_message(to_send, mac_key, ser_mac_keys,
                                            ser_mac_keys_len, data_msg)) {
@@ -297,6 +300,121 @@ tstatic otrng_result send_data_message(string_p *to_send, const uint8_t *msg,
   return OTRNG_SUCCESS;
 }
 
+/* The buffer a batch of data messages is built in. It is reused for every
+   message, and only grows to fit the biggest one. */
+typedef struct send_scratch_s {
+  uint8_t *buffer;
+  size_t capacity;
+} send_scratch_s;
+
+static uint8_t *scratch_reserve(send_scratch_s *scratch, size_t len) {
+  if (len > scratch->capacity) {
+    /* It only holds plaintext while a message is encrypted, and that is
+       wiped right after */
+    scratch->buffer = otrng_xrealloc(scratch->buffer, len);
+    scratch->capacity = len;
+  }
+
+  return scratch->buffer;
+}
+
+tstatic otrng_result send_batched_data_message(string_p *to_send,
+                                               const char *msg,
+                                               data_message_s *data_msg,
+                                               send_scratch_s *scratch,
+                                               otrng_s *otr) {
+  size_t msg_len = strlen(msg) + 1;
+  size_t padding_len = otrng_padding_size(msg_len, otr);
+  size_t plain_len = msg_len + padding_len;
+  size_t reveal_len = 0, body_len, body_capacity;
+  uint8_t *reveal = NULL;
+  uint8_t *plain, *body, *enc_msg;
+  uint8_t actual_enc_key[ENC_ACTUAL_KEY_BYTES];
+  k_msg_enc enc_key;
+  k_msg_mac mac_key;
+  int err;
+
+  memset(enc_key, 0, ENC_KEY_BYTES);
+  memset(mac_key, 0, MAC_KEY_BYTES);
+
+  data_msg->message_id = otr->keys->j;
+
+  if (!otrng_key_manager_derive_chain_keys(
+          enc_key, mac_key, otr->keys, NULL, otr->client->max_stored_msg_keys,
+          0, 's', otr->client->global_state->callbacks)) {
+    return OTRNG_ERROR;
+  }
+
+  if (otr->keys->j == 0) {
+    reveal_len = otr->keys->old_mac_keys.len * MAC_KEY_BYTES;
+    reveal = otrng_serialize_old_mac_keys(&otr->keys->old_mac_keys);
+  }
+
+  /* The plaintext, followed by the serialized message */
+  body_capacity =
+      DATA_MSG_MAX_BYTES + plain_len + DATA_MSG_MAC_BYTES + reveal_len;
+  plain = scratch_reserve(scratch, plain_len + body_capacity);
+  body = plain + plain_len;
+
+  memcpy(plain, msg, msg_len);
+  if (padding_len) {
+    otrng_padding_serialize(plain + msg_len, padding_len);
+  }
+
+  /* Serialize the plaintext in place of the encrypted message, and encrypt it
+     where it landed */
+  random_bytes(data_msg->nonce, DATA_MSG_NONCE_BYTES);
+  data_msg->enc_msg = plain;
+  data_msg->enc_msg_len = plain_len;
+  body_len = otrng_data_message_body_serialize_into(body, body_capacity,
+                                                    data_msg);
+  data_msg->enc_msg = NULL;
+  data_msg->enc_msg_len = 0;
+  otrng_secure_wipe(plain, plain_len);
+
+  if (!body_len) {
+    otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
+    otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
+    otrng_free(reveal);
+    return OTRNG_ERROR;
+  }
+
+  enc_msg = body + body_len - plain_len;
+  memcpy(actual_enc_key, enc_key, ENC_ACTUAL_KEY_BYTES);
+  err = crypto_stream_xor(enc_msg, enc_msg, plain_len, data_msg->nonce,
+                          actual_enc_key);
+  otrng_secure_wipe(actual_enc_key, ENC_ACTUAL_KEY_BYTES);
+  otrng_secure_wipe(enc_key, ENC_KEY_BYTES);
+
+  if (err) {
+    otrng_secure_wipe(enc_msg, plain_len);
+    otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
+    otrng_free(reveal);
+    return OTRNG_ERROR;
+  }
+
+  if (otrng_failed(otrng_data_message_authenticator(
+          body + body_len, MAC_KEY_BYTES, mac_key, body, body_len))) {
+    otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
+    otrng_free(reveal);
+    return OTRNG_ERROR;
+  }
+
+  otrng_secure_wipe(mac_key, MAC_KEY_BYTES);
+
+  if (reveal) {
+    memcpy(body + body_len + DATA_MSG_MAC_BYTES, reveal, reveal_len);
+    otrng_free(reveal);
+  }
+
+  *to_send =
+      otrl_base64_otr_encode(body, body_len + DATA_MSG_MAC_BYTES + reveal_len);
+
+  otr->keys->j++;
+
+  return OTRNG_SUCCESS;
+}
+
 tstatic otrng_result serialize_tlvs(uint8_t **dst, size_t *dst_len,
                                     const tlv_list_s *tlvs) {
   const tlv_list_s *current = tlvs;
@@ -404,3 +522,80 @@ INTERNAL otrng_result otrng_prepare_to_send_data_message(string_p *to_send,
 
   return OTRNG_SUCCESS;
 }
+
+INTERNAL otrng_result otrng_prepare_to_send_data_messages(
+    string_p *to_send, size_t *sent, const char *const *msgs, size_t count,
+    otrng_s *otr, unsigned char flags) {
+  data_message_s *data_msg = NULL;
+  send_scratch_s scratch;
+  otrng_result result = OTRNG_SUCCESS;
+  size_t i;
+
+  *sent = 0;
+
+  if (otr->state == OTRNG_STATE_FINISHED) {
+    otrng_client_callbacks_handle_event(otr->client->global_state->callbacks,
+                                        OTRNG_MSG_EVENT_CONNECTION_ENDED);
+    return OTRNG_ERROR; /* Should restart */
+  }
+
+  if (otr->state != OTRNG_STATE_ENCRYPTED_MESSAGES) {
+    otrng_client_callbacks_handle_event(
+        otr->client->global_state->callbacks,
+        OTRNG_MSG_EVENT_SENDING_NOT_IN_ENCRYPTED_STATE);
+    return OTRNG_ERROR;
+  }
+
+  memset(to_send, 0, count * sizeof(string_p));
+  memset(&scratch, 0, sizeof(send_scratch_s));
+
+  for (i = 0; i < count; i++) {
+    uint32_t ratchet_id = otr->keys->i;
+
+    if (!msgs[i]) {
+      result = OTRNG_ERROR;
+      break;
+    }
+
+    /* Only the first message can start a new ratchet */
+    if (!otrng_key_manager_derive_dh_ratchet_keys(
+            otr->keys, otr->client->max_stored_msg_keys, NULL, NULL, 0, 's',
+            otr->client->global_state->callbacks)) {
+      result = OTRNG_ERROR;
+      break;
+    }
+
+    /* The keys in the header stay the same for the whole batch */
+    if (!data_msg) {
+      data_msg = generate_data_message(otr, ratchet_id);
+      data_msg->flags = flags;
+    }
+
+    data_msg->ratchet_id = ratchet_id;
+    data_msg->previous_chain_n = otr->keys->pn;
+
+    result = send_batched_data_message(to_send + i, msgs[i], data_msg,
+                                       &scratch, otr);
+    if (otrng_failed(result)) {
+      break;
+    }
+  }
+
+  otrng_data_message_free(data_msg);
+  otrng_free(scratch.buffer);
+
+  /* The messages before the one that failed used up their keys, so they are
+     handed out to be sent anyway */
+  *sent = i;
+  if (*sent) {
+    otr->last_sent = time(NULL);
+  }
+
+  if (otrng_failed(result)) {
+    otrng_client_callbacks_handle_event(otr->client->global_state->callbacks,
+                                        OTRNG_MSG_EVENT_ENCRYPTION_ERROR);
+    return OTRNG_ERROR;
+  }
+
+  return OTRNG_SUCCESS;
+}
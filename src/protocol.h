@@ -29,9 +29,11 @@
 #define OTRNG_PROTOCOL_H
 
 #include "client_profile.h"
+#include "fragment.h"
 #include "key_management.h"
 #include "prekey_profile.h"
 #include "smp_protocol.h"
+#include "timers.h"
 #include "v3.h"
 
 typedef enum {
@@ -92,7 +94,8 @@ typedef struct otrng_s {
   key_manager_s *keys;
   smp_protocol_s *smp;
 
-  list_element_s *pending_fragments;
+  fragment_store_s pending_fragments;
+  otrng_timer_s fragments_timer; /* when the oldest pending fragments expire */
 
   time_t last_sent; // TODO: @refactoring not sure if the best place to put
 
@@ -125,6 +128,26 @@ INTERNAL otrng_result otrng_prepare_to_send_data_message(string_p *to_send,
                                                          otrng_s *otr,
                                                          unsigned char flags);
 
+/**
+ * @brief Encrypts several messages, in order, into consecutive data messages.
+ * The chain keys are derived one after the other, and the messages are built
+ * in a buffer shared by the whole batch.
+ *
+ * If a message fails, the ones after it are not encrypted. The ones before it
+ * have used up their keys, so they are still returned and have to be sent.
+ *
+ * @param [to_send] An array of [count] messages to send. Only the first
+ *                  [sent] are set, the others are NULL.
+ * @param [sent]    How many messages were encrypted.
+ * @param [msgs]    The [count] messages to encrypt.
+ * @param [count]   The number of messages.
+ * @param [otr]     The protocol state.
+ * @param [flags]   The flags of every data message.
+ */
+INTERNAL otrng_result otrng_prepare_to_send_data_messages(
+    string_p *to_send, size_t *sent, const char *const *msgs, size_t count,
+    otrng_s *otr, unsigned char flags);
+
 INTERNAL void otrng_error_message(string_p *to_send, otrng_err_code err_code);
 
 #ifdef OTRNG_PROTOCOL_PRIVATE
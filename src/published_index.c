@@ -0,0 +1,134 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "alloc.h"
+#include "hash_index.h"
+#include "published_index.h"
+
+#ifndef S_SPLINT_S
+#include <gcrypt.h>
+#endif
+
+#define PUBLISHED_INDEX_MIN_CAPACITY 16
+
+INTERNAL void otrng_published_index_init(published_index_s *index) {
+  memset(index, 0, sizeof(published_index_s));
+  gcry_create_nonce(index->hash_key, crypto_shorthash_KEYBYTES);
+}
+
+static void table_free(published_index_table_s *table) {
+  otrng_free(table->hashes);
+  otrng_free(table->items);
+  otrng_free(table);
+}
+
+INTERNAL void otrng_published_index_destroy(published_index_s *index) {
+  published_index_table_s *table = index->table;
+
+  while (table) {
+    published_index_table_s *previous = table->previous;
+
+    table_free(table);
+    table = previous;
+  }
+
+  index->table = NULL;
+  index->count = 0;
+}
+
+INTERNAL uint64_t otrng_published_index_hash(const published_index_s *index,
+                                             uint64_t seed, const void *data,
+                                             size_t len) {
+  return otrng_keyed_hash(index->hash_key, seed, data, len);
+}
+
+static void insert_bucket(published_index_table_s *table, uint64_t hash,
+                          void *item) {
+  size_t bucket = hash & table->mask;
+
+  while (table->items[bucket]) {
+    bucket = (bucket + 1) & table->mask;
+  }
+
+  table->hashes[bucket] = hash;
+  __atomic_store_n(&table->items[bucket], item, __ATOMIC_RELEASE);
+}
+
+static void published_index_grow(published_index_s *index) {
+  published_index_table_s *old = index->table;
+  size_t old_capacity = old ? old->mask + 1 : 0;
+  size_t capacity =
+      old_capacity ? old_capacity * 2 : (size_t)PUBLISHED_INDEX_MIN_CAPACITY;
+  published_index_table_s *table =
+      otrng_xmalloc_z(sizeof(published_index_table_s));
+  size_t i;
+
+  table->mask = capacity - 1;
+  table->hashes = otrng_xmalloc_z(capacity * sizeof(uint64_t));
+  table->items = otrng_xmalloc_z(capacity * sizeof(void *));
+  table->previous = old;
+
+  for (i = 0; i < old_capacity; i++) {
+    if (old->items[i]) {
+      insert_bucket(table, old->hashes[i], old->items[i]);
+    }
+  }
+
+  /* Readers still on the old table find everything that was in it */
+  __atomic_store_n(&index->table, table, __ATOMIC_RELEASE);
+}
+
+INTERNAL void otrng_published_index_add(published_index_s *index,
+                                        uint64_t hash, void *item) {
+  /* Keep the load under 1/2, as the table is never cleaned up */
+  if (!index->table || (index->count + 1) * 2 > index->table->mask + 1) {
+    published_index_grow(index);
+  }
+
+  insert_bucket(index->table, hash, item);
+  index->count++;
+}
+
+INTERNAL void *
+otrng_published_index_find(const published_index_s *index, uint64_t hash,
+                           int (*matches)(const void *item, const void *key),
+                           const void *key) {
+  const published_index_table_s *table =
+      __atomic_load_n(&index->table, __ATOMIC_ACQUIRE);
+  size_t bucket;
+  void *item;
+
+  if (!table) {
+    return NULL;
+  }
+
+  bucket = hash & table->mask;
+  while ((item = __atomic_load_n(&table->items[bucket], __ATOMIC_ACQUIRE))) {
+    if (table->hashes[bucket] == hash && matches(item, key)) {
+      return item;
+    }
+
+    bucket = (bucket + 1) & table->mask;
+  }
+
+  return NULL;
+}
@@ -0,0 +1,114 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * An index that can be read from any thread without locks while one thread at
+ * a time adds to it. Nothing is ever removed, and the tables that were
+ * outgrown are kept until the index is destroyed, so a reader never sees
+ * memory being freed under it.
+ */
+
+#ifndef OTRNG_PUBLISHED_INDEX_H
+#define OTRNG_PUBLISHED_INDEX_H
+
+#include <sodium.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "shared.h"
+
+typedef struct published_index_table_s {
+  size_t mask;
+  uint64_t *hashes;
+  /* an item is published after its hash, and NULL is an empty bucket */
+  void **items;
+
+  /* the table this one replaced */
+  /*@null@*/ struct published_index_table_s *previous;
+} published_index_table_s;
+
+/*
+ * An open addressing table (linear probing) of items owned by some other
+ * collection, like hash_index_s. Readers load the current table, and the
+ * items in it, with acquire semantics. When it grows, the new table is filled
+ * in before it is published.
+ */
+typedef struct published_index_s {
+  /*@null@*/ published_index_table_s *table;
+  size_t count;
+
+  uint8_t hash_key[crypto_shorthash_KEYBYTES];
+} published_index_s;
+
+/**
+ * @brief Initializes an empty index.
+ *
+ * @param [index]   The index.
+ */
+INTERNAL void otrng_published_index_init(published_index_s *index);
+
+/**
+ * @brief Frees the memory used by the index, but not the items in it. No
+ * reader may be using it.
+ *
+ * @param [index]   The index.
+ */
+INTERNAL void otrng_published_index_destroy(published_index_s *index);
+
+/**
+ * @brief Hashes a part of a key, like otrng_hash_index_hash().
+ *
+ * @param [index]   The index.
+ * @param [seed]    The hash of the previous parts, or 0.
+ * @param [data]    The data to hash.
+ * @param [len]     The length of the data.
+ */
+INTERNAL uint64_t otrng_published_index_hash(const published_index_s *index,
+                                             uint64_t seed, const void *data,
+                                             size_t len);
+
+/**
+ * @brief Adds the item to the index. Calls to this function must be
+ * serialized by the caller, but do not need to be with lookups.
+ *
+ * @param [index]   The index.
+ * @param [hash]    The hash of the item's key.
+ * @param [item]    The item.
+ */
+INTERNAL void otrng_published_index_add(published_index_s *index,
+                                        uint64_t hash, void *item);
+
+/**
+ * @brief Finds an item that matches the key. It can be called from any
+ * thread.
+ *
+ * @param [index]   The index.
+ * @param [hash]    The hash of the key.
+ * @param [matches] Returns non-zero if the item matches the key.
+ * @param [key]     The key.
+ *
+ * @return The first item found, or NULL.
+ */
+INTERNAL /*@null@*/ void *
+otrng_published_index_find(const published_index_s *index, uint64_t hash,
+                           int (*matches)(const void *item, const void *key),
+                           const void *key);
+
+#endif
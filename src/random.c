@@ -22,15 +22,15 @@
 
 #include "random.h"
 
+/* Read on every call to random_bytes, from any thread */
 static /*@null@*/ random_bytes_generator otrng_global_randomness = NULL;
 
 random_bytes_generator otrng_get_current_randomness(void) {
-  return otrng_global_randomness;
+  return __atomic_load_n(&otrng_global_randomness, __ATOMIC_ACQUIRE);
 }
 
 random_bytes_generator
 otrng_set_current_randomness(random_bytes_generator new_randomness) {
-  random_bytes_generator old = otrng_global_randomness;
-  otrng_global_randomness = new_randomness;
-  return old;
+  return __atomic_exchange_n(&otrng_global_randomness, new_randomness,
+                             __ATOMIC_ACQ_REL);
 }
@@ -175,26 +175,25 @@ INTERNAL size_t otrng_serialize_ring_sig(uint8_t *dst,
 }
 
 /*@null@*/ INTERNAL uint8_t *
-otrng_serialize_old_mac_keys(list_element_s *old_mac_keys) {
-  size_t num_mac_keys = otrng_list_len(old_mac_keys);
-  size_t serlen = num_mac_keys * MAC_KEY_BYTES;
+otrng_serialize_old_mac_keys(list_s *old_mac_keys) {
+  size_t serlen = old_mac_keys->len * MAC_KEY_BYTES;
   uint8_t *ser_mac_keys;
-  unsigned int i;
+  uint8_t *cursor;
+  const list_element_s *current;
 
   if (serlen == 0) {
     return NULL;
   }
 
   ser_mac_keys = otrng_xmalloc(serlen);
+  cursor = ser_mac_keys;
 
-  for (i = 0; i < num_mac_keys; i++) {
-    list_element_s *last = otrng_list_get_last(old_mac_keys);
-    memcpy(ser_mac_keys + i * MAC_KEY_BYTES, last->data, MAC_KEY_BYTES);
-    old_mac_keys = otrng_list_remove_element(last, old_mac_keys);
-    otrng_list_free(last, otrng_secure_free);
+  for (current = old_mac_keys->head; current; current = current->next) {
+    memcpy(cursor, current->data, MAC_KEY_BYTES);
+    cursor += MAC_KEY_BYTES;
   }
 
-  otrng_list_free_nodes(old_mac_keys);
+  otrng_list_clear(old_mac_keys, otrng_secure_free);
 
   return ser_mac_keys;
 }
@@ -94,10 +94,13 @@ INTERNAL size_t otrng_serialize_shared_prekey(
 /**
  * @brief Serialize the old mac keys to reveal.
  *
+ * The keys are serialized in the order they are in the list, and the list
+ * will be empty afterwards.
+ *
  * @param [old_mac_keys]   The list of old mac keys.
  */
 /*@null@*/ INTERNAL uint8_t *
-otrng_serialize_old_mac_keys(list_element_s *old_mac_keys);
+otrng_serialize_old_mac_keys(list_s *old_mac_keys);
 
 INTERNAL size_t otrng_serialize_phi(uint8_t *dst,
                                     const char *shared_session_state,
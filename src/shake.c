@@ -20,24 +20,31 @@
 
 #include <string.h>
 
+#include "keccak.h"
 #include "shake.h"
 
-tstatic otrng_result hash_init_with_dom(goldilocks_shake256_ctx_p hd) {
-  const char *domain = "OTRv4";
+/* All the usage IDs defined by the spec are below this */
+#define SHAKE_PREFIX_USAGES 0x20
 
-  hash_init(hd);
-  if (hash_update(hd, (const unsigned char *)domain, strlen(domain)) ==
-      GOLDILOCKS_FAILURE) {
-    hash_destroy(hd);
-    return OTRNG_ERROR;
-  }
+/* The longest prefix shake_256_kdf1_lanes hands to the parallel lanes */
+#define SHAKE_LANES_MAX_PREFIX 64
 
-  return OTRNG_SUCCESS;
-}
+static const char *otrv4_domain = "OTRv4";
+static const char *prekey_server_domain = "OTR-Prekey-Server";
 
-otrng_result
-hash_init_with_usage_and_domain_separation(goldilocks_shake256_ctx_p hd,
-                                           uint8_t usage, const char *domain) {
+/*
+ * Every KDF starts by absorbing the same few bytes: the domain and the usage
+ * ID. These sponges have them already absorbed, and are copied from instead.
+ * They are only written by otrng_shake_init, and only hold public data.
+ */
+static goldilocks_shake256_ctx_p otrv4_prefix;
+static goldilocks_shake256_ctx_p otrv4_usage_prefixes[SHAKE_PREFIX_USAGES];
+static goldilocks_shake256_ctx_p
+    prekey_server_usage_prefixes[SHAKE_PREFIX_USAGES];
+static otrng_bool prefixes_ready = otrng_false;
+
+static otrng_result absorb_prefix(goldilocks_shake256_ctx_p hd,
+                                  const char *domain, const uint8_t *usage) {
   hash_init(hd);
   if (hash_update(hd, (const uint8_t *)domain, strlen(domain)) ==
       GOLDILOCKS_FAILURE) {
@@ -45,7 +52,7 @@ hash_init_with_usage_and_domain_separation(goldilocks_shake256_ctx_p hd,
     return OTRNG_ERROR;
   }
 
-  if (hash_update(hd, &usage, 1) == GOLDILOCKS_FAILURE) {
+  if (usage && hash_update(hd, usage, 1) == GOLDILOCKS_FAILURE) {
     hash_destroy(hd);
     return OTRNG_ERROR;
   }
@@ -53,23 +60,62 @@ hash_init_with_usage_and_domain_separation(goldilocks_shake256_ctx_p hd,
   return OTRNG_SUCCESS;
 }
 
-static otrng_result
-hash_init_with_usage_prekey_server(goldilocks_shake256_ctx_p hash,
-                                   uint8_t usage) {
-  const char *domain = "OTR-Prekey-Server";
-  if (!hash_init_with_usage_and_domain_separation(hash, usage, domain)) {
+otrng_result otrng_shake_init(void) {
+  uint8_t usage;
+
+  if (prefixes_ready) {
+    return OTRNG_SUCCESS;
+  }
+
+  if (!absorb_prefix(otrv4_prefix, otrv4_domain, NULL)) {
     return OTRNG_ERROR;
   }
 
+  for (usage = 0; usage < SHAKE_PREFIX_USAGES; usage++) {
+    if (!absorb_prefix(otrv4_usage_prefixes[usage], otrv4_domain, &usage)) {
+      return OTRNG_ERROR;
+    }
+
+    if (!absorb_prefix(prekey_server_usage_prefixes[usage],
+                       prekey_server_domain, &usage)) {
+      return OTRNG_ERROR;
+    }
+  }
+
+  prefixes_ready = otrng_true;
+
   return OTRNG_SUCCESS;
 }
 
-otrng_result hash_init_with_usage(goldilocks_shake256_ctx_p hd, uint8_t usage) {
-  if (!hash_init_with_dom(hd)) {
-    return OTRNG_ERROR;
+static /*@null@*/ const struct goldilocks_shake256_ctx_s *
+find_prefix(uint8_t usage, const char *domain) {
+  if (!prefixes_ready || usage >= SHAKE_PREFIX_USAGES) {
+    return NULL;
   }
 
-  if (hash_update(hd, &usage, 1) == GOLDILOCKS_FAILURE) {
+  if (domain == otrv4_domain || strcmp(domain, otrv4_domain) == 0) {
+    return otrv4_usage_prefixes[usage];
+  }
+
+  if (domain == prekey_server_domain ||
+      strcmp(domain, prekey_server_domain) == 0) {
+    return prekey_server_usage_prefixes[usage];
+  }
+
+  return NULL;
+}
+
+tstatic otrng_result hash_init_with_dom(goldilocks_shake256_ctx_p hd) {
+  const char *domain = otrv4_domain;
+
+  if (prefixes_ready) {
+    memcpy(hd, otrv4_prefix, sizeof(goldilocks_shake256_ctx_p));
+    return OTRNG_SUCCESS;
+  }
+
+  hash_init(hd);
+  if (hash_update(hd, (const unsigned char *)domain, strlen(domain)) ==
+      GOLDILOCKS_FAILURE) {
     hash_destroy(hd);
     return OTRNG_ERROR;
   }
@@ -77,6 +123,34 @@ otrng_result hash_init_with_usage(goldilocks_shake256_ctx_p hd, uint8_t usage) {
   return OTRNG_SUCCESS;
 }
 
+otrng_result
+hash_init_with_usage_and_domain_separation(goldilocks_shake256_ctx_p hd,
+                                           uint8_t usage, const char *domain) {
+  const struct goldilocks_shake256_ctx_s *prefix = find_prefix(usage, domain);
+
+  if (prefix) {
+    memcpy(hd, prefix, sizeof(goldilocks_shake256_ctx_p));
+    return OTRNG_SUCCESS;
+  }
+
+  return absorb_prefix(hd, domain, &usage);
+}
+
+static otrng_result
+hash_init_with_usage_prekey_server(goldilocks_shake256_ctx_p hash,
+                                   uint8_t usage) {
+  if (!hash_init_with_usage_and_domain_separation(hash, usage,
+                                                  prekey_server_domain)) {
+    return OTRNG_ERROR;
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+otrng_result hash_init_with_usage(goldilocks_shake256_ctx_p hd, uint8_t usage) {
+  return hash_init_with_usage_and_domain_separation(hd, usage, otrv4_domain);
+}
+
 otrng_result shake_kkdf(uint8_t *dst, size_t dst_len, const uint8_t *key,
                         size_t key_len, const uint8_t *secret,
                         size_t secret_len) {
@@ -121,6 +195,48 @@ otrng_result shake_256_kdf1(uint8_t *dst, size_t dst_len, uint8_t usage,
   return OTRNG_SUCCESS;
 }
 
+otrng_result shake_256_kdf1_lanes(uint8_t *const *dst, size_t dst_len,
+                                  uint8_t usage, const uint8_t *prefix,
+                                  size_t prefix_len,
+                                  const uint8_t *const *values,
+                                  size_t values_len, size_t count) {
+  uint8_t head[SHAKE_LANES_MAX_PREFIX];
+  size_t domain_len = strlen(otrv4_domain);
+  goldilocks_shake256_ctx_p hd;
+  size_t i;
+
+  if (count > 1 && otrng_keccak_lanes() > 1 &&
+      domain_len + 1 + prefix_len <= sizeof(head)) {
+    memcpy(head, otrv4_domain, domain_len);
+    head[domain_len] = usage;
+    if (prefix_len > 0) {
+      memcpy(head + domain_len + 1, prefix, prefix_len);
+    }
+
+    return otrng_shake_256_lanes(dst, dst_len, head,
+                                 domain_len + 1 + prefix_len, values,
+                                 values_len, count);
+  }
+
+  for (i = 0; i < count; i++) {
+    if (!hash_init_with_usage(hd, usage)) {
+      return OTRNG_ERROR;
+    }
+
+    if ((prefix_len > 0 &&
+         hash_update(hd, prefix, prefix_len) == GOLDILOCKS_FAILURE) ||
+        hash_update(hd, values[i], values_len) == GOLDILOCKS_FAILURE) {
+      hash_destroy(hd);
+      return OTRNG_ERROR;
+    }
+
+    hash_final(hd, dst[i], dst_len);
+    hash_destroy(hd);
+  }
+
+  return OTRNG_SUCCESS;
+}
+
 otrng_result shake_256_prekey_server_kdf(uint8_t *dst, size_t dst_len,
                                          uint8_t usage, const uint8_t *values,
                                          size_t values_len) {
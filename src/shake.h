@@ -20,7 +20,8 @@
 
 /**
  * The functions in this file only operate on their arguments, and doesn't touch
- * any global state. It is safe to call these functions concurrently from
+ * any global state other than the table filled by otrng_shake_init, which is
+ * read-only afterwards. It is safe to call these functions concurrently from
  * different threads, as long as arguments pointing to the same memory areas are
  * not used from different threads.
  */
@@ -38,6 +39,14 @@
 #define hash_destroy goldilocks_shake256_destroy
 #define hash_hash goldilocks_shake256_hash
 
+/**
+ * @brief Absorbs, once, the domain and usage ID prefixes all the KDFs start
+ * with, so they can be copied instead of absorbed again. It is called by
+ * otrng_init, before any other thread can use the library. The KDFs work the
+ * same (only slower) if it has not been called.
+ */
+otrng_result otrng_shake_init(void);
+
 otrng_result
 hash_init_with_usage_and_domain_separation(goldilocks_shake256_ctx_p hash,
                                            uint8_t usage, const char *domain);
@@ -53,6 +62,15 @@ otrng_result shake_kkdf(uint8_t *dst, size_t dst_len, const uint8_t *key,
 otrng_result shake_256_kdf1(uint8_t *dst, size_t dst_len, uint8_t usage,
                             const uint8_t *values, size_t values_len);
 
+/* dst[i] = KDF_1("OTRv4" || usageID || prefix || values[i], len) for every
+ * i < count. [prefix] is short, and the same for every input. The values are
+ * hashed in parallel lanes when the CPU can (see keccak.h). */
+otrng_result shake_256_kdf1_lanes(uint8_t *const *dst, size_t dst_len,
+                                  uint8_t usage, const uint8_t *prefix,
+                                  size_t prefix_len,
+                                  const uint8_t *const *values,
+                                  size_t values_len, size_t count);
+
 /* KDF_1("OTR-Prekey-Server" || usageID || values, len) */
 otrng_result shake_256_prekey_server_kdf(uint8_t *dst, size_t dst_len,
                                          uint8_t usage, const uint8_t *values,
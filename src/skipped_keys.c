@@ -0,0 +1,376 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#define OTRNG_SKIPPED_KEYS_PRIVATE
+
+#include "alloc.h"
+#include "skipped_keys.h"
+
+#define SKIPPED_KEYS_NONE UINT32_MAX
+#define SKIPPED_KEYS_MIN_CAPACITY 16
+
+INTERNAL skipped_keys_store_s *otrng_skipped_keys_new(void) {
+  skipped_keys_store_s *store =
+      otrng_secure_alloc(sizeof(skipped_keys_store_s));
+
+  store->oldest = SKIPPED_KEYS_NONE;
+  store->newest = SKIPPED_KEYS_NONE;
+  store->free_list = SKIPPED_KEYS_NONE;
+  otrng_hash_index_init(&store->index);
+
+  return store;
+}
+
+INTERNAL void otrng_skipped_keys_free(skipped_keys_store_s *store) {
+  if (!store) {
+    return;
+  }
+
+  if (store->entries) {
+    otrng_secure_wipe(store->entries,
+                      store->capacity * sizeof(skipped_keys_s));
+    otrng_secure_free(store->entries);
+  }
+
+  otrng_hash_index_destroy(&store->index);
+  otrng_ec_point_destroy(store->last_ecdh);
+
+  otrng_secure_wipe(store, sizeof(skipped_keys_store_s));
+  otrng_secure_free(store);
+}
+
+INTERNAL size_t otrng_skipped_keys_size(const skipped_keys_store_s *store) {
+  if (!store) {
+    return 0;
+  }
+
+  return store->count;
+}
+
+static otrng_result encode_their_ecdh(uint8_t enc[ED448_POINT_BYTES],
+                                      skipped_keys_store_s *store,
+                                      const ec_point their_ecdh) {
+  if (store->has_last_ecdh &&
+      otrng_ec_point_eq(store->last_ecdh, their_ecdh)) {
+    memcpy(enc, store->last_ecdh_enc, ED448_POINT_BYTES);
+    return OTRNG_SUCCESS;
+  }
+
+  if (!otrng_ec_point_encode(enc, ED448_POINT_BYTES, their_ecdh)) {
+    return OTRNG_ERROR;
+  }
+
+  otrng_ec_point_copy(store->last_ecdh, their_ecdh);
+  memcpy(store->last_ecdh_enc, enc, ED448_POINT_BYTES);
+  store->has_last_ecdh = otrng_true;
+
+  return OTRNG_SUCCESS;
+}
+
+/* What an entry is looked up by */
+typedef struct skipped_keys_id_s {
+  const uint8_t *their_ecdh;
+  uint32_t k;
+} skipped_keys_id_s;
+
+static uint64_t hash_entry(const skipped_keys_store_s *store,
+                           const uint8_t their_ecdh[ED448_POINT_BYTES],
+                           uint32_t k) {
+  uint8_t buffer[ED448_POINT_BYTES + 4];
+
+  memcpy(buffer, their_ecdh, ED448_POINT_BYTES);
+  buffer[ED448_POINT_BYTES] = (uint8_t)(k >> 24);
+  buffer[ED448_POINT_BYTES + 1] = (uint8_t)(k >> 16);
+  buffer[ED448_POINT_BYTES + 2] = (uint8_t)(k >> 8);
+  buffer[ED448_POINT_BYTES + 3] = (uint8_t)k;
+
+  return otrng_hash_index_hash(&store->index, 0, buffer, sizeof(buffer));
+}
+
+static int entry_matches(const void *item, const void *key) {
+  const skipped_keys_s *entry = item;
+  const skipped_keys_id_s *id = key;
+
+  return entry->k == id->k &&
+         memcmp(entry->their_ecdh, id->their_ecdh, ED448_POINT_BYTES) == 0;
+}
+
+static /*@null@*/ skipped_keys_s *
+find_entry(const skipped_keys_store_s *store,
+           const uint8_t their_ecdh[ED448_POINT_BYTES], uint32_t k,
+           uint64_t hash) {
+  skipped_keys_id_s id;
+
+  id.their_ecdh = their_ecdh;
+  id.k = k;
+
+  return otrng_hash_index_find(&store->index, hash, entry_matches, &id);
+}
+
+static void remove_entry(skipped_keys_store_s *store, skipped_keys_s *entry) {
+  uint32_t pos = (uint32_t)(entry - store->entries);
+
+  (void)otrng_hash_index_remove(&store->index, entry->hash, entry);
+
+  if (entry->older != SKIPPED_KEYS_NONE) {
+    store->entries[entry->older].newer = entry->newer;
+  } else {
+    store->oldest = entry->newer;
+  }
+
+  if (entry->newer != SKIPPED_KEYS_NONE) {
+    store->entries[entry->newer].older = entry->older;
+  } else {
+    store->newest = entry->older;
+  }
+
+  otrng_secure_wipe(entry, sizeof(skipped_keys_s));
+  entry->newer = store->free_list;
+  store->free_list = pos;
+
+  store->count--;
+}
+
+static void remove_oldest(skipped_keys_store_s *store) {
+  remove_entry(store, &store->entries[store->oldest]);
+}
+
+tstatic otrng_result skipped_keys_grow(skipped_keys_store_s *store,
+                                       size_t max_stored) {
+  size_t capacity = store->capacity * 2;
+  skipped_keys_s *entries;
+  uint32_t pos;
+
+  if (capacity < SKIPPED_KEYS_MIN_CAPACITY) {
+    capacity = SKIPPED_KEYS_MIN_CAPACITY;
+  }
+
+  if (capacity > max_stored) {
+    capacity = max_stored;
+  }
+
+  if (capacity >= SKIPPED_KEYS_NONE) {
+    return OTRNG_ERROR;
+  }
+
+  entries = otrng_secure_alloc_array(capacity, sizeof(skipped_keys_s));
+  memset(entries, 0, capacity * sizeof(skipped_keys_s));
+
+  if (store->entries) {
+    memcpy(entries, store->entries, store->capacity * sizeof(skipped_keys_s));
+    otrng_secure_wipe(store->entries,
+                      store->capacity * sizeof(skipped_keys_s));
+    otrng_secure_free(store->entries);
+  }
+
+  /* The new positions are pushed to the free list in reverse, so they get
+   * used in order */
+  for (pos = capacity; pos > store->capacity; pos--) {
+    entries[pos - 1].newer = store->free_list;
+    store->free_list = pos - 1;
+  }
+
+  store->entries = entries;
+  store->capacity = capacity;
+
+  /* The entries moved. The hashes stay the same, as the index keeps its key */
+  otrng_hash_index_destroy(&store->index);
+  for (pos = store->oldest; pos != SKIPPED_KEYS_NONE;
+       pos = store->entries[pos].newer) {
+    otrng_hash_index_add(&store->index, store->entries[pos].hash,
+                         &store->entries[pos]);
+  }
+
+  return OTRNG_SUCCESS;
+}
+
+static otrng_result
+add_entry(skipped_keys_store_s *store,
+          const uint8_t ecdh_enc[ED448_POINT_BYTES], uint32_t k,
+          const uint8_t enc_key[ENC_KEY_BYTES],
+          const uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES],
+          size_t max_stored) {
+  uint64_t hash = hash_entry(store, ecdh_enc, k);
+  skipped_keys_s *entry;
+  uint32_t pos;
+
+  /* The same keys can be derived again if a message failed to be verified
+   * after they were stored */
+  if (store->count > 0) {
+    entry = find_entry(store, ecdh_enc, k, hash);
+    if (entry) {
+      memcpy(entry->enc_key, enc_key, ENC_KEY_BYTES);
+      memcpy(entry->extra_symmetric_key, extra_key, EXTRA_SYMMETRIC_KEY_BYTES);
+      return OTRNG_SUCCESS;
+    }
+  }
+
+  while (store->count >= max_stored) {
+    remove_oldest(store);
+  }
+
+  if (store->free_list == SKIPPED_KEYS_NONE) {
+    if (!skipped_keys_grow(store, max_stored)) {
+      return OTRNG_ERROR;
+    }
+  }
+
+  pos = store->free_list;
+  entry = &store->entries[pos];
+  store->free_list = entry->newer;
+
+  memcpy(entry->their_ecdh, ecdh_enc, ED448_POINT_BYTES);
+  entry->k = k;
+  memcpy(entry->enc_key, enc_key, ENC_KEY_BYTES);
+  memcpy(entry->extra_symmetric_key, extra_key, EXTRA_SYMMETRIC_KEY_BYTES);
+  entry->hash = hash;
+
+  entry->older = store->newest;
+  entry->newer = SKIPPED_KEYS_NONE;
+  if (store->newest != SKIPPED_KEYS_NONE) {
+    store->entries[store->newest].newer = pos;
+  } else {
+    store->oldest = pos;
+  }
+  store->newest = pos;
+
+  otrng_hash_index_add(&store->index, hash, entry);
+  store->count++;
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_skipped_keys_add(
+    skipped_keys_store_s *store, const ec_point their_ecdh, uint32_t k,
+    const uint8_t enc_key[ENC_KEY_BYTES],
+    const uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES], size_t max_stored) {
+  uint8_t ecdh_enc[ED448_POINT_BYTES];
+
+  if (max_stored == 0) {
+    return OTRNG_SUCCESS;
+  }
+
+  if (!encode_their_ecdh(ecdh_enc, store, their_ecdh)) {
+    return OTRNG_ERROR;
+  }
+
+  return add_entry(store, ecdh_enc, k, enc_key, extra_key, max_stored);
+}
+
+static /*@null@*/ skipped_keys_s *lookup(skipped_keys_store_s *store,
+                                         const ec_point their_ecdh,
+                                         uint32_t k) {
+  uint8_t ecdh_enc[ED448_POINT_BYTES];
+
+  /* Most messages arrive in order, so avoid encoding the point */
+  if (!store || store->count == 0) {
+    return NULL;
+  }
+
+  if (!encode_their_ecdh(ecdh_enc, store, their_ecdh)) {
+    return NULL;
+  }
+
+  return find_entry(store, ecdh_enc, k, hash_entry(store, ecdh_enc, k));
+}
+
+INTERNAL otrng_result otrng_skipped_keys_get(
+    uint8_t enc_key[ENC_KEY_BYTES],
+    uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES], skipped_keys_store_s *store,
+    const ec_point their_ecdh, uint32_t k) {
+  const skipped_keys_s *entry = lookup(store, their_ecdh, k);
+
+  if (!entry) {
+    return OTRNG_ERROR;
+  }
+
+  memcpy(enc_key, entry->enc_key, ENC_KEY_BYTES);
+  memcpy(extra_key, entry->extra_symmetric_key, EXTRA_SYMMETRIC_KEY_BYTES);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_skipped_keys_remove(skipped_keys_store_s *store,
+                                                const ec_point their_ecdh,
+                                                uint32_t k) {
+  skipped_keys_s *entry = lookup(store, their_ecdh, k);
+
+  if (!entry) {
+    return OTRNG_ERROR;
+  }
+
+  remove_entry(store, entry);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_skipped_keys_take(
+    uint8_t enc_key[ENC_KEY_BYTES],
+    uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES], skipped_keys_store_s *store,
+    const ec_point their_ecdh, uint32_t k) {
+  skipped_keys_s *entry = lookup(store, their_ecdh, k);
+
+  if (!entry) {
+    return OTRNG_ERROR;
+  }
+
+  memcpy(enc_key, entry->enc_key, ENC_KEY_BYTES);
+  memcpy(extra_key, entry->extra_symmetric_key, EXTRA_SYMMETRIC_KEY_BYTES);
+
+  remove_entry(store, entry);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_skipped_keys_pop_oldest(
+    uint8_t enc_key[ENC_KEY_BYTES], skipped_keys_store_s *store) {
+  if (!store || store->count == 0) {
+    return OTRNG_ERROR;
+  }
+
+  memcpy(enc_key, store->entries[store->oldest].enc_key, ENC_KEY_BYTES);
+  remove_oldest(store);
+
+  return OTRNG_SUCCESS;
+}
+
+INTERNAL otrng_result otrng_skipped_keys_move(skipped_keys_store_s *dst,
+                                              skipped_keys_store_s *src,
+                                              size_t max_stored) {
+  const skipped_keys_s *oldest;
+  otrng_result result = OTRNG_SUCCESS;
+
+  if (!src) {
+    return OTRNG_SUCCESS;
+  }
+
+  while (src->count > 0) {
+    oldest = &src->entries[src->oldest];
+    if (result == OTRNG_SUCCESS && max_stored > 0) {
+      result = add_entry(dst, oldest->their_ecdh, oldest->k, oldest->enc_key,
+                         oldest->extra_symmetric_key, max_stored);
+    }
+    remove_oldest(src);
+  }
+
+  return result;
+}
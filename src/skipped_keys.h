@@ -0,0 +1,192 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The functions in this file only operate on their arguments, and doesn't touch
+ * any global state. It is safe to call these functions concurrently from
+ * different threads, as long as arguments pointing to the same memory areas are
+ * not used from different threads.
+ */
+
+#ifndef OTRNG_SKIPPED_KEYS_H
+#define OTRNG_SKIPPED_KEYS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "ed448.h"
+#include "error.h"
+#include "hash_index.h"
+#include "shared.h"
+
+/* a stored message and extra symmetric key */
+typedef struct skipped_keys_s {
+  uint8_t their_ecdh[ED448_POINT_BYTES]; /* Encoded their_ecdh key */
+  uint32_t k; /* Counter of the receiving messages */
+  uint8_t extra_symmetric_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  uint8_t enc_key[ENC_KEY_BYTES];
+
+  uint64_t hash;  /* hash of (their_ecdh, k) in the index */
+  uint32_t older; /* previous entry in insertion order */
+  uint32_t newer; /* next entry in insertion order, or in the free list */
+} skipped_keys_s;
+
+/*
+ * The table of stored message keys, indexed by (their_ecdh, k).
+ *
+ * Entries live in a slab in secure memory and are chained in insertion order,
+ * so the oldest one can be evicted when the table is full. The index points
+ * into the slab, so it is rebuilt when the slab grows.
+ */
+typedef struct skipped_keys_store_s {
+  /*@null@*/ skipped_keys_s *entries;
+  size_t capacity;
+
+  hash_index_s index; /* by (their_ecdh, k) */
+
+  size_t count;
+  uint32_t oldest;
+  uint32_t newest;
+  uint32_t free_list;
+
+  /* the last point we have encoded, as they arrive in bursts */
+  ec_point last_ecdh;
+  uint8_t last_ecdh_enc[ED448_POINT_BYTES];
+  otrng_bool has_last_ecdh;
+} skipped_keys_store_s;
+
+/**
+ * @brief Creates a new, empty, store of skipped keys.
+ *
+ * @return A new store [skipped_keys_store_s].
+ */
+INTERNAL skipped_keys_store_s *otrng_skipped_keys_new(void);
+
+/**
+ * @brief Securely wipes and frees the store and all the keys in it.
+ *
+ * @param [store]   The store.
+ */
+INTERNAL void otrng_skipped_keys_free(/*@only@*/ /*@null@*/
+                                      skipped_keys_store_s *store);
+
+/**
+ * @brief Returns the number of keys in the store.
+ *
+ * @param [store]   The store.
+ */
+INTERNAL size_t otrng_skipped_keys_size(const skipped_keys_store_s *store);
+
+/**
+ * @brief Stores the keys for the message (their_ecdh, k). If the store already
+ * holds [max_stored] keys, the oldest ones are evicted to make room.
+ *
+ * @param [store]       The store.
+ * @param [their_ecdh]  Their ECDH key for the ratchet the message belongs to.
+ * @param [k]           The message id.
+ * @param [enc_key]     The message encryption key.
+ * @param [extra_key]   The extra symmetric key.
+ * @param [max_stored]  The maximum number of keys to keep.
+ */
+INTERNAL otrng_result otrng_skipped_keys_add(
+    skipped_keys_store_s *store, const ec_point their_ecdh, uint32_t k,
+    const uint8_t enc_key[ENC_KEY_BYTES],
+    const uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES], size_t max_stored);
+
+/**
+ * @brief Looks up the keys for the message (their_ecdh, k) and removes them
+ * from the store.
+ *
+ * @param [enc_key]     Where the message encryption key will be copied to.
+ * @param [extra_key]   Where the extra symmetric key will be copied to.
+ * @param [store]       The store.
+ * @param [their_ecdh]  Their ECDH key for the ratchet the message belongs to.
+ * @param [k]           The message id.
+ *
+ * @return OTRNG_SUCCESS if the keys were found, OTRNG_ERROR otherwise.
+ */
+INTERNAL otrng_result otrng_skipped_keys_take(
+    uint8_t enc_key[ENC_KEY_BYTES],
+    uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES], skipped_keys_store_s *store,
+    const ec_point their_ecdh, uint32_t k);
+
+/**
+ * @brief Looks up the keys for the message (their_ecdh, k), and leaves them in
+ * the store.
+ *
+ * @param [enc_key]     Where the message encryption key will be copied to.
+ * @param [extra_key]   Where the extra symmetric key will be copied to.
+ * @param [store]       The store.
+ * @param [their_ecdh]  Their ECDH key for the ratchet the message belongs to.
+ * @param [k]           The message id.
+ *
+ * @return OTRNG_SUCCESS if the keys were found, OTRNG_ERROR otherwise.
+ */
+INTERNAL otrng_result otrng_skipped_keys_get(
+    uint8_t enc_key[ENC_KEY_BYTES],
+    uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES], skipped_keys_store_s *store,
+    const ec_point their_ecdh, uint32_t k);
+
+/**
+ * @brief Removes the keys for the message (their_ecdh, k) from the store.
+ *
+ * @param [store]       The store.
+ * @param [their_ecdh]  Their ECDH key for the ratchet the message belongs to.
+ * @param [k]           The message id.
+ *
+ * @return OTRNG_SUCCESS if the keys were found, OTRNG_ERROR otherwise.
+ */
+INTERNAL otrng_result otrng_skipped_keys_remove(skipped_keys_store_s *store,
+                                                const ec_point their_ecdh,
+                                                uint32_t k);
+
+/**
+ * @brief Moves all the keys in [src] to [dst], oldest first, as if they were
+ * added to [dst] one by one. [src] is left empty.
+ *
+ * @param [dst]         The store the keys are added to.
+ * @param [src]         The store the keys are taken from.
+ * @param [max_stored]  The maximum number of keys [dst] keeps.
+ */
+INTERNAL otrng_result
+otrng_skipped_keys_move(skipped_keys_store_s *dst,
+                        /*@null@*/ skipped_keys_store_s *src,
+                        size_t max_stored);
+
+/**
+ * @brief Removes the oldest keys in the store.
+ *
+ * @param [enc_key]   Where the message encryption key will be copied to.
+ * @param [store]     The store.
+ *
+ * @return OTRNG_SUCCESS if there were keys, OTRNG_ERROR if the store is empty.
+ */
+INTERNAL otrng_result otrng_skipped_keys_pop_oldest(
+    uint8_t enc_key[ENC_KEY_BYTES], skipped_keys_store_s *store);
+
+#ifdef OTRNG_SKIPPED_KEYS_PRIVATE
+
+tstatic otrng_result skipped_keys_grow(skipped_keys_store_s *store,
+                                       size_t max_stored);
+
+#endif
+
+#endif
@@ -23,7 +23,9 @@
 
 void functionals_api_add_tests(void);
 void functionals_client_add_tests(void);
+void functionals_concurrency_add_tests(void);
 void functionals_double_ratchet_add_tests(void);
+void functionals_engine_add_tests(void);
 void functionals_prekey_client_add_tests(void);
 void functionals_smp_add_tests(void);
 
@@ -31,7 +33,9 @@ void functionals_smp_add_tests(void);
   do {                                                                         \
     functionals_api_add_tests();                                               \
     functionals_client_add_tests();                                            \
+    functionals_concurrency_add_tests();                                       \
     functionals_double_ratchet_add_tests();                                    \
+    functionals_engine_add_tests();                                            \
     functionals_prekey_client_add_tests();                                     \
     functionals_smp_add_tests();                                               \
   } while (0);
@@ -60,7 +60,7 @@ static void test_api_interactive_conversation(void) {
     // Alice sends a data message
     result = otrng_send_message(&to_send, "hi", NULL, 0, alice);
     assert_message_sent(result, to_send);
-    otrng_assert(!alice->keys->old_mac_keys);
+    otrng_assert(!alice->keys->old_mac_keys.head);
 
     g_assert_cmpint(alice->keys->i, ==, 1);
     g_assert_cmpint(alice->keys->j, ==, message_id + 1);
@@ -75,11 +75,11 @@ static void test_api_interactive_conversation(void) {
     response_to_alice = otrng_response_new();
     result = otrng_receive_message(response_to_alice, to_send, bob);
     assert_message_rec(result, "hi", response_to_alice);
-    otrng_assert(bob->keys->old_mac_keys);
+    otrng_assert(bob->keys->old_mac_keys.head);
 
     free_message_and_response(response_to_alice, &to_send);
 
-    g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==,
+    g_assert_cmpint(bob->keys->old_mac_keys.len, ==,
                     message_id + 1);
     g_assert_cmpint(bob->keys->i, ==, 1);
     g_assert_cmpint(bob->keys->j, ==, 0);
@@ -97,7 +97,7 @@ static void test_api_interactive_conversation(void) {
     result = otrng_send_message(&to_send, "hello", NULL, 0, bob);
     assert_message_sent(result, to_send);
 
-    g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+    g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
     g_assert_cmpint(bob->keys->i, ==, 2);
     g_assert_cmpint(bob->keys->j, ==, message_id);
@@ -112,7 +112,7 @@ static void test_api_interactive_conversation(void) {
     response_to_bob = otrng_response_new();
     result = otrng_receive_message(response_to_bob, to_send, alice);
     assert_message_rec(result, "hello", response_to_bob);
-    g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, message_id);
+    g_assert_cmpint(alice->keys->old_mac_keys.len, ==, message_id);
 
     free_message_and_response(response_to_bob, &to_send);
 
@@ -133,13 +133,13 @@ static void test_api_interactive_conversation(void) {
   result = otrng_smp_start(&to_send, NULL, 0, secret_data, secret_len, bob);
   assert_message_sent(result, to_send);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   // Alice receives a data message with TLV
   response_to_bob = otrng_response_new();
   otrng_assert_is_success(
       otrng_receive_message(response_to_bob, to_send, alice));
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 4);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 4);
 
   // Check TLVs
   otrng_assert(response_to_bob->tlvs);
@@ -192,7 +192,7 @@ static void test_otrng_send_offline_message() {
 
   prekey_ensemble_s *ensemble = otrng_build_prekey_ensemble(bob);
   otrng_assert(ensemble);
-  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble, NULL));
 
   g_assert_cmpint(bob->their_prekeys_id, ==, 0);
   otrng_assert(bob->running_version == 0);
@@ -253,7 +253,7 @@ static void test_otrng_send_offline_message() {
   for (message_id = 1; message_id < 4; message_id++) {
     result = otrng_send_message(&to_send, "hi", NULL, 0, alice);
     assert_message_sent(result, to_send);
-    otrng_assert(!alice->keys->old_mac_keys);
+    otrng_assert(!alice->keys->old_mac_keys.head);
 
     g_assert_cmpint(alice->keys->i, ==, 1);
     g_assert_cmpint(alice->keys->j, ==, message_id);
@@ -264,9 +264,9 @@ static void test_otrng_send_offline_message() {
     response_to_alice = otrng_response_new();
     result = otrng_receive_message(response_to_alice, to_send, bob);
     assert_message_rec(result, "hi", response_to_alice);
-    otrng_assert(bob->keys->old_mac_keys);
+    otrng_assert(bob->keys->old_mac_keys.head);
 
-    g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, message_id);
+    g_assert_cmpint(bob->keys->old_mac_keys.len, ==, message_id);
 
     g_assert_cmpint(bob->keys->i, ==, 1);
     g_assert_cmpint(bob->keys->j, ==, 0);
@@ -281,7 +281,7 @@ static void test_otrng_send_offline_message() {
     result = otrng_send_message(&to_send, "hello", NULL, 0, bob);
     assert_message_sent(result, to_send);
 
-    g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+    g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
     g_assert_cmpint(bob->keys->i, ==, 2);
     g_assert_cmpint(bob->keys->j, ==, message_id);
     g_assert_cmpint(bob->keys->k, ==, 3);
@@ -291,7 +291,7 @@ static void test_otrng_send_offline_message() {
     response_to_bob = otrng_response_new();
     result = otrng_receive_message(response_to_bob, to_send, alice);
     assert_message_rec(result, "hello", response_to_bob);
-    g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, message_id);
+    g_assert_cmpint(alice->keys->old_mac_keys.len, ==, message_id);
 
     g_assert_cmpint(alice->keys->i, ==, 2);
     g_assert_cmpint(alice->keys->j, ==, 0);
@@ -308,13 +308,13 @@ static void test_otrng_send_offline_message() {
   result = otrng_smp_start(&to_send, NULL, 0, secret_data, secret_len, bob);
   assert_message_sent(result, to_send);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   // Alice receives a data message with TLV
   response_to_bob = otrng_response_new();
   otrng_assert_is_success(
       otrng_receive_message(response_to_bob, to_send, alice));
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 4);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 4);
 
   // Check TLVS
   otrng_assert(response_to_bob->tlvs);
@@ -348,7 +348,7 @@ static void test_otrng_incorrect_offline_dake() {
   prekey_ensemble_s *ensemble = otrng_build_prekey_ensemble(bob);
   otrng_assert(ensemble);
   // TODO: @non_interactive should this validation happen outside?
-  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble, NULL));
 
   g_assert_cmpint(bob->their_prekeys_id, ==, 0);
   otrng_assert(bob->running_version == 0);
@@ -538,7 +538,7 @@ static void test_api_whitespace_tag(void) {
   otrng_assert(response_to_alice->to_display == NULL);
   otrng_assert(response_to_alice);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
@@ -585,7 +585,7 @@ static void test_api_conversation_errors_1(void) {
   result = otrng_send_message(&to_send, "hi", NULL, 0, alice);
 
   assert_message_sent(result, to_send);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -602,7 +602,7 @@ static void test_api_conversation_errors_1(void) {
   otrng_assert_cmpmem(err_code, response_to_alice->to_send, strlen(err_code));
 
   otrng_assert(response_to_alice->to_send != NULL);
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
 
@@ -646,7 +646,7 @@ static void test_api_conversation_errors_2(void) {
   // Alice sends a data message
   result = otrng_send_message(&to_send, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   // Corrupt message
   size_t dec_len = 0;
@@ -1109,7 +1109,7 @@ static void test_api_extra_sym_key(void) {
 
   result = otrng_send_message(&to_send, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   // This is a follow up message.
   g_assert_cmpint(alice->keys->i, ==, 1);
@@ -1119,9 +1119,9 @@ static void test_api_extra_sym_key(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send, bob);
   assert_message_rec(result, "hi", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -1138,13 +1138,13 @@ static void test_api_extra_sym_key(void) {
                                      bob->keys->extra_symmetric_key, bob);
   assert_message_sent(result, to_send);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   // Alice receives a data message with TLV
   response_to_bob = otrng_response_new();
   otrng_assert_is_success(
       otrng_receive_message(response_to_bob, to_send, alice));
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 1);
 
   // Check TLVS
   otrng_assert(response_to_bob->tlvs);
@@ -1183,21 +1183,21 @@ static void test_heartbeat_messages(void) {
 
   result = otrng_send_message(&to_send, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   // bob->last_sent = time(NULL) - 60;
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
 
   // Bob receives a data message
   // Bob sends a heartbeat message
   response_to_alice = otrng_response_new();
   otrng_assert_is_success(
       otrng_receive_message(response_to_alice, to_send, bob));
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   otrng_assert_cmpmem("hi", response_to_alice->to_display, strlen("hi") + 1);
   otrng_assert(response_to_alice->to_send != NULL);
@@ -1211,7 +1211,7 @@ static void test_heartbeat_messages(void) {
   response_to_bob = otrng_response_new();
   otrng_assert_is_success(otrng_receive_message(
       response_to_bob, response_to_alice->to_send, alice));
-  otrng_assert(alice->keys->old_mac_keys);
+  otrng_assert(alice->keys->old_mac_keys.head);
   otrng_assert(!response_to_bob->to_display);
   otrng_assert(!response_to_bob->to_send);
   g_assert_cmpint(alice->keys->i, ==, 2);
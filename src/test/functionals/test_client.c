@@ -36,13 +36,13 @@ static void test_client_conversation_api() {
   otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
 
   set_up_client(alice, 1);
-  otrng_assert(!alice->conversations);
+  otrng_assert(!alice->conversations.head);
 
   otrng_conversation_s *alice_to_bob =
       otrng_client_get_conversation(NOT_FORCE_CREATE_CONV, BOB_ACCOUNT, alice);
   otrng_conversation_s *alice_to_charlie = otrng_client_get_conversation(
       NOT_FORCE_CREATE_CONV, CHARLIE_ACCOUNT, alice);
-  otrng_assert(!alice->conversations);
+  otrng_assert(!alice->conversations.head);
   otrng_assert(!alice_to_bob);
   otrng_assert(!alice_to_charlie);
 
@@ -67,6 +67,58 @@ static void test_client_conversation_api() {
   otrng_global_state_free(alice->global_state);
 }
 
+static void test_client_many_conversations() {
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_conversation_s *convs[64];
+  const list_element_s *el;
+  char recipient[32];
+  int i;
+
+  set_up_client(alice, 1);
+
+  for (i = 0; i < 64; i++) {
+    snprintf(recipient, sizeof(recipient), "bob%d@otr.im", i);
+    convs[i] =
+        otrng_client_get_conversation(FORCE_CREATE_CONV, recipient, alice);
+    otrng_assert(convs[i]);
+  }
+
+  for (i = 0; i < 64; i++) {
+    snprintf(recipient, sizeof(recipient), "bob%d@otr.im", i);
+    otrng_assert(otrng_client_get_conversation(NOT_FORCE_CREATE_CONV, recipient,
+                                               alice) == convs[i]);
+    otrng_assert(otrng_client_get_conversation(FORCE_CREATE_CONV, recipient,
+                                               alice) == convs[i]);
+  }
+
+  for (i = 0; i < 64; i += 2) {
+    destroy_client_conversation(convs[i], alice);
+    conversation_free(convs[i]);
+  }
+
+  g_assert_cmpint(alice->conversations.len, ==, 32);
+
+  // Keeps the conversations in the order they were created
+  i = 1;
+  for (el = alice->conversations.head; el; el = el->next) {
+    otrng_assert(el->data == convs[i]);
+    i += 2;
+  }
+
+  for (i = 0; i < 64; i++) {
+    snprintf(recipient, sizeof(recipient), "bob%d@otr.im", i);
+    if (i % 2) {
+      otrng_assert(otrng_client_get_conversation(
+                       NOT_FORCE_CREATE_CONV, recipient, alice) == convs[i]);
+    } else {
+      otrng_assert(!otrng_client_get_conversation(NOT_FORCE_CREATE_CONV,
+                                                  recipient, alice));
+    }
+  }
+
+  otrng_global_state_free(alice->global_state);
+}
+
 static void test_client_api() {
   otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
   otrng_client_s *bob = otrng_client_new(BOB_IDENTITY);
@@ -1037,17 +1089,160 @@ static void test_client_expires_old_fragments(void) {
 
   otrng_conversation_s *conv =
       otrng_client_get_conversation(0, BOB_ACCOUNT, alice);
-  g_assert_cmpint(otrng_list_len(conv->conn->pending_fragments), ==, 1);
+  g_assert_cmpint(conv->conn->pending_fragments.count, ==, 1);
 
   otrng_client_expire_fragments(alice);
 
-  g_assert_cmpint(otrng_list_len(conv->conn->pending_fragments), ==, 0);
+  /* It has not waited long enough yet */
+  g_assert_cmpint(conv->conn->pending_fragments.count, ==, 1);
+
+  conv->conn->pending_fragments.oldest->last_fragment_received_at -= 3600;
+  otrng_client_expire_fragments(alice);
+
+  g_assert_cmpint(conv->conn->pending_fragments.count, ==, 0);
 
   otrng_free(to_display);
   otrng_message_free(fmessage);
   otrng_global_state_free(alice->global_state);
 }
 
+static void test_client_schedules_fragments_expiry(void) {
+  const char *message = "Pending fragmented message";
+  otrng_global_state_s *gs;
+  time_t received_at;
+
+  otrng_message_to_send_s *fmessage =
+      otrng_xmalloc_z(sizeof(otrng_message_to_send_s));
+  otrng_assert_is_success(otrng_fragment_message(60, fmessage, 0, 0, message));
+
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  set_up_client(alice, 1);
+  gs = alice->global_state;
+
+  char *to_send = NULL, *to_display = NULL;
+  otrng_bool ignore = otrng_false;
+
+  alice->fragments_exp_time = 3600;
+
+  /* Nothing is waiting to expire */
+  g_assert_cmpint(otrng_next_timeout(gs), ==, -1);
+
+  otrng_client_receive(&to_send, &to_display, fmessage->pieces[0], BOB_ACCOUNT,
+                       alice, &ignore);
+
+  otrng_conversation_s *conv =
+      otrng_client_get_conversation(0, BOB_ACCOUNT, alice);
+  g_assert_cmpint(conv->conn->pending_fragments.count, ==, 1);
+  received_at = conv->conn->pending_fragments.oldest->last_fragment_received_at;
+
+  otrng_assert(otrng_timer_is_scheduled(&conv->conn->fragments_timer));
+  g_assert_cmpint(conv->conn->fragments_timer.deadline, ==,
+                  received_at + 3600);
+  otrng_assert(otrng_next_timeout(gs) > 0);
+  otrng_assert(otrng_next_timeout(gs) <= 3600);
+
+  /* It has not waited long enough yet */
+  otrng_poll(gs);
+  g_assert_cmpint(conv->conn->pending_fragments.count, ==, 1);
+
+  g_assert_cmpint(otrng_timers_expire(&gs->timers, received_at + 3600), ==, 1);
+  g_assert_cmpint(conv->conn->pending_fragments.count, ==, 0);
+  otrng_assert(!otrng_timer_is_scheduled(&conv->conn->fragments_timer));
+  g_assert_cmpint(otrng_next_timeout(gs), ==, -1);
+
+  otrng_free(to_display);
+  otrng_message_free(fmessage);
+  otrng_global_state_free(gs);
+}
+
+static int session_expiry_injected = 0;
+
+static uint32_t expire_session_after_an_hour(const otrng_s *otr) {
+  (void)otr;
+  return 3600;
+}
+
+static void inject_expired_session_message(const otrng_s *otr,
+                                           string_p message) {
+  /* The conversation is still alive when the message is sent */
+  g_assert_cmpstr(otr->peer, ==, BOB_ACCOUNT);
+  otrng_assert(otr->client);
+  otrng_assert(message);
+
+  session_expiry_injected++;
+  otrng_free(message);
+}
+
+static void test_client_expires_session(void) {
+  otrng_client_callbacks_s callbacks = *test_callbacks;
+  otrng_bool ignore = otrng_false;
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_client_s *bob = otrng_client_new(BOB_IDENTITY);
+  otrng_global_state_s *gs;
+  time_t now;
+
+  callbacks.session_expiration_time_for = expire_session_after_an_hour;
+  callbacks.inject_message = inject_expired_session_message;
+
+  set_up_client(alice, 1);
+  set_up_client(bob, 2);
+  gs = alice->global_state;
+  gs->callbacks = &callbacks;
+  session_expiry_injected = 0;
+
+  char *query_message_to_bob =
+      otrng_client_init_message(BOB_ACCOUNT, "Hi bob", alice);
+  otrng_assert(query_message_to_bob);
+
+  char *from_alice_to_bob = NULL, *from_bob = NULL, *to_display = NULL;
+
+  /* Bob receives query message, sends identity message */
+  otrng_client_receive(&from_bob, &to_display, query_message_to_bob,
+                       ALICE_ACCOUNT, bob, &ignore);
+  otrng_free(query_message_to_bob);
+
+  /* Alice receives identity message (from Bob), sends Auth-R message */
+  otrng_client_receive(&from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT,
+                       alice, &ignore);
+  otrng_free(from_bob);
+
+  /* Bob receives Auth-R message, sends Auth-I message */
+  otrng_client_receive(&from_bob, &to_display, from_alice_to_bob, ALICE_ACCOUNT,
+                       bob, &ignore);
+  otrng_free(from_alice_to_bob);
+
+  /* Alice receives Auth-I message (from Bob) */
+  otrng_client_receive(&from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT,
+                       alice, &ignore);
+  otrng_free(from_bob);
+  otrng_free(from_alice_to_bob);
+
+  otrng_conversation_s *conv =
+      otrng_client_get_conversation(NOT_FORCE_CREATE_CONV, BOB_ACCOUNT, alice);
+  otrng_assert(conv);
+  otrng_assert(conv->conn->state == OTRNG_STATE_ENCRYPTED_MESSAGES);
+  otrng_assert(otrng_timer_is_scheduled(&conv->session_timer));
+
+  /* The keys are new, so the session has not expired yet */
+  now = time(NULL);
+  g_assert_cmpint(otrng_timers_expire(&gs->timers, now), ==, 0);
+  otrng_assert(otrng_client_get_conversation(NOT_FORCE_CREATE_CONV,
+                                             BOB_ACCOUNT, alice) == conv);
+
+  /* The keys have not been renewed for longer than the expiration time */
+  conv->conn->keys->last_generated = now - 7200;
+  g_assert_cmpint(otrng_timers_expire(&gs->timers, now + 3602), ==, 1);
+
+  /* The session is torn down, after the disconnect message was sent */
+  g_assert_cmpint(session_expiry_injected, ==, 1);
+  otrng_assert(!otrng_client_get_conversation(NOT_FORCE_CREATE_CONV,
+                                              BOB_ACCOUNT, alice));
+  g_assert_cmpint(otrng_next_timeout(gs), ==, -1);
+
+  otrng_global_state_free(alice->global_state);
+  otrng_global_state_free(bob->global_state);
+}
+
 static void test_client_sends_fragmented_message(void) {
   otrng_bool ignore = otrng_false;
   otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
@@ -1124,12 +1319,189 @@ static void test_client_sends_fragmented_message(void) {
   otrng_global_state_free(bob->global_state);
 }
 
+static void test_client_sends_batch_of_messages(void) {
+  otrng_bool ignore = otrng_false;
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_client_s *bob = otrng_client_new(BOB_IDENTITY);
+
+  set_up_client(alice, 1);
+  set_up_client(bob, 2);
+
+  char *query_message_to_bob =
+      otrng_client_init_message(BOB_ACCOUNT, "Hi bob", alice);
+  otrng_assert(query_message_to_bob);
+
+  char *from_alice_to_bob = NULL, *from_bob = NULL, *to_display = NULL;
+
+  /* Bob receives query message, sends identity message */
+  otrng_client_receive(&from_bob, &to_display, query_message_to_bob,
+                       ALICE_ACCOUNT, bob, &ignore);
+  otrng_free(query_message_to_bob);
+
+  /* Alice receives identity message (from Bob), sends Auth-R message */
+  otrng_client_receive(&from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT,
+                       alice, &ignore);
+  otrng_free(from_bob);
+
+  /* Bob receives Auth-R message, sends Auth-I message */
+  otrng_client_receive(&from_bob, &to_display, from_alice_to_bob, ALICE_ACCOUNT,
+                       bob, &ignore);
+  otrng_free(from_alice_to_bob);
+
+  /* Alice receives Auth-I message (from Bob) */
+  otrng_client_receive(&from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT,
+                       alice, &ignore);
+  otrng_free(from_bob);
+
+  /* Bob receives the initial data message */
+  otrng_client_receive(&from_bob, &to_display, from_alice_to_bob, ALICE_ACCOUNT,
+                       bob, &ignore);
+  otrng_free(from_alice_to_bob);
+  otrng_assert(!from_bob);
+  otrng_assert(!to_display);
+
+  const char *messages[3] = {"first", "second", "third"};
+  char *to_send[3];
+  size_t sent;
+  int round, i;
+
+  for (round = 0; round < 2; round++) {
+    /* Alice sends the messages at once */
+    otrng_assert_is_success(otrng_client_send_batch(to_send, &sent, messages,
+                                                    3, BOB_ACCOUNT, alice));
+    otrng_assert(sent == 3);
+
+    for (i = 0; i < 3; i++) {
+      otrng_assert(to_send[i]);
+      otrng_assert_is_success(otrng_client_receive(
+          &from_bob, &to_display, to_send[i], ALICE_ACCOUNT, bob, &ignore));
+      g_assert_cmpstr(to_display, ==, messages[i]);
+
+      otrng_free(to_send[i]);
+      otrng_free(to_display);
+      otrng_free(from_bob);
+      from_bob = NULL;
+    }
+
+    /* Bob answers, so Alice starts a new ratchet in the next batch */
+    otrng_assert_is_success(
+        otrng_client_send(&from_bob, "got them", ALICE_ACCOUNT, bob));
+    otrng_assert_is_success(otrng_client_receive(
+        &from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT, alice,
+        &ignore));
+    g_assert_cmpstr(to_display, ==, "got them");
+
+    otrng_free(from_bob);
+    from_bob = NULL;
+    otrng_free(from_alice_to_bob);
+    from_alice_to_bob = NULL;
+    otrng_free(to_display);
+  }
+
+  otrng_global_state_free(alice->global_state);
+  otrng_global_state_free(bob->global_state);
+}
+
+static void test_client_sends_batch_with_failing_message(void) {
+  otrng_bool ignore = otrng_false;
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_client_s *bob = otrng_client_new(BOB_IDENTITY);
+
+  set_up_client(alice, 1);
+  set_up_client(bob, 2);
+
+  char *query_message_to_bob =
+      otrng_client_init_message(BOB_ACCOUNT, "Hi bob", alice);
+  otrng_assert(query_message_to_bob);
+
+  char *from_alice_to_bob = NULL, *from_bob = NULL, *to_display = NULL;
+
+  /* Bob receives query message, sends identity message */
+  otrng_client_receive(&from_bob, &to_display, query_message_to_bob,
+                       ALICE_ACCOUNT, bob, &ignore);
+  otrng_free(query_message_to_bob);
+
+  /* Alice receives identity message (from Bob), sends Auth-R message */
+  otrng_client_receive(&from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT,
+                       alice, &ignore);
+  otrng_free(from_bob);
+
+  /* Bob receives Auth-R message, sends Auth-I message */
+  otrng_client_receive(&from_bob, &to_display, from_alice_to_bob, ALICE_ACCOUNT,
+                       bob, &ignore);
+  otrng_free(from_alice_to_bob);
+
+  /* Alice receives Auth-I message (from Bob) */
+  otrng_client_receive(&from_alice_to_bob, &to_display, from_bob, BOB_ACCOUNT,
+                       alice, &ignore);
+  otrng_free(from_bob);
+
+  /* Bob receives the initial data message */
+  otrng_client_receive(&from_bob, &to_display, from_alice_to_bob, ALICE_ACCOUNT,
+                       bob, &ignore);
+  otrng_free(from_alice_to_bob);
+  otrng_assert(!from_bob);
+  otrng_assert(!to_display);
+
+  /* The second message can not be encrypted */
+  const char *messages[3] = {"first", NULL, "third"};
+  const char *retried[2] = {"second", "third"};
+  char *to_send[3];
+  size_t sent;
+  int i;
+
+  otrng_assert_is_error(otrng_client_send_batch(to_send, &sent, messages, 3,
+                                                BOB_ACCOUNT, alice));
+
+  /* The first one used up its keys, so it is still returned */
+  otrng_assert(sent == 1);
+  otrng_assert(to_send[0]);
+  otrng_assert(!to_send[1]);
+  otrng_assert(!to_send[2]);
+
+  otrng_assert_is_success(otrng_client_receive(
+      &from_bob, &to_display, to_send[0], ALICE_ACCOUNT, bob, &ignore));
+  g_assert_cmpstr(to_display, ==, "first");
+  otrng_free(to_send[0]);
+  otrng_free(to_display);
+  otrng_free(from_bob);
+  from_bob = NULL;
+
+  /* The keys of the failed message were not used, so Bob does not wait for
+   * it */
+  otrng_assert_is_success(otrng_client_send_batch(to_send, &sent, retried, 2,
+                                                  BOB_ACCOUNT, alice));
+  otrng_assert(sent == 2);
+
+  for (i = 0; i < 2; i++) {
+    otrng_assert_is_success(otrng_client_receive(
+        &from_bob, &to_display, to_send[i], ALICE_ACCOUNT, bob, &ignore));
+    g_assert_cmpstr(to_display, ==, retried[i]);
+
+    otrng_free(to_send[i]);
+    otrng_free(to_display);
+    otrng_free(from_bob);
+    from_bob = NULL;
+  }
+
+  otrng_global_state_free(alice->global_state);
+  otrng_global_state_free(bob->global_state);
+}
+
 void functionals_client_add_tests(void) {
   g_test_add_func("/client/conversation_api", test_client_conversation_api);
+  g_test_add_func("/client/many_conversations", test_client_many_conversations);
   g_test_add_func("/client/sends_fragments",
                   test_client_sends_fragmented_message);
+  g_test_add_func("/client/sends_batch_of_messages",
+                  test_client_sends_batch_of_messages);
+  g_test_add_func("/client/sends_batch_with_failing_message",
+                  test_client_sends_batch_with_failing_message);
   g_test_add_func("/client/expires_old_fragments",
                   test_client_expires_old_fragments);
+  g_test_add_func("/client/schedules_fragments_expiry",
+                  test_client_schedules_fragments_expiry);
+  g_test_add_func("/client/expires_session", test_client_expires_session);
   g_test_add_func("/client/receives_fragments",
                   test_client_receives_fragmented_message);
   g_test_add_func("/client/initiate with identity message",
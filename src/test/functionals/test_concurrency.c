@@ -0,0 +1,185 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include "test_helpers.h"
+
+#include "test_fixtures.h"
+
+#include "client.h"
+#include "messaging.h"
+
+/*
+ * Several pairs of clients of the same global state talk to each other, each
+ * pair from its own thread, while another thread polls the global state and
+ * looks clients up. Run under the thread sanitizer (./configure
+ * --with-sanitizers=thread) to find data races.
+ */
+
+#define CONCURRENT_PAIRS 4
+#define CONCURRENT_MESSAGES 20
+
+typedef struct pair_s {
+  otrng_global_state_s *gs;
+  int index;
+  char alice_account[32];
+  char bob_account[32];
+  int displayed;
+} pair_s;
+
+typedef struct poller_s {
+  otrng_global_state_s *gs;
+  pair_s *pairs;
+  int done;
+} poller_s;
+
+static void deliver(char **reply, const char *msg, const char *from,
+                    otrng_client_s *to, char **to_display) {
+  otrng_bool ignore = otrng_false;
+
+  *reply = NULL;
+  *to_display = NULL;
+  (void)otrng_client_receive(reply, to_display, msg, from, to, &ignore);
+  otrng_assert(!ignore);
+}
+
+static void *talk(void *data) {
+  pair_s *pair = data;
+  otrng_client_s *alice, *bob;
+  char *msg, *reply, *to_display;
+  int i, turns = 0;
+
+  /* The clients are added to the global state from this thread */
+  alice = otrng_client_get(pair->gs, create_client_id("otr",
+                                                      pair->alice_account));
+  bob = otrng_client_get(pair->gs, create_client_id("otr", pair->bob_account));
+  set_up_client_keys(alice, 2 * pair->index + 1);
+  set_up_client_keys(bob, 2 * pair->index + 2);
+
+  /* The DAKE: the messages go back and forth until there is nothing more to
+   * say */
+  msg = otrng_client_init_message(pair->bob_account, "Hi bob", alice);
+  otrng_assert(msg);
+  while (msg && turns < 10) {
+    if (turns % 2 == 0) {
+      deliver(&reply, msg, pair->alice_account, bob, &to_display);
+    } else {
+      deliver(&reply, msg, pair->bob_account, alice, &to_display);
+    }
+    otrng_free(to_display);
+    otrng_free(msg);
+    msg = reply;
+    turns++;
+  }
+  otrng_free(msg);
+
+  otrng_assert(otrng_conversation_is_encrypted(otrng_client_get_conversation(
+      NOT_FORCE_CREATE_CONV, pair->bob_account, alice)));
+  otrng_assert(otrng_conversation_is_encrypted(otrng_client_get_conversation(
+      NOT_FORCE_CREATE_CONV, pair->alice_account, bob)));
+
+  for (i = 0; i < CONCURRENT_MESSAGES; i++) {
+    otrng_client_s *from = i % 2 ? bob : alice;
+    otrng_client_s *to = i % 2 ? alice : bob;
+    const char *from_account = i % 2 ? pair->bob_account : pair->alice_account;
+    const char *to_account = i % 2 ? pair->alice_account : pair->bob_account;
+
+    otrng_assert_is_success(otrng_client_send(&msg, "hello", to_account, from));
+    deliver(&reply, msg, from_account, to, &to_display);
+    otrng_free(msg);
+    otrng_assert(!reply);
+
+    otrng_assert_cmpmem("hello", to_display, 6);
+    otrng_free(to_display);
+    pair->displayed++;
+  }
+
+  return NULL;
+}
+
+static void *poll_and_look_up(void *data) {
+  poller_s *poller = data;
+  int i;
+
+  while (!__atomic_load_n(&poller->done, __ATOMIC_ACQUIRE)) {
+    otrng_poll(poller->gs);
+    (void)otrng_next_timeout(poller->gs);
+    (void)otrng_global_state_keypair_pool_stats(poller->gs);
+    (void)otrng_global_state_profile_cache_stats(poller->gs);
+
+    /* It may be the one adding the client, instead of the pair's thread */
+    for (i = 0; i < CONCURRENT_PAIRS; i++) {
+      otrng_client_s *client = otrng_client_get(
+          poller->gs, create_client_id("otr", poller->pairs[i].bob_account));
+      otrng_assert(client);
+    }
+  }
+
+  return NULL;
+}
+
+static void test_concurrent_conversations() {
+  otrng_global_state_s *gs =
+      otrng_global_state_new(test_callbacks, otrng_false);
+  pair_s pairs[CONCURRENT_PAIRS];
+  pthread_t threads[CONCURRENT_PAIRS], poller_thread;
+  poller_s poller;
+  int i;
+
+  for (i = 0; i < CONCURRENT_PAIRS; i++) {
+    pairs[i].gs = gs;
+    pairs[i].index = i;
+    pairs[i].displayed = 0;
+    snprintf(pairs[i].alice_account, sizeof(pairs[i].alice_account),
+             "alice%d@otr.example", i);
+    snprintf(pairs[i].bob_account, sizeof(pairs[i].bob_account),
+             "bob%d@otr.example", i);
+  }
+
+  poller.gs = gs;
+  poller.pairs = pairs;
+  poller.done = 0;
+
+  for (i = 0; i < CONCURRENT_PAIRS; i++) {
+    otrng_assert(pthread_create(&threads[i], NULL, talk, &pairs[i]) == 0);
+  }
+  otrng_assert(pthread_create(&poller_thread, NULL, poll_and_look_up,
+                              &poller) == 0);
+
+  for (i = 0; i < CONCURRENT_PAIRS; i++) {
+    otrng_assert(pthread_join(threads[i], NULL) == 0);
+    g_assert_cmpint(pairs[i].displayed, ==, CONCURRENT_MESSAGES);
+  }
+
+  __atomic_store_n(&poller.done, 1, __ATOMIC_RELEASE);
+  otrng_assert(pthread_join(poller_thread, NULL) == 0);
+
+  g_assert_cmpint(gs->clients.len, ==, 2 * CONCURRENT_PAIRS);
+
+  otrng_global_state_free(gs);
+}
+
+void functionals_concurrency_add_tests(void) {
+  g_test_add_func("/concurrency/conversations",
+                  test_concurrent_conversations);
+}
@@ -48,7 +48,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   // Alice sends a data message
   result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send_1);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -57,7 +57,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
 
   result = otrng_send_message(&to_send_2, "how are you?", NULL, 0, alice);
   assert_message_sent(result, to_send_2);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 3);
@@ -66,7 +66,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
 
   result = otrng_send_message(&to_send_3, "it's me", NULL, 0, alice);
   assert_message_sent(result, to_send_3);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 4);
@@ -77,11 +77,11 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_1, bob);
   assert_message_rec(result, "hi", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_1);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -90,11 +90,11 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_2, bob);
   assert_message_rec(result, "how are you?", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_2);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 3);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 3);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 3);
@@ -104,7 +104,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   result = otrng_send_message(&to_send_4, "oh, hi", NULL, 0, bob);
   assert_message_sent(result, to_send_4);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   g_assert_cmpint(bob->keys->i, ==, 2);
   g_assert_cmpint(bob->keys->j, ==, 1);
@@ -115,11 +115,11 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_3, bob);
   assert_message_rec(result, "it's me", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_3);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 2);
   g_assert_cmpint(bob->keys->j, ==, 1);
   g_assert_cmpint(bob->keys->k, ==, 4);
@@ -129,7 +129,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   response_to_bob = otrng_response_new();
   result = otrng_receive_message(response_to_bob, to_send_4, alice);
   assert_message_rec(result, "oh, hi", response_to_bob);
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 1);
 
   free_message_and_response(response_to_bob, &to_send_4);
   g_assert_cmpint(alice->keys->i, ==, 2);
@@ -141,7 +141,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   result = otrng_send_message(&to_send_5, "I'm good", NULL, 0, bob);
   assert_message_sent(result, to_send_5);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
 
   g_assert_cmpint(bob->keys->i, ==, 2);
   g_assert_cmpint(bob->keys->j, ==, 2);
@@ -152,7 +152,7 @@ static void test_double_ratchet_new_sending_ratchet_in_order(void) {
   response_to_bob = otrng_response_new();
   result = otrng_receive_message(response_to_bob, to_send_5, alice);
   assert_message_rec(result, "I'm good", response_to_bob);
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 2);
 
   free_message_and_response(response_to_bob, &to_send_5);
   g_assert_cmpint(alice->keys->i, ==, 2);
@@ -188,7 +188,7 @@ static void test_double_ratchet_same_ratchet_out_of_order(void) {
 
   result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send_1);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -197,7 +197,7 @@ static void test_double_ratchet_same_ratchet_out_of_order(void) {
 
   result = otrng_send_message(&to_send_2, "how are you?", NULL, 0, alice);
   assert_message_sent(result, to_send_2);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 3);
@@ -206,7 +206,7 @@ static void test_double_ratchet_same_ratchet_out_of_order(void) {
 
   result = otrng_send_message(&to_send_3, "it's me", NULL, 0, alice);
   assert_message_sent(result, to_send_3);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 4);
@@ -215,7 +215,7 @@ static void test_double_ratchet_same_ratchet_out_of_order(void) {
 
   result = otrng_send_message(&to_send_4, "ok?", NULL, 0, alice);
   assert_message_sent(result, to_send_4);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 5);
@@ -226,11 +226,11 @@ static void test_double_ratchet_same_ratchet_out_of_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_1, bob);
   assert_message_rec(result, "hi", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_1);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -239,39 +239,39 @@ static void test_double_ratchet_same_ratchet_out_of_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_4, bob);
   assert_message_rec(result, "ok?", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_4);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 3);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 3);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 5);
   g_assert_cmpint(bob->keys->pn, ==, 0);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 2);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 2);
 
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_3, bob);
   assert_message_rec(result, "it's me", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_3);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 4);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 4);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 5);
   g_assert_cmpint(bob->keys->pn, ==, 0);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 1);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 1);
 
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_2, bob);
   assert_message_rec(result, "how are you?", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_2);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 5);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 5);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 5);
@@ -306,7 +306,7 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
   // Alice sends a data message
   result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send_1);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -315,7 +315,7 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
 
   result = otrng_send_message(&to_send_2, "how are you?", NULL, 0, alice);
   assert_message_sent(result, to_send_2);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 3);
@@ -324,7 +324,7 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
 
   result = otrng_send_message(&to_send_3, "it's me", NULL, 0, alice);
   assert_message_sent(result, to_send_3);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 4);
@@ -335,11 +335,11 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_1, bob);
   assert_message_rec(result, "hi", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_1);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -351,8 +351,8 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
 
   free_message_and_response(response_to_alice, &to_send_2);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 3);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 3);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 0);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 3);
@@ -362,7 +362,7 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
   result = otrng_send_message(&to_send_4, "oh, hi", NULL, 0, bob);
   assert_message_sent(result, to_send_4);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   g_assert_cmpint(bob->keys->i, ==, 2);
   g_assert_cmpint(bob->keys->j, ==, 1);
@@ -373,7 +373,7 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
   response_to_bob = otrng_response_new();
   result = otrng_receive_message(response_to_bob, to_send_4, alice);
   assert_message_rec(result, "oh, hi", response_to_bob);
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 1);
 
   free_message_and_response(response_to_bob, &to_send_4);
   g_assert_cmpint(alice->keys->i, ==, 2);
@@ -385,7 +385,7 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
   result = otrng_send_message(&to_send_5, "good", NULL, 0, alice);
   assert_message_sent(result, to_send_5);
 
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 0);
 
   g_assert_cmpint(alice->keys->i, ==, 3);
   g_assert_cmpint(alice->keys->j, ==, 1);
@@ -396,16 +396,16 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_5, bob);
   assert_message_rec(result, "good", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_5);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 3);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
   g_assert_cmpint(bob->keys->pn, ==, 1);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 1);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 1);
 
   // Bob receives the previous data message
   response_to_alice = otrng_response_new();
@@ -414,8 +414,8 @@ static void test_double_ratchet_new_ratchet_out_of_order(void) {
 
   free_message_and_response(response_to_alice, &to_send_3);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 0);
   g_assert_cmpint(bob->keys->i, ==, 3);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
@@ -451,7 +451,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   // Alice sends a data message
   result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send_1);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -460,7 +460,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
 
   result = otrng_send_message(&to_send_2, "how are you?", NULL, 0, alice);
   assert_message_sent(result, to_send_2);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 3);
@@ -469,7 +469,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
 
   result = otrng_send_message(&to_send_3, "it's me", NULL, 0, alice);
   assert_message_sent(result, to_send_3);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 4);
@@ -480,11 +480,11 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_1, bob);
   assert_message_rec(result, "hi", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_1);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -496,8 +496,8 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
 
   free_message_and_response(response_to_alice, &to_send_2);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 3);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 3);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 0);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 3);
@@ -507,7 +507,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   result = otrng_send_message(&to_send_4, "oh, hi", NULL, 0, bob);
   assert_message_sent(result, to_send_4);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   g_assert_cmpint(bob->keys->i, ==, 2);
   g_assert_cmpint(bob->keys->j, ==, 1);
@@ -518,7 +518,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   result = otrng_send_message(&to_send_6, "and test", NULL, 0, bob);
   assert_message_sent(result, to_send_6);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 0);
 
   g_assert_cmpint(bob->keys->i, ==, 2);
   g_assert_cmpint(bob->keys->j, ==, 2);
@@ -529,7 +529,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   response_to_bob = otrng_response_new();
   result = otrng_receive_message(response_to_bob, to_send_6, alice);
   assert_message_rec(result, "and test", response_to_bob);
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 1);
 
   free_message_and_response(response_to_bob, &to_send_6);
 
@@ -542,7 +542,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   response_to_bob = otrng_response_new();
   result = otrng_receive_message(response_to_bob, to_send_4, alice);
   assert_message_rec(result, "oh, hi", response_to_bob);
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 2);
 
   free_message_and_response(response_to_bob, &to_send_4);
 
@@ -555,7 +555,7 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   result = otrng_send_message(&to_send_5, "good", NULL, 0, alice);
   assert_message_sent(result, to_send_5);
 
-  g_assert_cmpint(otrng_list_len(alice->keys->old_mac_keys), ==, 0);
+  g_assert_cmpint(alice->keys->old_mac_keys.len, ==, 0);
 
   g_assert_cmpint(alice->keys->i, ==, 3);
   g_assert_cmpint(alice->keys->j, ==, 1);
@@ -566,16 +566,16 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_5, bob);
   assert_message_rec(result, "good", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_5);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 3);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
   g_assert_cmpint(bob->keys->pn, ==, 2);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 1);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 1);
 
   // Bob receives the previous data message
   response_to_alice = otrng_response_new();
@@ -584,8 +584,8 @@ static void test_double_ratchet_new_ratchet_out_of_order_2(void) {
 
   free_message_and_response(response_to_alice, &to_send_3);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 0);
   g_assert_cmpint(bob->keys->i, ==, 3);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
@@ -616,7 +616,7 @@ static void test_double_ratchet_corrupted_ratchet(void) {
   // Alice sends a data message
   result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send_1);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -646,11 +646,11 @@ static void test_double_ratchet_corrupted_ratchet(void) {
   response_to_alice = otrng_response_new();
   result = otrng_receive_message(response_to_alice, to_send_1, bob);
   assert_message_rec(result, "hi", response_to_alice);
-  otrng_assert(bob->keys->old_mac_keys);
+  otrng_assert(bob->keys->old_mac_keys.head);
 
   free_message_and_response(response_to_alice, &to_send_1);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -662,8 +662,8 @@ static void test_double_ratchet_corrupted_ratchet(void) {
       otrng_receive_message(response_to_alice, to_send_2, bob));
   free_message_and_response(response_to_alice, &to_send_2);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 2);
-  g_assert_cmpint(otrng_list_len(bob->keys->skipped_keys), ==, 0);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 2);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 0);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 2);
@@ -676,6 +676,94 @@ static void test_double_ratchet_corrupted_ratchet(void) {
   otrng_conn_free_all(alice, bob);
 }
 
+static void receive_forged_message(otrng_s *alice, otrng_s *bob,
+                                   uint32_t message_id) {
+  data_message_s *forged = otrng_data_message_new();
+  otrng_response_s *response = otrng_response_new();
+  string_p to_send = NULL;
+  k_msg_mac mac_key;
+
+  forged->ratchet_id = alice->keys->i;
+  forged->message_id = message_id;
+  forged->sender_instance_tag = otrng_client_get_instance_tag(alice->client);
+  forged->receiver_instance_tag = otrng_client_get_instance_tag(bob->client);
+  forged->enc_msg = (uint8_t *)otrng_xstrdup("hduejo");
+  forged->enc_msg_len = 7;
+  otrng_ec_point_copy(forged->ecdh, alice->keys->our_ecdh->pub);
+  forged->dh = otrng_dh_mpi_copy(alice->keys->our_dh->pub);
+  memset(forged->nonce, 0, DATA_MSG_NONCE_BYTES);
+  memset(mac_key, 0, sizeof mac_key);
+  otrng_assert_is_success(serialize_and_encode_data_message(
+      &to_send, mac_key, NULL, 0, forged));
+
+  otrng_assert_is_error(otrng_receive_message(response, to_send, bob));
+
+  free_message_and_response(response, &to_send);
+  otrng_data_message_free(forged);
+}
+
+/* Test that messages that fail to verify don't change the stored keys */
+static void test_double_ratchet_forged_message_keeps_skipped_keys(void) {
+  otrng_client_s *alice_client = otrng_client_new(ALICE_IDENTITY);
+  otrng_client_s *bob_client = otrng_client_new(BOB_IDENTITY);
+
+  otrng_s *alice = set_up(alice_client, 1);
+  otrng_s *bob = set_up(bob_client, 2);
+
+  // DAKE has finished
+  do_dake_fixture(alice, bob);
+  otrng_client_set_max_stored_msg_keys(3, bob_client);
+
+  otrng_response_s *response_to_alice = NULL;
+
+  string_p to_send_1 = NULL;
+  string_p to_send_2 = NULL;
+  string_p to_send_3 = NULL;
+  otrng_result result;
+
+  // Alice sends three data messages
+  result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
+  assert_message_sent(result, to_send_1);
+  result = otrng_send_message(&to_send_2, "how are you?", NULL, 0, alice);
+  assert_message_sent(result, to_send_2);
+  result = otrng_send_message(&to_send_3, "it's me", NULL, 0, alice);
+  assert_message_sent(result, to_send_3);
+
+  // Bob receives the first and the third
+  response_to_alice = otrng_response_new();
+  result = otrng_receive_message(response_to_alice, to_send_1, bob);
+  assert_message_rec(result, "hi", response_to_alice);
+  free_message_and_response(response_to_alice, &to_send_1);
+
+  response_to_alice = otrng_response_new();
+  result = otrng_receive_message(response_to_alice, to_send_3, bob);
+  assert_message_rec(result, "it's me", response_to_alice);
+  free_message_and_response(response_to_alice, &to_send_3);
+
+  g_assert_cmpint(bob->keys->k, ==, 4);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 1);
+
+  // A forged message far ahead would store enough keys to push the second
+  // message's out, and one with its id would use it up
+  receive_forged_message(alice, bob, bob->keys->k + 3);
+  receive_forged_message(alice, bob, 2);
+
+  g_assert_cmpint(bob->keys->k, ==, 4);
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 1);
+
+  // Bob can still read the second message
+  response_to_alice = otrng_response_new();
+  result = otrng_receive_message(response_to_alice, to_send_2, bob);
+  assert_message_rec(result, "how are you?", response_to_alice);
+  free_message_and_response(response_to_alice, &to_send_2);
+
+  g_assert_cmpint(otrng_skipped_keys_size(bob->keys->skipped_keys), ==, 0);
+
+  otrng_global_state_free(alice_client->global_state);
+  otrng_global_state_free(bob_client->global_state);
+  otrng_conn_free_all(alice, bob);
+}
+
 void functionals_double_ratchet_add_tests(void) {
   g_test_add_func("/double_ratchet/in_order/new_sending_ratchet/v4",
                   test_double_ratchet_new_sending_ratchet_in_order);
@@ -687,4 +775,6 @@ void functionals_double_ratchet_add_tests(void) {
                   test_double_ratchet_new_ratchet_out_of_order_2);
   g_test_add_func("/double_ratchet/corrupted_ratchet/v4",
                   test_double_ratchet_corrupted_ratchet);
+  g_test_add_func("/double_ratchet/forged_message_keeps_skipped_keys/v4",
+                  test_double_ratchet_forged_message_keeps_skipped_keys);
 }
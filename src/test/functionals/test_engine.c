@@ -0,0 +1,180 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include "test_helpers.h"
+
+#include "test_fixtures.h"
+
+#include "client.h"
+#include "engine.h"
+#include "messaging.h"
+
+#define ENGINE_MESSAGES 40
+
+typedef struct completions_s {
+  pthread_mutex_t lock;
+  /* the data of the completed messages, by sender, in completion order */
+  intptr_t from_alice[ENGINE_MESSAGES];
+  intptr_t from_charlie[ENGINE_MESSAGES];
+  int alice_count;
+  int charlie_count;
+  int displayed;
+} completions_s;
+
+static void record_completion(otrng_engine_result_s *result, void *context) {
+  completions_s *completions = context;
+  intptr_t index = (intptr_t)result->data;
+
+  pthread_mutex_lock(&completions->lock);
+  if (strcmp(result->recipient, ALICE_ACCOUNT) == 0) {
+    completions->from_alice[completions->alice_count++] = index;
+  } else {
+    completions->from_charlie[completions->charlie_count++] = index;
+  }
+
+  if (result->to_display && strcmp(result->to_display, "hello") == 0) {
+    completions->displayed++;
+  }
+  pthread_mutex_unlock(&completions->lock);
+}
+
+static void start_conversation(otrng_client_s *from, const char *from_account,
+                               otrng_client_s *to, const char *to_account) {
+  otrng_bool ignore = otrng_false;
+  char *msg, *reply = NULL, *to_display = NULL;
+  int turns = 0;
+
+  msg = otrng_client_init_message(to_account, "Hi", from);
+  while (msg && turns < 10) {
+    if (turns % 2 == 0) {
+      otrng_client_receive(&reply, &to_display, msg, from_account, to, &ignore);
+    } else {
+      otrng_client_receive(&reply, &to_display, msg, to_account, from, &ignore);
+    }
+    otrng_free(to_display);
+    to_display = NULL;
+    otrng_free(msg);
+    msg = reply;
+    reply = NULL;
+    turns++;
+  }
+  otrng_free(msg);
+}
+
+static void test_engine_keeps_conversations_in_order() {
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_client_s *bob = otrng_client_new(BOB_IDENTITY);
+  otrng_client_s *charlie = otrng_client_new(CHARLIE_IDENTITY);
+  char *from_alice[ENGINE_MESSAGES], *from_charlie[ENGINE_MESSAGES];
+  completions_s completions;
+  otrng_engine_s *engine;
+  int i;
+
+  set_up_client(alice, 1);
+  set_up_client(bob, 2);
+  set_up_client(charlie, 3);
+
+  start_conversation(alice, ALICE_ACCOUNT, bob, BOB_ACCOUNT);
+  start_conversation(charlie, CHARLIE_ACCOUNT, bob, BOB_ACCOUNT);
+
+  for (i = 0; i < ENGINE_MESSAGES; i++) {
+    otrng_assert_is_success(
+        otrng_client_send(&from_alice[i], "hello", BOB_ACCOUNT, alice));
+    otrng_assert_is_success(
+        otrng_client_send(&from_charlie[i], "hello", BOB_ACCOUNT, charlie));
+  }
+
+  memset(&completions, 0, sizeof(completions));
+  pthread_mutex_init(&completions.lock, NULL);
+
+  engine = otrng_engine_new(4, record_completion, &completions);
+  otrng_assert(engine);
+
+  /* The two conversations are interleaved, and received in parallel */
+  for (i = 0; i < ENGINE_MESSAGES; i++) {
+    otrng_assert_is_success(otrng_engine_submit(
+        engine, bob, ALICE_ACCOUNT, from_alice[i], (void *)(intptr_t)i));
+    otrng_assert_is_success(otrng_engine_submit(
+        engine, bob, CHARLIE_ACCOUNT, from_charlie[i], (void *)(intptr_t)i));
+    otrng_free(from_alice[i]);
+    otrng_free(from_charlie[i]);
+  }
+
+  otrng_engine_drain(engine);
+
+  g_assert_cmpint(completions.alice_count, ==, ENGINE_MESSAGES);
+  g_assert_cmpint(completions.charlie_count, ==, ENGINE_MESSAGES);
+  g_assert_cmpint(completions.displayed, ==, 2 * ENGINE_MESSAGES);
+  for (i = 0; i < ENGINE_MESSAGES; i++) {
+    g_assert_cmpint(completions.from_alice[i], ==, i);
+    g_assert_cmpint(completions.from_charlie[i], ==, i);
+  }
+
+  otrng_engine_free(engine);
+  pthread_mutex_destroy(&completions.lock);
+
+  otrng_global_state_free(alice->global_state);
+  otrng_global_state_free(bob->global_state);
+  otrng_global_state_free(charlie->global_state);
+}
+
+static void take_to_display(otrng_engine_result_s *result, void *context) {
+  char **taken = context;
+
+  *taken = result->to_display;
+  result->to_display = NULL;
+}
+
+static void test_engine_hands_results_over() {
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_client_s *bob = otrng_client_new(BOB_IDENTITY);
+  char *msg = NULL, *taken = NULL;
+  otrng_engine_s *engine;
+
+  set_up_client(alice, 1);
+  set_up_client(bob, 2);
+  start_conversation(alice, ALICE_ACCOUNT, bob, BOB_ACCOUNT);
+
+  otrng_assert_is_success(otrng_client_send(&msg, "hello", BOB_ACCOUNT, alice));
+
+  engine = otrng_engine_new(1, take_to_display, &taken);
+  otrng_assert_is_success(
+      otrng_engine_submit(engine, bob, ALICE_ACCOUNT, msg, NULL));
+  otrng_free(msg);
+  otrng_engine_free(engine);
+
+  /* The callback kept it, so the engine did not free it */
+  otrng_assert_cmpmem("hello", taken, 6);
+  otrng_free(taken);
+
+  otrng_global_state_free(alice->global_state);
+  otrng_global_state_free(bob->global_state);
+}
+
+void functionals_engine_add_tests(void) {
+  g_test_add_func("/engine/keeps_conversations_in_order",
+                  test_engine_keeps_conversations_in_order);
+  g_test_add_func("/engine/hands_results_over",
+                  test_engine_hands_results_over);
+}
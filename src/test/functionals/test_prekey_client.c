@@ -39,7 +39,7 @@ static void test_send_dake_1_message(void) {
   otrng_fingerprint fpr = {1};
 
   set_up_client(alice, 1);
-  otrng_assert(!alice->conversations);
+  otrng_assert(!alice->conversations.head);
 
   otrng_prekey_ensure_manager(alice, "alice@localhost");
   alice->prekey_manager->callbacks->domain_for_account =
@@ -65,7 +65,7 @@ static void test_send_dake_3_message_with_storage_info_request(void) {
   random_bytes(sym, ED448_PRIVATE_BYTES);
 
   set_up_client(alice, 1);
-  otrng_assert(!alice->conversations);
+  otrng_assert(!alice->conversations.head);
 
   otrng_prekey_ensure_manager(alice, "alice@localhost");
   alice->prekey_manager->callbacks->domain_for_account =
@@ -146,7 +146,7 @@ static void test_receive_prekey_server_messages(void) {
   otrng_fingerprint fpr = {1};
 
   set_up_client(alice, 1);
-  otrng_assert(!alice->conversations);
+  otrng_assert(!alice->conversations.head);
 
   otrng_prekey_ensure_manager(alice, "alice@localhost");
   alice->prekey_manager->callbacks->domain_for_account =
@@ -200,7 +200,7 @@ static void test_receive_prekey_ensemble_retrieval_message(void) {
   otrng_fingerprint fpr = {1};
 
   set_up_client(alice, 1);
-  otrng_assert(!alice->conversations);
+  otrng_assert(!alice->conversations.head);
 
   otrng_prekey_ensure_manager(alice, "alice@localhost");
   alice->prekey_manager->callbacks->domain_for_account =
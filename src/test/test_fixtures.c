@@ -51,21 +51,17 @@ get_account_and_protocol_cb_empty(char **account, char **protocol,
   return OTRNG_SUCCESS;
 }
 
-void set_up_client(otrng_client_s *client, int byte) {
-  client->global_state = otrng_global_state_new(test_callbacks, otrng_false);
-  client->global_state->clients =
-      otrng_list_add(client, client->global_state->clients);
-
+void set_up_client_keys(otrng_client_s *client, int byte) {
   uint8_t long_term_priv[ED448_PRIVATE_BYTES] = {byte + 0xA};
   uint8_t forging_sym[ED448_PRIVATE_BYTES] = {byte + 0xD};
 
   otrng_client_add_private_key_v4(client, long_term_priv);
 
-  // TODO: free me!
   otrng_keypair_s *f_keypair = otrng_keypair_new();
   otrng_keypair_generate(f_keypair, forging_sym);
 
   otrng_client_add_forging_key(client, f_keypair->pub);
+  otrng_keypair_free(f_keypair);
 
   otrng_client_add_instance_tag(client, 0x100 + byte);
 
@@ -73,11 +69,17 @@ void set_up_client(otrng_client_s *client, int byte) {
   client->should_heartbeat = test_should_not_heartbeat;
 }
 
+void set_up_client(otrng_client_s *client, int byte) {
+  client->global_state = otrng_global_state_new(test_callbacks, otrng_false);
+  otrng_global_state_add_client(client->global_state, client);
+
+  set_up_client_keys(client, byte);
+}
+
 void set_up_client_different_policy(otrng_client_s *client, int byte) {
   client->global_state =
       otrng_global_state_new(test_callbacks_policy, otrng_false);
-  client->global_state->clients =
-      otrng_list_add(client, client->global_state->clients);
+  otrng_global_state_add_client(client->global_state, client);
 
   uint8_t long_term_priv[ED448_PRIVATE_BYTES] = {byte + 0xA};
   uint8_t forging_sym[ED448_PRIVATE_BYTES] = {byte + 0xD};
@@ -546,7 +548,7 @@ void do_dake_fixture(otrng_s *alice, otrng_s *bob) {
   otrng_assert(response_to_alice->to_send == NULL);
   otrng_assert(response_to_alice->to_display == NULL);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
@@ -60,6 +60,10 @@ otrng_result
 get_account_and_protocol_cb_empty(char **account, char **protocol,
                                   const struct otrng_client_id_s client_id);
 
+/* Gives keys, an instance tag and a profile to a client that already is in a
+   global state */
+void set_up_client_keys(otrng_client_s *client, int byte);
+
 void set_up_client(otrng_client_s *client, int byte);
 
 void set_up_client_different_policy(otrng_client_s *client, int byte);
@@ -21,21 +21,26 @@
 #ifndef __TEST_HELPERS_H__
 #define __TEST_HELPERS_H__
 
+#define OTRNG_ALLOC_PRIVATE
 #define OTRNG_AUTH_PRIVATE
 #define OTRNG_CLIENT_PRIVATE
 #define OTRNG_DAKE_PRIVATE
 #define OTRNG_DH_PRIVATE
 #define OTRNG_ED448_PRIVATE
 #define OTRNG_FRAGMENT_PRIVATE
+#define OTRNG_HASH_INDEX_PRIVATE
 #define OTRNG_KEY_MANAGEMENT_PRIVATE
+#define OTRNG_KEYPAIR_POOL_PRIVATE
 #define OTRNG_LIST_PRIVATE
 #define OTRNG_OTRNG_PRIVATE
 #define OTRNG_PERSISTENCE_PRIVATE
 #define OTRNG_PREKEY_MANAGER_PRIVATE
 #define OTRNG_PREKEY_MESSAGE_PRIVATE
 #define OTRNG_PREKEY_PROFILE_PRIVATE
+#define OTRNG_PROFILE_CACHE_PRIVATE
 #define OTRNG_PROTOCOL_PRIVATE
 #define OTRNG_SHAKE_PRIVATE
+#define OTRNG_SKIPPED_KEYS_PRIVATE
 #define OTRNG_SMP_PRIVATE
 #define OTRNG_SMP_PROTOCOL_PRIVATE
 #define OTRNG_TLV_PRIVATE
@@ -21,6 +21,7 @@
 #ifndef __TEST_UNIT_ALL_H__
 #define __TEST_UNIT_ALL_H__
 
+void units_alloc_add_tests(void);
 void units_auth_add_tests(void);
 void units_client_add_tests(void);
 void units_client_profile_add_tests(void);
@@ -29,9 +30,12 @@ void units_data_message_add_tests(void);
 void units_dh_add_tests(void);
 void units_ed448_add_tests(void);
 void units_fragment_add_tests(void);
+void units_hash_index_add_tests(void);
 void units_identity_message_add_tests(void);
 void units_instance_tag_add_tests(void);
+void units_keccak_add_tests(void);
 void units_key_management_add_tests(void);
+void units_keypair_pool_add_tests(void);
 void units_list_add_tests(void);
 void units_messaging_add_tests(void);
 void units_non_interactive_messages_add_tests(void);
@@ -42,14 +46,19 @@ void units_prekey_ensemble_add_tests(void);
 void units_prekey_manager_add_tests(void);
 void units_prekey_messages_add_tests(void);
 void units_prekey_profile_add_tests(void);
+void units_profile_cache_add_tests(void);
 void units_prekey_proofs_add_tests(void);
 void units_prekey_server_client_add_tests(void);
+void units_published_index_add_tests(void);
 void units_serialize_add_tests(void);
+void units_skipped_keys_add_tests(void);
 void units_standard_add_tests(void);
+void units_timers_add_tests(void);
 void units_tlv_add_tests(void);
 
 #define REGISTER_UNITS                                                         \
   do {                                                                         \
+    units_alloc_add_tests();                                                   \
     units_auth_add_tests();                                                    \
     units_client_add_tests();                                                  \
     units_client_profile_add_tests();                                          \
@@ -58,9 +67,12 @@ void units_tlv_add_tests(void);
     units_dh_add_tests();                                                      \
     units_ed448_add_tests();                                                   \
     units_fragment_add_tests();                                                \
+    units_hash_index_add_tests();                                              \
     units_identity_message_add_tests();                                        \
     units_instance_tag_add_tests();                                            \
+    units_keccak_add_tests();                                                  \
     units_key_management_add_tests();                                          \
+    units_keypair_pool_add_tests();                                            \
     units_list_add_tests();                                                    \
     units_messaging_add_tests();                                               \
     units_non_interactive_messages_add_tests();                                \
@@ -71,10 +83,14 @@ void units_tlv_add_tests(void);
     units_prekey_manager_add_tests();                                          \
     units_prekey_messages_add_tests();                                         \
     units_prekey_profile_add_tests();                                          \
+    units_profile_cache_add_tests();                                           \
     units_prekey_proofs_add_tests();                                           \
     units_prekey_server_client_add_tests();                                    \
+    units_published_index_add_tests();                                         \
     units_serialize_add_tests();                                               \
+    units_skipped_keys_add_tests();                                            \
     units_standard_add_tests();                                                \
+    units_timers_add_tests();                                                  \
     units_tlv_add_tests();                                                     \
   } while (0);
 
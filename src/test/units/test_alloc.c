@@ -0,0 +1,143 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "test_helpers.h"
+
+#include "alloc.h"
+
+static otrng_bool is_zero(const uint8_t *p, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    if (p[i]) {
+      return otrng_false;
+    }
+  }
+  return otrng_true;
+}
+
+static void test_secure_alloc_is_zeroed() {
+  size_t sizes[] = {0, 1, 15, 16, 17, 57, 100, 1000, 2048, 2049, 10000};
+  size_t i;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    uint8_t *p = otrng_secure_alloc(sizes[i]);
+    otrng_assert(p);
+    otrng_assert(is_zero(p, sizes[i]));
+
+    memset(p, 0xAB, sizes[i]);
+    otrng_secure_free(p);
+
+    /* memory given back is wiped before it is handed out again */
+    p = otrng_secure_alloc(sizes[i]);
+    otrng_assert(is_zero(p, sizes[i]));
+    otrng_secure_free(p);
+  }
+
+  otrng_secure_free(NULL);
+}
+
+static void test_secure_alloc_array() {
+  uint32_t *p = otrng_secure_alloc_array(100, sizeof(uint32_t));
+  size_t i;
+
+  otrng_assert(p);
+  for (i = 0; i < 100; i++) {
+    p[i] = (uint32_t)i;
+  }
+  otrng_secure_free(p);
+
+  otrng_assert(!otrng_secure_alloc_array((size_t)-1, 2));
+}
+
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+static void test_secure_slab_reuses_slots() {
+  uint8_t *small[300];
+  uint8_t *big;
+  void *p, *q;
+  size_t i, j;
+
+  /* more than one region of the same class */
+  for (i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+    small[i] = otrng_secure_alloc(400);
+    otrng_assert(secure_slab_owns(small[i]));
+    memset(small[i], (int)i, 400);
+  }
+
+  for (i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+    for (j = 0; j < 400; j++) {
+      g_assert_cmpuint(small[i][j], ==, (uint8_t)i);
+    }
+  }
+
+  for (i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+    otrng_secure_free(small[i]);
+  }
+
+  p = otrng_secure_alloc(64);
+  otrng_secure_free(p);
+  q = otrng_secure_alloc(33);
+  otrng_assert(p == q);
+  otrng_secure_free(q);
+
+  big = otrng_secure_alloc(4096);
+  otrng_assert(!secure_slab_owns(big));
+  otrng_secure_free(big);
+}
+#endif
+
+static void test_secure_memory_stats() {
+  otrng_secure_memory_stats_s before = otrng_secure_memory_stats();
+  otrng_secure_memory_stats_s during, after;
+  uint8_t *small = otrng_secure_alloc(100);
+  uint8_t *big = otrng_secure_alloc(10000);
+
+  during = otrng_secure_memory_stats();
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+  /* the small one takes a slot of 128 bytes */
+  g_assert_cmpuint(during.slab_bytes_in_use, ==,
+                   before.slab_bytes_in_use + 128);
+  g_assert_cmpuint(during.slab_bytes, >=, during.slab_bytes_in_use);
+  g_assert_cmpuint(during.direct_allocations, ==,
+                   before.direct_allocations + 1);
+#else
+  g_assert_cmpuint(during.direct_allocations, ==,
+                   before.direct_allocations + 2);
+#endif
+
+  otrng_secure_free(small);
+  otrng_secure_free(big);
+
+  after = otrng_secure_memory_stats();
+  g_assert_cmpuint(after.slab_bytes_in_use, ==, before.slab_bytes_in_use);
+  g_assert_cmpuint(after.direct_allocations, ==, before.direct_allocations);
+}
+
+void units_alloc_add_tests(void) {
+  g_test_add_func("/alloc/secure_alloc_is_zeroed",
+                  test_secure_alloc_is_zeroed);
+  g_test_add_func("/alloc/secure_alloc_array", test_secure_alloc_array);
+  g_test_add_func("/alloc/secure_memory_stats", test_secure_memory_stats);
+#ifndef OTRNG_SECURE_SLAB_DISABLED
+  g_test_add_func("/alloc/secure_slab_reuses_slots",
+                  test_secure_slab_reuses_slots);
+#endif
+}
@@ -99,6 +99,59 @@ static void test_rsig_auth() {
                                  (unsigned char *)msg, strlen(msg)));
 }
 
+static void test_rsig_verify_rejects_tampering() {
+  const char *msg = "hi";
+  otrng_keypair_s p1, p2, p3;
+  uint8_t sym1[ED448_PRIVATE_BYTES] = {1}, sym2[ED448_PRIVATE_BYTES] = {2},
+          sym3[ED448_PRIVATE_BYTES] = {3};
+  ring_sig_s dst, tampered;
+
+  otrng_assert_is_success(otrng_keypair_generate(&p1, sym1));
+  otrng_assert_is_success(otrng_keypair_generate(&p2, sym2));
+  otrng_assert_is_success(otrng_keypair_generate(&p3, sym3));
+
+  /* the secret key in every position of the ring */
+  otrng_assert_is_success(
+      otrng_rsig_authenticate(&dst, p2.priv, p2.pub, p1.pub, p2.pub, p3.pub,
+                              (const uint8_t *)msg, strlen(msg)));
+  otrng_assert(otrng_rsig_verify(&dst, p1.pub, p2.pub, p3.pub,
+                                 (const uint8_t *)msg, strlen(msg)));
+
+  otrng_assert_is_success(
+      otrng_rsig_authenticate(&dst, p3.priv, p3.pub, p1.pub, p2.pub, p3.pub,
+                              (const uint8_t *)msg, strlen(msg)));
+  otrng_assert(otrng_rsig_verify(&dst, p1.pub, p2.pub, p3.pub,
+                                 (const uint8_t *)msg, strlen(msg)));
+
+  otrng_assert(!otrng_rsig_verify(&dst, p1.pub, p2.pub, p3.pub,
+                                  (const uint8_t *)"ho", 2));
+  otrng_assert(!otrng_rsig_verify(&dst, p2.pub, p1.pub, p3.pub,
+                                  (const uint8_t *)msg, strlen(msg)));
+
+  tampered = dst;
+  goldilocks_448_scalar_add(tampered.r1, tampered.r1,
+                            goldilocks_448_scalar_one);
+  otrng_assert(!otrng_rsig_verify(&tampered, p1.pub, p2.pub, p3.pub,
+                                  (const uint8_t *)msg, strlen(msg)));
+
+  tampered = dst;
+  goldilocks_448_scalar_add(tampered.c3, tampered.c3,
+                            goldilocks_448_scalar_one);
+  otrng_assert(!otrng_rsig_verify(&tampered, p1.pub, p2.pub, p3.pub,
+                                  (const uint8_t *)msg, strlen(msg)));
+
+  /* moving weight from one c to another keeps the sum, but not the T values */
+  tampered = dst;
+  goldilocks_448_scalar_add(tampered.c1, tampered.c1,
+                            goldilocks_448_scalar_one);
+  goldilocks_448_scalar_sub(tampered.c2, tampered.c2,
+                            goldilocks_448_scalar_one);
+  otrng_assert(!otrng_rsig_verify(&tampered, p1.pub, p2.pub, p3.pub,
+                                  (const uint8_t *)msg, strlen(msg)));
+
+  otrng_ring_sig_destroy(&dst);
+}
+
 static void test_rsig_compatible_with_prekey_server() {
   otrng_keypair_s p1, p2, p3;
 
@@ -538,6 +591,8 @@ static void test_rsig_compatible_with_prekey_server() {
 
 void units_auth_add_tests(void) {
   g_test_add_func("/ring-signature/rsig_auth", test_rsig_auth);
+  g_test_add_func("/ring-signature/verify_rejects_tampering",
+                  test_rsig_verify_rejects_tampering);
   g_test_add_func("/ring-signature/calculate_c", test_rsig_calculate_c);
   g_test_add_func("/ring-signature/compatible_with_prekey_server",
                   test_rsig_compatible_with_prekey_server);
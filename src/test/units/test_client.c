@@ -76,9 +76,60 @@ static void test_fingerprint_hash_to_human() {
                   strncmp(expected_fp, fp_human, OTRNG_FPRINT_HUMAN_LEN));
 }
 
+static void count_fingerprints(const otrng_client_s *client,
+                               otrng_known_fingerprint_s *fp, void *context) {
+  int *count = context;
+  (void)client;
+  (void)fp;
+  (*count)++;
+}
+
+static void test_client_known_fingerprints() {
+  otrng_client_s *alice = otrng_client_new(ALICE_IDENTITY);
+  otrng_fingerprint fp_bob = {1}, fp_bob2 = {2}, fp_charlie = {3};
+  otrng_fingerprint fp_unknown = {4};
+  otrng_known_fingerprint_s *bob, *bob2, *charlie;
+  int count = 0;
+
+  otrng_assert(!otrng_fingerprint_get_by_fp(alice, fp_bob));
+  otrng_assert(!otrng_fingerprint_get_by_username(alice, BOB_ACCOUNT));
+
+  bob = otrng_fingerprint_add(alice, fp_bob, BOB_ACCOUNT, otrng_false);
+  bob2 = otrng_fingerprint_add(alice, fp_bob2, BOB_ACCOUNT, otrng_true);
+  charlie =
+      otrng_fingerprint_add(alice, fp_charlie, CHARLIE_ACCOUNT, otrng_false);
+
+  otrng_assert(otrng_fingerprint_get_by_fp(alice, fp_bob) == bob);
+  otrng_assert(otrng_fingerprint_get_by_fp(alice, fp_bob2) == bob2);
+  otrng_assert(otrng_fingerprint_get_by_fp(alice, fp_charlie) == charlie);
+  otrng_assert(!otrng_fingerprint_get_by_fp(alice, fp_unknown));
+
+  otrng_assert(otrng_fingerprint_get_by_username(alice, BOB_ACCOUNT) == bob);
+  otrng_assert(otrng_fingerprint_get_by_username(alice, CHARLIE_ACCOUNT) ==
+               charlie);
+  otrng_assert(!otrng_fingerprint_get_by_username(alice, ALICE_ACCOUNT));
+
+  otrng_fingerprint_forget(alice, bob);
+  otrng_assert(!otrng_fingerprint_get_by_fp(alice, fp_bob));
+  otrng_assert(otrng_fingerprint_get_by_username(alice, BOB_ACCOUNT) == bob2);
+
+  otrng_fingerprints_do_all(alice, count_fingerprints, &count);
+  g_assert_cmpint(count, ==, 2);
+  otrng_assert(alice->fingerprints->fps.head->data == bob2);
+  otrng_assert(alice->fingerprints->fps.tail->data == charlie);
+
+  otrng_fingerprint_forget(alice, charlie);
+  otrng_assert(!otrng_fingerprint_get_by_username(alice, CHARLIE_ACCOUNT));
+  g_assert_cmpint(alice->fingerprints->fps.len, ==, 1);
+
+  otrng_client_free(alice);
+}
+
 void units_client_add_tests(void) {
   g_test_add_func("/client/fingerprint_to_human",
                   test_fingerprint_hash_to_human);
+  g_test_add_func("/client/known_fingerprints",
+                  test_client_known_fingerprints);
   g_test_add_func("/client/get_our_fingerprint",
                   test_client_get_our_fingerprint);
 }
@@ -213,6 +213,131 @@ static void test_otrng_data_message_deserializes() {
   otrng_free(ser);
 }
 
+static void test_data_message_deserializes_view() {
+  data_message_s *data_msg = set_up_data_message();
+  k_msg_mac mac_key = {0x01};
+
+  uint8_t *ser = NULL;
+  size_t ser_len = 0;
+  otrng_assert_is_success(
+      otrng_data_message_body_serialize(&ser, &ser_len, data_msg));
+
+  ser = otrng_xrealloc(ser, ser_len + DATA_MSG_MAC_BYTES);
+  otrng_assert_is_success(otrng_data_message_authenticator(
+      ser + ser_len, DATA_MSG_MAC_BYTES, mac_key, ser, ser_len));
+
+  data_message_s *deser = otrng_data_message_new();
+  otrng_assert_is_success(otrng_data_message_deserialize_view(
+      deser, ser, ser_len + DATA_MSG_MAC_BYTES, NULL, NULL));
+
+  /* The encrypted message and the body are not copied */
+  otrng_assert(deser->enc_msg > ser && deser->enc_msg < ser + ser_len);
+  otrng_assert_cmpmem(data_msg->enc_msg, deser->enc_msg, data_msg->enc_msg_len);
+  otrng_assert(deser->body == ser);
+  otrng_assert(deser->body_len == ser_len);
+
+  otrng_assert(otrng_valid_data_message(mac_key, deser) == otrng_true);
+
+  /* The body is authenticated as it was received */
+  ser[ser_len - 1] ^= 0x01;
+  otrng_assert(otrng_valid_data_message(mac_key, deser) == otrng_false);
+
+  /* A truncated message is not read past its end */
+  data_message_s *truncated = otrng_data_message_new();
+  otrng_assert_is_error(otrng_data_message_deserialize_view(
+      truncated, ser, ser_len - data_msg->enc_msg_len, NULL, NULL));
+
+  otrng_data_message_free(truncated);
+  otrng_data_message_free(deser);
+  otrng_data_message_free(data_msg);
+  otrng_free(ser);
+}
+
+static void test_data_message_serializes_encoded_keys() {
+  data_message_s *data_msg = set_up_data_message();
+  ratchet_keys_enc_s keys_enc;
+  uint8_t *ser = NULL, *ser_enc = NULL;
+  size_t ser_len = 0, ser_enc_len = 0;
+
+  memset(&keys_enc, 0, sizeof(keys_enc));
+  otrng_assert(otrng_serialize_ec_point(keys_enc.ecdh_enc, data_msg->ecdh));
+  otrng_assert_is_success(otrng_serialize_dh_public_key(
+      keys_enc.dh_enc, DH_MPI_MAX_BYTES, &keys_enc.dh_enc_len, data_msg->dh));
+  keys_enc.valid = otrng_true;
+
+  otrng_assert_is_success(
+      otrng_data_message_body_serialize(&ser, &ser_len, data_msg));
+
+  /* the keys themselves are not looked at */
+  otrng_dh_mpi_release(data_msg->dh);
+  data_msg->dh = NULL;
+  data_msg->keys_enc = &keys_enc;
+  otrng_assert_is_success(
+      otrng_data_message_body_serialize(&ser_enc, &ser_enc_len, data_msg));
+
+  g_assert_cmpuint(ser_len, ==, ser_enc_len);
+  otrng_assert_cmpmem(ser, ser_enc, ser_len);
+
+  otrng_free(ser);
+  otrng_free(ser_enc);
+  otrng_data_message_free(data_msg);
+}
+
+static void test_data_message_deserializes_known_keys() {
+  data_message_s *data_msg = set_up_data_message();
+  data_message_s *first = otrng_data_message_new();
+  data_message_s *second = otrng_data_message_new();
+  data_message_s *other = otrng_data_message_new();
+  k_msg_mac mac_key = {0x01};
+  ratchet_keys_enc_s known;
+  uint8_t *ser = NULL;
+  size_t ser_len = 0;
+
+  memset(&known, 0, sizeof(known));
+
+  otrng_assert_is_success(
+      otrng_data_message_body_serialize(&ser, &ser_len, data_msg));
+  ser = otrng_xrealloc(ser, ser_len + DATA_MSG_MAC_BYTES);
+  otrng_assert_is_success(otrng_data_message_authenticator(
+      ser + ser_len, DATA_MSG_MAC_BYTES, mac_key, ser, ser_len));
+
+  /* nothing is known yet */
+  otrng_assert_is_success(otrng_data_message_deserialize_view(
+      first, ser, ser_len + DATA_MSG_MAC_BYTES, NULL, &known));
+  otrng_assert(!first->ecdh_known);
+  otrng_assert(!first->dh_known);
+  otrng_assert(otrng_valid_data_message(mac_key, first));
+  otrng_data_message_remember_keys(&known, first);
+
+  otrng_assert(known.valid);
+  otrng_assert(otrng_ec_point_eq(known.ecdh, data_msg->ecdh));
+  otrng_assert(known.dh_enc_len > 4);
+
+  /* the same keys again are neither decoded nor validated again */
+  otrng_assert_is_success(otrng_data_message_deserialize_view(
+      second, ser, ser_len + DATA_MSG_MAC_BYTES, NULL, &known));
+  otrng_assert(second->ecdh_known);
+  otrng_assert(second->dh_known);
+  otrng_assert(otrng_ec_point_eq(second->ecdh, data_msg->ecdh));
+  otrng_assert(gcry_mpi_cmp(second->dh, data_msg->dh) == 0);
+  otrng_assert(otrng_valid_data_message(mac_key, second));
+
+  /* but different ones are */
+  known.ecdh_enc[0] ^= 0x01;
+  known.dh_enc[known.dh_enc_len - 1] ^= 0x01;
+  otrng_assert_is_success(otrng_data_message_deserialize_view(
+      other, ser, ser_len + DATA_MSG_MAC_BYTES, NULL, &known));
+  otrng_assert(!other->ecdh_known);
+  otrng_assert(!other->dh_known);
+  otrng_assert(otrng_ec_point_eq(other->ecdh, data_msg->ecdh));
+
+  otrng_data_message_free(first);
+  otrng_data_message_free(second);
+  otrng_data_message_free(other);
+  otrng_data_message_free(data_msg);
+  otrng_free(ser);
+}
+
 static void test_data_message_valid() {
   data_message_s *data_msg = set_up_data_message();
 
@@ -262,4 +387,10 @@ void units_data_message_add_tests(void) {
                   test_data_message_serializes_absent_dh);
   g_test_add_func("/data_message/deserialize",
                   test_otrng_data_message_deserializes);
+  g_test_add_func("/data_message/deserialize_view",
+                  test_data_message_deserializes_view);
+  g_test_add_func("/data_message/serialize_encoded_keys",
+                  test_data_message_serializes_encoded_keys);
+  g_test_add_func("/data_message/deserialize_known_keys",
+                  test_data_message_deserializes_known_keys);
 }
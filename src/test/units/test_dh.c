@@ -183,9 +183,86 @@ static void test_dh_keypair_destroy() {
   otrng_assert(!alice.pub);
 }
 
+static void test_dh_comb_matches_powm() {
+  unsigned int sizes[] = {0, 1, 8, DH_KEY_SIZE * 8 - 1, DH_KEY_SIZE * 8,
+                          DH_KEY_SIZE * 8 + 2, 1500, DH3072_MOD_LEN_BITS - 1};
+  gcry_mpi_t exponent = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  gcry_mpi_t expected = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  gcry_mpi_t got = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  size_t i;
+  int round;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (round = 0; round < 4; round++) {
+      gcry_mpi_set_ui(exponent, 0);
+      if (sizes[i] > 0) {
+        gcry_mpi_randomize(exponent, sizes[i], GCRY_WEAK_RANDOM);
+        /* make sure the top bit is set */
+        gcry_mpi_set_bit(exponent, sizes[i] - 1);
+      }
+
+      gcry_mpi_powm(expected, otrng_dh_mpi_generator(), exponent,
+                    otrng_dh_modulus_p());
+      otrng_assert_is_success(dh_comb_powm(got, exponent));
+      otrng_assert(gcry_mpi_cmp(expected, got) == 0);
+
+      otrng_dh_calculate_public_key(got, exponent);
+      otrng_assert(gcry_mpi_cmp(expected, got) == 0);
+    }
+  }
+
+  gcry_mpi_release(exponent);
+  gcry_mpi_release(expected);
+  gcry_mpi_release(got);
+}
+
+static void test_dh_multi_powm() {
+  /* the last one spans more than one chunk */
+  size_t counts[] = {0, 1, 3, 70};
+  gcry_mpi_t bases[70], exponents[70];
+  gcry_mpi_t expected = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  gcry_mpi_t power = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  gcry_mpi_t got = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+  size_t i, c;
+
+  for (i = 0; i < 70; i++) {
+    bases[i] = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+    gcry_mpi_randomize(bases[i], DH3072_MOD_LEN_BITS - 8, GCRY_WEAK_RANDOM);
+
+    exponents[i] = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+    if (i % 10 == 5) {
+      gcry_mpi_set_ui(exponents[i], i % 2);
+    } else {
+      gcry_mpi_randomize(exponents[i], 352 - i % 3, GCRY_WEAK_RANDOM);
+    }
+  }
+
+  for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    gcry_mpi_set_ui(expected, 1);
+    for (i = 0; i < counts[c]; i++) {
+      gcry_mpi_powm(power, bases[i], exponents[i], otrng_dh_modulus_p());
+      gcry_mpi_mulm(expected, expected, power, otrng_dh_modulus_p());
+    }
+
+    otrng_dh_multi_powm(got, (const dh_mpi *)bases, (const dh_mpi *)exponents,
+                        counts[c]);
+    otrng_assert(gcry_mpi_cmp(expected, got) == 0);
+  }
+
+  for (i = 0; i < 70; i++) {
+    gcry_mpi_release(bases[i]);
+    gcry_mpi_release(exponents[i]);
+  }
+  gcry_mpi_release(expected);
+  gcry_mpi_release(power);
+  gcry_mpi_release(got);
+}
+
 void units_dh_add_tests(void) {
   g_test_add_func("/dh/api", test_dh_api);
   g_test_add_func("/dh/serialize", test_dh_serialize);
   g_test_add_func("/dh/shared-secret", test_dh_shared_secret);
   g_test_add_func("/dh/destroy", test_dh_keypair_destroy);
+  g_test_add_func("/dh/comb-matches-powm", test_dh_comb_matches_powm);
+  g_test_add_func("/dh/multi-powm", test_dh_multi_powm);
 }
@@ -93,6 +93,39 @@ static void test_ed448_signature() {
   otrng_keypair_free(pair);
 }
 
+static void test_ed448_multi_scalarmul() {
+  /* the last one spans more than one chunk */
+  size_t counts[] = {0, 1, 3, 70};
+  ec_point points[70], expected, got, term;
+  ec_scalar scalars[70];
+  uint8_t buff[ED448_SCALAR_BYTES];
+  size_t i, c;
+
+  for (i = 0; i < 70; i++) {
+    random_bytes(buff, ED448_SCALAR_BYTES);
+    goldilocks_448_scalar_decode_long(scalars[i], buff, ED448_SCALAR_BYTES);
+    goldilocks_448_point_scalarmul(points[i], goldilocks_448_point_base,
+                                   scalars[i]);
+
+    /* the proofs use scalars of 352 bits */
+    random_bytes(buff, ED448_SCALAR_BYTES);
+    goldilocks_448_scalar_decode_long(scalars[i], buff, i % 2 ? 44 : 56);
+  }
+  goldilocks_448_scalar_copy(scalars[2], goldilocks_448_scalar_zero);
+
+  for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    goldilocks_448_point_copy(expected, goldilocks_448_point_identity);
+    for (i = 0; i < counts[c]; i++) {
+      goldilocks_448_point_scalarmul(term, points[i], scalars[i]);
+      goldilocks_448_point_add(expected, expected, term);
+    }
+
+    otrng_ec_multi_scalarmul(got, (const ec_point *)points,
+                             (const ec_scalar *)scalars, counts[c]);
+    otrng_assert(otrng_ec_point_eq(expected, got) == otrng_true);
+  }
+}
+
 void units_ed448_add_tests(void) {
   g_test_add_func("/edwards448/eddsa_serialization",
                   test_ed448_eddsa_serialization);
@@ -100,4 +133,5 @@ void units_ed448_add_tests(void) {
   g_test_add_func("/edwards448/scalar_serialization",
                   test_ed448_scalar_serialization);
   g_test_add_func("/edwards448/signature", test_ed448_signature);
+  g_test_add_func("/edwards448/multi_scalarmul", test_ed448_multi_scalarmul);
 }
@@ -71,62 +71,107 @@ static void test_create_fragments_smaller_than_max_size(void) {
   otrng_message_free(frag_message);
 }
 
+static void test_create_contiguous_fragments(void) {
+  int max_size = 48;
+  const char *message = "one two tree";
+
+  otrng_message_to_send_s *frag_message =
+      otrng_xmalloc_z(sizeof(otrng_message_to_send_s));
+
+  otrng_assert_is_success(
+      otrng_fragment_message_contiguous(max_size, frag_message, 1, 2, message));
+
+  otrng_assert(frag_message->contiguous);
+  g_assert_cmpint(frag_message->total, ==, 4);
+
+  g_assert_cmpstr(frag_message->pieces[0] + 14, ==,
+                  "00000001|00000002,00001,00004,one,");
+  g_assert_cmpstr(frag_message->pieces[1] + 14, ==,
+                  "00000001|00000002,00002,00004, tw,");
+  g_assert_cmpstr(frag_message->pieces[2] + 14, ==,
+                  "00000001|00000002,00003,00004,o t,");
+  g_assert_cmpstr(frag_message->pieces[3] + 14, ==,
+                  "00000001|00000002,00004,00004,ree,");
+
+  /* All the pieces belong to the same message */
+  otrng_assert(strncmp(frag_message->pieces[0], frag_message->pieces[3], 14) ==
+               0);
+
+  otrng_message_free(frag_message);
+}
+
+static void test_create_fragments_fails_for_small_max_size(void) {
+  otrng_message_to_send_s *frag_message =
+      otrng_xmalloc_z(sizeof(otrng_message_to_send_s));
+
+  otrng_assert_is_error(otrng_fragment_message_contiguous(
+      FRAGMENT_HEADER_LEN, frag_message, 1, 2, "one two"));
+  otrng_assert_is_error(
+      otrng_fragment_message(FRAGMENT_HEADER_LEN, frag_message, 1, 2, "one"));
+
+  otrng_message_free(frag_message);
+}
+
 static void test_defragment_valid_message(void) {
   const string_p fragments[2];
   fragments[0] = "?OTR|00000000|00000001|00000002,00001,00002,one ,";
   fragments[1] = "?OTR|00000000|00000001|00000002,00002,00002,more,";
 
   fragment_context_s *context = NULL;
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
   char *unfrag = NULL;
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[0], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[0], 2));
 
-  context = list->data;
+  context = store.oldest;
   g_assert_cmpint(context->total, ==, 2);
   g_assert_cmpint(context->count, ==, 1);
   otrng_assert(!unfrag);
 
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[1], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[1], 2));
 
-  otrng_assert(otrng_list_len(list) == 0);
+  otrng_assert(store.count == 0);
   g_assert_cmpstr(unfrag, ==, "one more");
 
   otrng_free(unfrag);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_single_fragment(void) {
   const string_p message =
       "?OTR|00000000|00000001|00000002,00001,00001,small lol,";
 
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
   char *unfrag = NULL;
 
-  otrng_assert_is_success(otrng_unfragment_message(&unfrag, &list, message, 2));
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, message, 2));
 
-  otrng_assert(otrng_list_len(list) == 0);
+  otrng_assert(store.count == 0);
   g_assert_cmpstr(unfrag, ==, "small lol");
 
   otrng_free(unfrag);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_without_comma_fails(void) {
   const string_p message = "?OTR|00000000|00000001|00000002,00001,00001,blergh";
 
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
   char *unfrag = NULL;
-  otrng_assert_is_error(otrng_unfragment_message(&unfrag, &list, message, 2));
+  otrng_assert_is_error(otrng_unfragment_message(&unfrag, &store, message, 2));
 
-  otrng_assert(list == NULL);
+  otrng_assert(store.oldest == NULL);
   g_assert_cmpstr(unfrag, ==, NULL);
 
   otrng_free(unfrag);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_with_different_total_fails(void) {
@@ -135,27 +180,27 @@ static void test_defragment_with_different_total_fails(void) {
   fragments[1] = "?OTR|00000000|00000001|00000002,00002,00002,total,";
 
   fragment_context_s *context = NULL;
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
   char *unfrag = NULL;
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[0], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[0], 2));
   otrng_assert(!unfrag);
 
-  context = list->data;
+  context = store.oldest;
   g_assert_cmpint(context->total, ==, 3);
   g_assert_cmpint(context->count, ==, 1);
 
   otrng_assert_is_error(
-      otrng_unfragment_message(&unfrag, &list, fragments[1], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[1], 2));
 
-  context = list->data;
+  context = store.oldest;
   otrng_assert(!unfrag);
   g_assert_cmpint(context->total, ==, 3);
   g_assert_cmpint(context->count, ==, 1);
 
-  otrng_fragment_context_free(context);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_fragment_twice_fails(void) {
@@ -164,26 +209,26 @@ static void test_defragment_fragment_twice_fails(void) {
   fragments[1] = "?OTR|00000000|00000001|00000002,00001,00002,same twice,";
 
   fragment_context_s *context = NULL;
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
   char *unfrag = NULL;
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[0], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[0], 2));
 
-  context = list->data;
+  context = store.oldest;
   otrng_assert(!unfrag);
   g_assert_cmpint(context->total, ==, 2);
   g_assert_cmpint(context->count, ==, 1);
 
   otrng_assert_is_error(
-      otrng_unfragment_message(&unfrag, &list, fragments[1], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[1], 2));
 
   otrng_assert(!unfrag);
   g_assert_cmpint(context->total, ==, 2);
   g_assert_cmpint(context->count, ==, 1);
 
-  otrng_fragment_context_free(context);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_out_of_order_message(void) {
@@ -193,61 +238,66 @@ static void test_defragment_out_of_order_message(void) {
   fragments[2] = "?OTR|00000000|00000001|00000002,00001,00003,one more ,";
 
   fragment_context_s *context = NULL;
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
   char *unfrag = NULL;
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[0], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[0], 2));
 
-  context = list->data;
+  context = store.oldest;
   otrng_assert(!unfrag);
   g_assert_cmpint(context->total, ==, 3);
   g_assert_cmpint(context->count, ==, 1);
 
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[1], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[1], 2));
   otrng_assert(!unfrag);
   g_assert_cmpint(context->total, ==, 3);
   g_assert_cmpint(context->count, ==, 2);
 
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, fragments[2], 2));
+      otrng_unfragment_message(&unfrag, &store, fragments[2], 2));
   g_assert_cmpstr(unfrag, ==, "one more fragment send");
 
-  otrng_assert(otrng_list_len(list) == 0);
+  otrng_assert(store.count == 0);
 
   otrng_free(unfrag);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_fails_for_another_instance(void) {
   const string_p message =
       "?OTR|00000000|00000001|00000002,00001,00001,small lol,";
 
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
   char *unfrag = NULL;
 
-  otrng_assert_is_success(otrng_unfragment_message(&unfrag, &list, message, 1));
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, message, 1));
 
-  otrng_assert(list == NULL);
+  otrng_assert(store.oldest == NULL);
   g_assert_cmpstr(unfrag, ==, NULL);
 
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_regular_otr_message(void) {
   const string_p message = "?OTR:not a fragmented message.";
 
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
   char *unfrag = NULL;
 
-  otrng_assert_is_success(otrng_unfragment_message(&unfrag, &list, message, 1));
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, message, 1));
 
-  otrng_assert(list == NULL);
+  otrng_assert(store.oldest == NULL);
   g_assert_cmpstr(unfrag, ==, message);
 
   otrng_free(unfrag);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_defragment_two_messages(void) {
@@ -261,62 +311,245 @@ static void test_defragment_two_messages(void) {
   message2_fragments[1] =
       "?OTR|00000002|00000001|00000002,00002,00002,message,";
 
-  list_element_s *list = NULL;
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
   char *unfrag = NULL;
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, message1_fragments[0], 2));
+      otrng_unfragment_message(&unfrag, &store, message1_fragments[0], 2));
 
   otrng_assert(!unfrag);
-  otrng_assert(otrng_list_len(list) == 1);
+  otrng_assert(store.count == 1);
 
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, message2_fragments[0], 2));
+      otrng_unfragment_message(&unfrag, &store, message2_fragments[0], 2));
   otrng_assert(!unfrag);
-  otrng_assert(otrng_list_len(list) == 2);
+  otrng_assert(store.count == 2);
 
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, message2_fragments[1], 2));
+      otrng_unfragment_message(&unfrag, &store, message2_fragments[1], 2));
   g_assert_cmpstr(unfrag, ==, "second message");
-  otrng_assert(otrng_list_len(list) == 1);
+  otrng_assert(store.count == 1);
 
   otrng_free(unfrag);
   unfrag = NULL;
 
   otrng_assert_is_success(
-      otrng_unfragment_message(&unfrag, &list, message1_fragments[1], 2));
+      otrng_unfragment_message(&unfrag, &store, message1_fragments[1], 2));
   g_assert_cmpstr(unfrag, ==, "first message");
-  otrng_assert(otrng_list_len(list) == 0);
+  otrng_assert(store.count == 0);
 
   otrng_free(unfrag);
-  otrng_list_free_nodes(list);
+  otrng_fragment_store_destroy(&store);
 }
 
 static void test_expiration_of_fragments(void) {
   time_t HOUR_IN_SEC = 3600;
-  list_element_s *list = NULL;
-  fragment_context_s *ctx1 = otrng_fragment_context_new();
-  fragment_context_s *ctx2 = otrng_fragment_context_new();
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
 
-  ctx1->last_fragment_received_at = HOUR_IN_SEC;
-  ctx2->last_fragment_received_at = HOUR_IN_SEC + 2;
+  char *unfrag = NULL;
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000001|00000001|00000002,00001,00002,old,",
+      2));
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000002|00000001|00000002,00001,00002,new,",
+      2));
+  otrng_assert(!unfrag);
+  otrng_assert(store.count == 2);
 
-  list = otrng_list_add(ctx1, list);
-  list = otrng_list_add(ctx2, list);
+  store.oldest->last_fragment_received_at = HOUR_IN_SEC;
+  store.newest->last_fragment_received_at = HOUR_IN_SEC + 2;
 
   time_t now = HOUR_IN_SEC + 1;
-  otrng_assert_is_success(otrng_expire_fragments(now, 5, &list));
-  otrng_assert(otrng_list_len(list) == 1);
+  otrng_assert_is_success(otrng_expire_fragments(now, 5, &store));
+  otrng_assert(store.count == 2);
+
+  now = HOUR_IN_SEC + 5;
+  otrng_assert_is_success(otrng_expire_fragments(now, 5, &store));
+  otrng_assert(store.count == 1);
+  g_assert_cmpint(store.oldest->identifier, ==, 2);
+
+  now = HOUR_IN_SEC + 7;
+  otrng_assert_is_success(otrng_expire_fragments(now, 5, &store));
+  otrng_assert(store.count == 0);
+  otrng_assert(store.buffered_bytes == 0);
+
+  otrng_fragment_store_destroy(&store);
+}
+
+static void test_defragment_separates_senders(void) {
+  const string_p fragments[4];
+  fragments[0] = "?OTR|00000001|00000011|00000002,00001,00002,from ,";
+  fragments[1] = "?OTR|00000001|00000012|00000002,00001,00002,also from ,";
+  fragments[2] = "?OTR|00000001|00000012|00000002,00002,00002,the second,";
+  fragments[3] = "?OTR|00000001|00000011|00000002,00002,00002,the first,";
 
-  now = HOUR_IN_SEC + 3;
-  otrng_assert_is_success(otrng_expire_fragments(now, 5, &list));
-  otrng_assert(otrng_list_len(list) == 0);
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
+
+  char *unfrag = NULL;
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, fragments[0], 2));
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, fragments[1], 2));
+  otrng_assert(!unfrag);
+  otrng_assert(store.count == 2);
+
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, fragments[2], 2));
+  g_assert_cmpstr(unfrag, ==, "also from the second");
+  otrng_free(unfrag);
+  unfrag = NULL;
+
+  otrng_assert_is_success(
+      otrng_unfragment_message(&unfrag, &store, fragments[3], 2));
+  g_assert_cmpstr(unfrag, ==, "from the first");
+  otrng_assert(store.count == 0);
+
+  otrng_free(unfrag);
+  otrng_fragment_store_destroy(&store);
+}
+
+static void test_defragment_malformed_header_fails(void) {
+  const string_p messages[4];
+  messages[0] = "?OTR|0000000g|00000001|00000002,00001,00002,piece,";
+  messages[1] = "?OTR|000000001|00000001|00000002,00001,00002,piece,";
+  messages[2] = "?OTR|00000001|00000001|00000002,70000,70000,piece,";
+  messages[3] = "?OTR|00000001|00000001|00000002,00001,,piece,";
+
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
+
+  char *unfrag = NULL;
+  int i;
+  for (i = 0; i < 4; i++) {
+    otrng_assert_is_error(
+        otrng_unfragment_message(&unfrag, &store, messages[i], 2));
+    otrng_assert(!unfrag);
+  }
+
+  otrng_assert(store.count == 0);
+
+  otrng_fragment_store_destroy(&store);
+}
+
+static void test_defragment_is_bounded(void) {
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
+  store.max_buffered_bytes = 2 * sizeof(fragment_context_s) + 100;
+
+  char *unfrag = NULL;
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000001|00000001|00000002,00001,00002,first,",
+      2));
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000002|00000001|00000002,00001,00002,second,",
+      2));
+  otrng_assert(store.count == 2);
+  otrng_assert(store.buffered_bytes <= store.max_buffered_bytes);
+
+  /* The oldest message is dropped to make room */
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000003|00000001|00000002,00001,00002,third,",
+      2));
+  otrng_assert(!unfrag);
+  otrng_assert(store.count == 2);
+  g_assert_cmpint(store.oldest->identifier, ==, 2);
+  otrng_assert(store.buffered_bytes <= store.max_buffered_bytes);
+
+  /* A message that does not fit on its own is refused */
+  store.max_buffered_bytes = sizeof(fragment_context_s) + 64;
+  otrng_assert_is_error(otrng_unfragment_message(
+      &unfrag, &store,
+      "?OTR|00000004|00000001|00000002,00001,00001,"
+      "a piece that is much longer than what the store allows to keep for a "
+      "single message,",
+      2));
+  otrng_assert(!unfrag);
+  otrng_assert(store.count == 0);
+  otrng_assert(store.buffered_bytes == 0);
+
+  otrng_fragment_store_destroy(&store);
+}
+
+static void test_defragment_large_total_keeps_other_messages(void) {
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
+
+  char *unfrag = NULL;
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000001|00000001|00000002,00001,00002,first,",
+      2));
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000002|00000001|00000002,00001,00002,second,",
+      2));
+
+  /* Room for the pieces of the third message and a bit less than what it
+   * would need if all of them were as long as the first one */
+  store.max_buffered_bytes = store.buffered_bytes + sizeof(fragment_context_s) +
+                             65535 * (sizeof(fragment_piece_s) + 20) - 16;
+
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store,
+      "?OTR|00000003|00000001|00000002,00001,65535,01234567890123456789,", 2));
+  otrng_assert(!unfrag);
+  otrng_assert(store.count == 3);
+  g_assert_cmpint(store.oldest->identifier, ==, 1);
+  otrng_assert(store.buffered_bytes <= store.max_buffered_bytes);
+
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000001|00000001|00000002,00002,00002,done,",
+      2));
+  g_assert_cmpstr(unfrag, ==, "firstdone");
+  otrng_assert(store.count == 2);
+
+  otrng_free(unfrag);
+  otrng_fragment_store_destroy(&store);
+}
+
+static void test_defragment_keeps_order_of_last_fragment(void) {
+  fragment_store_s store;
+  otrng_fragment_store_init(&store);
+
+  char *unfrag = NULL;
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000001|00000001|00000002,00001,00003,one,", 2));
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000002|00000001|00000002,00001,00003,two,", 2));
+  g_assert_cmpint(store.oldest->identifier, ==, 1);
+
+  /* A new fragment makes the message the last one to expire */
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000001|00000001|00000002,00002,00003,one,", 2));
+  otrng_assert(!unfrag);
+  g_assert_cmpint(store.oldest->identifier, ==, 2);
+  g_assert_cmpint(store.newest->identifier, ==, 1);
+
+  time_t at;
+  otrng_assert(otrng_fragments_next_expiry(&at, 5, &store));
+  otrng_assert(at == store.oldest->last_fragment_received_at + 5);
+
+  /* And the last one to be dropped to make room */
+  store.max_buffered_bytes = store.buffered_bytes;
+  otrng_assert_is_success(otrng_unfragment_message(
+      &unfrag, &store, "?OTR|00000003|00000001|00000002,00001,00003,three,",
+      2));
+  otrng_assert(store.count == 2);
+  g_assert_cmpint(store.oldest->identifier, ==, 1);
+  g_assert_cmpint(store.newest->identifier, ==, 3);
+
+  otrng_fragment_store_destroy(&store);
 }
 
 void units_fragment_add_tests(void) {
   g_test_add_func("/fragment/create_fragments_smaller_than_max_size",
                   test_create_fragments_smaller_than_max_size);
   g_test_add_func("/fragment/create_fragments", test_create_fragments);
+  g_test_add_func("/fragment/create_contiguous_fragments",
+                  test_create_contiguous_fragments);
+  g_test_add_func("/fragment/create_fragments_fails_for_small_max_size",
+                  test_create_fragments_fails_for_small_max_size);
   g_test_add_func("/fragment/defragment_message",
                   test_defragment_valid_message);
   g_test_add_func("/fragment/defragment_single_fragment",
@@ -327,6 +560,16 @@ void units_fragment_add_tests(void) {
                   test_defragment_without_comma_fails);
   g_test_add_func("/fragment/defragment_with_different_total_fails",
                   test_defragment_with_different_total_fails);
+  g_test_add_func("/fragment/defragment_separates_senders",
+                  test_defragment_separates_senders);
+  g_test_add_func("/fragment/defragment_malformed_header_fails",
+                  test_defragment_malformed_header_fails);
+  g_test_add_func("/fragment/defragment_is_bounded",
+                  test_defragment_is_bounded);
+  g_test_add_func("/fragment/defragment_large_total_keeps_other_messages",
+                  test_defragment_large_total_keeps_other_messages);
+  g_test_add_func("/fragment/defragment_keeps_order_of_last_fragment",
+                  test_defragment_keeps_order_of_last_fragment);
   g_test_add_func("/fragment/defragment_fragment_twice_fails",
                   test_defragment_fragment_twice_fails);
   g_test_add_func("/fragment/fails_for_another_instance",
@@ -0,0 +1,166 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "hash_index.h"
+
+static int int_matches(const void *item, const void *key) {
+  return *(const int *)item == *(const int *)key;
+}
+
+static void test_hash_index_add_find_remove() {
+  hash_index_s index;
+  int values[100];
+  int i, missing = 100;
+
+  otrng_hash_index_init(&index);
+  otrng_assert(!otrng_hash_index_find(&index, 0, int_matches, &missing));
+
+  for (i = 0; i < 100; i++) {
+    values[i] = i;
+    otrng_hash_index_add(
+        &index, otrng_hash_index_hash(&index, 0, &values[i], sizeof(int)),
+        &values[i]);
+  }
+  g_assert_cmpint(otrng_hash_index_size(&index), ==, 100);
+
+  for (i = 0; i < 100; i++) {
+    otrng_assert(otrng_hash_index_find(
+                     &index, otrng_hash_index_hash(&index, 0, &i, sizeof(int)),
+                     int_matches, &i) == &values[i]);
+  }
+
+  otrng_assert(!otrng_hash_index_find(
+      &index, otrng_hash_index_hash(&index, 0, &missing, sizeof(int)),
+      int_matches, &missing));
+
+  for (i = 0; i < 100; i += 2) {
+    otrng_assert_is_success(otrng_hash_index_remove(
+        &index, otrng_hash_index_hash(&index, 0, &i, sizeof(int)),
+        &values[i]));
+  }
+  g_assert_cmpint(otrng_hash_index_size(&index), ==, 50);
+
+  for (i = 0; i < 100; i++) {
+    void *found = otrng_hash_index_find(
+        &index, otrng_hash_index_hash(&index, 0, &i, sizeof(int)), int_matches,
+        &i);
+    if (i % 2) {
+      otrng_assert(found == &values[i]);
+    } else {
+      otrng_assert(!found);
+    }
+  }
+
+  otrng_assert_is_error(otrng_hash_index_remove(
+      &index, otrng_hash_index_hash(&index, 0, &values[0], sizeof(int)),
+      &values[0]));
+
+  otrng_hash_index_destroy(&index);
+}
+
+static void test_hash_index_colliding_hashes() {
+  hash_index_s index;
+  int values[40];
+  int i;
+
+  otrng_hash_index_init(&index);
+
+  /* Every item lands in the same buckets */
+  for (i = 0; i < 40; i++) {
+    values[i] = i;
+    otrng_hash_index_add(&index, 7, &values[i]);
+  }
+
+  for (i = 0; i < 40; i += 3) {
+    otrng_assert_is_success(otrng_hash_index_remove(&index, 7, &values[i]));
+  }
+
+  for (i = 0; i < 40; i++) {
+    void *found = otrng_hash_index_find(&index, 7, int_matches, &i);
+    if (i % 3) {
+      otrng_assert(found == &values[i]);
+    } else {
+      otrng_assert(!found);
+    }
+  }
+
+  otrng_hash_index_destroy(&index);
+}
+
+static int always_matches(const void *item, const void *key) {
+  (void)item;
+  (void)key;
+  return 1;
+}
+
+static void test_hash_index_find_next() {
+  hash_index_s index;
+  int values[3] = {1, 2, 3};
+  int other = 4;
+  const char *name = "alice";
+  uint64_t hash;
+  size_t cursor = 0;
+  int found = 0;
+  int *item;
+
+  otrng_hash_index_init(&index);
+  hash = otrng_hash_index_hash(&index, 0, name, strlen(name));
+
+  otrng_hash_index_add(&index, hash, &values[0]);
+  otrng_hash_index_add(&index, hash + 1, &other);
+  otrng_hash_index_add(&index, hash, &values[1]);
+  otrng_hash_index_add(&index, hash, &values[2]);
+
+  while ((item = otrng_hash_index_find_next(&index, hash, always_matches, NULL,
+                                            &cursor))) {
+    otrng_assert(item != &other);
+    found += *item;
+  }
+  g_assert_cmpint(found, ==, 6);
+
+  otrng_hash_index_destroy(&index);
+}
+
+static void test_hash_index_hash_is_seeded() {
+  hash_index_s index;
+  const char *name = "alice";
+
+  otrng_hash_index_init(&index);
+
+  otrng_assert(otrng_hash_index_hash(&index, 0, name, strlen(name)) ==
+               otrng_hash_index_hash(&index, 0, name, strlen(name)));
+  otrng_assert(otrng_hash_index_hash(&index, 0, name, strlen(name)) !=
+               otrng_hash_index_hash(&index, 1, name, strlen(name)));
+
+  otrng_hash_index_destroy(&index);
+}
+
+void units_hash_index_add_tests(void) {
+  g_test_add_func("/hash_index/add_find_remove",
+                  test_hash_index_add_find_remove);
+  g_test_add_func("/hash_index/colliding_hashes",
+                  test_hash_index_colliding_hashes);
+  g_test_add_func("/hash_index/find_next", test_hash_index_find_next);
+  g_test_add_func("/hash_index/hash_is_seeded", test_hash_index_hash_is_seeded);
+}
@@ -183,7 +183,7 @@ static void test_dake_identity_message_valid(dake_fixture_s *f,
 
   otrng_assert(otrng_valid_received_values(identity_msg->sender_instance_tag,
                                            identity_msg->Y, identity_msg->B,
-                                           identity_msg->profile));
+                                           identity_msg->profile, NULL));
 
   otrng_ecdh_keypair_destroy(&ecdh);
   otrng_dh_keypair_destroy(&dh);
@@ -216,7 +216,7 @@ static void test_dake_identity_message_valid(dake_fixture_s *f,
 
   otrng_assert(!otrng_valid_received_values(
       invalid_identity_msg->sender_instance_tag, invalid_identity_msg->Y,
-      invalid_identity_msg->B, invalid_identity_msg->profile));
+      invalid_identity_msg->B, invalid_identity_msg->profile, NULL));
 
   otrng_client_profile_free(invalid_profile);
   otrng_ecdh_keypair_destroy(&invalid_ecdh);
@@ -0,0 +1,123 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "keccak.h"
+#include "shake.h"
+
+static void shake_256_reference(uint8_t *dst, size_t dst_len,
+                                const uint8_t *prefix, size_t prefix_len,
+                                const uint8_t *src, size_t src_len) {
+  goldilocks_shake256_ctx_p hd;
+
+  hash_init(hd);
+  hash_update(hd, prefix, prefix_len);
+  hash_update(hd, src, src_len);
+  hash_final(hd, dst, dst_len);
+  hash_destroy(hd);
+}
+
+static void test_keccak_lanes_match_shake_256() {
+  const size_t limits[] = {1, 4, OTRNG_KECCAK_MAX_LANES};
+  const size_t lengths[][3] = {
+      /* prefix, src, dst */
+      {6, 64, 64}, {7, 64, 64}, {0, 0, 32},     {0, 135, 64},
+      {1, 135, 64}, {0, 136, 64}, {5, 200, 137}, {100, 300, 300},
+  };
+  uint8_t prefix[100];
+  uint8_t src[9][300];
+  uint8_t dst[9][300];
+  uint8_t expected[300];
+  const uint8_t *srcs[9];
+  uint8_t *dsts[9];
+  size_t l, t, count, i;
+
+  for (i = 0; i < sizeof(prefix); i++) {
+    prefix[i] = (uint8_t)(7 * i + 1);
+  }
+
+  for (i = 0; i < 9; i++) {
+    memset(src[i], (int)i + 1, sizeof(src[i]));
+    src[i][0] = (uint8_t)i;
+    srcs[i] = src[i];
+    dsts[i] = dst[i];
+  }
+
+  for (l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+    otrng_keccak_limit_lanes(limits[l]);
+    otrng_assert(otrng_keccak_lanes() <= limits[l]);
+
+    for (t = 0; t < sizeof(lengths) / sizeof(lengths[0]); t++) {
+      for (count = 1; count <= 9; count++) {
+        memset(dst, 0, sizeof(dst));
+        otrng_assert_is_success(otrng_shake_256_lanes(
+            dsts, lengths[t][2], prefix, lengths[t][0], srcs, lengths[t][1],
+            count));
+
+        for (i = 0; i < count; i++) {
+          shake_256_reference(expected, lengths[t][2], prefix, lengths[t][0],
+                              src[i], lengths[t][1]);
+          otrng_assert_cmpmem(expected, dst[i], lengths[t][2]);
+        }
+      }
+    }
+  }
+
+  otrng_keccak_limit_lanes(OTRNG_KECCAK_MAX_LANES);
+}
+
+static void test_keccak_kdf_lanes() {
+  uint8_t magic[1] = {0xFF};
+  uint8_t values[5][64];
+  uint8_t dst[5][64];
+  uint8_t expected[64];
+  uint8_t input[65];
+  const uint8_t *srcs[5];
+  uint8_t *dsts[5];
+  size_t i;
+
+  for (i = 0; i < 5; i++) {
+    memset(values[i], (int)i, sizeof(values[i]));
+    srcs[i] = values[i];
+    dsts[i] = dst[i];
+  }
+
+  otrng_assert_is_success(shake_256_kdf1_lanes(dsts, sizeof(dst[0]), 0x19,
+                                               magic, sizeof(magic), srcs,
+                                               sizeof(values[0]), 5));
+
+  for (i = 0; i < 5; i++) {
+    input[0] = magic[0];
+    memcpy(input + 1, values[i], sizeof(values[i]));
+    otrng_assert_is_success(
+        shake_256_kdf1(expected, sizeof(expected), 0x19, input, sizeof(input)));
+    otrng_assert_cmpmem(expected, dst[i], sizeof(expected));
+  }
+}
+
+void units_keccak_add_tests(void) {
+  g_test_add_func("/keccak/lanes_match_shake_256",
+                  test_keccak_lanes_match_shake_256);
+  g_test_add_func("/keccak/kdf_lanes", test_keccak_kdf_lanes);
+}
@@ -22,7 +22,9 @@
 
 #include "test_helpers.h"
 
+#include "keccak.h"
 #include "key_management.h"
+#include "serialize.h"
 #include "shake.h"
 
 static void test_derive_ratchet_keys() {
@@ -96,13 +98,147 @@ static void test_calculate_extra_symm_key() {
 
   memcpy(s, manager.current->chain_s, sizeof(k_sending_chain));
 
-  calculate_extra_key(&manager, NULL, 's');
+  k_msg_enc enc_key;
+  otrng_assert_is_success(derive_message_keys(
+      enc_key, manager.extra_symmetric_key, manager.current->chain_s));
   otrng_assert_cmpmem(expected_extra_key, manager.extra_symmetric_key,
                       EXTRA_SYMMETRIC_KEY_BYTES);
 
   otrng_key_manager_destroy(&manager);
 }
 
+static void test_derive_message_keys() {
+  uint8_t chain_key[CHAIN_KEY_BYTES];
+  uint8_t expected_chain_key[CHAIN_KEY_BYTES];
+  uint8_t magic_and_chain_key[1 + CHAIN_KEY_BYTES] = {0xFF};
+  k_msg_enc enc_key, expected_enc_key;
+  uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  uint8_t expected_extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  int i;
+
+  for (i = 0; i < CHAIN_KEY_BYTES; i++) {
+    chain_key[i] = (uint8_t)i;
+  }
+  memcpy(magic_and_chain_key + 1, chain_key, CHAIN_KEY_BYTES);
+
+  otrng_assert_is_success(shake_256_kdf1(expected_enc_key, ENC_KEY_BYTES, 0x17,
+                                         chain_key, CHAIN_KEY_BYTES));
+  otrng_assert_is_success(shake_256_kdf1(expected_extra_key,
+                                         EXTRA_SYMMETRIC_KEY_BYTES, 0x19,
+                                         magic_and_chain_key,
+                                         sizeof(magic_and_chain_key)));
+  otrng_assert_is_success(shake_256_kdf1(expected_chain_key, CHAIN_KEY_BYTES,
+                                         0x16, chain_key, CHAIN_KEY_BYTES));
+
+  otrng_assert_is_success(derive_message_keys(enc_key, extra_key, chain_key));
+  otrng_assert_cmpmem(expected_enc_key, enc_key, ENC_KEY_BYTES);
+  otrng_assert_cmpmem(expected_extra_key, extra_key,
+                      EXTRA_SYMMETRIC_KEY_BYTES);
+  otrng_assert_cmpmem(expected_chain_key, chain_key, CHAIN_KEY_BYTES);
+}
+
+static void test_store_skipped_keys_in_lanes() {
+  const size_t limits[] = {1, 4, OTRNG_KECCAK_MAX_LANES};
+  const uint32_t msg_id = 19;
+  size_t l;
+  uint32_t k;
+
+  for (l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+    key_manager_s *manager = otrng_key_manager_new();
+    receiving_ratchet_s *ratchet;
+    uint8_t chain_key[CHAIN_KEY_BYTES];
+    uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+    k_msg_enc enc_key, expected_enc_key;
+    k_msg_mac mac_key;
+    int i;
+
+    otrng_keccak_limit_lanes(limits[l]);
+
+    for (i = 0; i < CHAIN_KEY_BYTES; i++) {
+      manager->current->chain_r[i] = (uint8_t)(i + 1);
+    }
+    memcpy(chain_key, manager->current->chain_r, CHAIN_KEY_BYTES);
+
+    ratchet = otrng_receiving_ratchet_new(manager);
+    otrng_ec_point_copy(ratchet->their_ecdh, goldilocks_448_point_base);
+
+    /* stores the keys for the messages before [msg_id] */
+    otrng_assert_is_success(otrng_key_manager_derive_chain_keys(
+        enc_key, mac_key, manager, ratchet, 100, msg_id, 'r', NULL));
+    g_assert_cmpuint(ratchet->k, ==, msg_id);
+
+    /* they are only stored once the message is verified */
+    g_assert_cmpuint(otrng_skipped_keys_size(manager->skipped_keys), ==, 0);
+    g_assert_cmpuint(otrng_skipped_keys_size(ratchet->staged_keys), ==,
+                     msg_id);
+    otrng_assert_is_success(
+        otrng_receiving_ratchet_commit_skipped_keys(manager, ratchet));
+    g_assert_cmpuint(otrng_skipped_keys_size(manager->skipped_keys), ==,
+                     msg_id);
+
+    for (k = 0; k < msg_id; k++) {
+      otrng_assert_is_success(
+          derive_message_keys(expected_enc_key, extra_key, chain_key));
+      otrng_assert_is_success(otrng_key_get_skipped_keys(
+          enc_key, mac_key, ratchet->their_ecdh, k, manager, ratchet));
+      otrng_assert_cmpmem(expected_enc_key, enc_key, ENC_KEY_BYTES);
+      otrng_assert_cmpmem(extra_key, ratchet->extra_symmetric_key,
+                          EXTRA_SYMMETRIC_KEY_BYTES);
+    }
+
+    otrng_assert_is_success(
+        derive_message_keys(expected_enc_key, extra_key, chain_key));
+    otrng_assert_cmpmem(chain_key, ratchet->chain_r, CHAIN_KEY_BYTES);
+
+    otrng_receiving_ratchet_destroy(ratchet);
+    otrng_key_manager_free(manager);
+  }
+
+  otrng_keccak_limit_lanes(OTRNG_KECCAK_MAX_LANES);
+}
+
+static void absorb_kdf_prefix(goldilocks_shake256_ctx_p hd,
+                              const char *domain, uint8_t usage) {
+  hash_init(hd);
+  hash_update(hd, (const uint8_t *)domain, strlen(domain));
+  hash_update(hd, &usage, 1);
+}
+
+static void test_kdf_prefixes() {
+  const char *domains[] = {"OTRv4", "OTR-Prekey-Server", "other"};
+  const uint8_t usages[] = {0x00, 0x01, 0x16, 0x1F, 0x20, 0xFF};
+  const uint8_t values[3] = {0x01, 0x02, 0x03};
+  goldilocks_shake256_ctx_p hd, expected_hd;
+  uint8_t dst[64], expected[64];
+  size_t i, j;
+
+  for (i = 0; i < sizeof(domains) / sizeof(domains[0]); i++) {
+    for (j = 0; j < sizeof(usages); j++) {
+      otrng_assert_is_success(hash_init_with_usage_and_domain_separation(
+          hd, usages[j], domains[i]));
+      absorb_kdf_prefix(expected_hd, domains[i], usages[j]);
+
+      hash_update(hd, values, sizeof(values));
+      hash_update(expected_hd, values, sizeof(values));
+      hash_final(hd, dst, sizeof(dst));
+      hash_final(expected_hd, expected, sizeof(expected));
+      hash_destroy(hd);
+      hash_destroy(expected_hd);
+
+      otrng_assert_cmpmem(expected, dst, sizeof(dst));
+    }
+  }
+
+  absorb_kdf_prefix(expected_hd, "OTRv4", 0x16);
+  hash_update(expected_hd, values, sizeof(values));
+  hash_final(expected_hd, expected, sizeof(expected));
+  hash_destroy(expected_hd);
+
+  otrng_assert_is_success(
+      shake_256_kdf1(dst, sizeof(dst), 0x16, values, sizeof(values)));
+  otrng_assert_cmpmem(expected, dst, sizeof(dst));
+}
+
 static void test_calculate_brace_key() {
   key_manager_s *manager = otrng_xmalloc_z(sizeof(key_manager_s));
   otrng_key_manager_init(manager);
@@ -154,11 +290,58 @@ static void test_calculate_brace_key() {
   otrng_free(manager);
 }
 
+static void test_our_keys_enc() {
+  key_manager_s *manager = otrng_xmalloc_z(sizeof(key_manager_s));
+  uint8_t sym[ED448_PRIVATE_BYTES] = {1};
+  uint8_t ecdh_enc[ED448_POINT_BYTES];
+  uint8_t dh_enc[DH_MPI_MAX_BYTES];
+  size_t dh_enc_len = 0;
+  const ratchet_keys_enc_s *enc;
+
+  otrng_key_manager_init(manager);
+  otrng_assert_is_success(otrng_ecdh_keypair_generate(manager->our_ecdh, sym));
+  otrng_assert_is_success(otrng_dh_keypair_generate(manager->our_dh));
+
+  enc = otrng_key_manager_our_keys_enc(manager);
+  otrng_assert(enc);
+  otrng_assert(otrng_serialize_ec_point(ecdh_enc, manager->our_ecdh->pub));
+  otrng_assert_is_success(otrng_serialize_dh_public_key(
+      dh_enc, DH_MPI_MAX_BYTES, &dh_enc_len, manager->our_dh->pub));
+  otrng_assert_cmpmem(ecdh_enc, enc->ecdh_enc, ED448_POINT_BYTES);
+  g_assert_cmpuint(dh_enc_len, ==, enc->dh_enc_len);
+  otrng_assert_cmpmem(dh_enc, enc->dh_enc, dh_enc_len);
+
+  /* the keys did not change */
+  otrng_assert(otrng_key_manager_our_keys_enc(manager) == enc);
+  otrng_assert_cmpmem(ecdh_enc, enc->ecdh_enc, ED448_POINT_BYTES);
+
+  /* a new ECDH key, but the same DH key */
+  sym[0] = 2;
+  otrng_ecdh_keypair_destroy(manager->our_ecdh);
+  otrng_assert_is_success(otrng_ecdh_keypair_generate(manager->our_ecdh, sym));
+
+  enc = otrng_key_manager_our_keys_enc(manager);
+  otrng_assert(enc);
+  otrng_assert(memcmp(ecdh_enc, enc->ecdh_enc, ED448_POINT_BYTES) != 0);
+  otrng_assert(otrng_serialize_ec_point(ecdh_enc, manager->our_ecdh->pub));
+  otrng_assert_cmpmem(ecdh_enc, enc->ecdh_enc, ED448_POINT_BYTES);
+  otrng_assert_cmpmem(dh_enc, enc->dh_enc, dh_enc_len);
+
+  otrng_key_manager_destroy(manager);
+  otrng_free(manager);
+}
+
 void units_key_management_add_tests(void) {
   g_test_add_func("/key_management/derive_ratchet_keys",
                   test_derive_ratchet_keys);
   g_test_add_func("/key_management/ssid", test_calculate_ssid);
   g_test_add_func("/key_management/extra_symm_key",
                   test_calculate_extra_symm_key);
+  g_test_add_func("/key_management/derive_message_keys",
+                  test_derive_message_keys);
+  g_test_add_func("/key_management/store_skipped_keys_in_lanes",
+                  test_store_skipped_keys_in_lanes);
+  g_test_add_func("/key_management/kdf_prefixes", test_kdf_prefixes);
   g_test_add_func("/key_management/brace_key", test_calculate_brace_key);
+  g_test_add_func("/key_management/our_keys_enc", test_our_keys_enc);
 }
@@ -0,0 +1,126 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "test_helpers.h"
+
+#include "keypair_pool.h"
+
+static void assert_dh_keypair_is_valid(const dh_keypair_s *keypair) {
+  gcry_mpi_t pub = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+
+  otrng_assert(keypair->priv);
+  otrng_assert(keypair->pub);
+  otrng_dh_calculate_public_key(pub, keypair->priv);
+  otrng_assert(gcry_mpi_cmp(pub, keypair->pub) == 0);
+
+  gcry_mpi_release(pub);
+}
+
+static void test_keypair_pool_refill_and_take() {
+  otrng_keypair_pool_s pool;
+  ecdh_keypair_s ecdh[3];
+  dh_keypair_s dh[2];
+  ec_point pub;
+
+  otrng_keypair_pool_init(&pool, 2, 1);
+  g_assert_cmpuint(pool.ecdh_len, ==, 0);
+  g_assert_cmpuint(pool.dh_len, ==, 0);
+
+  /* DH keypairs go first */
+  g_assert_cmpuint(otrng_keypair_pool_refill(&pool, 2), ==, 2);
+  g_assert_cmpuint(pool.dh_len, ==, 1);
+  g_assert_cmpuint(pool.ecdh_len, ==, 1);
+
+  g_assert_cmpuint(otrng_keypair_pool_refill(&pool, 0), ==, 1);
+  g_assert_cmpuint(otrng_keypair_pool_refill(&pool, 0), ==, 0);
+
+  otrng_assert_is_success(otrng_keypair_pool_take_ecdh(&ecdh[0], &pool));
+  otrng_assert_is_success(otrng_keypair_pool_take_ecdh(&ecdh[1], &pool));
+  otrng_assert_is_success(otrng_keypair_pool_take_ecdh(&ecdh[2], &pool));
+  g_assert_cmpuint(pool.stats.ecdh_hits, ==, 2);
+  g_assert_cmpuint(pool.stats.ecdh_misses, ==, 1);
+  g_assert_cmpuint(pool.ecdh_len, ==, 0);
+
+  /* every keypair is handed out once */
+  otrng_assert(!otrng_ec_point_eq(ecdh[0].pub, ecdh[1].pub));
+  otrng_assert(!otrng_ec_point_eq(ecdh[1].pub, ecdh[2].pub));
+
+  goldilocks_448_point_scalarmul(pub, goldilocks_448_point_base, ecdh[0].priv);
+  otrng_assert(otrng_ec_point_eq(pub, ecdh[0].pub));
+
+  dh[0].pub = dh[0].priv = NULL;
+  dh[1].pub = dh[1].priv = NULL;
+  otrng_assert_is_success(otrng_keypair_pool_take_dh(&dh[0], &pool));
+  otrng_assert_is_success(otrng_keypair_pool_take_dh(&dh[1], &pool));
+  g_assert_cmpuint(pool.stats.dh_hits, ==, 1);
+  g_assert_cmpuint(pool.stats.dh_misses, ==, 1);
+  assert_dh_keypair_is_valid(&dh[0]);
+  assert_dh_keypair_is_valid(&dh[1]);
+  otrng_assert(gcry_mpi_cmp(dh[0].pub, dh[1].pub) != 0);
+
+  otrng_ecdh_keypair_destroy(&ecdh[0]);
+  otrng_ecdh_keypair_destroy(&ecdh[1]);
+  otrng_ecdh_keypair_destroy(&ecdh[2]);
+  otrng_dh_keypair_destroy(&dh[0]);
+  otrng_dh_keypair_destroy(&dh[1]);
+  otrng_keypair_pool_destroy(&pool);
+}
+
+static void test_keypair_pool_resize() {
+  otrng_keypair_pool_s pool;
+
+  otrng_keypair_pool_init(&pool, 4, 2);
+  g_assert_cmpuint(otrng_keypair_pool_refill(&pool, 0), ==, 6);
+
+  otrng_keypair_pool_resize(&pool, 1, 0);
+  g_assert_cmpuint(pool.ecdh_len, ==, 1);
+  g_assert_cmpuint(pool.dh_len, ==, 0);
+  g_assert_cmpuint(otrng_keypair_pool_refill(&pool, 0), ==, 0);
+
+  otrng_keypair_pool_resize(&pool, 3, 1);
+  g_assert_cmpuint(pool.ecdh_len, ==, 1);
+  g_assert_cmpuint(otrng_keypair_pool_refill(&pool, 0), ==, 3);
+
+  otrng_keypair_pool_destroy(&pool);
+  otrng_assert(!pool.ecdh);
+  otrng_assert(!pool.dh);
+}
+
+static void test_keypair_pool_without_pool() {
+  ecdh_keypair_s ecdh;
+  dh_keypair_s dh = {.pub = NULL, .priv = NULL};
+
+  otrng_assert_is_success(otrng_keypair_pool_take_ecdh(&ecdh, NULL));
+  otrng_assert_is_success(otrng_keypair_pool_take_dh(&dh, NULL));
+  assert_dh_keypair_is_valid(&dh);
+
+  otrng_ecdh_keypair_destroy(&ecdh);
+  otrng_dh_keypair_destroy(&dh);
+}
+
+void units_keypair_pool_add_tests(void) {
+  g_test_add_func("/keypair_pool/refill_and_take",
+                  test_keypair_pool_refill_and_take);
+  g_test_add_func("/keypair_pool/resize", test_keypair_pool_resize);
+  g_test_add_func("/keypair_pool/without_pool",
+                  test_keypair_pool_without_pool);
+}
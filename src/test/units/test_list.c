@@ -156,6 +156,87 @@ static void test_list_empty_size() {
   otrng_list_free_nodes(empty);
 }
 
+static void test_otrng_list_append() {
+  int one = 1, two = 2, three = 3;
+  list_s list = {NULL, NULL, 0};
+
+  otrng_list_append(&list, &one);
+  otrng_assert(list.head);
+  otrng_assert(list.head == list.tail);
+  g_assert_cmpint(list.len, ==, 1);
+
+  otrng_list_append(&list, &two);
+  otrng_list_append(&list, &three);
+  g_assert_cmpint(list.len, ==, 3);
+  g_assert_cmpint(one, ==, *((int *)list.head->data));
+  g_assert_cmpint(two, ==, *((int *)list.head->next->data));
+  g_assert_cmpint(three, ==, *((int *)list.tail->data));
+  otrng_assert(!list.tail->next);
+
+  otrng_list_clear(&list, NULL);
+  otrng_assert(!list.head);
+  otrng_assert(!list.tail);
+  g_assert_cmpint(list.len, ==, 0);
+}
+
+static void test_otrng_list_prepend() {
+  int one = 1, two = 2;
+  list_s list = {NULL, NULL, 0};
+
+  otrng_list_prepend(&list, &one);
+  otrng_list_prepend(&list, &two);
+  g_assert_cmpint(list.len, ==, 2);
+  g_assert_cmpint(two, ==, *((int *)list.head->data));
+  g_assert_cmpint(one, ==, *((int *)list.tail->data));
+
+  otrng_list_clear(&list, NULL);
+}
+
+static void test_otrng_list_unlink() {
+  int one = 1, two = 2, three = 3, four = 4;
+  list_element_s *elem;
+  list_s list = {NULL, NULL, 0};
+
+  otrng_list_append(&list, &one);
+  otrng_list_append(&list, &two);
+  otrng_list_append(&list, &three);
+
+  // Unlinks the last element and updates the tail
+  elem = list.tail;
+  otrng_list_unlink(&list, elem);
+  otrng_assert(!elem->next);
+  otrng_list_free_nodes(elem);
+  g_assert_cmpint(list.len, ==, 2);
+  g_assert_cmpint(two, ==, *((int *)list.tail->data));
+
+  otrng_list_append(&list, &four);
+  g_assert_cmpint(four, ==, *((int *)list.head->next->next->data));
+
+  // Unlinks the first element and updates the head
+  elem = list.head;
+  otrng_list_unlink(&list, elem);
+  otrng_list_free_nodes(elem);
+  g_assert_cmpint(list.len, ==, 2);
+  g_assert_cmpint(two, ==, *((int *)list.head->data));
+  g_assert_cmpint(four, ==, *((int *)list.tail->data));
+
+  // Unlinking an element not in the list does nothing
+  elem = list_new();
+  otrng_list_unlink(&list, elem);
+  otrng_list_free_nodes(elem);
+  g_assert_cmpint(list.len, ==, 2);
+
+  elem = list.head;
+  otrng_list_unlink(&list, elem);
+  otrng_list_free_nodes(elem);
+  elem = list.head;
+  otrng_list_unlink(&list, elem);
+  otrng_list_free_nodes(elem);
+  otrng_assert(!list.head);
+  otrng_assert(!list.tail);
+  g_assert_cmpint(list.len, ==, 0);
+}
+
 void units_list_add_tests(void) {
   g_test_add_func("/list/add", test_otrng_list_add);
   g_test_add_func("/list/copy", test_otrng_list_copy);
@@ -163,4 +244,7 @@ void units_list_add_tests(void) {
   g_test_add_func("/list/get_by_value", test_otrng_list_get_by_value);
   g_test_add_func("/list/length", test_otrng_list_len);
   g_test_add_func("/list/empty_size", test_list_empty_size);
+  g_test_add_func("/list/append", test_otrng_list_append);
+  g_test_add_func("/list/prepend", test_otrng_list_prepend);
+  g_test_add_func("/list/unlink", test_otrng_list_unlink);
 }
@@ -318,7 +318,7 @@ static void test_global_state_prekey_message_management(void) {
   otrng_client_s *client =
       get_client(state, create_client_id("otr", charlie_account));
 
-  otrng_assert(client->our_prekeys);
+  otrng_assert(client->our_prekeys.head);
 
   uint32_t message_id = 831563016;
   const prekey_message_s *stored_prekey = NULL;
@@ -405,45 +405,45 @@ static void test_global_state_fingerprint_reading(void) {
   fclose(fp);
   otrng_assert_is_success(result);
 
-  g_assert_cmpint(otrng_list_len(state->clients), ==, 3);
+  g_assert_cmpint(state->clients.len, ==, 3);
 
-  otrng_client_s *client1 = state->clients->data;
+  otrng_client_s *client1 = state->clients.head->data;
 
   g_assert_cmpstr(client1->client_id.account, ==, "alice@otr.im");
   g_assert_cmpstr(client1->client_id.protocol, ==, "prpl-jabber");
 
-  g_assert_cmpint(otrng_list_len(client1->fingerprints->fps), ==, 1);
+  g_assert_cmpint(client1->fingerprints->fps.len, ==, 1);
 
-  otrng_known_fingerprint_s *fp1 = client1->fingerprints->fps->data;
+  otrng_known_fingerprint_s *fp1 = client1->fingerprints->fps.head->data;
   g_assert_cmpstr(fp1->username, ==, "foo@example.org");
   g_assert(fp1->trusted == otrng_false);
   otrng_assert_cmpmem(fp1->fp, expected1, FPRINT_LEN_BYTES);
 
-  otrng_client_s *client2 = state->clients->next->data;
+  otrng_client_s *client2 = state->clients.head->next->data;
 
   g_assert_cmpstr(client2->client_id.account, ==, "alice@otr.im");
   g_assert_cmpstr(client2->client_id.protocol, ==, "prpl-msn");
 
-  g_assert_cmpint(otrng_list_len(client2->fingerprints->fps), ==, 1);
+  g_assert_cmpint(client2->fingerprints->fps.len, ==, 1);
 
-  otrng_known_fingerprint_s *fp2 = client2->fingerprints->fps->data;
+  otrng_known_fingerprint_s *fp2 = client2->fingerprints->fps.head->data;
   g_assert_cmpstr(fp2->username, ==, "foo2@example.org");
   g_assert(fp2->trusted == otrng_true);
   otrng_assert_cmpmem(fp2->fp, expected2, FPRINT_LEN_BYTES);
 
-  otrng_client_s *client3 = state->clients->next->next->data;
+  otrng_client_s *client3 = state->clients.head->next->next->data;
 
   g_assert_cmpstr(client3->client_id.account, ==, "bob@otr.im");
   g_assert_cmpstr(client3->client_id.protocol, ==, "prpl-jabber");
 
-  g_assert_cmpint(otrng_list_len(client3->fingerprints->fps), ==, 2);
+  g_assert_cmpint(client3->fingerprints->fps.len, ==, 2);
 
-  otrng_known_fingerprint_s *fp3 = client3->fingerprints->fps->data;
+  otrng_known_fingerprint_s *fp3 = client3->fingerprints->fps.head->data;
   g_assert_cmpstr(fp3->username, ==, "foo4@example.org");
   g_assert(fp3->trusted == otrng_false);
   otrng_assert_cmpmem(fp3->fp, expected3, FPRINT_LEN_BYTES);
 
-  otrng_known_fingerprint_s *fp4 = client3->fingerprints->fps->next->data;
+  otrng_known_fingerprint_s *fp4 = client3->fingerprints->fps.head->next->data;
   g_assert_cmpstr(fp4->username, ==, "foo5@example.org");
   g_assert(fp4->trusted == otrng_true);
   otrng_assert_cmpmem(fp4->fp, expected4, FPRINT_LEN_BYTES);
@@ -451,6 +451,36 @@ static void test_global_state_fingerprint_reading(void) {
   otrng_global_state_free(state);
 }
 
+static void test_global_state_client_lookup(void) {
+  const otrng_client_id_s alice_otr_id =
+      create_client_id("otr", "alice@otr.im");
+  const otrng_client_id_s alice_xmpp_id =
+      create_client_id("xmpp", "alice@otr.im");
+  otrng_global_state_s *state =
+      otrng_global_state_new(empty_callbacks, otrng_false);
+
+  otrng_client_s *alice_otr = otrng_client_get(state, alice_otr_id);
+  otrng_client_s *alice_xmpp = otrng_client_get(state, alice_xmpp_id);
+  otrng_client_s *split1 = otrng_client_get(state, create_client_id("ab", "c"));
+  otrng_client_s *split2 = otrng_client_get(state, create_client_id("a", "bc"));
+
+  otrng_assert(alice_otr);
+  otrng_assert(alice_otr != alice_xmpp);
+  otrng_assert(split1 != split2);
+  g_assert_cmpint(state->clients.len, ==, 4);
+
+  otrng_assert(otrng_client_get(state, alice_otr_id) == alice_otr);
+  otrng_assert(otrng_client_get(state, alice_xmpp_id) == alice_xmpp);
+  otrng_assert(otrng_client_get(state, create_client_id("a", "bc")) == split2);
+  g_assert_cmpint(state->clients.len, ==, 4);
+
+  // Keeps the clients in the order they were added
+  otrng_assert(state->clients.head->data == alice_otr);
+  otrng_assert(state->clients.tail->data == split2);
+
+  otrng_global_state_free(state);
+}
+
 static void test_instance_tag_api(void) {
   const char *alice_protocol = "otr";
   unsigned int instance_tag = 0x9abcdef0;
@@ -479,6 +509,48 @@ static void test_instance_tag_api(void) {
   otrng_client_free(alice);
 }
 
+static void test_global_state_instance_tags(void) {
+  otrng_global_state_s *state =
+      otrng_global_state_new(test_callbacks, otrng_false);
+  otrng_client_s *alice =
+      otrng_client_get(state, create_client_id("otr", alice_account));
+
+  /* Nothing has been read yet */
+  g_assert_cmpuint(alice->instance_tag, ==, 0);
+
+  FILE *instagFILEp = tmpfile();
+  fprintf(instagFILEp, "%s\t%s\t%08x\n", alice_account, "otr", 0x9abcdef0);
+  fprintf(instagFILEp, "%s\t%s\t%08x\n", bob_account, "otr", 0x12345678);
+  rewind(instagFILEp);
+  otrng_assert_is_success(
+      otrng_global_state_instance_tags_read_from(state, instagFILEp));
+  fclose(instagFILEp);
+
+  /* Clients that exist are refreshed when the tags are read... */
+  g_assert_cmpuint(alice->instance_tag, ==, 0x9abcdef0);
+  g_assert_cmpuint(otrng_client_get_instance_tag(alice), ==, 0x9abcdef0);
+
+  /* ...and new ones look their tag up the first time it is needed */
+  otrng_client_s *bob =
+      otrng_client_get(state, create_client_id("otr", bob_account));
+  g_assert_cmpuint(bob->instance_tag, ==, 0);
+  g_assert_cmpuint(otrng_client_get_instance_tag(bob), ==, 0x12345678);
+  g_assert_cmpuint(bob->instance_tag, ==, 0x12345678);
+
+  /* A tag that is already known can't be replaced */
+  otrng_assert_is_error(otrng_client_add_instance_tag(bob, 0x100A0F));
+  g_assert_cmpuint(otrng_client_get_instance_tag(bob), ==, 0x12345678);
+
+  otrng_client_s *charlie =
+      otrng_client_get(state, create_client_id("otr", charlie_account));
+  g_assert_cmpuint(charlie->instance_tag, ==, 0);
+  otrng_assert_is_success(otrng_client_add_instance_tag(charlie, 0x100A0F));
+  g_assert_cmpuint(charlie->instance_tag, ==, 0x100A0F);
+  g_assert_cmpuint(otrng_client_get_instance_tag(charlie), ==, 0x100A0F);
+
+  otrng_global_state_free(state);
+}
+
 /* Expects the file pointer to be at the END of the file */
 static char *read_full_file(FILE *fp) {
   long fsize = ftell(fp);
@@ -566,6 +638,10 @@ void units_messaging_add_tests() {
                   test_global_state_fingerprint_reading);
   g_test_add_func("/global_state/fingerprints/writing",
                   test_global_state_fingerprint_writing);
+  g_test_add_func("/global_state/client_lookup",
+                  test_global_state_client_lookup);
 
   g_test_add_func("/api/instance_tag", test_instance_tag_api);
+  g_test_add_func("/global_state/instance_tags",
+                  test_global_state_instance_tags);
 }
@@ -139,7 +139,7 @@ static void test_prekey_message_valid(dake_fixture_s *f, gconstpointer d) {
 
   otrng_assert(otrng_valid_received_values(prekey_msg->sender_instance_tag,
                                            prekey_msg->Y, prekey_msg->B,
-                                           f->profile) == otrng_true);
+                                           f->profile, NULL) == otrng_true);
 
   otrng_prekey_message_free(prekey_msg);
 
@@ -152,7 +152,7 @@ static void test_prekey_message_valid(dake_fixture_s *f, gconstpointer d) {
   otrng_assert(
       otrng_valid_received_values(invalid_prekey_msg->sender_instance_tag,
                                   invalid_prekey_msg->Y, invalid_prekey_msg->B,
-                                  f->profile) == otrng_false);
+                                  f->profile, NULL) == otrng_false);
 
   otrng_ecdh_keypair_destroy(&ecdh);
   otrng_dh_keypair_destroy(&dh);
@@ -297,6 +297,39 @@ test_otrng_dake_non_interactive_auth_message_deserializes(dake_fixture_s *f,
   otrng_dake_non_interactive_auth_message_destroy(&deser);
 }
 
+static void test_prekey_messages_generate_with(size_t threads) {
+  prekey_message_s *messages[5];
+  size_t i;
+
+  otrng_assert_is_success(
+      otrng_prekey_messages_generate(messages, 5, 0x101, threads));
+
+  for (i = 0; i < 5; i++) {
+    dh_public_key expected = gcry_mpi_new(DH3072_MOD_LEN_BITS);
+
+    otrng_assert(messages[i]);
+    g_assert_cmpuint(messages[i]->sender_instance_tag, ==, 0x101);
+    otrng_assert_ec_public_key_eq(messages[i]->Y, messages[i]->y->pub);
+    otrng_assert_dh_public_key_eq(messages[i]->B, messages[i]->b->pub);
+
+    otrng_dh_calculate_public_key(expected, messages[i]->b->priv);
+    otrng_assert_dh_public_key_eq(messages[i]->B, expected);
+
+    otrng_dh_mpi_release(expected);
+  }
+
+  otrng_assert(!otrng_ec_point_eq(messages[0]->Y, messages[1]->Y));
+
+  for (i = 0; i < 5; i++) {
+    otrng_prekey_message_free(messages[i]);
+  }
+}
+
+static void test_prekey_messages_generate(void) {
+  test_prekey_messages_generate_with(1);
+  test_prekey_messages_generate_with(4);
+}
+
 void units_non_interactive_messages_add_tests(void) {
   WITH_DAKE_FIXTURE("/dake/non_interactive_auth_message/serialize",
                     test_dake_non_interactive_auth_message_serializes);
@@ -307,4 +340,6 @@ void units_non_interactive_messages_add_tests(void) {
                   test_otrng_prekey_message_deserializes);
   g_test_add_func("/dake/prekey_message/serializes",
                   test_prekey_message_serializes);
+  g_test_add_func("/dake/prekey_message/generate",
+                  test_prekey_messages_generate);
 }
@@ -121,11 +121,15 @@ static void load_prekey_messages(otrng_client_s *client) {
   load_prekey_messages__called_with = client;
 
   if (load_prekey_messages__should_assign) {
-    if (client->our_prekeys != NULL) {
-      otrng_list_free(client->our_prekeys, prekey_free_from_list);
+    list_element_s *el;
+
+    otrng_list_clear(&client->our_prekeys, prekey_free_from_list);
+    for (el = load_prekey_messages__assign; el; el = el->next) {
+      otrng_list_append(&client->our_prekeys, el->data);
     }
 
-    client->our_prekeys = load_prekey_messages__assign;
+    otrng_list_free_nodes(load_prekey_messages__assign);
+    load_prekey_messages__assign = NULL;
   }
 }
 
@@ -314,6 +318,10 @@ static void orchestration_fixture_setup(orchestration_fixture_s *f,
   f->gs = otrng_xmalloc_z(sizeof(otrng_global_state_s));
   f->gs->callbacks = f->callbacks;
   f->gs->user_state_v3 = otrl_userstate_create();
+  otrng_published_index_init(&f->gs->clients_index);
+  pthread_mutex_init(&f->gs->clients_lock, NULL);
+  pthread_mutex_init(&f->gs->user_state_v3_lock, NULL);
+  otrng_timers_init(&f->gs->timers);
   f->client_id.protocol = otrng_xstrdup("test-otr");
   f->client_id.account = otrng_xstrdup("sita@otr.im");
 
@@ -322,7 +330,7 @@ static void orchestration_fixture_setup(orchestration_fixture_s *f,
   f->client->minimum_stored_prekey_msg = 2;
 
   f->client->global_state = f->gs;
-  f->gs->clients = otrng_list_add(f->client, f->gs->clients);
+  otrng_global_state_add_client(f->gs, f->client);
 
   f->callbacks->load_privkey_v4 = load_privkey_v4;
   f->callbacks->store_privkey_v4 = store_privkey_v4;
@@ -452,7 +460,11 @@ static void orchestration_fixture_teardown(orchestration_fixture_s *f,
 
   otrng_free(f->callbacks);
   otrng_client_free(f->client);
-  otrng_list_free_nodes(f->gs->clients);
+  otrng_list_clear(&f->gs->clients, NULL);
+  otrng_published_index_destroy(&f->gs->clients_index);
+  pthread_mutex_destroy(&f->gs->clients_lock);
+  pthread_mutex_destroy(&f->gs->user_state_v3_lock);
+  otrng_timers_destroy(&f->gs->timers);
   otrl_userstate_free(f->gs->user_state_v3);
   otrng_free(f->gs);
   otrng_secure_free(f->long_term_key);
@@ -1584,16 +1596,15 @@ static void test__otrng_client_ensure_correct_state__prekey_messages__creates(
   g_assert_cmpint(load_prekey_messages__called, ==, 1);
   g_assert_cmpint(store_prekey_messages__called, ==, 1);
 
-  g_assert_cmpint(otrng_list_len(f->client->our_prekeys), ==, 3);
+  g_assert_cmpint(f->client->our_prekeys.len, ==, 3);
   g_assert_cmpint(f->client->prekey_msgs_num_to_publish, ==, 0);
 
   g_assert(f->client->should_publish == otrng_true);
-  g_assert(
-      ((prekey_message_s *)(f->client->our_prekeys->data))->should_publish ==
-      otrng_false);
-  g_assert(((prekey_message_s *)(f->client->our_prekeys->next->data))
+  g_assert(((prekey_message_s *)(f->client->our_prekeys.head->data))
+               ->should_publish == otrng_false);
+  g_assert(((prekey_message_s *)(f->client->our_prekeys.head->next->data))
                ->should_publish == otrng_true);
-  g_assert(((prekey_message_s *)(f->client->our_prekeys->next->next->data))
+  g_assert(((prekey_message_s *)(f->client->our_prekeys.head->next->next->data))
                ->should_publish == otrng_true);
 
   f->client->keypair = NULL;
@@ -1626,7 +1637,7 @@ test__otrng_client_ensure_correct_state__prekey_messages__creates_based_on_to_pu
   g_assert_cmpint(load_prekey_messages__called, ==, 1);
   g_assert_cmpint(store_prekey_messages__called, ==, 1);
 
-  g_assert_cmpint(otrng_list_len(f->client->our_prekeys), ==, 5);
+  g_assert_cmpint(f->client->our_prekeys.len, ==, 5);
   g_assert_cmpint(f->client->prekey_msgs_num_to_publish, ==, 0);
 
   f->client->keypair = NULL;
@@ -1660,7 +1671,7 @@ static void test__otrng_client_ensure_correct_state__prekey_messages__fails(
   g_assert_cmpint(load_prekey_messages__called, ==, 1);
   g_assert_cmpint(store_prekey_messages__called, ==, 0);
 
-  g_assert_cmpint(otrng_list_len(f->client->our_prekeys), ==, 3);
+  g_assert_cmpint(f->client->our_prekeys.len, ==, 3);
   g_assert_cmpint(f->client->prekey_msgs_num_to_publish, ==, 0);
 
   f->client->keypair = NULL;
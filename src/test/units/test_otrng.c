@@ -255,7 +255,7 @@ static void test_otrng_build_prekey_ensemble() {
   // TODO: @sanitizer add a client profile
   prekey_ensemble_s *ensemble = otrng_build_prekey_ensemble(otr);
   otrng_assert(ensemble);
-  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble, NULL));
 
   // Sends the same stored clients
   otrng_assert_client_profile_eq(ensemble->client_profile,
@@ -266,7 +266,7 @@ static void test_otrng_build_prekey_ensemble() {
   // Stores the same prekey message sent
   // TODO: Assert the instance tag
   // TODO: Assert the private part
-  prekey_message_s *stored = client->our_prekeys->data;
+  prekey_message_s *stored = client->our_prekeys.head->data;
   otrng_assert(stored);
   otrng_assert_ec_public_key_eq(ensemble->message->Y, stored->y->pub);
   otrng_assert_dh_public_key_eq(ensemble->message->B, stored->b->pub);
@@ -476,7 +476,7 @@ void test_start_with_whitespace_tag(void) {
   otrng_assert(response_to_alice->to_send == NULL);
   otrng_assert(response_to_alice->to_display == NULL);
 
-  g_assert_cmpint(otrng_list_len(bob->keys->old_mac_keys), ==, 1);
+  g_assert_cmpint(bob->keys->old_mac_keys.len, ==, 1);
   g_assert_cmpint(bob->keys->i, ==, 1);
   g_assert_cmpint(bob->keys->j, ==, 0);
   g_assert_cmpint(bob->keys->k, ==, 1);
@@ -509,7 +509,7 @@ void test_send_with_padding(void) {
   /* Alice sends a data message */
   result = otrng_send_message(&to_send_1, "hi", NULL, 0, alice);
   assert_message_sent(result, to_send_1);
-  otrng_assert(!alice->keys->old_mac_keys);
+  otrng_assert(!alice->keys->old_mac_keys.head);
 
   g_assert_cmpint(alice->keys->i, ==, 1);
   g_assert_cmpint(alice->keys->j, ==, 2);
@@ -63,49 +63,49 @@ static void test_prekey_ensemble_validate(void) {
   otrng_ec_point_copy(ensemble->message->Y, keypair2->pub);
   ensemble->message->B = gcry_mpi_set_ui(NULL, 3);
 
-  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_success(otrng_prekey_ensemble_validate(ensemble, NULL));
 
   // Should fail if instance tags do not match
   ensemble->client_profile->sender_instance_tag = 2;
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   ensemble->client_profile->sender_instance_tag = 1;
 
   ensemble->prekey_profile->instance_tag = 2;
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   ensemble->prekey_profile->instance_tag = 1;
 
   ensemble->message->sender_instance_tag = 2;
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   ensemble->message->sender_instance_tag = 1;
 
   // Should fail if client profile is not valid
   ensemble->client_profile->expires -= 1; // Messes up with the signature
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   ensemble->client_profile->expires += 1;
 
   // Should fail if prekey profile is not valid
   ensemble->prekey_profile->expires -= 1; // Messes up with the signature
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   ensemble->prekey_profile->expires += 1; // Messes up with the signature
 
   // Should fail if profiles are signed with a different key
   otrng_assert_is_success(
       otrng_prekey_profile_sign(ensemble->prekey_profile, keypair2));
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   otrng_assert_is_success(
       otrng_prekey_profile_sign(ensemble->prekey_profile, keypair));
 
   // Should fail if prekey message is not valid
   otrng_dh_mpi_release(ensemble->message->B);
   ensemble->message->B = NULL;
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   ensemble->message->B = gcry_mpi_set_ui(NULL, 3);
 
   // Should fail if the prekey profile does not contain the prekey message
   // version.
   char *old = ensemble->client_profile->versions;
   ensemble->client_profile->versions = otrng_xstrdup("3");
-  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble));
+  otrng_assert_is_error(otrng_prekey_ensemble_validate(ensemble, NULL));
   otrng_free(ensemble->client_profile->versions);
   ensemble->client_profile->versions = old;
 
@@ -47,13 +47,17 @@ test_prekey_manager__otrng_prekey_request_storage_information(void) {
   otrng_result ret;
 
   otrng_global_state_s *gs = otrng_xmalloc_z(sizeof(otrng_global_state_s));
+  otrng_published_index_init(&gs->clients_index);
+  pthread_mutex_init(&gs->clients_lock, NULL);
+  pthread_mutex_init(&gs->user_state_v3_lock, NULL);
+  otrng_timers_init(&gs->timers);
 
   client_id.protocol = otrng_xstrdup("test-otr");
   client_id.account = otrng_xstrdup("sita@otr.im");
 
   client = otrng_client_new(client_id);
   client->global_state = gs;
-  gs->clients = otrng_list_add(client, gs->clients);
+  otrng_global_state_add_client(gs, client);
 
   set_up_fixed_randomness();
 
@@ -97,7 +101,11 @@ test_prekey_manager__otrng_prekey_request_storage_information(void) {
 
   otrng_free(output);
   otrng_client_free(client);
-  otrng_list_free_nodes(gs->clients);
+  otrng_list_clear(&gs->clients, NULL);
+  otrng_published_index_destroy(&gs->clients_index);
+  pthread_mutex_destroy(&gs->clients_lock);
+  pthread_mutex_destroy(&gs->user_state_v3_lock);
+  otrng_timers_destroy(&gs->timers);
   otrng_free(gs);
   otrng_free((char *)client_id.protocol);
   otrng_free((char *)client_id.account);
@@ -306,6 +306,70 @@ static void test_dh_proof_deserialization(void) {
   otrng_dh_mpi_release(expected_v);
 }
 
+/* More values than are multiplied at once, as when publishing many messages */
+#define MANY_VALUES 70
+
+static void test_ecdh_proof_many_values(void) {
+  ecdh_keypair_s keypairs[MANY_VALUES];
+  ec_scalar privs[MANY_VALUES];
+  ec_point pubs[MANY_VALUES];
+  uint8_t sym[ED448_PRIVATE_BYTES] = {0};
+  uint8_t m[HASH_BYTES] = {0x01, 0x02, 0x03};
+  ecdh_proof_s res;
+  size_t i;
+
+  for (i = 0; i < MANY_VALUES; i++) {
+    sym[0] = (uint8_t)i;
+    otrng_assert_is_success(otrng_ecdh_keypair_generate(&keypairs[i], sym));
+    goldilocks_448_scalar_copy(privs[i], keypairs[i].priv);
+    goldilocks_448_point_copy(pubs[i], keypairs[i].pub);
+  }
+
+  otrng_assert_is_success(
+      otrng_ecdh_proof_generate(&res, (const ec_scalar *)privs,
+                                (const ec_point *)pubs, MANY_VALUES, m, 0x13));
+  otrng_assert(otrng_ecdh_proof_verify(&res, (const ec_point *)pubs,
+                                       MANY_VALUES, m, 0x13));
+
+  goldilocks_448_point_copy(pubs[MANY_VALUES - 1], pubs[0]);
+  otrng_assert(!otrng_ecdh_proof_verify(&res, (const ec_point *)pubs,
+                                        MANY_VALUES, m, 0x13));
+
+  for (i = 0; i < MANY_VALUES; i++) {
+    otrng_ecdh_keypair_destroy(&keypairs[i]);
+  }
+}
+
+static void test_dh_proof_many_values(void) {
+  dh_keypair_s keypairs[MANY_VALUES];
+  gcry_mpi_t privs[MANY_VALUES];
+  gcry_mpi_t pubs[MANY_VALUES];
+  uint8_t m[HASH_BYTES] = {0x01, 0x02, 0x03};
+  dh_proof_s res;
+  size_t i;
+
+  for (i = 0; i < MANY_VALUES; i++) {
+    otrng_assert_is_success(otrng_dh_keypair_generate(&keypairs[i]));
+    privs[i] = keypairs[i].priv;
+    pubs[i] = keypairs[i].pub;
+  }
+
+  otrng_assert_is_success(otrng_dh_proof_generate(
+      &res, (const gcry_mpi_t *)privs, (const gcry_mpi_t *)pubs, MANY_VALUES,
+      m, 0x13, NULL));
+  otrng_assert(otrng_dh_proof_verify(&res, (const gcry_mpi_t *)pubs,
+                                     MANY_VALUES, m, 0x13));
+
+  pubs[MANY_VALUES - 1] = pubs[0];
+  otrng_assert(!otrng_dh_proof_verify(&res, (const gcry_mpi_t *)pubs,
+                                      MANY_VALUES, m, 0x13));
+
+  for (i = 0; i < MANY_VALUES; i++) {
+    otrng_dh_keypair_destroy(&keypairs[i]);
+  }
+  otrng_dh_mpi_release(res.v);
+}
+
 void units_prekey_proofs_add_tests(void) {
   g_test_add_func("/prekey_server/proofs/dh_gen_validation",
                   test_dh_proof_generation_and_validation);
@@ -321,4 +385,8 @@ void units_prekey_proofs_add_tests(void) {
                   test_ecdh_proof_deserialization);
   g_test_add_func("/prekey_server/proofs/dh/deserialization",
                   test_dh_proof_deserialization);
+  g_test_add_func("/prekey_server/proofs/ecdh/many_values",
+                  test_ecdh_proof_many_values);
+  g_test_add_func("/prekey_server/proofs/dh/many_values",
+                  test_dh_proof_many_values);
 }
@@ -0,0 +1,205 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "test_helpers.h"
+
+#include "test_fixtures.h"
+
+#include "profile_cache.h"
+
+static otrng_client_profile_s *build_client_profile(uint8_t seed,
+                                                    time_t expires) {
+  uint8_t sym[ED448_PRIVATE_BYTES] = {0};
+  uint8_t forging_sym[ED448_PRIVATE_BYTES] = {0};
+  otrng_keypair_s *keypair = otrng_keypair_new();
+  otrng_public_key *forging_key;
+  otrng_client_profile_s *profile;
+
+  sym[0] = seed;
+  forging_sym[0] = seed + 1;
+  otrng_assert_is_success(otrng_keypair_generate(keypair, sym));
+  forging_key = create_forging_key_from(forging_sym);
+
+  profile = otrng_client_profile_build_with_custom_expiration(
+      0x101, "4", keypair, *forging_key, expires);
+  otrng_assert(profile);
+
+  otrng_free(forging_key);
+  otrng_keypair_free(keypair);
+
+  return profile;
+}
+
+static void test_profile_cache_client_profile() {
+  otrng_profile_cache_s cache;
+  otrng_client_profile_s *profile =
+      build_client_profile(0x10, time(NULL) + 60 * 60);
+
+  otrng_profile_cache_init(&cache, 4);
+
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profile, 0x101));
+  g_assert_cmpuint(cache.stats.misses, ==, 1);
+  g_assert_cmpuint(cache.stats.hits, ==, 0);
+
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profile, 0x101));
+  g_assert_cmpuint(cache.stats.misses, ==, 1);
+  g_assert_cmpuint(cache.stats.hits, ==, 1);
+
+  /* the verdict depends on the instance tag it was received from */
+  otrng_assert(
+      !otrng_profile_cache_client_profile_valid(&cache, profile, 0x102));
+  otrng_assert(
+      !otrng_profile_cache_client_profile_valid(&cache, profile, 0x102));
+  g_assert_cmpuint(cache.stats.misses, ==, 2);
+  g_assert_cmpuint(cache.stats.hits, ==, 2);
+
+  /* a changed profile is a different one, and its signature is checked */
+  profile->expires += 1;
+  otrng_assert(
+      !otrng_profile_cache_client_profile_valid(&cache, profile, 0x101));
+  g_assert_cmpuint(cache.stats.misses, ==, 3);
+  profile->expires -= 1;
+
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profile, 0x101));
+  g_assert_cmpuint(cache.stats.hits, ==, 3);
+  g_assert_cmpuint(cache.count, ==, 3);
+
+  otrng_client_profile_free(profile);
+  otrng_profile_cache_destroy(&cache);
+}
+
+static void test_profile_cache_checks_expiration() {
+  otrng_profile_cache_s cache;
+  otrng_client_profile_s *profile = build_client_profile(0x20, time(NULL) - 1);
+
+  otrng_profile_cache_init(&cache, 4);
+
+  otrng_assert(
+      !otrng_profile_cache_client_profile_valid(&cache, profile, 0x101));
+  otrng_assert(
+      !otrng_profile_cache_client_profile_valid(&cache, profile, 0x101));
+  g_assert_cmpuint(cache.stats.hits, ==, 1);
+
+  otrng_client_profile_free(profile);
+  otrng_profile_cache_destroy(&cache);
+}
+
+static void test_profile_cache_evicts_least_recently_used() {
+  otrng_profile_cache_s cache;
+  otrng_client_profile_s *profiles[3];
+  time_t expires = time(NULL) + 60 * 60;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    profiles[i] = build_client_profile(0x30 + 2 * i, expires);
+  }
+
+  otrng_profile_cache_init(&cache, 2);
+
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[0], 0x101));
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[1], 0x101));
+
+  /* profiles[1] is now the least recently used */
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[0], 0x101));
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[2], 0x101));
+  g_assert_cmpuint(cache.stats.evictions, ==, 1);
+  g_assert_cmpuint(cache.count, ==, 2);
+
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[0], 0x101));
+  g_assert_cmpuint(cache.stats.hits, ==, 2);
+
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[1], 0x101));
+  g_assert_cmpuint(cache.stats.hits, ==, 2);
+  g_assert_cmpuint(cache.stats.misses, ==, 4);
+
+  /* resizing drops the verdicts */
+  otrng_profile_cache_resize(&cache, 1);
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[1], 0x101));
+  g_assert_cmpuint(cache.stats.misses, ==, 5);
+
+  /* and without a cache, everything is validated */
+  otrng_profile_cache_resize(&cache, 0);
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(&cache, profiles[1], 0x101));
+  otrng_assert(
+      otrng_profile_cache_client_profile_valid(NULL, profiles[1], 0x101));
+  g_assert_cmpuint(cache.stats.misses, ==, 5);
+  g_assert_cmpuint(cache.stats.hits, ==, 2);
+
+  for (i = 0; i < 3; i++) {
+    otrng_client_profile_free(profiles[i]);
+  }
+  otrng_profile_cache_destroy(&cache);
+}
+
+static void test_profile_cache_prekey_profile() {
+  otrng_profile_cache_s cache;
+  uint8_t sym[ED448_PRIVATE_BYTES] = {0x40};
+  uint8_t other_sym[ED448_PRIVATE_BYTES] = {0x41};
+  otrng_keypair_s *keypair = otrng_keypair_new();
+  otrng_keypair_s *other = otrng_keypair_new();
+  otrng_prekey_profile_s *profile;
+
+  otrng_assert_is_success(otrng_keypair_generate(keypair, sym));
+  otrng_assert_is_success(otrng_keypair_generate(other, other_sym));
+  profile = otrng_prekey_profile_build(0x101, keypair);
+  otrng_assert(profile);
+
+  otrng_profile_cache_init(&cache, 4);
+
+  otrng_assert(otrng_profile_cache_prekey_profile_valid(&cache, profile, 0x101,
+                                                        keypair->pub));
+  otrng_assert(otrng_profile_cache_prekey_profile_valid(&cache, profile, 0x101,
+                                                        keypair->pub));
+  g_assert_cmpuint(cache.stats.hits, ==, 1);
+
+  /* the verdict depends on the key it was checked against */
+  otrng_assert(!otrng_profile_cache_prekey_profile_valid(&cache, profile, 0x101,
+                                                         other->pub));
+  g_assert_cmpuint(cache.stats.misses, ==, 2);
+
+  otrng_prekey_profile_free(profile);
+  otrng_keypair_free(keypair);
+  otrng_keypair_free(other);
+  otrng_profile_cache_destroy(&cache);
+}
+
+void units_profile_cache_add_tests(void) {
+  g_test_add_func("/profile_cache/client_profile",
+                  test_profile_cache_client_profile);
+  g_test_add_func("/profile_cache/checks_expiration",
+                  test_profile_cache_checks_expiration);
+  g_test_add_func("/profile_cache/evicts_least_recently_used",
+                  test_profile_cache_evicts_least_recently_used);
+  g_test_add_func("/profile_cache/prekey_profile",
+                  test_profile_cache_prekey_profile);
+}
@@ -0,0 +1,146 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <pthread.h>
+
+#include "test_helpers.h"
+
+#include "published_index.h"
+
+static int int_matches(const void *item, const void *key) {
+  return *(const int *)item == *(const int *)key;
+}
+
+static uint64_t hash_int(const published_index_s *index, int value) {
+  return otrng_published_index_hash(index, 0, &value, sizeof(int));
+}
+
+static void test_published_index_add_find() {
+  published_index_s index;
+  int values[100];
+  int i, missing = 100;
+
+  otrng_published_index_init(&index);
+  otrng_assert(!otrng_published_index_find(&index, hash_int(&index, missing),
+                                           int_matches, &missing));
+
+  for (i = 0; i < 100; i++) {
+    values[i] = i;
+    otrng_published_index_add(&index, hash_int(&index, i), &values[i]);
+  }
+
+  for (i = 0; i < 100; i++) {
+    otrng_assert(otrng_published_index_find(&index, hash_int(&index, i),
+                                            int_matches, &i) == &values[i]);
+  }
+
+  otrng_assert(!otrng_published_index_find(&index, hash_int(&index, missing),
+                                           int_matches, &missing));
+
+  otrng_published_index_destroy(&index);
+}
+
+static void test_published_index_colliding_hashes() {
+  published_index_s index;
+  int values[40];
+  int i;
+
+  otrng_published_index_init(&index);
+
+  /* Every item lands in the same buckets */
+  for (i = 0; i < 40; i++) {
+    values[i] = i;
+    otrng_published_index_add(&index, 7, &values[i]);
+  }
+
+  for (i = 0; i < 40; i++) {
+    otrng_assert(otrng_published_index_find(&index, 7, int_matches, &i) ==
+                 &values[i]);
+  }
+
+  otrng_published_index_destroy(&index);
+}
+
+#define READER_VALUES 2000
+
+typedef struct reader_s {
+  published_index_s *index;
+  int *values;
+  int found;
+} reader_s;
+
+static void *read_while_growing(void *data) {
+  reader_s *reader = data;
+  int i;
+
+  /* What has been found once is always found again, whatever table it is in
+   * by then */
+  for (i = 0; i < READER_VALUES; i++) {
+    int *found = otrng_published_index_find(
+        reader->index, hash_int(reader->index, i), int_matches, &i);
+
+    if (found) {
+      otrng_assert(found == &reader->values[i]);
+      otrng_assert(otrng_published_index_find(reader->index,
+                                              hash_int(reader->index, i),
+                                              int_matches, &i) == found);
+      reader->found++;
+    }
+  }
+
+  return NULL;
+}
+
+static void test_published_index_find_while_adding() {
+  published_index_s index;
+  int values[READER_VALUES];
+  reader_s reader;
+  pthread_t thread;
+  int i;
+
+  otrng_published_index_init(&index);
+  reader.index = &index;
+  reader.values = values;
+  reader.found = 0;
+
+  otrng_assert(pthread_create(&thread, NULL, read_while_growing, &reader) ==
+               0);
+  for (i = 0; i < READER_VALUES; i++) {
+    values[i] = i;
+    otrng_published_index_add(&index, hash_int(&index, i), &values[i]);
+  }
+  otrng_assert(pthread_join(thread, NULL) == 0);
+
+  g_assert_cmpint(reader.found, <=, READER_VALUES);
+  for (i = 0; i < READER_VALUES; i++) {
+    otrng_assert(otrng_published_index_find(&index, hash_int(&index, i),
+                                            int_matches, &i) == &values[i]);
+  }
+
+  otrng_published_index_destroy(&index);
+}
+
+void units_published_index_add_tests(void) {
+  g_test_add_func("/published_index/add_find", test_published_index_add_find);
+  g_test_add_func("/published_index/colliding_hashes",
+                  test_published_index_colliding_hashes);
+  g_test_add_func("/published_index/find_while_adding",
+                  test_published_index_find_while_adding);
+}
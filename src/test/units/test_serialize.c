@@ -22,6 +22,7 @@
 
 #include "test_helpers.h"
 
+#include "base64.h"
 #include "deserialize.h"
 #include "serialize.h"
 
@@ -222,6 +223,35 @@ static void test_serializes_fingerprint() {
 
 // TODO: ADD test for otrng_serialize_ring_sig
 
+static void test_base64_otr_decode_in_place() {
+  uint8_t data[40];
+  size_t i, len;
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 37 + 11);
+  }
+
+  for (len = 1; len <= sizeof(data); len++) {
+    char *encoded = otrl_base64_otr_encode(data, len);
+    uint8_t *decoded = NULL;
+    size_t decoded_len = 0;
+
+    otrng_assert_is_success(
+        otrng_base64_otr_decode_in_place(&decoded, &decoded_len, encoded));
+    otrng_assert(decoded == (uint8_t *)encoded);
+    g_assert_cmpuint(decoded_len, ==, len);
+    otrng_assert_cmpmem(decoded, data, len);
+
+    free(encoded);
+  }
+
+  char not_encoded[] = "?OTR:AAQD";
+  uint8_t *decoded = NULL;
+  size_t decoded_len = 0;
+  otrng_assert_is_error(
+      otrng_base64_otr_decode_in_place(&decoded, &decoded_len, not_encoded));
+}
+
 void units_serialize_add_tests(void) {
   g_test_add_func("/serialize_and_deserialize/uint", test_ser_deser_uint);
   g_test_add_func("/serialize_and_deserialize/data",
@@ -237,4 +267,6 @@ void units_serialize_add_tests(void) {
                   test_ser_des_otrng_forging_public_key);
   g_test_add_func("/serialize_and_deserialize/ed448-shared-prekey",
                   test_ser_des_otrng_shared_prekey);
+  g_test_add_func("/serialize_and_deserialize/base64-otr-in-place",
+                  test_base64_otr_decode_in_place);
 }
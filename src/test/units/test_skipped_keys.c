@@ -0,0 +1,226 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "test_helpers.h"
+
+#include "skipped_keys.h"
+
+static void generate_point(ec_point point, uint8_t seed) {
+  ecdh_keypair_s ecdh;
+  uint8_t sym[ED448_PRIVATE_BYTES] = {seed};
+
+  otrng_assert_is_success(otrng_ecdh_keypair_generate(&ecdh, sym));
+  otrng_ec_point_copy(point, ecdh.pub);
+  otrng_ecdh_keypair_destroy(&ecdh);
+}
+
+static void test_skipped_keys_add_and_take() {
+  skipped_keys_store_s *store = otrng_skipped_keys_new();
+  uint8_t enc_key[ENC_KEY_BYTES];
+  uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  uint8_t got_enc_key[ENC_KEY_BYTES];
+  uint8_t got_extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  ec_point first, second;
+  uint32_t k;
+
+  generate_point(first, 1);
+  generate_point(second, 2);
+
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 0);
+  otrng_assert_is_error(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, first, 0));
+
+  for (k = 0; k < 100; k++) {
+    memset(enc_key, k, ENC_KEY_BYTES);
+    memset(extra_key, k + 1, EXTRA_SYMMETRIC_KEY_BYTES);
+    otrng_assert_is_success(
+        otrng_skipped_keys_add(store, first, k, enc_key, extra_key, 1000));
+    memset(enc_key, k + 2, ENC_KEY_BYTES);
+    otrng_assert_is_success(
+        otrng_skipped_keys_add(store, second, k, enc_key, extra_key, 1000));
+  }
+
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 200);
+
+  otrng_assert_is_success(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, first, 42));
+  memset(enc_key, 42, ENC_KEY_BYTES);
+  memset(extra_key, 43, EXTRA_SYMMETRIC_KEY_BYTES);
+  otrng_assert_cmpmem(enc_key, got_enc_key, ENC_KEY_BYTES);
+  otrng_assert_cmpmem(extra_key, got_extra_key, EXTRA_SYMMETRIC_KEY_BYTES);
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 199);
+
+  /* Keys can only be retrieved once */
+  otrng_assert_is_error(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, first, 42));
+
+  otrng_assert_is_success(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, second, 42));
+  memset(enc_key, 44, ENC_KEY_BYTES);
+  otrng_assert_cmpmem(enc_key, got_enc_key, ENC_KEY_BYTES);
+
+  otrng_assert_is_error(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, first, 100));
+
+  for (k = 0; k < 100; k++) {
+    if (k == 42) {
+      continue;
+    }
+    otrng_assert_is_success(
+        otrng_skipped_keys_take(got_enc_key, got_extra_key, store, first, k));
+    otrng_assert_is_success(
+        otrng_skipped_keys_take(got_enc_key, got_extra_key, store, second, k));
+  }
+
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 0);
+
+  otrng_ec_point_destroy(first);
+  otrng_ec_point_destroy(second);
+  otrng_skipped_keys_free(store);
+}
+
+static void test_skipped_keys_evicts_oldest() {
+  skipped_keys_store_s *store = otrng_skipped_keys_new();
+  uint8_t enc_key[ENC_KEY_BYTES];
+  uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES] = {0};
+  uint8_t got_enc_key[ENC_KEY_BYTES];
+  uint8_t got_extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  ec_point point;
+  uint32_t k;
+
+  generate_point(point, 1);
+
+  for (k = 0; k < 50; k++) {
+    memset(enc_key, k, ENC_KEY_BYTES);
+    otrng_assert_is_success(
+        otrng_skipped_keys_add(store, point, k, enc_key, extra_key, 20));
+  }
+
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 20);
+
+  otrng_assert_is_error(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, point, 29));
+  otrng_assert_is_success(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, point, 30));
+
+  /* The oldest keys come out first */
+  for (k = 31; k < 50; k++) {
+    otrng_assert_is_success(otrng_skipped_keys_pop_oldest(got_enc_key, store));
+    memset(enc_key, k, ENC_KEY_BYTES);
+    otrng_assert_cmpmem(enc_key, got_enc_key, ENC_KEY_BYTES);
+  }
+
+  otrng_assert_is_error(otrng_skipped_keys_pop_oldest(got_enc_key, store));
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 0);
+
+  otrng_ec_point_destroy(point);
+  otrng_skipped_keys_free(store);
+}
+
+static void test_skipped_keys_add_twice() {
+  skipped_keys_store_s *store = otrng_skipped_keys_new();
+  uint8_t enc_key[ENC_KEY_BYTES] = {1};
+  uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES] = {2};
+  uint8_t got_enc_key[ENC_KEY_BYTES];
+  uint8_t got_extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  ec_point point;
+
+  generate_point(point, 1);
+
+  otrng_assert_is_success(
+      otrng_skipped_keys_add(store, point, 7, enc_key, extra_key, 10));
+  otrng_assert_is_success(
+      otrng_skipped_keys_add(store, point, 7, enc_key, extra_key, 10));
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 1);
+
+  otrng_assert_is_success(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, point, 7));
+  otrng_assert_cmpmem(enc_key, got_enc_key, ENC_KEY_BYTES);
+  otrng_assert_cmpmem(extra_key, got_extra_key, EXTRA_SYMMETRIC_KEY_BYTES);
+
+  otrng_ec_point_destroy(point);
+  otrng_skipped_keys_free(store);
+}
+
+static void test_skipped_keys_get_remove_and_move() {
+  skipped_keys_store_s *store = otrng_skipped_keys_new();
+  skipped_keys_store_s *staged = otrng_skipped_keys_new();
+  uint8_t enc_key[ENC_KEY_BYTES];
+  uint8_t extra_key[EXTRA_SYMMETRIC_KEY_BYTES] = {0};
+  uint8_t got_enc_key[ENC_KEY_BYTES];
+  uint8_t got_extra_key[EXTRA_SYMMETRIC_KEY_BYTES];
+  ec_point point;
+  uint32_t k;
+
+  generate_point(point, 1);
+
+  for (k = 0; k < 4; k++) {
+    memset(enc_key, k, ENC_KEY_BYTES);
+    otrng_assert_is_success(
+        otrng_skipped_keys_add(store, point, k, enc_key, extra_key, 6));
+  }
+
+  /* Looking keys up leaves them in the store */
+  otrng_assert_is_success(
+      otrng_skipped_keys_get(got_enc_key, got_extra_key, store, point, 1));
+  memset(enc_key, 1, ENC_KEY_BYTES);
+  otrng_assert_cmpmem(enc_key, got_enc_key, ENC_KEY_BYTES);
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 4);
+
+  otrng_assert_is_success(otrng_skipped_keys_remove(store, point, 1));
+  otrng_assert_is_error(otrng_skipped_keys_remove(store, point, 1));
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 3);
+
+  for (k = 10; k < 14; k++) {
+    memset(enc_key, k, ENC_KEY_BYTES);
+    otrng_assert_is_success(
+        otrng_skipped_keys_add(staged, point, k, enc_key, extra_key, 6));
+  }
+
+  /* The moved keys are the newest, so the oldest ones make room for them */
+  otrng_assert_is_success(otrng_skipped_keys_move(store, staged, 6));
+  g_assert_cmpint(otrng_skipped_keys_size(staged), ==, 0);
+  g_assert_cmpint(otrng_skipped_keys_size(store), ==, 6);
+
+  otrng_assert_is_error(
+      otrng_skipped_keys_get(got_enc_key, got_extra_key, store, point, 0));
+  otrng_assert_is_success(
+      otrng_skipped_keys_get(got_enc_key, got_extra_key, store, point, 2));
+  otrng_assert_is_success(
+      otrng_skipped_keys_take(got_enc_key, got_extra_key, store, point, 13));
+  memset(enc_key, 13, ENC_KEY_BYTES);
+  otrng_assert_cmpmem(enc_key, got_enc_key, ENC_KEY_BYTES);
+
+  otrng_ec_point_destroy(point);
+  otrng_skipped_keys_free(staged);
+  otrng_skipped_keys_free(store);
+}
+
+void units_skipped_keys_add_tests(void) {
+  g_test_add_func("/skipped_keys/add_and_take",
+                  test_skipped_keys_add_and_take);
+  g_test_add_func("/skipped_keys/evicts_oldest",
+                  test_skipped_keys_evicts_oldest);
+  g_test_add_func("/skipped_keys/add_twice", test_skipped_keys_add_twice);
+  g_test_add_func("/skipped_keys/get_remove_and_move",
+                  test_skipped_keys_get_remove_and_move);
+}
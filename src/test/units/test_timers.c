@@ -0,0 +1,250 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "timers.h"
+
+typedef struct expired_s {
+  time_t order[64];
+  size_t count;
+} expired_s;
+
+static expired_s expired;
+
+static void record_expired(otrng_timer_s *timer, time_t now) {
+  (void)now;
+  expired.order[expired.count++] = timer->deadline;
+}
+
+static void test_timers_expire_in_order() {
+  otrng_timers_s timers;
+  otrng_timer_s timer[64];
+  time_t deadline;
+  size_t i;
+
+  memset(&expired, 0, sizeof(expired));
+  otrng_timers_init(&timers);
+  otrng_assert(!otrng_timers_next_deadline(&deadline, &timers));
+
+  /* More than the initial capacity, in no particular order */
+  for (i = 0; i < 64; i++) {
+    otrng_timer_init(&timer[i], record_expired, NULL, NULL);
+    otrng_timer_schedule(&timers, &timer[i], (time_t)(1000 + (i * 37) % 64));
+  }
+
+  otrng_assert(otrng_timers_next_deadline(&deadline, &timers));
+  g_assert_cmpint(deadline, ==, 1000);
+
+  g_assert_cmpint(otrng_timers_expire(&timers, 999), ==, 0);
+  g_assert_cmpint(otrng_timers_expire(&timers, 1031), ==, 32);
+  g_assert_cmpint(otrng_timers_expire(&timers, 2000), ==, 32);
+
+  g_assert_cmpint(expired.count, ==, 64);
+  for (i = 0; i < 64; i++) {
+    g_assert_cmpint(expired.order[i], ==, 1000 + i);
+    otrng_assert(!otrng_timer_is_scheduled(&timer[i]));
+  }
+
+  otrng_assert(!otrng_timers_next_deadline(&deadline, &timers));
+  otrng_timers_destroy(&timers);
+}
+
+static void test_timers_reschedule_and_cancel() {
+  otrng_timers_s timers;
+  otrng_timer_s a, b, c;
+  time_t deadline;
+
+  memset(&expired, 0, sizeof(expired));
+  otrng_timers_init(&timers);
+  otrng_timer_init(&a, record_expired, NULL, NULL);
+  otrng_timer_init(&b, record_expired, NULL, NULL);
+  otrng_timer_init(&c, record_expired, NULL, NULL);
+
+  otrng_timer_schedule(&timers, &a, 10);
+  otrng_timer_schedule(&timers, &b, 20);
+  otrng_timer_schedule(&timers, &c, 30);
+
+  /* Later, then earlier */
+  otrng_timer_schedule(&timers, &a, 40);
+  otrng_assert(otrng_timers_next_deadline(&deadline, &timers));
+  g_assert_cmpint(deadline, ==, 20);
+
+  otrng_timer_schedule(&timers, &c, 5);
+  otrng_assert(otrng_timers_next_deadline(&deadline, &timers));
+  g_assert_cmpint(deadline, ==, 5);
+  g_assert_cmpint(timers.count, ==, 3);
+
+  otrng_timer_cancel(&c);
+  otrng_assert(!otrng_timer_is_scheduled(&c));
+  otrng_timer_cancel(&c);
+  otrng_assert(otrng_timers_next_deadline(&deadline, &timers));
+  g_assert_cmpint(deadline, ==, 20);
+
+  g_assert_cmpint(otrng_timers_expire(&timers, 100), ==, 2);
+  g_assert_cmpint(expired.count, ==, 2);
+  g_assert_cmpint(expired.order[0], ==, 20);
+  g_assert_cmpint(expired.order[1], ==, 40);
+
+  otrng_timers_destroy(&timers);
+}
+
+static void reschedule_once(otrng_timer_s *timer, time_t now) {
+  otrng_timers_s *timers = timer->data;
+
+  record_expired(timer, now);
+  if (expired.count == 1) {
+    otrng_timer_schedule(timers, timer, now + 10);
+  }
+}
+
+static void test_timers_reschedule_when_expired() {
+  otrng_timers_s timers;
+  otrng_timer_s timer;
+
+  memset(&expired, 0, sizeof(expired));
+  otrng_timers_init(&timers);
+  otrng_timer_init(&timer, reschedule_once, &timers, NULL);
+  otrng_timer_schedule(&timers, &timer, 10);
+
+  g_assert_cmpint(otrng_timers_expire(&timers, 15), ==, 1);
+  otrng_assert(otrng_timer_is_scheduled(&timer));
+  g_assert_cmpint(timer.deadline, ==, 25);
+
+  g_assert_cmpint(otrng_timers_expire(&timers, 25), ==, 1);
+  otrng_assert(!otrng_timer_is_scheduled(&timer));
+  g_assert_cmpint(expired.count, ==, 2);
+
+  otrng_timers_destroy(&timers);
+}
+
+static void test_timers_destroy_unschedules() {
+  otrng_timers_s timers;
+  otrng_timer_s timer;
+
+  otrng_timers_init(&timers);
+  otrng_timer_init(&timer, NULL, NULL, NULL);
+  otrng_timer_schedule(&timers, &timer, 10);
+  otrng_timers_destroy(&timers);
+
+  otrng_assert(!otrng_timer_is_scheduled(&timer));
+  /* Cancelling it afterwards does not touch the freed heap */
+  otrng_timer_cancel(&timer);
+}
+
+#define OWNERS 4
+#define OWNER_TIMERS 8
+#define OWNER_ROUNDS 2000
+
+typedef struct owner_s {
+  pthread_mutex_t lock;
+  otrng_timers_s *timers;
+  otrng_timer_s timer[OWNER_TIMERS];
+  /* only touched with the lock held, so the sanitizer sees a race if a timer
+   * is fired without it */
+  size_t fired;
+} owner_s;
+
+static void count_fired(otrng_timer_s *timer, time_t now) {
+  owner_s *owner = timer->data;
+
+  (void)now;
+  owner->fired++;
+}
+
+static void *schedule_and_cancel(void *data) {
+  owner_s *owner = data;
+  unsigned int seed = (unsigned int)(size_t)owner;
+  int round;
+
+  for (round = 0; round < OWNER_ROUNDS; round++) {
+    otrng_timer_s *timer = &owner->timer[rand_r(&seed) % OWNER_TIMERS];
+
+    pthread_mutex_lock(&owner->lock);
+    if (rand_r(&seed) % 3 == 0) {
+      otrng_timer_cancel(timer);
+    } else {
+      otrng_timer_schedule(owner->timers, timer, rand_r(&seed) % 4);
+    }
+    pthread_mutex_unlock(&owner->lock);
+  }
+
+  return NULL;
+}
+
+static void test_timers_expire_while_owners_schedule() {
+  otrng_timers_s timers;
+  owner_s owner[OWNERS];
+  pthread_t thread[OWNERS];
+  size_t fired = 0, expired_count = 0;
+  int i, j;
+
+  otrng_timers_init(&timers);
+  for (i = 0; i < OWNERS; i++) {
+    pthread_mutex_init(&owner[i].lock, NULL);
+    owner[i].timers = &timers;
+    owner[i].fired = 0;
+    for (j = 0; j < OWNER_TIMERS; j++) {
+      otrng_timer_init(&owner[i].timer[j], count_fired, &owner[i],
+                       &owner[i].lock);
+    }
+  }
+
+  for (i = 0; i < OWNERS; i++) {
+    otrng_assert(pthread_create(&thread[i], NULL, schedule_and_cancel,
+                                &owner[i]) == 0);
+  }
+
+  for (i = 0; i < OWNER_ROUNDS; i++) {
+    expired_count += otrng_timers_expire(&timers, 1);
+  }
+
+  for (i = 0; i < OWNERS; i++) {
+    otrng_assert(pthread_join(thread[i], NULL) == 0);
+  }
+  expired_count += otrng_timers_expire(&timers, 10);
+
+  for (i = 0; i < OWNERS; i++) {
+    fired += owner[i].fired;
+    for (j = 0; j < OWNER_TIMERS; j++) {
+      otrng_assert(!otrng_timer_is_scheduled(&owner[i].timer[j]));
+    }
+    pthread_mutex_destroy(&owner[i].lock);
+  }
+  g_assert_cmpint(fired, ==, expired_count);
+
+  otrng_timers_destroy(&timers);
+}
+
+void units_timers_add_tests(void) {
+  g_test_add_func("/timers/expire_in_order", test_timers_expire_in_order);
+  g_test_add_func("/timers/reschedule_and_cancel",
+                  test_timers_reschedule_and_cancel);
+  g_test_add_func("/timers/reschedule_when_expired",
+                  test_timers_reschedule_when_expired);
+  g_test_add_func("/timers/destroy_unschedules",
+                  test_timers_destroy_unschedules);
+  g_test_add_func("/timers/expire_while_owners_schedule",
+                  test_timers_expire_while_owners_schedule);
+}
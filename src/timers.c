@@ -0,0 +1,276 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "alloc.h"
+#include "timers.h"
+
+#define TIMERS_MIN_CAPACITY 16
+
+INTERNAL void otrng_timers_init(otrng_timers_s *timers) {
+  memset(timers, 0, sizeof(otrng_timers_s));
+  (void)pthread_mutex_init(&timers->lock, NULL);
+}
+
+INTERNAL void otrng_timers_destroy(otrng_timers_s *timers) {
+  size_t i;
+
+  for (i = 0; i < timers->count; i++) {
+    timers->heap[i]->position = 0;
+    timers->heap[i]->timers = NULL;
+  }
+
+  otrng_free(timers->heap);
+  timers->heap = NULL;
+  timers->count = 0;
+  timers->capacity = 0;
+
+  (void)pthread_mutex_destroy(&timers->lock);
+}
+
+INTERNAL void otrng_timer_init(otrng_timer_s *timer,
+                               void (*expire)(otrng_timer_s *timer,
+                                              time_t now),
+                               void *data, pthread_mutex_t *owner_lock) {
+  memset(timer, 0, sizeof(otrng_timer_s));
+  timer->expire = expire;
+  timer->data = data;
+  timer->owner_lock = owner_lock;
+}
+
+static void place(otrng_timers_s *timers, otrng_timer_s *timer, size_t i) {
+  timers->heap[i] = timer;
+  timer->position = i + 1;
+}
+
+static void sift_up(otrng_timers_s *timers, size_t i) {
+  otrng_timer_s *timer = timers->heap[i];
+
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+
+    if (timers->heap[parent]->deadline <= timer->deadline) {
+      break;
+    }
+
+    place(timers, timers->heap[parent], i);
+    i = parent;
+  }
+
+  place(timers, timer, i);
+}
+
+static void sift_down(otrng_timers_s *timers, size_t i) {
+  otrng_timer_s *timer = timers->heap[i];
+
+  for (;;) {
+    size_t child = 2 * i + 1;
+
+    if (child >= timers->count) {
+      break;
+    }
+
+    if (child + 1 < timers->count &&
+        timers->heap[child + 1]->deadline < timers->heap[child]->deadline) {
+      child++;
+    }
+
+    if (timer->deadline <= timers->heap[child]->deadline) {
+      break;
+    }
+
+    place(timers, timers->heap[child], i);
+    i = child;
+  }
+
+  place(timers, timer, i);
+}
+
+static void remove_at(otrng_timers_s *timers, size_t i) {
+  otrng_timer_s *last;
+
+  timers->heap[i]->position = 0;
+  timers->heap[i]->timers = NULL;
+
+  timers->count--;
+  if (i == timers->count) {
+    return;
+  }
+
+  /* The last timer takes the place of the removed one, and goes up or down
+   * from there */
+  last = timers->heap[timers->count];
+  place(timers, last, i);
+  if (i > 0 && timers->heap[(i - 1) / 2]->deadline > last->deadline) {
+    sift_up(timers, i);
+  } else {
+    sift_down(timers, i);
+  }
+}
+
+static void cancel_locked(otrng_timer_s *timer) {
+  if (timer->position == 0) {
+    return;
+  }
+
+  remove_at(timer->timers, timer->position - 1);
+}
+
+INTERNAL void otrng_timer_schedule(otrng_timers_s *timers,
+                                   otrng_timer_s *timer, time_t deadline) {
+  if (timer->timers && timer->timers != timers) {
+    otrng_timer_cancel(timer);
+  }
+
+  (void)pthread_mutex_lock(&timers->lock);
+
+  if (timer->position != 0) {
+    time_t previous = timer->deadline;
+
+    timer->deadline = deadline;
+    if (deadline < previous) {
+      sift_up(timers, timer->position - 1);
+    } else {
+      sift_down(timers, timer->position - 1);
+    }
+
+    (void)pthread_mutex_unlock(&timers->lock);
+    return;
+  }
+
+  if (timers->count == timers->capacity) {
+    size_t capacity = timers->capacity ? timers->capacity * 2
+                                       : TIMERS_MIN_CAPACITY;
+
+    timers->heap =
+        otrng_xrealloc(timers->heap, capacity * sizeof(otrng_timer_s *));
+    timers->capacity = capacity;
+  }
+
+  timer->deadline = deadline;
+  timer->timers = timers;
+  timers->heap[timers->count] = timer;
+  timers->count++;
+  sift_up(timers, timers->count - 1);
+
+  (void)pthread_mutex_unlock(&timers->lock);
+}
+
+INTERNAL void otrng_timer_cancel(otrng_timer_s *timer) {
+  /* Only the owner of the timer sets this, and it holds its lock */
+  otrng_timers_s *timers = timer->timers;
+
+  if (!timers) {
+    return;
+  }
+
+  (void)pthread_mutex_lock(&timers->lock);
+  cancel_locked(timer);
+  (void)pthread_mutex_unlock(&timers->lock);
+}
+
+INTERNAL otrng_bool otrng_timer_is_scheduled(const otrng_timer_s *timer) {
+  return timer->timers != NULL;
+}
+
+INTERNAL otrng_bool otrng_timers_next_deadline(time_t *deadline,
+                                               const otrng_timers_s *timers) {
+  /* The lock is not part of the value of the timers */
+  pthread_mutex_t *lock = (pthread_mutex_t *)&timers->lock;
+  otrng_bool found = otrng_false;
+
+  (void)pthread_mutex_lock(lock);
+  if (timers->count > 0) {
+    *deadline = timers->heap[0]->deadline;
+    found = otrng_true;
+  }
+  (void)pthread_mutex_unlock(lock);
+
+  return found;
+}
+
+/* Takes the owner lock of the earliest timer if it is due, and removes it
+ * from the heap. The owner lock can not be taken while holding the heap lock,
+ * so the heap is looked at again once it is held. */
+static otrng_timer_s *take_due(otrng_timers_s *timers, time_t now) {
+  for (;;) {
+    otrng_timer_s *timer;
+    pthread_mutex_t *owner_lock;
+
+    (void)pthread_mutex_lock(&timers->lock);
+    if (timers->count == 0 || timers->heap[0]->deadline > now) {
+      (void)pthread_mutex_unlock(&timers->lock);
+      return NULL;
+    }
+
+    timer = timers->heap[0];
+    owner_lock = timer->owner_lock;
+    if (!owner_lock) {
+      remove_at(timers, 0);
+      (void)pthread_mutex_unlock(&timers->lock);
+      return timer;
+    }
+
+    if (pthread_mutex_trylock(owner_lock) == 0) {
+      remove_at(timers, 0);
+      (void)pthread_mutex_unlock(&timers->lock);
+      return timer;
+    }
+    (void)pthread_mutex_unlock(&timers->lock);
+
+    /* The owner is busy: wait for it, and check it still has the earliest
+     * timer, as it could have been cancelled in the meantime */
+    (void)pthread_mutex_lock(owner_lock);
+    (void)pthread_mutex_lock(&timers->lock);
+    if (timers->count > 0 && timers->heap[0]->deadline <= now &&
+        timers->heap[0]->owner_lock == owner_lock) {
+      timer = timers->heap[0];
+      remove_at(timers, 0);
+      (void)pthread_mutex_unlock(&timers->lock);
+      return timer;
+    }
+    (void)pthread_mutex_unlock(&timers->lock);
+    (void)pthread_mutex_unlock(owner_lock);
+  }
+}
+
+INTERNAL size_t otrng_timers_expire(otrng_timers_s *timers, time_t now) {
+  size_t expired = 0;
+
+  otrng_timer_s *timer;
+
+  while ((timer = take_due(timers, now)) != NULL) {
+    pthread_mutex_t *owner_lock = timer->owner_lock;
+
+    expired++;
+
+    /* This may free the object the timer lives in */
+    if (timer->expire) {
+      timer->expire(timer, now);
+    }
+
+    if (owner_lock) {
+      (void)pthread_mutex_unlock(owner_lock);
+    }
+  }
+
+  return expired;
+}
@@ -0,0 +1,150 @@
+/*
+ *  This file is part of the Off-the-Record Next Generation Messaging
+ *  library (libotr-ng).
+ *
+ *  Copyright (C) 2016-2019, the libotr-ng contributors.
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The heap of timers is shared by all the clients of a global state, and is
+ * guarded by its own lock. A timer is only scheduled or cancelled while
+ * holding the lock of its owner (the client it belongs to), and it is fired
+ * with that lock held. The owner lock is always taken before the heap lock.
+ */
+
+#ifndef OTRNG_TIMERS_H
+#define OTRNG_TIMERS_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "error.h"
+#include "shared.h"
+
+struct otrng_timers_s;
+
+/* A deadline registered by some object (a conversation, a fragment store, a
+   prekey request). The timer lives in the object, so scheduling it again or
+   cancelling it does not allocate. */
+typedef struct otrng_timer_s {
+  time_t deadline;
+
+  /* where the timer is in the heap, plus one, or 0 if it is not scheduled */
+  size_t position;
+  /*@null@*/ struct otrng_timers_s *timers;
+
+  /* Called once the deadline has passed, after the timer was removed from
+     the heap. It may schedule the timer again, but for a later time. */
+  void (*expire)(struct otrng_timer_s *timer, time_t now);
+  /*@null@*/ void *data;
+
+  /* held while the timer is scheduled, cancelled or fired */
+  /*@null@*/ pthread_mutex_t *owner_lock;
+} otrng_timer_s;
+
+/*
+ * The scheduled timers, in a binary min-heap by deadline. Finding the next
+ * deadline is O(1), and scheduling, cancelling or expiring a timer is
+ * O(log n), so expiring what is due does not depend on how many objects are
+ * waiting.
+ */
+typedef struct otrng_timers_s {
+  /*@null@*/ otrng_timer_s **heap;
+  size_t count;
+  size_t capacity;
+
+  pthread_mutex_t lock;
+} otrng_timers_s;
+
+/**
+ * @brief Initializes an empty set of timers.
+ *
+ * @param [timers]  The timers.
+ */
+INTERNAL void otrng_timers_init(otrng_timers_s *timers);
+
+/**
+ * @brief Cancels all the timers and frees the heap.
+ *
+ * @param [timers]  The timers.
+ */
+INTERNAL void otrng_timers_destroy(otrng_timers_s *timers);
+
+/**
+ * @brief Initializes a timer that is not scheduled.
+ *
+ * @param [timer]   The timer.
+ * @param [expire]  What to do when the deadline passes.
+ * @param [data]    Passed along with the timer to [expire].
+ * @param [owner_lock]  The lock of the object the timer belongs to, which is
+ *                      taken to fire it. It may be NULL.
+ */
+INTERNAL void otrng_timer_init(otrng_timer_s *timer,
+                               void (*expire)(otrng_timer_s *timer,
+                                              time_t now),
+                               /*@null@*/ void *data,
+                               /*@null@*/ pthread_mutex_t *owner_lock);
+
+/**
+ * @brief Schedules the timer for [deadline]. If it was already scheduled, it
+ * is moved to the new deadline.
+ *
+ * @param [timers]    The timers.
+ * @param [timer]     The timer.
+ * @param [deadline]  When the timer expires.
+ */
+INTERNAL void otrng_timer_schedule(otrng_timers_s *timers,
+                                   otrng_timer_s *timer, time_t deadline);
+
+/**
+ * @brief Removes the timer from the heap it is scheduled in, if any.
+ *
+ * @param [timer]   The timer.
+ */
+INTERNAL void otrng_timer_cancel(otrng_timer_s *timer);
+
+/**
+ * @brief Tells if the timer is scheduled.
+ *
+ * @param [timer]   The timer.
+ */
+INTERNAL otrng_bool otrng_timer_is_scheduled(const otrng_timer_s *timer);
+
+/**
+ * @brief Finds the earliest deadline.
+ *
+ * @param [deadline]  Where the deadline will be written to.
+ * @param [timers]    The timers.
+ *
+ * @return otrng_false if no timer is scheduled.
+ */
+INTERNAL otrng_bool otrng_timers_next_deadline(time_t *deadline,
+                                               const otrng_timers_s *timers);
+
+/**
+ * @brief Removes the timers whose deadline is not after [now], and calls
+ * their expire function, earliest first. Each one is fired holding its owner
+ * lock, and none of the timers lock.
+ *
+ * @param [timers]  The timers.
+ * @param [now]     The current time.
+ *
+ * @return The number of timers that expired.
+ */
+INTERNAL size_t otrng_timers_expire(otrng_timers_s *timers, time_t now);
+
+#endif
@@ -41,6 +41,7 @@ tstatic void create_instag_cb_v3(const otrng_s *conv) {
 
   otrng_client_callbacks_create_instag(conv->client->global_state->callbacks,
                                        conv->client);
+  otrng_client_refresh_instance_tag(conv->client);
 }
 
 tstatic void gone_secure_cb_v3(const otrng_s *conv) {
@@ -663,11 +664,13 @@ INTERNAL otrng_result otrng_v3_send_message(char **new_msg, const char *msg,
     return OTRNG_ERROR;
   }
 
+  otrng_global_state_lock_v3(conn->client->global_state);
   err = otrl_message_sending(
       conn->client->global_state->user_state_v3, conn->ops, conn->opdata,
       conn->client->client_id.account, conn->client->client_id.protocol,
       conn->peer, OTRL_INSTAG_RECENT, msg, tlvsv3, new_msg,
       OTRL_FRAGMENT_SEND_SKIP, &conn->ctx, NULL, NULL);
+  otrng_global_state_unlock_v3(conn->client->global_state);
 
   if (!err) {
     return OTRNG_SUCCESS;
@@ -693,10 +696,12 @@ INTERNAL otrng_result otrng_v3_receive_message(char **to_send,
     return OTRNG_ERROR;
   }
 
+  otrng_global_state_lock_v3(conn->client->global_state);
   ignore_msg = otrl_message_receiving(
       conn->client->global_state->user_state_v3, conn->ops, conn->opdata,
       conn->client->client_id.account, conn->client->client_id.protocol,
       conn->peer, msg, &new_msg, &tlvs_v3, &conn->ctx, NULL, NULL);
+  otrng_global_state_unlock_v3(conn->client->global_state);
 
   (void)ignore_msg;
 
@@ -734,10 +739,12 @@ INTERNAL otrng_result otrng_v3_close(char **to_send, otrng_v3_conn_s *conn) {
   // TODO: @client there is also: otrl_message_disconnect, which only
   // disconnects one instance
 
+  otrng_global_state_lock_v3(conn->client->global_state);
   otrl_message_disconnect_all_instances(
       conn->client->global_state->user_state_v3, conn->ops, conn->opdata,
       conn->client->client_id.account, conn->client->client_id.protocol,
       conn->peer);
+  otrng_global_state_unlock_v3(conn->client->global_state);
 
   *to_send = otrng_v3_retrieve_injected_message(conn);
 
@@ -747,9 +754,11 @@ INTERNAL otrng_result otrng_v3_close(char **to_send, otrng_v3_conn_s *conn) {
 INTERNAL otrng_result otrng_v3_send_symkey_message(
     char **to_send, otrng_v3_conn_s *conn, unsigned int use,
     const unsigned char *usedata, size_t usedatalen, unsigned char *extra_key) {
+  otrng_global_state_lock_v3(conn->client->global_state);
   otrl_message_symkey(conn->client->global_state->user_state_v3, conn->ops,
                       conn->opdata, conn->ctx, use, usedata, usedatalen,
                       extra_key);
+  otrng_global_state_unlock_v3(conn->client->global_state);
 
   *to_send = otrng_v3_retrieve_injected_message(conn);
   return OTRNG_SUCCESS;
@@ -767,6 +776,7 @@ INTERNAL otrng_result otrng_v3_smp_start(char **to_send,
     q[q_len] = 0;
   }
 
+  otrng_global_state_lock_v3(conn->client->global_state);
   if (question) {
     otrl_message_initiate_smp_q(conn->client->global_state->user_state_v3,
                                 conn->ops, conn->opdata, conn->ctx, q, secret,
@@ -776,6 +786,7 @@ INTERNAL otrng_result otrng_v3_smp_start(char **to_send,
                               conn->ops, conn->opdata, conn->ctx, secret,
                               secretlen);
   }
+  otrng_global_state_unlock_v3(conn->client->global_state);
 
   *to_send = otrng_v3_retrieve_injected_message(conn);
   return OTRNG_SUCCESS;
@@ -785,16 +796,20 @@ INTERNAL otrng_result otrng_v3_smp_continue(char **to_send,
                                             const uint8_t *secret,
                                             const size_t secretlen,
                                             otrng_v3_conn_s *conn) {
+  otrng_global_state_lock_v3(conn->client->global_state);
   otrl_message_respond_smp(conn->client->global_state->user_state_v3, conn->ops,
                            conn->opdata, conn->ctx, secret, secretlen);
+  otrng_global_state_unlock_v3(conn->client->global_state);
 
   *to_send = otrng_v3_retrieve_injected_message(conn);
   return OTRNG_SUCCESS;
 }
 
 INTERNAL otrng_result otrng_v3_smp_abort(otrng_v3_conn_s *conn) {
+  otrng_global_state_lock_v3(conn->client->global_state);
   otrl_message_abort_smp(conn->client->global_state->user_state_v3, conn->ops,
                          conn->opdata, conn->ctx);
+  otrng_global_state_unlock_v3(conn->client->global_state);
   return OTRNG_SUCCESS;
 }
 